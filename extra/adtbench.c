@@ -0,0 +1,549 @@
+/*
+	ADT depacker benchmark: pack data, then compare previous decoder
+	with buffer and surface decoders
+
+	Build with:
+	gcc -O2 -o adtbench adtbench.c `sdl-config --cflags --libs`
+
+	Usage: adtbench [file [loops]]
+	Without file, pack a random RE2 background: 256x256 then 128x128
+	15 bits pixels.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#define ENABLE_ADT_REFERENCE 1
+#include "../src/g_re2/adt.c"
+
+#include "bench_file.h"
+
+#define DEFAULT_LOOPS	50
+
+#define PACK_HASH_BITS	14
+#define PACK_MAX_CHAIN	32
+#define PACK_MIN_MATCH	3
+#define PACK_MAX_MATCH	258
+#define PACK_MAX_OFFSET	(ADT_WINDOW_SIZE-1)
+#define PACK_BLOCK_SYMBOLS	16384
+#define PACK_MAX_BITS	15	/* Length changes of array 2 must fit in 16 symbols */
+
+#define BACKGROUND_LENGTH	((256*256+128*128)*2)
+
+/* LZ77 token: literal byte, or match of length at offset */
+typedef struct {
+	Uint16 symbol;	/* Array 2 symbol */
+	Uint16 offset;
+} pack_token_t;
+
+/* Random image, with smooth gradients and noise like a background */
+
+static Uint8 *randomImage(int *length)
+{
+	Uint8 *buffer;
+	int i;
+
+	*length = BACKGROUND_LENGTH;
+	buffer = (Uint8 *) malloc(*length);
+	if (buffer==NULL) {
+		return NULL;
+	}
+
+	for (i=0; i<*length>>1; i++) {
+		int x = (i<256*256 ? i & 255 : 256+(i & 127));
+		int y = (i<256*256 ? i>>8 : (i-256*256)>>7);
+		int r = (x>>3) & 31;
+		int g = (y>>3) & 31;
+		int b = ((x+y)>>4) & 31;
+		Uint16 color;
+
+		if ((rand() & 7) == 0) {
+			r ^= 1;
+		}
+		color = (b<<10)|(g<<5)|r;
+		buffer[i*2] = color & 0xff;
+		buffer[i*2+1] = color>>8;
+	}
+
+	return buffer;
+}
+
+/* Write num_bits code, MSB first */
+
+static void writeCode(Uint8 *dst, int *bitpos, int code, int num_bits)
+{
+	int i;
+
+	for (i=num_bits-1; i>=0; i--) {
+		if (code & (1<<i)) {
+			dst[*bitpos>>3] |= 0x80>>(*bitpos & 7);
+		}
+		(*bitpos)++;
+	}
+}
+
+/* Number of 0 bits, a 1 bit, then value without its highest bit */
+
+static void writeBitfield(Uint8 *dst, int *bitpos, int value)
+{
+	int num_bits = 0;
+
+	while (value >= (2<<num_bits)) {
+		num_bits++;
+	}
+
+	writeCode(dst, bitpos, 1, num_bits+1);
+	writeCode(dst, bitpos, value & ((1<<num_bits)-1), num_bits);
+}
+
+/* Huffman code lengths from frequencies, up to max_bits */
+
+static void buildLengths(const int *freq, int num_symbols, int max_bits, int *length)
+{
+	int weight[ADT_MAX_SYMBOLS*2], parent[ADT_MAX_SYMBOLS*2];
+	int scale = 0;
+
+	for (;;) {
+		int num_nodes = num_symbols, num_used = 0, max_length = 0;
+		int i;
+
+		for (i=0; i<num_symbols; i++) {
+			weight[i] = (freq[i] ? (freq[i]>>scale)+1 : 0);
+			parent[i] = -1;
+			if (freq[i]) {
+				num_used++;
+			}
+		}
+
+		memset(length, 0, num_symbols*sizeof(int));
+		if (num_used <= 1) {
+			for (i=0; i<num_symbols; i++) {
+				if (freq[i]) {
+					length[i] = 1;
+				}
+			}
+			return;
+		}
+
+		/* Merge 2 lightest nodes, until only root is left */
+		while (--num_used > 0) {
+			int min1 = -1, min2 = -1;
+
+			for (i=0; i<num_nodes; i++) {
+				if ((weight[i]==0) || (parent[i]>=0)) {
+					continue;
+				}
+				if ((min1<0) || (weight[i]<weight[min1])) {
+					min2 = min1;
+					min1 = i;
+				} else if ((min2<0) || (weight[i]<weight[min2])) {
+					min2 = i;
+				}
+			}
+
+			weight[num_nodes] = weight[min1] + weight[min2];
+			parent[num_nodes] = -1;
+			parent[min1] = parent[min2] = num_nodes++;
+		}
+
+		for (i=0; i<num_symbols; i++) {
+			int node;
+
+			if (!freq[i]) {
+				continue;
+			}
+			for (node=i; parent[node]>=0; node=parent[node]) {
+				length[i]++;
+			}
+			if (length[i] > max_length) {
+				max_length = length[i];
+			}
+		}
+
+		if (max_length <= max_bits) {
+			return;
+		}
+
+		/* Too long, retry with flatter frequencies */
+		scale++;
+	}
+}
+
+/* Canonical codes from lengths, same order as decoder */
+
+static void buildCodes(const int *length, int num_symbols, int *code)
+{
+	int start[ADT_MAX_BITS+2], count[ADT_MAX_BITS+2];
+	int i;
+
+	memset(count, 0, sizeof(count));
+	for (i=0; i<num_symbols; i++) {
+		count[length[i]]++;
+	}
+
+	start[1] = 0;
+	for (i=1; i<=ADT_MAX_BITS; i++) {
+		start[i+1] = (start[i] + count[i])<<1;
+	}
+
+	for (i=0; i<num_symbols; i++) {
+		if (length[i]) {
+			code[i] = start[length[i]]++;
+		}
+	}
+}
+
+/* Lengths of array 1 and 3: same as previous, or changed bits */
+
+static void writeLengths(Uint8 *dst, int *bitpos, const int *length, int num_symbols)
+{
+	int i, prevValue = 0;
+
+	for (i=0; i<num_symbols; i++) {
+		if (length[i] == prevValue) {
+			writeCode(dst, bitpos, 0, 1);
+		} else {
+			writeCode(dst, bitpos, 1, 1);
+			writeBitfield(dst, bitpos, length[i] ^ prevValue);
+			prevValue = length[i];
+		}
+	}
+}
+
+/* Distance symbol of array 3, and its extra bits */
+
+static int distanceSymbol(int distance)
+{
+	int symbol = 0;
+
+	while (distance >= (1<<symbol)) {
+		symbol++;
+	}
+
+	return symbol;
+}
+
+/* Find longest matches with hash chains */
+
+static pack_token_t *findMatches(const Uint8 *src, int srcLength, int *numTokens)
+{
+	pack_token_t *tokens;
+	int *head, *prev;
+	int pos = 0, num = 0;
+
+	tokens = (pack_token_t *) malloc(srcLength * sizeof(pack_token_t));
+	head = (int *) malloc((1<<PACK_HASH_BITS) * sizeof(int));
+	prev = (int *) malloc(srcLength * sizeof(int));
+	if (!tokens || !head || !prev) {
+		free(tokens);
+		free(head);
+		free(prev);
+		return NULL;
+	}
+
+	memset(head, -1, (1<<PACK_HASH_BITS) * sizeof(int));
+
+	while (pos < srcLength) {
+		int best_length = 0, best_offset = 0, hash = 0, i;
+
+		if (pos+PACK_MIN_MATCH <= srcLength) {
+			int chain = PACK_MAX_CHAIN, cand;
+
+			hash = ((src[pos]<<8) ^ (src[pos+1]<<4) ^ src[pos+2]) & ((1<<PACK_HASH_BITS)-1);
+			for (cand=head[hash]; (cand>=0) && (pos-cand<=PACK_MAX_OFFSET) && chain--; cand=prev[cand]) {
+				int max_length = srcLength-pos, length = 0;
+
+				if (max_length > PACK_MAX_MATCH) {
+					max_length = PACK_MAX_MATCH;
+				}
+				while ((length<max_length) && (src[cand+length]==src[pos+length])) {
+					length++;
+				}
+				if (length > best_length) {
+					best_length = length;
+					best_offset = pos-cand;
+				}
+			}
+		}
+
+		if (best_length >= PACK_MIN_MATCH) {
+			tokens[num].symbol = best_length + 0xfd;
+			tokens[num++].offset = best_offset;
+		} else {
+			best_length = 1;
+			tokens[num].symbol = src[pos];
+			tokens[num++].offset = 0;
+		}
+
+		/* Insert all positions of token in hash chains */
+		for (i=0; i<best_length; i++, pos++) {
+			if (pos+PACK_MIN_MATCH > srcLength) {
+				continue;
+			}
+			hash = ((src[pos]<<8) ^ (src[pos+1]<<4) ^ src[pos+2]) & ((1<<PACK_HASH_BITS)-1);
+			prev[pos] = head[hash];
+			head[hash] = pos;
+		}
+	}
+
+	free(head);
+	free(prev);
+
+	*numTokens = num;
+	return tokens;
+}
+
+/* LZ77 and Huffman packer, using same blocks as ADT files */
+
+static Uint8 *packData(const Uint8 *src, int srcLength, int *dstLength)
+{
+	pack_token_t *tokens;
+	Uint8 *dst;
+	int bitpos = 4*8, num_tokens, first, i;
+
+	tokens = findMatches(src, srcLength, &num_tokens);
+	if (!tokens) {
+		return NULL;
+	}
+
+	/* Each byte needs at most 15 bits, plus 3 tables per block */
+	dst = (Uint8 *) calloc(srcLength*2 + (num_tokens/PACK_BLOCK_SYMBOLS+1)*2048 + 16, 1);
+	if (!dst) {
+		free(tokens);
+		return NULL;
+	}
+
+	/* 4 bytes header, skipped by decoders */
+	for (first=0; first<num_tokens; first+=PACK_BLOCK_SYMBOLS) {
+		int freq1[16], freq2[ADT_MAX_SYMBOLS], freq3[16];
+		int length1[16], length2[ADT_MAX_SYMBOLS], length3[16];
+		int code1[16], code2[ADT_MAX_SYMBOLS], code3[16];
+		int block_length = num_tokens-first, prevValue, j;
+
+		if (block_length > PACK_BLOCK_SYMBOLS) {
+			block_length = PACK_BLOCK_SYMBOLS;
+		}
+
+		/* Arrays 2 and 3 from tokens */
+		memset(freq2, 0, sizeof(freq2));
+		memset(freq3, 0, sizeof(freq3));
+		for (i=first; i<first+block_length; i++) {
+			freq2[tokens[i].symbol]++;
+			if (tokens[i].symbol >= 256) {
+				freq3[distanceSymbol(tokens[i].offset-1)]++;
+			}
+		}
+		buildLengths(freq2, ADT_MAX_SYMBOLS, PACK_MAX_BITS, length2);
+		buildLengths(freq3, 16, PACK_MAX_BITS, length3);
+		buildCodes(length2, ADT_MAX_SYMBOLS, code2);
+		buildCodes(length3, 16, code3);
+
+		/* Array 1 from length changes of array 2 */
+		memset(freq1, 0, sizeof(freq1));
+		for (i=0, prevValue=0; i<ADT_MAX_SYMBOLS; i++) {
+			if (length2[i] != prevValue) {
+				freq1[length2[i] ^ prevValue]++;
+			}
+			prevValue = length2[i];
+		}
+		buildLengths(freq1, 16, PACK_MAX_BITS, length1);
+		buildCodes(length1, 16, code1);
+
+		writeCode(dst, &bitpos, block_length & 0xff, 8);
+		writeCode(dst, &bitpos, block_length>>8, 8);
+
+		writeLengths(dst, &bitpos, length1, 16);
+
+		/* Array 2: runs of changed lengths, and runs of same lengths */
+		writeCode(dst, &bitpos, length2[0] != 0, 1);
+		for (i=0, prevValue=0; i<ADT_MAX_SYMBOLS; ) {
+			int changed = (length2[i] != prevValue);
+
+			for (j=i; j<ADT_MAX_SYMBOLS; j++) {
+				int prev = (j>0 ? length2[j-1] : 0);
+
+				if ((length2[j] != prev) != changed) {
+					break;
+				}
+			}
+
+			writeBitfield(dst, &bitpos, j-i);
+			for (; i<j; i++) {
+				if (changed) {
+					int delta = length2[i] ^ prevValue;
+
+					writeCode(dst, &bitpos, code1[delta], length1[delta]);
+				}
+				prevValue = length2[i];
+			}
+		}
+
+		writeLengths(dst, &bitpos, length3, 16);
+
+		/* Symbols */
+		for (i=first; i<first+block_length; i++) {
+			int symbol = tokens[i].symbol;
+
+			writeCode(dst, &bitpos, code2[symbol], length2[symbol]);
+			if (symbol >= 256) {
+				int distance = tokens[i].offset-1;
+				int dist_symbol = distanceSymbol(distance);
+
+				writeCode(dst, &bitpos, code3[dist_symbol], length3[dist_symbol]);
+				if (dist_symbol > 1) {
+					writeCode(dst, &bitpos, distance - (1<<(dist_symbol-1)), dist_symbol-1);
+				}
+			}
+		}
+	}
+
+	/* Empty block to end */
+	writeCode(dst, &bitpos, 0, 16);
+
+	free(tokens);
+
+	*dstLength = (bitpos+7)>>3;
+	return dst;
+}
+
+/* Same pixels in both surfaces */
+
+static int compareSurfaces(SDL_Surface *surface1, SDL_Surface *surface2)
+{
+	int y;
+
+	for (y=0; y<240; y++) {
+		if (memcmp((Uint8 *) surface1->pixels + y*surface1->pitch,
+			(Uint8 *) surface2->pixels + y*surface2->pitch, 320*2))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	Uint8 *file, *packed, *dst1, *dst2;
+	SDL_Surface *surface = NULL;
+	int file_length, packed_length, loops, reorganize = -1, j;
+	int dst1_length, dst2_length, errors = 0;
+	Uint32 ticks_ref = 0, ticks_mem = 0, ticks_surf = 0, start;
+
+	loops = (argc>2 ? atoi(argv[2]) : DEFAULT_LOOPS);
+
+	if (SDL_Init(0)<0) {
+		fprintf(stderr, "Can not initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	if (argc>1) {
+		file = loadFile(argv[1], &file_length);
+	} else {
+		file = randomImage(&file_length);
+	}
+	if (!file || (file_length<1)) {
+		SDL_Quit();
+		return 1;
+	}
+
+	packed = packData(file, file_length, &packed_length);
+	if (!packed) {
+		fprintf(stderr, "Unable to pack data\n");
+		free(file);
+		SDL_Quit();
+		return 1;
+	}
+	printf("%d bytes packed to %d bytes, %d loops\n", file_length, packed_length, loops);
+
+	/* Previous decoder */
+	start = SDL_GetTicks();
+	for (j=0; j<loops; j++) {
+		SDL_RWops *src = SDL_RWFromMem(packed, packed_length);
+
+		adt_depack_ref(src, &dst1, &dst1_length);
+		SDL_RWclose(src);
+		if (j<loops-1) {
+			free(dst1);
+		}
+	}
+	ticks_ref = SDL_GetTicks() - start;
+
+	/* Buffer decoder */
+	start = SDL_GetTicks();
+	for (j=0; j<loops; j++) {
+		SDL_RWops *src = SDL_RWFromMem(packed, packed_length);
+
+		adt_depack(src, &dst2, &dst2_length);
+		SDL_RWclose(src);
+		if (j<loops-1) {
+			free(dst2);
+		}
+	}
+	ticks_mem = SDL_GetTicks() - start;
+
+	/* Both give length rounded up to 32KB */
+	if ((dst1_length < file_length) || memcmp(dst1, file, file_length)) {
+		printf("previous decoder: depacked data differs\n");
+		errors++;
+	}
+	if ((dst2_length != dst1_length) || memcmp(dst2, file, file_length)) {
+		printf("buffer decoder: depacked data differs\n");
+		errors++;
+	}
+
+	/* Surface decoder, if data is large enough for an image */
+	if (file_length >= BACKGROUND_LENGTH) {
+		reorganize = 1;
+	} else if (file_length >= 320*240*2) {
+		reorganize = 0;
+	}
+	if (reorganize >= 0) {
+		SDL_Surface *image;
+
+		start = SDL_GetTicks();
+		for (j=0; j<loops; j++) {
+			SDL_RWops *src = SDL_RWFromMem(packed, packed_length);
+
+			if (surface) {
+				SDL_FreeSurface(surface);
+			}
+			surface = adt_depack_surface(src, reorganize);
+			SDL_RWclose(src);
+		}
+		ticks_surf = SDL_GetTicks() - start;
+
+		image = adt_surface((Uint16 *) dst2, reorganize);
+		if (!surface || !image || compareSurfaces(surface, image)) {
+			printf("surface decoder: image differs\n");
+			errors++;
+		}
+		if (image) {
+			SDL_FreeSurface(image);
+		}
+		if (surface) {
+			SDL_FreeSurface(surface);
+		}
+	}
+
+	printf("previous decoder: %d ms, %.1f MB/s\n", ticks_ref,
+		ticks_ref ? (file_length/1048576.0)*loops*1000.0/ticks_ref : 0.0);
+	printf("buffer decoder: %d ms, %.1f MB/s\n", ticks_mem,
+		ticks_mem ? (file_length/1048576.0)*loops*1000.0/ticks_mem : 0.0);
+	if (reorganize >= 0) {
+		printf("surface decoder: %d ms, %.1f MB/s\n", ticks_surf,
+			ticks_surf ? (file_length/1048576.0)*loops*1000.0/ticks_surf : 0.0);
+	}
+	printf("%d errors\n", errors);
+
+	free(dst1);
+	free(dst2);
+	free(packed);
+	free(file);
+	SDL_Quit();
+	return (errors>0);
+}
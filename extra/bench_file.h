@@ -0,0 +1,37 @@
+/*
+	Benchmarks: load a test file in memory
+*/
+
+#ifndef BENCH_FILE_H
+#define BENCH_FILE_H
+
+/* Load file in mem from filename, return buffer, update length */
+
+static Uint8 *loadFile(const char *filename, int *length)
+{
+	SDL_RWops *src;
+	Uint8 *buffer;
+
+	src = SDL_RWFromFile(filename, "rb");
+	if (!src) {
+		fprintf(stderr, "Unable to open %s\n", filename);
+		return NULL;
+	}
+
+	*length = SDL_RWseek(src, 0, RW_SEEK_END);
+	SDL_RWseek(src, 0, RW_SEEK_SET);
+
+	buffer = (Uint8 *) malloc(*length);
+	if (buffer==NULL) {
+		fprintf(stderr, "Unable to allocate %d bytes\n", *length);
+		SDL_RWclose(src);
+		return NULL;
+	}
+
+	SDL_RWread(src, buffer, *length, 1);
+	SDL_RWclose(src);
+
+	return buffer;
+}
+
+#endif /* BENCH_FILE_H */
@@ -0,0 +1,196 @@
+/*
+	Raw CD sector emulation benchmark: compare byte per byte and
+	block based generation of raw sectors for PS1 movies
+
+	Build with:
+	gcc -O2 -I../src -o cdbench cdbench.c `sdl-config --cflags --libs`
+
+	Usage: cdbench [file.str [chunk_size [loops]]]
+	Without file, generate 32MB of video and audio sectors.
+	Reports the time to read the whole movie as raw sectors with both
+	versions, and the sectors that differ. Sector type differences are
+	counted apart, as previous version can miss them when a read stops
+	in the sector header.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <SDL.h>
+
+#define ENABLE_CD_REFERENCE 1
+#include "../src/movie_cd.c"
+
+#include "bench_file.h"
+
+#define DEFAULT_CHUNK_SIZE	32768
+#define DEFAULT_LOOPS	5
+
+#define RANDOM_SECTORS	16384
+
+#define CD_TYPE_OFFSET	0x12
+
+/* No log while benchmarking */
+
+void logMsg(int level, const char *fmt, ...)
+{
+}
+
+/* Random sectors, with 7 video sectors for 1 audio sector */
+
+static Uint8 *randomMovie(int *length)
+{
+	Uint8 *buffer;
+	int i;
+
+	*length = RANDOM_SECTORS * CD_DATA_SIZE;
+	buffer = (Uint8 *) malloc(*length);
+	if (buffer==NULL) {
+		return NULL;
+	}
+
+	for (i=0; i<*length; i++) {
+		buffer[i] = rand();
+	}
+
+	for (i=0; i<RANDOM_SECTORS; i+=8) {
+		Uint8 *sector = &buffer[i * CD_DATA_SIZE];
+		int j;
+
+		for (j=0; j<7; j++) {
+			sector[0] = (STR_MAGIC>>24) & 0xff;
+			sector[1] = (STR_MAGIC>>16) & 0xff;
+			sector[2] = (STR_MAGIC>>8) & 0xff;
+			sector[3] = STR_MAGIC & 0xff;
+			sector += CD_DATA_SIZE;
+		}
+	}
+
+	return buffer;
+}
+
+/* Read whole movie as raw sectors, return length read */
+
+static int readMovie(Uint8 *file, int file_length, Uint8 *dst, int chunk_size, int reference)
+{
+	SDL_RWops *src;
+	movie_cd_t movie_cd;
+	int length = 0, size_read;
+
+	src = SDL_RWFromMem(file, file_length);
+	if (!src) {
+		return 0;
+	}
+	if (!movie_cd_init(&movie_cd, src)) {
+		SDL_RWclose(src);
+		return 0;
+	}
+
+	for (;;) {
+		if (reference) {
+			size_read = movie_cd_read_ref(&movie_cd, &dst[length], chunk_size);
+		} else {
+			size_read = movie_cd_read(&movie_cd, &dst[length], chunk_size);
+		}
+		if (size_read<=0) {
+			break;
+		}
+		length += size_read;
+	}
+
+	movie_cd_shutdown(&movie_cd);
+	SDL_RWclose(src);
+	return length;
+}
+
+int main(int argc, char **argv)
+{
+	Uint8 *file, *dst1, *dst2;
+	int file_length, chunk_size, loops, raw_length, i;
+	int dst1_length = 0, dst2_length = 0, num_sectors;
+	int errors = 0, type_errors = 0;
+	Uint32 ticks_ref = 0, ticks_blk = 0, start;
+
+	chunk_size = (argc>2 ? atoi(argv[2]) : DEFAULT_CHUNK_SIZE);
+	loops = (argc>3 ? atoi(argv[3]) : DEFAULT_LOOPS);
+
+	if (SDL_Init(0)<0) {
+		fprintf(stderr, "Can not initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	if (argc>1) {
+		file = loadFile(argv[1], &file_length);
+	} else {
+		file = randomMovie(&file_length);
+	}
+	if (!file) {
+		SDL_Quit();
+		return 1;
+	}
+
+	/* Room for a last chunk past the end */
+	raw_length = ((file_length + CD_DATA_SIZE-1) / CD_DATA_SIZE) * RAW_CD_SECTOR_SIZE;
+	dst1 = (Uint8 *) malloc(raw_length + chunk_size);
+	dst2 = (Uint8 *) malloc(raw_length + chunk_size);
+	if (!dst1 || !dst2) {
+		fprintf(stderr, "Unable to allocate %d bytes\n", raw_length + chunk_size);
+		free(dst1);
+		free(dst2);
+		free(file);
+		SDL_Quit();
+		return 1;
+	}
+
+	printf("%d bytes, read as %d raw bytes by chunks of %d bytes, %d loops\n",
+		file_length, raw_length, chunk_size, loops);
+
+	/* Byte per byte */
+	start = SDL_GetTicks();
+	for (i=0; i<loops; i++) {
+		dst1_length = readMovie(file, file_length, dst1, chunk_size, 1);
+	}
+	ticks_ref += SDL_GetTicks() - start;
+
+	/* Block based */
+	start = SDL_GetTicks();
+	for (i=0; i<loops; i++) {
+		dst2_length = readMovie(file, file_length, dst2, chunk_size, 0);
+	}
+	ticks_blk += SDL_GetTicks() - start;
+
+	/* Previous version fails on a partial last sector */
+	num_sectors = (dst1_length<dst2_length ? dst1_length : dst2_length) / RAW_CD_SECTOR_SIZE;
+	for (i=0; i<num_sectors; i++) {
+		Uint8 *sector1 = &dst1[i * RAW_CD_SECTOR_SIZE];
+		Uint8 *sector2 = &dst2[i * RAW_CD_SECTOR_SIZE];
+
+		if (sector1[CD_TYPE_OFFSET] != sector2[CD_TYPE_OFFSET]) {
+			type_errors++;
+			sector1[CD_TYPE_OFFSET] = sector2[CD_TYPE_OFFSET];
+		}
+		if (memcmp(sector1, sector2, RAW_CD_SECTOR_SIZE)) {
+			printf("sector %d: generated data differs\n", i);
+			errors++;
+		}
+	}
+
+	printf("byte per byte: %d ms, %d bytes", ticks_ref, dst1_length);
+	if (ticks_ref>0) {
+		printf(", %d MB/s", (int) (((Sint64) dst1_length * loops * 1000) / ((Sint64) ticks_ref << 20)));
+	}
+	printf("\nblock based: %d ms, %d bytes", ticks_blk, dst2_length);
+	if (ticks_blk>0) {
+		printf(", %d MB/s", (int) (((Sint64) dst2_length * loops * 1000) / ((Sint64) ticks_blk << 20)));
+	}
+	printf("\n%d sectors compared, %d sector types differ, %d errors\n",
+		num_sectors, type_errors, errors);
+
+	free(dst1);
+	free(dst2);
+	free(file);
+	SDL_Quit();
+	return (errors>0);
+}
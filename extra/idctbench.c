@@ -0,0 +1,351 @@
+/*
+	IDCT benchmark: compare integer IDCT() and float IDCT_dequant()
+
+	Build with:
+	gcc -O2 -I../src -o idctbench idctbench.c ../src/idctfst.c `sdl-config --cflags --libs`
+
+	On x86_64, both SSE2 and C versions of IDCT_dequant() are built, add
+	-DIDCT_NO_SIMD to build only the C version.
+
+	Usage: idctbench [num_blocks [loops]]
+	Decode random sparse blocks, as found in MDEC streams, print
+	maximal and mean error, and timing of all versions. Fails if
+	IDCT_dequant() is more than 1 from exact IDCT, or more than 7 from
+	IDCT(), or if SSE2 and C versions differ. Blocks with too large
+	coefficients are also decoded, to check the clamping to
+	[-ROUND_BIAS,ROUND_BIAS] when rounding.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <SDL.h>
+
+#define ENABLE_IDCT_C 1
+#include "../src/idctflt.c"
+
+#define DEFAULT_NUM_BLOCKS	4096
+#define DEFAULT_LOOPS	50
+
+#define LARGE_SCALE	64	/* Coefficients of blocks checked for clamping */
+
+/* Same as depack_mdec.c */
+
+static const int aanscales[DCTSIZE2] = {
+	16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+	22725, 31521, 29692, 26722, 22725, 17855, 12299,  6270,
+	21407, 29692, 27969, 25172, 21407, 16819, 11585,  5906,
+	19266, 26722, 25172, 22654, 19266, 15137, 10426,  5315,
+	16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+	12873, 17855, 16819, 15137, 12873, 10114,  6967,  3552,
+	 8867, 12299, 11585, 10426,  8867,  6967,  4799,  2446,
+	 4520,  6270,  5906,  5315,  4520,  3552,  2446,  1247
+};
+
+static const unsigned char zscan[DCTSIZE2] = {
+	0 ,1 ,8 ,16,9 ,2 ,3 ,10,
+	17,24,32,25,18,11,4 ,5 ,
+	12,19,26,33,40,48,41,34,
+	27,20,13,6 ,7 ,14,21,28,
+	35,42,49,56,57,50,43,36,
+	29,22,15,23,30,37,44,51,
+	58,59,52,45,38,31,39,46,
+	53,60,61,54,47,55,62,63
+};
+
+static const unsigned char bs_iqtab[DCTSIZE2] = {
+	 2,16,19,22,26,27,29,34,
+	16,16,22,24,27,29,34,37,
+	19,22,26,27,29,34,34,38,
+	22,22,26,27,29,34,37,40,
+	22,26,27,29,32,35,40,48,
+	26,27,29,32,35,40,48,58,
+	26,27,29,34,38,46,56,69,
+	27,29,35,38,46,56,69,83
+};
+
+typedef struct {
+	int q_scale;
+	int k;	/* Index of last coefficient+1 */
+	BLOCK coefs[DCTSIZE2];	/* Natural order */
+} test_block_t;
+
+/* Exact IDCT, in doubles, clamped like IDCT_dequant() */
+
+static void exactIDCT(const test_block_t *block, BLOCK *blk)
+{
+	double coefs[DCTSIZE2], cosines[8][8];
+	int x, y, u, v;
+
+	for (x=0; x<8; x++) {
+		for (u=0; u<8; u++) {
+			cosines[x][u] = cos((2*x+1)*u*M_PI/16.0) * (u ? 1.0 : M_SQRT1_2);
+		}
+	}
+
+	coefs[0] = block->coefs[0] * bs_iqtab[0];
+	for (u=1; u<DCTSIZE2; u++) {
+		coefs[u] = block->coefs[u] * bs_iqtab[u] * block->q_scale / 8.0;
+	}
+
+	for (y=0; y<8; y++) {
+		for (x=0; x<8; x++) {
+			double sum = 0.0;
+
+			for (v=0; v<8; v++) {
+				for (u=0; u<8; u++) {
+					sum += cosines[y][v] * cosines[x][u] * coefs[v*8+u];
+				}
+			}
+			sum = floor(sum/4.0 + 0.5);
+			if (sum < -ROUND_BIAS) {
+				sum = -ROUND_BIAS;
+			} else if (sum > ROUND_BIAS) {
+				sum = ROUND_BIAS;
+			}
+			blk[y*8+x] = (int) sum;
+		}
+	}
+}
+
+/*
+	Random block: decreasing values and increasing runs in zigzag order,
+	dequantized values in range of DCT of 8 bits samples
+*/
+
+static void randomBlock(test_block_t *block, int q_scale)
+{
+	int k = 0, num_ac = rand() % 24;
+
+	memset(block->coefs, 0, sizeof(block->coefs));
+	block->q_scale = q_scale;
+	block->coefs[0] = (rand() % 1024) - 512;
+
+	while (num_ac-- > 0) {
+		int range, value;
+
+		k += 1 + (rand() % (1 + (k>>2)));
+		if (k >= DCTSIZE2) {
+			k = DCTSIZE2-1;
+			break;
+		}
+		range = 1024 >> (k>>3);
+		value = (rand() % (2*range+1)) - range;
+		block->coefs[zscan[k]] = (value*8) / (bs_iqtab[zscan[k]]*q_scale);
+	}
+	block->k = k+1;
+}
+
+int main(int argc, char **argv)
+{
+	test_block_t *blocks;
+	BLOCK blk_ref[DCTSIZE2], blk_new[DCTSIZE2], blk_exact[DCTSIZE2];
+#ifdef IDCT_X86_SSE
+	BLOCK blk_c[DCTSIZE2];
+	Uint32 ticks_c = 0;
+#endif
+	int iqtab[DCTSIZE2];
+	float dequant[DCTSIZE2];
+	int num_blocks, loops, i, j, k, q_scale = 1;
+	int max_error = 0, histo[4] = {0,0,0,0};
+	int max_error_ref = 0, max_error_new = 0, max_error_large = 0;
+	int c_differs = 0;
+	double sum_error = 0.0;
+	Uint32 ticks_ref = 0, ticks_new = 0, start;
+
+	num_blocks = (argc>1 ? atoi(argv[1]) : DEFAULT_NUM_BLOCKS);
+	loops = (argc>2 ? atoi(argv[2]) : DEFAULT_LOOPS);
+
+	if (SDL_Init(0)<0) {
+		fprintf(stderr, "Can not initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	blocks = (test_block_t *) malloc(num_blocks * sizeof(test_block_t));
+	if (!blocks) {
+		fprintf(stderr, "Unable to allocate %d blocks\n", num_blocks);
+		SDL_Quit();
+		return 1;
+	}
+
+	/* Same scale for a few macroblocks */
+	for (i=0; i<num_blocks; i++) {
+		if ((i % 60) == 0) {
+			q_scale = 1 + (rand() % 63);
+		}
+		randomBlock(&blocks[i], q_scale);
+	}
+
+	for (i=0; i<DCTSIZE2; i++) {
+		iqtab[i] = bs_iqtab[i]*aanscales[i]>>(14-2);
+	}
+
+	/* Compare results */
+	for (i=0; i<num_blocks; i++) {
+		test_block_t *block = &blocks[i];
+
+		blk_ref[0] = iqtab[0]*block->coefs[0];
+		for (k=1; k<DCTSIZE2; k++) {
+			blk_ref[k] = (iqtab[k]*block->q_scale*block->coefs[k])>>3;
+		}
+		IDCT(blk_ref, block->k);
+
+		dequant[0] = bs_iqtab[0];
+		for (k=1; k<DCTSIZE2; k++) {
+			dequant[k] = (bs_iqtab[k]*block->q_scale) * 0.125f;
+		}
+		IDCT_scaleDequant(dequant);
+		memcpy(blk_new, block->coefs, sizeof(blk_new));
+		IDCT_dequant(blk_new, dequant, block->k);
+
+		exactIDCT(block, blk_exact);
+
+#ifdef IDCT_X86_SSE
+		memcpy(blk_c, block->coefs, sizeof(blk_c));
+		if (block->k==1) {
+			IDCT_dequant(blk_c, dequant, block->k);
+		} else {
+			IDCT_c(blk_c, dequant);
+		}
+		if (memcmp(blk_c, blk_new, sizeof(blk_c))) {
+			c_differs++;
+		}
+#endif
+
+		for (k=0; k<DCTSIZE2; k++) {
+			int error = abs(blk_new[k] - blk_ref[k]);
+
+			if (abs(blk_ref[k] - blk_exact[k]) > max_error_ref) {
+				max_error_ref = abs(blk_ref[k] - blk_exact[k]);
+			}
+			if (abs(blk_new[k] - blk_exact[k]) > max_error_new) {
+				max_error_new = abs(blk_new[k] - blk_exact[k]);
+			}
+
+			sum_error += error;
+			if (error > max_error) {
+				max_error = error;
+			}
+			histo[error<3 ? error : 3]++;
+		}
+	}
+
+	/* Too large coefficients, results must be clamped */
+	for (i=0; i<num_blocks; i++) {
+		test_block_t block = blocks[i];
+
+		for (k=0; k<DCTSIZE2; k++) {
+			block.coefs[k] *= LARGE_SCALE;
+		}
+
+		dequant[0] = bs_iqtab[0];
+		for (k=1; k<DCTSIZE2; k++) {
+			dequant[k] = (bs_iqtab[k]*block.q_scale) * 0.125f;
+		}
+		IDCT_scaleDequant(dequant);
+		memcpy(blk_new, block.coefs, sizeof(blk_new));
+		IDCT_dequant(blk_new, dequant, block.k);
+
+		exactIDCT(&block, blk_exact);
+
+#ifdef IDCT_X86_SSE
+		memcpy(blk_c, block.coefs, sizeof(blk_c));
+		if (block.k==1) {
+			IDCT_dequant(blk_c, dequant, block.k);
+		} else {
+			IDCT_c(blk_c, dequant);
+		}
+		if (memcmp(blk_c, blk_new, sizeof(blk_c))) {
+			c_differs++;
+		}
+#endif
+
+		for (k=0; k<DCTSIZE2; k++) {
+			if (abs(blk_new[k] - blk_exact[k]) > max_error_large) {
+				max_error_large = abs(blk_new[k] - blk_exact[k]);
+			}
+		}
+	}
+
+	/* Timing, dequantization included */
+	start = SDL_GetTicks();
+	for (j=0; j<loops; j++) {
+		for (i=0; i<num_blocks; i++) {
+			test_block_t *block = &blocks[i];
+
+			blk_ref[0] = iqtab[0]*block->coefs[0];
+			for (k=1; k<DCTSIZE2; k++) {
+				blk_ref[k] = (iqtab[k]*block->q_scale*block->coefs[k])>>3;
+			}
+			IDCT(blk_ref, block->k);
+		}
+	}
+	ticks_ref = SDL_GetTicks() - start;
+
+	q_scale = -1;
+	start = SDL_GetTicks();
+	for (j=0; j<loops; j++) {
+		for (i=0; i<num_blocks; i++) {
+			test_block_t *block = &blocks[i];
+
+			if (block->q_scale != q_scale) {
+				q_scale = block->q_scale;
+				dequant[0] = bs_iqtab[0];
+				for (k=1; k<DCTSIZE2; k++) {
+					dequant[k] = (bs_iqtab[k]*q_scale) * 0.125f;
+				}
+				IDCT_scaleDequant(dequant);
+			}
+			memcpy(blk_new, block->coefs, sizeof(blk_new));
+			IDCT_dequant(blk_new, dequant, block->k);
+		}
+	}
+	ticks_new = SDL_GetTicks() - start;
+
+#ifdef IDCT_X86_SSE
+	q_scale = -1;
+	start = SDL_GetTicks();
+	for (j=0; j<loops; j++) {
+		for (i=0; i<num_blocks; i++) {
+			test_block_t *block = &blocks[i];
+
+			if (block->q_scale != q_scale) {
+				q_scale = block->q_scale;
+				dequant[0] = bs_iqtab[0];
+				for (k=1; k<DCTSIZE2; k++) {
+					dequant[k] = (bs_iqtab[k]*q_scale) * 0.125f;
+				}
+				IDCT_scaleDequant(dequant);
+			}
+			memcpy(blk_c, block->coefs, sizeof(blk_c));
+			if (block->k==1) {
+				IDCT_dequant(blk_c, dequant, block->k);
+			} else {
+				IDCT_c(blk_c, dequant);
+			}
+		}
+	}
+	ticks_c = SDL_GetTicks() - start;
+#endif
+
+	printf("%d blocks, %d loops\n", num_blocks, loops);
+	printf("IDCT(): %d ms, IDCT_dequant(): %d ms\n", ticks_ref, ticks_new);
+#ifdef IDCT_X86_SSE
+	printf("IDCT_dequant() C version: %d ms, %d blocks differ from SSE2 version\n",
+		ticks_c, c_differs);
+#endif
+	printf("max error: %d, mean error: %.4f\n", max_error,
+		sum_error / (num_blocks*DCTSIZE2));
+	printf("error 0: %d, 1: %d, 2: %d, more: %d\n",
+		histo[0], histo[1], histo[2], histo[3]);
+	printf("max error against exact IDCT: IDCT(): %d, IDCT_dequant(): %d\n",
+		max_error_ref, max_error_new);
+	printf("max error against exact IDCT, coefficients x%d: %d\n",
+		LARGE_SCALE, max_error_large);
+
+	free(blocks);
+	SDL_Quit();
+	return (max_error_new>1) || (max_error>7) || (max_error_large>1) || c_differs;
+}
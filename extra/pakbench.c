@@ -0,0 +1,207 @@
+/*
+	PAK depacker benchmark: pack data, then compare stream and memory
+	decoders
+
+	Build with:
+	gcc -O2 -o pakbench pakbench.c `sdl-config --cflags --libs`
+
+	Usage: pakbench [file [loops]]
+	Without file, pack a random 320x240 15 bits image.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#define ENABLE_PAK_REFERENCE 1
+#include "../src/g_re1/pak.c"
+
+#include "bench_file.h"
+
+#define DEFAULT_LOOPS	50
+
+#define PACK_MAX_CODES	4096
+
+/* Random image, with smooth gradients and noise like a background */
+
+static Uint8 *randomImage(int *length)
+{
+	Uint8 *buffer;
+	int x, y;
+
+	*length = 320*240*2;
+	buffer = (Uint8 *) malloc(*length);
+	if (buffer==NULL) {
+		return NULL;
+	}
+
+	for (y=0; y<240; y++) {
+		for (x=0; x<320; x++) {
+			int r = (x>>3) & 31;
+			int g = (y>>3) & 31;
+			int b = ((x+y)>>4) & 31;
+			Uint16 color;
+
+			if ((rand() & 7) == 0) {
+				r ^= 1;
+			}
+			color = (b<<10)|(g<<5)|r;
+			buffer[(y*320+x)*2] = color & 0xff;
+			buffer[(y*320+x)*2+1] = color>>8;
+		}
+	}
+
+	return buffer;
+}
+
+/* Write num_bits code, MSB first */
+
+static void writeCode(Uint8 *dst, int *bitpos, int code, int num_bits)
+{
+	int i;
+
+	for (i=num_bits-1; i>=0; i--) {
+		if (code & (1<<i)) {
+			dst[*bitpos>>3] |= 0x80>>(*bitpos & 7);
+		}
+		(*bitpos)++;
+	}
+}
+
+/* LZW packer, using same codes as PAK files */
+
+static Uint8 *packData(const Uint8 *src, int srcLength, int *dstLength)
+{
+	Uint16 (*dict)[256];
+	Uint8 *dst;
+	int bitpos = 0, num_bits = 9, next = PAK_CODE_FIRST;
+	int i, w;
+
+	/* Each byte needs at most 12 bits, with 3 bits width changes */
+	dst = (Uint8 *) calloc(srcLength*4 + 16, 1);
+	dict = (Uint16 (*)[256]) calloc(PACK_MAX_CODES, sizeof(Uint16 [256]));
+	if (!dst || !dict) {
+		free(dst);
+		free(dict);
+		return NULL;
+	}
+
+	w = src[0];
+	for (i=1; i<srcLength; i++) {
+		int c = src[i];
+
+		if (dict[w][c]) {
+			w = dict[w][c];
+			continue;
+		}
+
+		while (w >= (1<<num_bits)) {
+			writeCode(dst, &bitpos, PAK_CODE_BITS, num_bits);
+			num_bits++;
+		}
+		writeCode(dst, &bitpos, w, num_bits);
+
+		dict[w][c] = next++;
+		if (next == PACK_MAX_CODES) {
+			writeCode(dst, &bitpos, PAK_CODE_RESET, num_bits);
+			memset(dict, 0, PACK_MAX_CODES * sizeof(Uint16 [256]));
+			next = PAK_CODE_FIRST;
+			num_bits = 9;
+		}
+
+		w = c;
+	}
+
+	while (w >= (1<<num_bits)) {
+		writeCode(dst, &bitpos, PAK_CODE_BITS, num_bits);
+		num_bits++;
+	}
+	writeCode(dst, &bitpos, w, num_bits);
+	writeCode(dst, &bitpos, PAK_CODE_END, num_bits);
+
+	free(dict);
+
+	*dstLength = (bitpos+7)>>3;
+	return dst;
+}
+
+int main(int argc, char **argv)
+{
+	Uint8 *file, *packed, *dst1, *dst2;
+	int file_length, packed_length, loops, j;
+	int dst1_length, dst2_length, errors = 0;
+	Uint32 ticks_ref = 0, ticks_mem = 0, start;
+
+	loops = (argc>2 ? atoi(argv[2]) : DEFAULT_LOOPS);
+
+	if (SDL_Init(0)<0) {
+		fprintf(stderr, "Can not initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	if (argc>1) {
+		file = loadFile(argv[1], &file_length);
+	} else {
+		file = randomImage(&file_length);
+	}
+	if (!file || (file_length<1)) {
+		SDL_Quit();
+		return 1;
+	}
+
+	packed = packData(file, file_length, &packed_length);
+	if (!packed) {
+		fprintf(stderr, "Unable to pack data\n");
+		free(file);
+		SDL_Quit();
+		return 1;
+	}
+	printf("%d bytes packed to %d bytes, %d loops\n", file_length, packed_length, loops);
+
+	/* Stream decoder */
+	start = SDL_GetTicks();
+	for (j=0; j<loops; j++) {
+		SDL_RWops *src = SDL_RWFromMem(packed, packed_length);
+
+		pak_depack_ref(src, &dst1, &dst1_length);
+		SDL_RWclose(src);
+		if (j<loops-1) {
+			free(dst1);
+		}
+	}
+	ticks_ref = SDL_GetTicks() - start;
+
+	/* Memory decoder, with known depacked length */
+	start = SDL_GetTicks();
+	for (j=0; j<loops; j++) {
+		pak_depack_mem(packed, packed_length, &dst2, &dst2_length, file_length);
+		if (j<loops-1) {
+			free(dst2);
+		}
+	}
+	ticks_mem = SDL_GetTicks() - start;
+
+	if ((dst1_length != file_length) || memcmp(dst1, file, file_length)) {
+		printf("stream decoder: depacked data differs\n");
+		errors++;
+	}
+	if ((dst2_length != file_length) || memcmp(dst2, file, file_length)) {
+		printf("memory decoder: depacked data differs\n");
+		errors++;
+	}
+
+	printf("stream decoder: %d ms, %.1f MB/s\n", ticks_ref,
+		ticks_ref ? (file_length/1048576.0)*loops*1000.0/ticks_ref : 0.0);
+	printf("memory decoder: %d ms, %.1f MB/s\n", ticks_mem,
+		ticks_mem ? (file_length/1048576.0)*loops*1000.0/ticks_mem : 0.0);
+	printf("%d errors\n", errors);
+
+	free(dst1);
+	free(dst2);
+	free(packed);
+	free(file);
+	SDL_Quit();
+	return (errors>0);
+}
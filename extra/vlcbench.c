@@ -0,0 +1,285 @@
+/*
+	VLC depacker benchmark: compare stream and memory decoders
+
+	Build with:
+	gcc -O2 -o vlcbench vlcbench.c `sdl-config --cflags --libs`
+
+	Usage: vlcbench [file.bss [chunk_size [loops]]]
+	Without file, decode random macroblocks encoded here, and check
+	the decoded RL codes against the encoded ones.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#define ENABLE_VLC_REFERENCE 1
+#include "../src/depack_vlc.c"
+
+#include "bench_file.h"
+
+#define DEFAULT_CHUNK_SIZE	65536
+#define DEFAULT_LOOPS	50
+
+/* Encoder state: 16 bits words, MSB first, stored little endian */
+
+typedef struct {
+	Uint8 *buffer;
+	int length, max_length;
+	Uint32 bits;
+	int num_bits;
+} bitwriter_t;
+
+/* AC code of each run,level, as prefix with sign bit cleared, and length */
+static Uint32 ac_codes[64][41];
+static int ac_lengths[64][41];
+
+static void initEncoder(void)
+{
+	int value, run, level, len;
+
+	memset(ac_lengths, 0, sizeof(ac_lengths));
+
+	/* Shortest code of each run,level from decoder tables */
+	for (value=0; value<(1<<SBIT); value++) {
+		Uint32 ac = vlc_ac_code(value);
+
+		if ((ac==0) || (ac==EOB_CODE) || (ac==ESCAPE_CODE)) {
+			continue;
+		}
+
+		run = (ac>>10) & 63;
+		level = VALOF(ac);
+		len = BITOF(ac);
+		if ((level<=0) || (level>40)) {
+			continue;
+		}
+		if (ac_lengths[run][level] && (ac_lengths[run][level]<=len)) {
+			continue;
+		}
+
+		ac_codes[run][level] = value>>(SBIT-len);
+		ac_lengths[run][level] = len;
+	}
+}
+
+static void writeBits(bitwriter_t *bw, Uint32 value, int num_bits)
+{
+	while (num_bits>0) {
+		int n = (num_bits > 16-bw->num_bits ? 16-bw->num_bits : num_bits);
+
+		num_bits -= n;
+		bw->bits = (bw->bits<<n) | ((value>>num_bits) & ((1<<n)-1));
+		bw->num_bits += n;
+
+		if (bw->num_bits == 16) {
+			if (bw->length+2 <= bw->max_length) {
+				bw->buffer[bw->length++] = bw->bits & 0xff;
+				bw->buffer[bw->length++] = bw->bits>>8;
+			}
+			bw->bits = 0;
+			bw->num_bits = 0;
+		}
+	}
+}
+
+static void writeDC(bitwriter_t *bw, int diff, int is_y)
+{
+	const Uint8 (*sizes)[3] = (is_y ? DC_Ysizes : DC_UVsizes);
+	int size = 0, absdiff = (diff<0 ? -diff : diff);
+
+	while (absdiff>=(1<<size)) {
+		size++;
+	}
+
+	writeBits(bw, sizes[size][0], sizes[size][1]);
+	if (size) {
+		writeBits(bw, (diff<0 ? diff+(1<<size)-1 : diff), size);
+	}
+}
+
+/* Random coefficient level, mostly small */
+static int randomLevel(void)
+{
+	int r = rand() & 255;
+
+	if (r<150) {
+		return 1;
+	} else if (r<210) {
+		return 2;
+	} else if (r<240) {
+		return 3+(rand() & 3);
+	} else if (r<252) {
+		return 7+(rand() & 31);
+	}
+	return 40+(rand() & 255);
+}
+
+/*
+	Encode random macroblocks like a 320x240 background: 6 blocks each,
+	with DC close to previous one and a few AC coefficients. RL values
+	the decoder must give are stored in expected.
+*/
+static Uint8 *encodeImage(Uint16 **expected, int *num_expected, int *length)
+{
+	bitwriter_t bw;
+	Uint16 *rl;
+	int num_mb = 20*15, max_rl = num_mb*6*65+2, num_rl = 2;
+	int quant = 2, last_dc[3] = {0,0,0};
+	int i, j;
+
+	bw.max_length = 8 + max_rl*4;
+	bw.buffer = (Uint8 *) calloc(bw.max_length, 1);
+	rl = (Uint16 *) malloc(max_rl*sizeof(Uint16));
+	if (!bw.buffer || !rl) {
+		free(bw.buffer);
+		free(rl);
+		return NULL;
+	}
+	bw.length = 8;
+	bw.bits = 0;
+	bw.num_bits = 0;
+
+	initEncoder();
+
+	for (i=0; i<num_mb*6; i++) {
+		int n = i % 6, *dc = &last_dc[n>=2 ? 2 : n];
+		int diff = (rand() % 61) - 30, k = 0;
+
+		/* DC is stored in units of 4, on 10 bits */
+		if ((*dc+diff*4 < -500) || (*dc+diff*4 > 500)) {
+			diff = -diff;
+		}
+		writeDC(&bw, diff, n>=2);
+		*dc += diff*4;
+		rl[num_rl++] = (quant<<10) | (*dc & 0x3ff);
+
+		/* AC */
+		for (j=rand() & 15; j>0; j--) {
+			int run = (rand() & 7 ? rand() & 3 : rand() & 31);
+			int level = randomLevel();
+			int sign = rand() & 1;
+
+			if (k+run+1 > 63) {
+				break;
+			}
+			k += run+1;
+
+			if ((level<=40) && ac_lengths[run][level]) {
+				writeBits(&bw, ac_codes[run][level] | sign, ac_lengths[run][level]);
+			} else {
+				/* Escape, then 16 bits run,level */
+				writeBits(&bw, 1, 6);
+				writeBits(&bw, (run<<10) | ((sign ? -level : level) & 0x3ff), 16);
+			}
+			rl[num_rl++] = (run<<10) | ((sign ? -level : level) & 0x3ff);
+		}
+
+		/* EOB */
+		writeBits(&bw, 2, 2);
+		rl[num_rl++] = EOB;
+	}
+	writeBits(&bw, 0, 16-bw.num_bits);
+
+	/* length, id, quant, version */
+	j = (num_rl+1)>>1;
+	bw.buffer[0] = j & 0xff;	bw.buffer[1] = j>>8;
+	bw.buffer[2] = VLC_ID & 0xff;	bw.buffer[3] = VLC_ID>>8;
+	bw.buffer[4] = quant;	bw.buffer[5] = 0x00;
+	bw.buffer[6] = 0x03;	bw.buffer[7] = 0x00;
+
+	rl[0] = j;
+	rl[1] = VLC_ID;
+
+	*expected = rl;
+	*num_expected = num_rl;
+	*length = bw.length;
+	return bw.buffer;
+}
+
+int main(int argc, char **argv)
+{
+	Uint8 *file, *dst1, *dst2;
+	Uint16 *expected = NULL;
+	int file_length, chunk_size, loops, num_chunks, num_expected = 0, i, j;
+	int dst1_length, dst2_length, errors = 0;
+	Uint32 ticks_ref = 0, ticks_mem = 0, start;
+
+	chunk_size = (argc>2 ? atoi(argv[2]) : DEFAULT_CHUNK_SIZE);
+	loops = (argc>3 ? atoi(argv[3]) : DEFAULT_LOOPS);
+
+	if (SDL_Init(0)<0) {
+		fprintf(stderr, "Can not initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+	vlc_init();
+
+	if (argc>1) {
+		file = loadFile(argv[1], &file_length);
+	} else {
+		file = encodeImage(&expected, &num_expected, &file_length);
+		chunk_size = file_length;
+	}
+	if (!file) {
+		SDL_Quit();
+		return 1;
+	}
+
+	num_chunks = file_length / chunk_size;
+	printf("%d chunks of %d bytes, %d loops\n", num_chunks, chunk_size, loops);
+
+	for (i=0; i<num_chunks; i++) {
+		Uint8 *chunk = &file[i*chunk_size];
+
+		if ((chunk[2] | (chunk[3]<<8)) != VLC_ID) {
+			continue;
+		}
+
+		/* Stream decoder */
+		start = SDL_GetTicks();
+		for (j=0; j<loops; j++) {
+			SDL_RWops *src = SDL_RWFromMem(chunk, file_length - i*chunk_size);
+
+			vlc_depack_ref(src, &dst1, &dst1_length);
+			SDL_RWclose(src);
+			if (j<loops-1) {
+				free(dst1);
+			}
+		}
+		ticks_ref += SDL_GetTicks() - start;
+
+		/* Memory decoder */
+		start = SDL_GetTicks();
+		for (j=0; j<loops; j++) {
+			vlc_depack_mem(chunk, file_length - i*chunk_size, &dst2, &dst2_length);
+			if (j<loops-1) {
+				free(dst2);
+			}
+		}
+		ticks_mem += SDL_GetTicks() - start;
+
+		if ((dst1_length != dst2_length) || memcmp(dst1, dst2, dst1_length)) {
+			printf("chunk %d: decoded data differs\n", i);
+			errors++;
+		} else if (expected && ((dst1_length < num_expected*2)
+			|| memcmp(dst1, expected, num_expected*2)))
+		{
+			printf("chunk %d: decoded data differs from encoded one\n", i);
+			errors++;
+		}
+
+		free(dst1);
+		free(dst2);
+	}
+
+	printf("stream decoder: %d ms\n", ticks_ref);
+	printf("memory decoder: %d ms\n", ticks_mem);
+	printf("%d errors\n", errors);
+
+	free(expected);
+	free(file);
+	SDL_Quit();
+	return (errors>0);
+}
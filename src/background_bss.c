@@ -23,13 +23,14 @@
 #include <SDL.h>
 
 #include "filesystem.h"
+#include "parameters.h"
 #include "background_bss.h"
 #include "depack_vlc.h"
 #include "depack_mdec.h"
+#include "diskcache.h"
 #include "video.h"
 
 #include "g_common/room.h"
-#include "g_common/game.h"
 
 #include "r_common/render.h"
 
@@ -42,21 +43,36 @@
 
 /*--- Functions prototypes ---*/
 
-static int background_vlc_load(SDL_RWops *src, int chunk_size, int row_offset);
-static int background_mdec_load(SDL_RWops *src, int row_offset);
+static int background_vlc_load(room_t *room, const char *filename, SDL_RWops *src,
+	int num_camera, int chunk_size, int row_offset);
+static int background_mdec_load(room_t *room, const char *filename, SDL_RWops *src,
+	int num_camera, int row_offset);
 
 /*--- Functions ---*/
 
-int background_bss_load(const char *filename, int chunk_size, int row_offset)
+int background_bss_load(room_t *room, const char *filename, int num_camera,
+	int chunk_size, int row_offset)
 {
 	SDL_RWops *src;
 	/*Uint8 *dstBuffer;
 	int dstBufLen;*/
+	SDL_Surface *image;
 	int retval = 0;
-	
+
+	image = diskcache_load_surface(filename, num_camera);
+	if (image) {
+		room->background = render.createTexture(RENDER_TEXTURE_CACHEABLE);
+		if (room->background) {
+			room->background->load_from_surf(room->background, image);
+			retval = 1;
+		}
+		diskcache_free_surface(image);
+		return retval;
+	}
+
 	src = FS_makeRWops(filename);
 	if (src) {
-		retval = background_vlc_load(src, chunk_size, row_offset);
+		retval = background_vlc_load(room, filename, src, num_camera, chunk_size, row_offset);
 
 		SDL_RWclose(src);
 	}
@@ -64,13 +80,14 @@ int background_bss_load(const char *filename, int chunk_size, int row_offset)
 	return retval;
 }
 
-static int background_vlc_load(SDL_RWops *src, int chunk_size, int row_offset)
+static int background_vlc_load(room_t *room, const char *filename, SDL_RWops *src,
+	int num_camera, int chunk_size, int row_offset)
 {
 	Uint8 *dstBuffer;
 	int dstBufLen;
 	int retval = 0;
 
-	SDL_RWseek(src, game->num_camera * chunk_size, RW_SEEK_SET);
+	SDL_RWseek(src, num_camera * chunk_size, RW_SEEK_SET);
 
 	vlc_depack(src, &dstBuffer, &dstBufLen);
 
@@ -79,7 +96,7 @@ static int background_vlc_load(SDL_RWops *src, int chunk_size, int row_offset)
 			
 		mdec_src = SDL_RWFromMem(dstBuffer, dstBufLen);
 		if (mdec_src) {
-			retval = background_mdec_load(mdec_src, row_offset);
+			retval = background_mdec_load(room, filename, mdec_src, num_camera, row_offset);
 
 			SDL_FreeRW(mdec_src);
 		}
@@ -90,20 +107,36 @@ static int background_vlc_load(SDL_RWops *src, int chunk_size, int row_offset)
 	return retval;
 }
 
-static int background_mdec_load(SDL_RWops *src, int row_offset)
+static int background_mdec_load(room_t *room, const char *filename, SDL_RWops *src,
+	int num_camera, int row_offset)
 {
+	render_texture_t *texture;
 	Uint8 *dstBuffer;
 	int dstBufLen;
 	int retval = 0;
 
+	/* Decode directly in texture format, if possible, and store it in
+	   disk cache as is */
+	texture = render.createTexture(RENDER_TEXTURE_CACHEABLE);
+	if (texture) {
+		if (mdec_depack_texture(src, texture, WIDTH, HEIGHT, row_offset)) {
+			diskcache_save_texture(filename, num_camera, texture);
+			room->background = texture;
+			return 1;
+		}
+		texture->shutdown(texture);
+	}
+
 	mdec_depack(src, &dstBuffer, &dstBufLen, WIDTH, HEIGHT);
 
 	if (dstBuffer && dstBufLen) {
 		SDL_Surface *image = mdec_surface(dstBuffer, WIDTH, HEIGHT, row_offset);
 		if (image) {
-			game->room->background = render.createTexture(RENDER_TEXTURE_CACHEABLE);
-			if (game->room->background) {
-				game->room->background->load_from_surf(game->room->background, image);
+			diskcache_save_surface(filename, num_camera, image);
+
+			room->background = render.createTexture(RENDER_TEXTURE_CACHEABLE);
+			if (room->background) {
+				room->background->load_from_surf(room->background, image);
 				retval = 1;
 			}
 			SDL_FreeSurface(image);
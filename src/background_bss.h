@@ -21,8 +21,14 @@
 #ifndef BACKGROUND_BSS_H
 #define BACKGROUND_BSS_H 1
 
+/*--- External types ---*/
+
+struct room_s;
+
 /*--- Functions ---*/
 
-int background_bss_load(const char *filename, int chunk_size, int row_offset);
+/* Load background for camera in room->background */
+int background_bss_load(struct room_s *room, const char *filename, int num_camera,
+	int chunk_size, int row_offset);
 
 #endif /* BACKGROUND_BSS_H */
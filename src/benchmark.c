@@ -0,0 +1,342 @@
+/*
+	Benchmark mode, sweep all stages/rooms/cameras
+
+	Copyright (C) 2017	Patrice Mandin
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*--- Includes ---*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL.h>
+
+#include "parameters.h"
+#include "log.h"
+#include "video.h"
+#include "view_background.h"
+#include "benchmark.h"
+
+#include "g_common/game.h"
+#include "g_common/room.h"
+#include "g_common/player.h"
+
+#include "r_common/render.h"
+#include "r_soft/dirty_rects.h"
+
+/*--- Defines ---*/
+
+enum {
+	PHASE_ROOM=0,		/* game->setRoom(): file load and parsing */
+	PHASE_BACKGROUND,	/* background image load and decode */
+	PHASE_MASKS,		/* background mask load, mask build */
+	PHASE_DRAW,		/* background restore, masks and model draw */
+	PHASE_PRESENT,		/* render end of frame, video update */
+
+	NUM_PHASES
+};
+
+/*--- Types ---*/
+
+typedef struct {
+	const char *name;
+	int num_samples;
+	int size_samples;
+	float *samples;	/* Duration in milliseconds */
+} bench_phase_t;
+
+/*--- Variables ---*/
+
+static bench_phase_t phases[NUM_PHASES]={
+	{"file load", 0, 0, NULL},
+	{"background decode", 0, 0, NULL},
+	{"mask build", 0, 0, NULL},
+	{"model draw", 0, 0, NULL},
+	{"present", 0, 0, NULL}
+};
+
+/* Renderer counters when benchmark starts */
+static Uint32 start_draw_calls, start_vertex_uploads;
+
+/*--- Functions prototypes ---*/
+
+static double bench_time(void);
+static void add_sample(int num_phase, double start);
+static int compare_samples(const void *s1, const void *s2);
+static int bench_quit(void);
+
+static int bench_camera(int num_camera);
+static void print_results(int num_rooms, int num_cameras, double total);
+static void write_csv(const char *filename);
+static void free_samples(void);
+
+/*--- Functions ---*/
+
+void benchmark_setenv(void)
+{
+#if SDL_VERSION_ATLEAST(2,0,0)
+	SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+#else
+	if (!getenv("SDL_VIDEODRIVER")) {
+		SDL_putenv("SDL_VIDEODRIVER=dummy");
+	}
+#endif
+}
+
+void benchmark_run(void)
+{
+	int num_rooms = 0, num_cameras = 0, quit = 0;
+	double start, total;
+
+	logMsg(0, "benchmark: %d frames per camera\n", params.benchmark);
+
+	/* Load player model and initial room */
+	view_background_update();
+
+	total = bench_time();
+	start_draw_calls = render.num_draw_calls;
+	start_vertex_uploads = render.num_vertex_uploads;
+
+	game->reset_stage(game);
+	do {
+		game->reset_room(game);
+		do {
+			int num_camera;
+
+			start = bench_time();
+			game->setRoom(game, game->num_stage, game->num_room);
+			if (game->room) {
+				add_sample(PHASE_ROOM, start);
+				num_rooms++;
+
+				for (num_camera=0; num_camera<game->room->num_cameras; num_camera++) {
+					quit = bench_camera(num_camera);
+					if (quit) {
+						break;
+					}
+					num_cameras++;
+				}
+			}
+
+			game->next_room(game);
+		} while (!quit && (game->num_room != 0));
+
+		game->next_stage(game);
+	} while (!quit && (game->num_stage != 1));
+
+	total = bench_time() - total;
+
+	print_results(num_rooms, num_cameras, total);
+	if (params.benchmark_csv) {
+		write_csv(params.benchmark_csv);
+	}
+
+	free_samples();
+}
+
+/* Load a camera, render frames, return 1 if user wants to quit */
+static int bench_camera(int num_camera)
+{
+	room_t *room = game->room;
+	player_t *player = game->player;
+	room_camera_t room_camera;
+	double start;
+	int i;
+
+	game->num_camera = num_camera;
+
+	start = bench_time();
+	room->setBackground(room, num_camera);
+	add_sample(PHASE_BACKGROUND, start);
+
+	start = bench_time();
+	room->setBgmask(room, num_camera);
+	room->initMasks(room, num_camera);
+	add_sample(PHASE_MASKS, start);
+
+	/* Put player where camera looks at */
+	room->getCamera(room, num_camera, &room_camera);
+	player->x = room_camera.to_x;
+	player->y = 0;
+	player->z = room_camera.to_z;
+
+	dirty_rects[0]->setDirty(dirty_rects[0], 0,0, video.width, video.height);
+	dirty_rects[1]->setDirty(dirty_rects[1], 0,0, video.width, video.height);
+
+	for (i=0; i<params.benchmark; i++) {
+		if (bench_quit()) {
+			return 1;
+		}
+
+		render.startFrame();
+
+		start = bench_time();
+		view_background_draw();
+		add_sample(PHASE_DRAW, start);
+
+		start = bench_time();
+		render.endFrame();
+		video.swapBuffers();
+		add_sample(PHASE_PRESENT, start);
+	}
+
+	return 0;
+}
+
+/* Check if user closed window or pressed escape */
+static int bench_quit(void)
+{
+	SDL_Event event;
+	int quit = 0;
+
+	while (SDL_PollEvent(&event)) {
+		switch(event.type) {
+			case SDL_QUIT:
+				quit = 1;
+				break;
+			case SDL_KEYDOWN:
+				if (event.key.keysym.sym == SDLK_ESCAPE) {
+					quit = 1;
+				}
+				break;
+		}
+	}
+
+	return quit;
+}
+
+/* Current time in milliseconds */
+static double bench_time(void)
+{
+#if SDL_VERSION_ATLEAST(2,0,0)
+	return (SDL_GetPerformanceCounter() * 1000.0) / SDL_GetPerformanceFrequency();
+#else
+	return SDL_GetTicks();
+#endif
+}
+
+static void add_sample(int num_phase, double start)
+{
+	bench_phase_t *phase = &phases[num_phase];
+
+	if (phase->num_samples >= phase->size_samples) {
+		int new_size = (phase->size_samples ? phase->size_samples<<1 : 256);
+		float *new_samples;
+
+		new_samples = (float *) realloc(phase->samples, new_size * sizeof(float));
+		if (!new_samples) {
+			fprintf(stderr, "Can not allocate memory for benchmark samples\n");
+			return;
+		}
+		phase->samples = new_samples;
+		phase->size_samples = new_size;
+	}
+
+	phase->samples[phase->num_samples++] = bench_time() - start;
+}
+
+static int compare_samples(const void *s1, const void *s2)
+{
+	float f1 = *((const float *) s1);
+	float f2 = *((const float *) s2);
+
+	return (f1 > f2) - (f1 < f2);
+}
+
+static void print_results(int num_rooms, int num_cameras, double total)
+{
+	Uint32 draw_calls = render.num_draw_calls - start_draw_calls;
+	Uint32 vertex_uploads = render.num_vertex_uploads - start_vertex_uploads;
+	int i, num_frames;
+
+	logMsg(0, "benchmark: %d rooms, %d cameras, %.3f s\n",
+		num_rooms, num_cameras, total/1000.0);
+	logMsg(0, "benchmark: %-18s %8s %10s %10s %10s\n",
+		"phase", "samples", "min ms", "median ms", "p99 ms");
+
+	for (i=0; i<NUM_PHASES; i++) {
+		bench_phase_t *phase = &phases[i];
+		int num = phase->num_samples;
+
+		if (num == 0) {
+			logMsg(0, "benchmark: %-18s %8d\n", phase->name, 0);
+			continue;
+		}
+
+		qsort(phase->samples, num, sizeof(float), compare_samples);
+
+		logMsg(0, "benchmark: %-18s %8d %10.3f %10.3f %10.3f\n",
+			phase->name, num, phase->samples[0],
+			phase->samples[num>>1], phase->samples[(num*99)/100]);
+	}
+
+	/* Only counted by OpenGL renderer */
+	num_frames = phases[PHASE_DRAW].num_samples;
+	if (num_frames>0) {
+		logMsg(0, "benchmark: %u draw calls, %u vertices uploaded, %.1f and %.1f per frame\n",
+			draw_calls, vertex_uploads,
+			(float) draw_calls / num_frames, (float) vertex_uploads / num_frames);
+	}
+}
+
+/* Samples must already be sorted */
+static void write_csv(const char *filename)
+{
+	FILE *output;
+	int i;
+
+	output = fopen(filename, "w");
+	if (!output) {
+		fprintf(stderr, "Can not create %s\n", filename);
+		return;
+	}
+
+	fprintf(output, "phase,samples,min_ms,median_ms,p99_ms\n");
+	for (i=0; i<NUM_PHASES; i++) {
+		bench_phase_t *phase = &phases[i];
+		int num = phase->num_samples;
+
+		if (num == 0) {
+			fprintf(output, "%s,0,,,\n", phase->name);
+			continue;
+		}
+
+		fprintf(output, "%s,%d,%.3f,%.3f,%.3f\n", phase->name, num,
+			phase->samples[0], phase->samples[num>>1],
+			phase->samples[(num*99)/100]);
+	}
+
+	fclose(output);
+
+	logMsg(0, "benchmark: results written to %s\n", filename);
+}
+
+static void free_samples(void)
+{
+	int i;
+
+	for (i=0; i<NUM_PHASES; i++) {
+		if (phases[i].samples) {
+			free(phases[i].samples);
+			phases[i].samples = NULL;
+		}
+		phases[i].num_samples = phases[i].size_samples = 0;
+	}
+}
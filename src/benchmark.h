@@ -0,0 +1,32 @@
+/*
+	Benchmark mode, sweep all stages/rooms/cameras
+
+	Copyright (C) 2017	Patrice Mandin
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H 1
+
+/*--- Function prototypes ---*/
+
+/* Select headless video driver, if user did not choose one */
+void benchmark_setenv(void);
+
+/* Run benchmark, return when finished */
+void benchmark_run(void);
+
+#endif /* BENCHMARK_H */
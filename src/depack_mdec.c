@@ -29,7 +29,12 @@
 
 #include <SDL.h>
 
-#include "idctfst.h"
+#include "idctflt.h"
+#include "depack_mdec.h"
+#include "parameters.h"
+
+#include "r_common/render_texture.h"
+#include "r_soft/dither.h"
 
 /*--- Defines ---*/
 
@@ -39,12 +44,17 @@
 #define REEVENGI_SDLSURF_FLAGS SDL_SWSURFACE
 #endif
 
+#define MAX_MDEC_THREADS	16
+
 #define VLC_ID		0x3800
 #define	EOB		0xfe00
 #define	DCTSIZE2	64
 #define	RUNOF(a)	((a)>>10)
 #define	VALOF(a)	((short)((a)<<6)>>6)
 
+/* Read next RL value, stream end reads as EOB */
+#define READ_RL(ctxt)	((ctxt)->src < (ctxt)->src_end ? SDL_SwapLE16(*(ctxt)->src++) : EOB)
+
 #define	ROUND(r)	bs_roundtbl[(r)+256]
 
 #define	SHIFT		12
@@ -58,20 +68,6 @@
 
 enum {B,G,R};
 
-/* this table is based on djpeg by Independent Jpeg Group */
-
-static const int aanscales[DCTSIZE2] = {
-	  /* precomputed values scaled up by 14 bits */
-	  16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
-	  22725, 31521, 29692, 26722, 22725, 17855, 12299,  6270,
-	  21407, 29692, 27969, 25172, 21407, 16819, 11585,  5906,
-	  19266, 26722, 25172, 22654, 19266, 15137, 10426,  5315,
-	  16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
-	  12873, 17855, 16819, 15137, 12873, 10114,  6967,  3552,
-	   8867, 12299, 11585, 10426,  8867,  6967,  4799,  2446,
-	   4520,  6270,  5906,  5315,  4520,  3552,  2446,  1247
-};
-
 static unsigned char zscan[DCTSIZE2] = {
 	0 ,1 ,8 ,16,9 ,2 ,3 ,10,
 	17,24,32,25,18,11,4 ,5 ,
@@ -96,47 +92,74 @@ static unsigned char bs_iqtab[DCTSIZE2] = {
 
 /*--- Types ---*/
 
+typedef struct mdec_output_s mdec_output_t;
+
+struct mdec_output_s {
+	/* Write row of 16 pixels (R,G,B bytes) at x,y of decoded image */
+	void (*writeRow)(mdec_output_t *this, const Uint8 *rgb, int x, int y);
+
+	Uint8 *pixels;
+	int pitch, bpp;
+	const SDL_PixelFormat *format;
+
+	int src_width;		/* Width of decoded image */
+	int width, height;	/* Dimension of image zone, after cropping */
+	int offset;		/* Position of image zone */
+};
+
 typedef struct {
-	int iqtab[DCTSIZE2];
-	SDL_RWops *src;
+	int q_scale;			/* Scale of current dequant table */
+	float dequant[DCTSIZE2];	/* Dequantization table, for IDCT_dequant() */
+	const Uint16 *src, *src_end;	/* RL stream */
 } bs_context_t;
 
-/*--- Variables ---*/
+/* Decode a range of macroblocks */
+typedef struct {
+	bs_context_t ctxt;
+	mdec_output_t *output;
+	const Uint16 **mb_start;	/* Start of each macroblock in RL stream */
+	int first_mb, num_mb;
+	int mb_height;			/* Macroblocks per column */
+	int height;
+	SDL_Thread *thread;
+} mdec_worker_t;
 
-static Uint16 *dstPointer;
-static int dstBufLen;
-static int dstOffset;
+/*--- Variables ---*/
 
 static Uint8 bs_roundtbl[256*3];
 
+/*--- Functions prototypes ---*/
+
+static void dequant_init(bs_context_t *ctxt, int q_scale);
+static int mdec_worker(void *data);
+
 /*--- Functions ---*/
 
 void rl2blk(bs_context_t *ctxt, BLOCK *blk)
 {
-	SDL_RWops *src = ctxt->src;
-
 	int i,k,q_scale,rl;
 	memset(blk,0,6*DCTSIZE2*sizeof(BLOCK));
 	for(i=0;i<6;i++) {
-		rl = SDL_ReadLE16(src);
-		/*printf("%d: 0x%04x, %d\n", i,rl, SDL_RWtell(src));*/
+		rl = READ_RL(ctxt);
 		if (rl==EOB) {
 			continue;
 		}
 		q_scale = RUNOF(rl);
-		blk[0] = ctxt->iqtab[0]*VALOF(rl);
+		if (q_scale != ctxt->q_scale) {
+			dequant_init(ctxt, q_scale);
+		}
+		blk[0] = VALOF(rl);
 		k = 0;
 		for(;;) {
-			rl = SDL_ReadLE16(src);
-			/*printf("    0x%04x, 0x%08x\n", rl, SDL_RWtell(src));*/
+			rl = READ_RL(ctxt);
 			if (rl==EOB) {
 				break;
 			}
 			k += RUNOF(rl)+1;
-			blk[zscan[k]] = (ctxt->iqtab[zscan[k]]*q_scale*VALOF(rl))>>3;
+			blk[zscan[k]] = VALOF(rl);
 		}
 
-		IDCT(blk,k+1);
+		IDCT_dequant(blk, ctxt->dequant, k+1);
 
 		blk+=DCTSIZE2;
 	}
@@ -193,18 +216,7 @@ static void yuv2rgb24(BLOCK *blk,Uint8 image[][3])
 	}
 }
 
-static void dec_dct_out(bs_context_t *ctxt,Uint16 *image,int size)
-{
-	BLOCK blk[DCTSIZE2*6];
-	int blocksize = (16*16*3)>>1;
-
-	for(;size>0; size-=blocksize>>1,image+=blocksize) {
-		rl2blk(ctxt, blk);
-		yuv2rgb24(blk, (Uint8 (*)[3]) image);
-	}
-}
-
-static void bs_init(void)
+void mdec_init(void)
 {
 	int i;
 	for(i=0;i<256;i++) {
@@ -214,78 +226,287 @@ static void bs_init(void)
 	}
 }
 
-static void iqtab_init(bs_context_t *ctxt)
+/* DC is not scaled by q_scale, AC are scaled by q_scale/8 */
+static void dequant_init(bs_context_t *ctxt, int q_scale)
 {
-#define CONST_BITS 14
-#define	IFAST_SCALE_BITS 2
 	int i;
-	for(i=0;i<DCTSIZE2;i++) {
-		ctxt->iqtab[i] = bs_iqtab[i]*aanscales[i]>>(CONST_BITS-IFAST_SCALE_BITS);
+
+	ctxt->q_scale = q_scale;
+	ctxt->dequant[0] = bs_iqtab[0];
+	for(i=1;i<DCTSIZE2;i++) {
+		ctxt->dequant[i] = (bs_iqtab[i]*q_scale) * 0.125f;
 	}
+	IDCT_scaleDequant(ctxt->dequant);
 }
 
-void mdec_depack(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength,
-	int width, int height)
+/*
+	Record start of each macroblock: 6 blocks, each one is a list of
+	RL values ending with EOB. Macroblocks are stored column by column.
+*/
+static void find_macroblocks(const Uint16 *src, const Uint16 *src_end,
+	const Uint16 **mb_start, int num_mb)
 {
-	bs_context_t ctxt;
-	Uint16	vlc_id;
-	int height2 = (height+15)&~15;
-	int width2 = (width*3)>>1;
-	int w = 8*3;
-	int slice = (height2 * w)>>1;
-	int x,y;
-	Uint16 *image;
+	int i, j;
+
+	for (i=0; i<num_mb; i++) {
+		mb_start[i] = src;
+		for (j=0; j<6; j++) {
+			while (src < src_end) {
+				if (SDL_SwapLE16(*src++) == EOB) {
+					break;
+				}
+			}
+		}
+	}
+}
 
-	*dstBufPtr = NULL;
-	dstOffset = *dstLength = 0;
+/* Decode macroblocks, pass each 16 pixels row to output */
+static void decode_macroblocks(mdec_worker_t *worker)
+{
+	BLOCK blk[DCTSIZE2*6];
+	Uint8 image[16*16][3];
+	int i, x, y, yy;
+
+	for (i=worker->first_mb; i<worker->first_mb+worker->num_mb; i++) {
+		worker->ctxt.src = worker->mb_start[i];
+		rl2blk(&worker->ctxt, blk);
+		yuv2rgb24(blk, image);
+
+		x = (i / worker->mb_height)*16;
+		y = (i % worker->mb_height)*16;
+		for (yy=0; (yy<16) && (y+yy<worker->height); yy++) {
+			worker->output->writeRow(worker->output, image[yy*16], x, y+yy);
+		}
+	}
+}
+
+static int mdec_worker(void *data)
+{
+	decode_macroblocks((mdec_worker_t *) data);
+	return 0;
+}
 
-	ctxt.src = src;
+/*
+	Decode image, macroblocks are split between params.mdec_threads
+	threads, each one writes its own pixels in output
+*/
+static int mdec_decode(SDL_RWops *src, int width, int height, mdec_output_t *output)
+{
+	mdec_worker_t workers[MAX_MDEC_THREADS];
+	Uint16	vlc_id;
+	int mb_height = (height+15)>>4;
+	int num_mb = ((width+15)>>4) * mb_height;
+	int num_threads = params.mdec_threads;
+	int i, start, length;
+	Uint16 *rl_stream;
+	const Uint16 **mb_start;
 
 	SDL_RWseek(src, 2, RW_SEEK_CUR); /* skip block length */
 
 	vlc_id = SDL_ReadLE16(src);
 	if (vlc_id != VLC_ID) {
 		fprintf(stderr, "mdec: Unknown vlc id: 0x%04x\n", vlc_id);
-		return;
+		return 0;
 	}
 
-	image = (Uint16 *) malloc(height2 * w * sizeof(Uint16));
-	if (!image) {
+	/* Read RL stream in memory */
+	start = SDL_RWtell(src);
+	length = SDL_RWseek(src, 0, RW_SEEK_END) - start;
+	SDL_RWseek(src, start, RW_SEEK_SET);
+
+	rl_stream = (Uint16 *) malloc(length);
+	mb_start = (const Uint16 **) malloc(num_mb * sizeof(Uint16 *));
+	if (!rl_stream || !mb_start) {
 		fprintf(stderr, "mdec: Can not allocate memory for temp buffer\n");
-		return;
+		free(rl_stream);
+		free(mb_start);
+		return 0;
+	}
+	length = SDL_RWread(src, rl_stream, 1, length) >> 1;
+	if (length<0) {
+		length = 0;
+	}
+
+	find_macroblocks(rl_stream, rl_stream+length, mb_start, num_mb);
+
+	if (num_threads > MAX_MDEC_THREADS) {
+		num_threads = MAX_MDEC_THREADS;
+	}
+	if (num_threads > num_mb) {
+		num_threads = num_mb;
 	}
+	if (num_threads < 1) {
+		num_threads = 1;
+	}
+
+	for (i=0; i<num_threads; i++) {
+		mdec_worker_t *worker = &workers[i];
+
+		worker->ctxt.src_end = rl_stream+length;
+		dequant_init(&worker->ctxt, 1);
+		worker->output = output;
+		worker->mb_start = mb_start;
+		worker->first_mb = (i*num_mb)/num_threads;
+		worker->num_mb = ((i+1)*num_mb)/num_threads - worker->first_mb;
+		worker->mb_height = mb_height;
+		worker->height = height;
+		worker->thread = NULL;
+	}
+
+	/* First range is decoded by the calling thread */
+	for (i=1; i<num_threads; i++) {
+#if SDL_VERSION_ATLEAST(2,0,0)
+		workers[i].thread = SDL_CreateThread(mdec_worker, "mdec", &workers[i]);
+#else
+		workers[i].thread = SDL_CreateThread(mdec_worker, &workers[i]);
+#endif
+		if (!workers[i].thread) {
+			fprintf(stderr, "mdec: can not create thread: %s\n", SDL_GetError());
+		}
+	}
+
+	decode_macroblocks(&workers[0]);
+
+	for (i=1; i<num_threads; i++) {
+		if (workers[i].thread) {
+			SDL_WaitThread(workers[i].thread, NULL);
+		} else {
+			decode_macroblocks(&workers[i]);
+		}
+	}
+
+	free(mb_start);
+	free(rl_stream);
+	return 1;
+}
+
+/* Copy to 24 bits buffer */
+static void write_row_rgb24(mdec_output_t *this, const Uint8 *rgb, int x, int y)
+{
+	memcpy(&this->pixels[y*this->pitch + x*3], rgb, 16*3);
+}
+
+void mdec_depack(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength,
+	int width, int height)
+{
+	mdec_output_t output;
+	Uint8 *dstPointer;
+	int dstBufLen;
+
+	*dstBufPtr = NULL;
+	*dstLength = 0;
 
 	dstBufLen = width*height*4;
-	dstPointer = (Uint16 *) malloc(dstBufLen);
+	dstPointer = (Uint8 *) malloc(dstBufLen);
 	if (!dstPointer) {
 		fprintf(stderr, "mdec: Can not allocate memory for final buffer\n");
-		free(image);
 		return;
 	}
 
-	iqtab_init(&ctxt);
-	bs_init();
+	output.writeRow = write_row_rgb24;
+	output.pixels = dstPointer;
+	output.pitch = width*3;
+
+	if (!mdec_decode(src, width, height, &output)) {
+		free(dstPointer);
+		return;
+	}
+
+	*dstBufPtr = dstPointer;
+	*dstLength = dstBufLen;
+}
+
+/*
+	Convert to texture format, same pixel position as mdec_surface(),
+	16 pixels row may continue on next texture row if cropped
+*/
+static void write_row_texture(mdec_output_t *this, const Uint8 *rgb, int x, int y)
+{
+	const SDL_PixelFormat *fmt = this->format;
+	int pos = y*this->src_width + x;
+	int tx = pos % this->width;
+	int ty = pos / this->width;
+	int i;
+
+	for (i=0; i<16; i++, tx++, rgb+=3) {
+		Uint8 *dst;
+		Uint32 color;
+
+		if (tx >= this->width) {
+			tx = 0;
+			ty++;
+		}
+		if (ty >= this->height) {
+			return;
+		}
+
+		dst = &this->pixels[(ty+this->offset)*this->pitch + (tx+this->offset)*this->bpp];
+
+		/* Same byte order as mdec_surface(): R,G,B */
+		switch(this->bpp) {
+			case 1:
+				*dst = dither_nearest_index(rgb[0],rgb[1],rgb[2]);
+				break;
+			case 2:
+				color = ((rgb[0]>>fmt->Rloss)<<fmt->Rshift)
+					| ((rgb[1]>>fmt->Gloss)<<fmt->Gshift)
+					| ((rgb[2]>>fmt->Bloss)<<fmt->Bshift)
+					| fmt->Amask;
+				*((Uint16 *) dst) = color;
+				break;
+			case 3:
+				dst[0] = rgb[0];
+				dst[1] = rgb[1];
+				dst[2] = rgb[2];
+				break;
+			case 4:
+				color = ((rgb[0]>>fmt->Rloss)<<fmt->Rshift)
+					| ((rgb[1]>>fmt->Gloss)<<fmt->Gshift)
+					| ((rgb[2]>>fmt->Bloss)<<fmt->Bshift)
+					| fmt->Amask;
+				*((Uint32 *) dst) = color;
+				break;
+		}
+	}
+}
+
+int mdec_depack_texture(SDL_RWops *src, render_texture_t *tex,
+	int width, int height, int row_offset)
+{
+	mdec_output_t output;
+	int y;
+
+	if (!tex->prepare_rgb(tex, width, height)) {
+		return 0;
+	}
 
-	for (x=0; x<width2; x+=w) {
-		Uint16 *dst,*src;
-		/*printf("x=%d\n",x);*/
+	output.writeRow = write_row_texture;
+	output.pixels = tex->pixels;
+	output.pitch = tex->pitch;
+	output.bpp = tex->bpp;
+	output.format = &(tex->format);
+	output.src_width = width;
+	output.width = width;
+	output.height = height;
+	output.offset = 0;
 
-		dec_dct_out(&ctxt,image,slice);
+	if (row_offset<0) {
+		output.offset = -row_offset>>1;
+		output.width += row_offset;
+		output.height -= output.offset*2;
 
-		src = image;
- 		/*dst = buf2+x+(0)*width;*/
-		dst = &dstPointer[x];
- 		for(y=height-1; y>=0; y--) {
- 			memcpy(dst,src,w*2);
- 			src+=w;
- 			dst+=width2;
- 		}
+		/* Borders stay black */
+		for (y=0; y<height; y++) {
+			memset(&tex->pixels[y*tex->pitch], 0, width*tex->bpp);
+		}
 	}
 
-	free(image);
+	if (!mdec_decode(src, width, height, &output)) {
+		return 0;
+	}
 
-	*dstBufPtr = (Uint8 *) dstPointer;
-	*dstLength = dstBufLen;
+	tex->download(tex);
+	return 1;
 }
 
 SDL_Surface *mdec_surface(Uint8 *source, int width, int height, int row_offset)
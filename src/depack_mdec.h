@@ -21,9 +21,24 @@
 #ifndef DEPACK_MDEC_H
 #define DEPACK_MDEC_H
 
+/*--- External types ---*/
+
+struct render_texture_s;
+
+/*--- Functions prototypes ---*/
+
+/* Init tables shared by decoding threads, once at startup */
+void mdec_init(void);
+
 void mdec_depack(SDL_RWops *src, Uint8 **dstPointer, int *dstLength,
 	int width, int height);
 
 SDL_Surface *mdec_surface(Uint8 *source, int width, int height, int row_offset);
 
+/* Decode directly in texture pixel format, with same cropping as
+   mdec_surface(). Return 0 if failed, or if texture needs a surface,
+   nothing is read from src in this case */
+int mdec_depack_texture(SDL_RWops *src, struct render_texture_s *tex,
+	int width, int height, int row_offset);
+
 #endif /* DEPACK_MDEC_H */
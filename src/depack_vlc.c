@@ -24,10 +24,13 @@
 */
 
 #include <stdio.h>
-#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <SDL.h>
 
+#include "depack_vlc.h"
+
 /*--- Defines ---*/
 
 #define VLC_ID		0x3800
@@ -45,6 +48,11 @@
 
 #define	Show_Bits(N)	(bitbuf>>(32-(N)))
 
+/* Length of AC code with sign bit, lookup tables sizes */
+#define	SBIT	17
+#define	AC_TAB1_BITS	11
+#define	AC_TAB2_BITS	(SBIT-7)
+
 #define	Flush_Buffer(N)	\
 	{	\
 		bitbuf <<=(N);	\
@@ -176,6 +184,7 @@ static const Uint32 VLCtab6[16*2] = {
 8	1111110xxxxxxxx	11111110xxxxxxxx	-255..-128,128..255
 */
 
+#ifdef ENABLE_VLC_REFERENCE
 static const Uint32 DC_Ytab0[48] = {
 	CODE1(0,-1,3),CODE1(0,-1,3),CODE1(0,-1,3),CODE1(0,-1,3),
 	CODE1(0,-1,3),CODE1(0,-1,3),CODE1(0,-1,3),CODE1(0,-1,3),
@@ -213,6 +222,21 @@ static const Uint32 DC_UVtab0[56] = {
 	CODE1(0,-7,6),CODE1(0,-6,6),CODE1(0,-5,6),CODE1(0,-4,6),
 	CODE1(0,4,6),CODE1(0,5,6),CODE1(0,6,6),CODE1(0,7,6),
 };
+#endif
+
+/*
+	DC size codes, as prefix code, prefix length, number of value bits
+*/
+
+static const Uint8 DC_Ysizes[9][3] = {
+	{0x4,3,0}, {0x0,2,1}, {0x1,2,2}, {0x5,3,3}, {0x6,3,4},
+	{0xe,4,5}, {0x1e,5,6}, {0x3e,6,7}, {0x7e,7,8}
+};
+
+static const Uint8 DC_UVsizes[9][3] = {
+	{0x0,2,0}, {0x1,2,1}, {0x2,2,2}, {0x6,3,3}, {0xe,4,4},
+	{0x1e,5,5}, {0x3e,6,6}, {0x7e,7,7}, {0xfe,8,8}
+};
 
 /*--- Types ---*/
 
@@ -225,14 +249,303 @@ typedef struct {
 
 /*--- Variables ---*/
 
+/*
+	AC codes lookup: first table is indexed by the 11 first bits of the
+	17 bits code, second one by the code itself when its 7 first bits
+	are 0. A 0 entry means use second table, or end of data.
+*/
+static Uint32 VLC_ACtab1[1<<AC_TAB1_BITS];
+static Uint32 VLC_ACtab2[1<<AC_TAB2_BITS];
+
+/* DC size lookup, indexed by 8 first bits: code length<<4 | value bits */
+static Uint8 VLC_DCYtab[256];
+static Uint8 VLC_DCUVtab[256];
+
+#ifdef ENABLE_VLC_REFERENCE
 static Uint16 *dstPointer;
 static int dstBufLen;
 static int dstOffset;
 
 static vlc_header_t vlcHeader;
+#endif
+
+/*--- Functions prototypes ---*/
+
+static Uint32 vlc_ac_code(Uint32 code);
+static void vlc_decode_mem(const Uint8 *src, int srcLength, const vlc_header_t *header,
+	Uint16 *dst, int total_length);
 
 /*--- Functions ---*/
 
+void vlc_depack(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength)
+{
+	Uint8 *srcBuffer;
+	int srcLength, start, end;
+	vlc_header_t header;
+
+	*dstBufPtr = NULL;
+	*dstLength = 0;
+
+	start = SDL_RWseek(src, 0, RW_SEEK_CUR);
+	end = SDL_RWseek(src, 0, RW_SEEK_END);
+	SDL_RWseek(src, start, RW_SEEK_SET);
+
+	header.length = SDL_ReadLE16(src);
+	header.id = SDL_ReadLE16(src);
+	if (header.id != VLC_ID) {
+		return;
+	}
+
+	/*
+		Each decoded word needs at most 22 bits of packed data, so only
+		read what can be used from the rest of the file
+	*/
+	srcLength = 8 + ((header.length + 2) * 4 * 22) / 8 + 4;
+	if (srcLength > end - start) {
+		srcLength = end - start;
+	}
+
+	srcBuffer = (Uint8 *) malloc(srcLength);
+	if (!srcBuffer) {
+		fprintf(stderr, "Can not allocate %d bytes to read VLC data\n", srcLength);
+		return;
+	}
+
+	SDL_RWseek(src, start, RW_SEEK_SET);
+	srcLength = SDL_RWread(src, srcBuffer, 1, srcLength);
+
+	vlc_depack_mem(srcBuffer, srcLength, dstBufPtr, dstLength);
+
+	free(srcBuffer);
+}
+
+void vlc_depack_mem(const Uint8 *src, int srcLength, Uint8 **dstBufPtr, int *dstLength)
+{
+	vlc_header_t header;
+	Uint16 *dst;
+	int dstBufLen;
+
+	*dstBufPtr = NULL;
+	*dstLength = 0;
+
+	if (srcLength < 8) {
+		return;
+	}
+
+	header.length = src[0] | (src[1]<<8);
+	header.id = src[2] | (src[3]<<8);
+	header.quant = src[4] | (src[5]<<8);
+	header.version = src[6] | (src[7]<<8);
+
+	if (header.id != VLC_ID) {
+		return;
+	}
+
+	dstBufLen = (header.length + 2) * sizeof(Uint32) * 2;
+	dst = (Uint16 *) malloc(dstBufLen);
+	if (dst == NULL) {
+		return;
+	}
+
+	dst[0] = SDL_SwapLE16(header.length);
+	dst[1] = SDL_SwapLE16(VLC_ID);
+
+	vlc_decode_mem(src+8, srcLength-8, &header, dst, dstBufLen>>1);
+
+	/* Return depacked buffer */
+	*dstBufPtr = (Uint8 *) dst;
+	*dstLength = dstBufLen;
+}
+
+/* Decode 17 bits AC code using Psxdev tables, return 0 if invalid */
+static Uint32 vlc_ac_code(Uint32 code)
+{
+	if (code>=1<<(SBIT- 2)) {
+		return VLCtabnext[(code>>12)-8];
+	} else if (code>=1<<(SBIT- 6)) {
+		return VLCtab0[(code>>8)-8];
+	} else if (code>=1<<(SBIT- 7)) {
+		return VLCtab1[(code>>6)-16];
+	} else if (code>=1<<(SBIT- 8)) {
+		return VLCtab2[(code>>4)-32];
+	} else if (code>=1<<(SBIT- 9)) {
+		return VLCtab3[(code>>3)-32];
+	} else if (code>=1<<(SBIT-10)) {
+		return VLCtab4[(code>>2)-32];
+	} else if (code>=1<<(SBIT-11)) {
+		return VLCtab5[(code>>1)-32];
+	} else if (code>=1<<(SBIT-12)) {
+		return VLCtab6[(code>>0)-32];
+	}
+
+	return 0;
+}
+
+void vlc_init(void)
+{
+	int i, j;
+
+	/* Codes which only need the first 11 bits */
+	for (i=0; i<(1<<AC_TAB1_BITS); i++) {
+		Uint32 code = i<<(SBIT-AC_TAB1_BITS);
+
+		VLC_ACtab1[i] = (code>=1<<AC_TAB2_BITS ? vlc_ac_code(code) : 0);
+	}
+
+	/* Longer codes, starting with 7 zero bits */
+	for (i=0; i<(1<<AC_TAB2_BITS); i++) {
+		VLC_ACtab2[i] = vlc_ac_code(i);
+	}
+
+	/* DC sizes */
+	memset(VLC_DCYtab, 0, sizeof(VLC_DCYtab));
+	memset(VLC_DCUVtab, 0, sizeof(VLC_DCUVtab));
+	for (i=0; i<9; i++) {
+		int len = DC_Ysizes[i][1];
+
+		for (j=0; j<(1<<(8-len)); j++) {
+			VLC_DCYtab[(DC_Ysizes[i][0]<<(8-len))|j] = ((len+DC_Ysizes[i][2])<<4)|DC_Ysizes[i][2];
+		}
+
+		/* Longest U,V code does not fit, left to decoder loop */
+		len = DC_UVsizes[i][1];
+		if (len+DC_UVsizes[i][2]>15) {
+			continue;
+		}
+		for (j=0; j<(1<<(8-len)); j++) {
+			VLC_DCUVtab[(DC_UVsizes[i][0]<<(8-len))|j] = ((len+DC_UVsizes[i][2])<<4)|DC_UVsizes[i][2];
+		}
+	}
+}
+
+/* Read next 16 bits word of packed data, 0 after end */
+#define	Read_Word(w)	\
+	{	\
+		w = (srcPos+2<=srcLength ? src[srcPos]|(src[srcPos+1]<<8) : 0);	\
+		srcPos+=2;	\
+	}
+
+#define	Flush_MemBuffer(N)	\
+	{	\
+		bitbuf <<=(N);	\
+		incnt +=(N);	\
+		while(incnt>=0) {	\
+			Read_Word(word)	\
+			bitbuf |= word <<incnt;	\
+			incnt-=16;	\
+		}	\
+	}
+
+#define	Write_Code(code)	\
+	if (dstOffset<total_length) {	\
+		dst[dstOffset++] = SDL_SwapLE16(code);	\
+	} else {	\
+		fprintf(stderr, "vlc: writing out of range: %d\n", dstOffset*2);	\
+	}
+
+static void vlc_decode_mem(const Uint8 *src, int srcLength, const vlc_header_t *header,
+	Uint16 *dst, int total_length)
+{
+	Uint32	bitbuf, word;
+	int incnt, q_code, n, srcPos = 0, dstOffset = 2;
+	int last_dc[3];
+
+	/* Init buffer */
+	Read_Word(word)
+	bitbuf = word<<16;
+	Read_Word(word)
+	bitbuf |= word;
+	incnt = -16;
+
+	q_code = header->quant << 10;
+	n = last_dc[0] = last_dc[1] = last_dc[2] = 0;
+	while(dstOffset < total_length) {
+		Uint32 code2;
+
+		/* DC */
+		if (header->version==2) {
+			code2 = Show_Bits(10)|(10<<16); /* DC code */
+		} else {
+			int dc_size, *dc = &last_dc[n>=2 ? 2 : n];
+
+			dc_size = (n>=2 ? VLC_DCYtab : VLC_DCUVtab)[Show_Bits(8)];
+			if (dc_size) {
+				int bit = dc_size & 15, nbit = dc_size>>4, val = 0;
+
+				if (bit) {
+					val = Show_Bits(nbit)&((1<<bit)-1);
+					if ((val&(1<<(bit-1)))==0)
+						val -= (1<<bit)-1;
+				}
+				val = (*dc+=val*4);
+				code2 = (nbit<<16) | (val&0x3ff);
+			} else if (n>=2) {
+				/* Y, longer than table */
+				int nbit,val;
+				int bit = 8;
+				while(Show_Bits(bit)&1) {
+					bit++;
+				}
+				bit++;
+				nbit = bit*2-1;
+				val = Show_Bits(nbit)&((1<<bit)-1);
+				if ((val&(1<<(bit-1)))==0)
+					val -= (1<<bit)-1;
+				val = (*dc+=val*4);
+				code2 = (nbit<<16) | (val&0x3ff);
+			} else {
+				/* U,V, longer than table */
+				int nbit,val;
+				int bit = 8;
+				while(Show_Bits(bit)&1) {
+					bit++;
+				}
+				nbit = bit*2;
+				val = Show_Bits(nbit)&((1<<bit)-1);
+				if ((val&(1<<(bit-1)))==0)
+					val -= (1<<bit)-1;
+				val = (*dc+=val*4);
+				code2 = (nbit<<16) | (val&0x3ff);
+			}
+			if (++n==6)
+				n=0;
+		}
+		code2 |= q_code;
+
+		/* AC */
+		for(;;) {
+			Write_Code(code2)
+			Flush_MemBuffer(BITOF(code2));
+
+			code2 = VLC_ACtab1[Show_Bits(AC_TAB1_BITS)];
+			if (code2==0) {
+				code2 = VLC_ACtab2[Show_Bits(SBIT)];
+				if (code2==0) {
+					/* End of data */
+					while(dstOffset < total_length) {
+						dst[dstOffset++] = SDL_SwapLE16(EOB);
+					}
+					return;
+				}
+			} else if (code2==EOB_CODE) {
+				break;
+			} else if (code2==ESCAPE_CODE) {
+				Flush_MemBuffer(6); /* ESCAPE len */
+				code2 = Show_Bits(16)| (16<<16);
+			}
+		}
+		Write_Code(code2) /* EOB code */
+		Flush_MemBuffer(2); /* EOB bitlen */
+	}
+}
+
+#ifdef ENABLE_VLC_REFERENCE
+
+/*
+	Reference decoder, reading data from stream, to compare results and
+	performance with vlc_depack()
+*/
+
 static void vlc_decode(SDL_RWops *src)
 {
 	Uint16	tmp0[2];
@@ -304,7 +617,6 @@ static void vlc_decode(SDL_RWops *src)
 		/* AC */
 		for(;;) {
 #define	code code2
-#define	SBIT	17
 			/*printf("%d: 0x%04x\n", dstOffset, code2);*/
 			if (dstOffset<total_length) {
 				dstPointer[dstOffset++]= SDL_SwapLE16(code2);
@@ -354,7 +666,7 @@ static void vlc_decode(SDL_RWops *src)
 	/*printf("vlc: end at %d bytes written\n", dstOffset*2);*/
 }
 
-void vlc_depack(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength)
+void vlc_depack_ref(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength)
 {
 	*dstBufPtr = NULL;
 	*dstLength = 0;
@@ -389,3 +701,5 @@ void vlc_depack(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength)
 	*dstBufPtr = (Uint8 *) dstPointer;
 	*dstLength = dstBufLen;
 }
+
+#endif /* ENABLE_VLC_REFERENCE */
@@ -21,6 +21,17 @@
 #ifndef DEPACK_VLC_H
 #define DEPACK_VLC_H
 
+/* Init tables shared by decoding threads, once at startup */
+void vlc_init(void);
+
 void vlc_depack(SDL_RWops *src, Uint8 **dstPointer, int *dstLength);
 
+/* Same, from packed data already in memory */
+void vlc_depack_mem(const Uint8 *src, int srcLength, Uint8 **dstPointer, int *dstLength);
+
+#ifdef ENABLE_VLC_REFERENCE
+/* Previous decoder, reading data from stream */
+void vlc_depack_ref(SDL_RWops *src, Uint8 **dstPointer, int *dstLength);
+#endif
+
 #endif /* DEPACK_VLC_H */
@@ -0,0 +1,951 @@
+/*
+	Disk cache of decoded backgrounds
+
+	Copyright (C) 2017	Patrice Mandin
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*--- Includes ---*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#define DISKCACHE_MMAP 1
+#endif
+#if defined(HAVE_SYS_STAT_H) && defined(HAVE_MKDIR)
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include "video.h"
+#include "parameters.h"
+#include "filesystem.h"
+#include "log.h"
+#include "diskcache.h"
+
+#include "g_common/game.h"
+#include "g_common/room.h"
+
+#include "r_common/render.h"
+#include "r_common/render_texture.h"
+
+/*--- Defines ---*/
+
+#if SDL_VERSION_ATLEAST(2,0,0)
+#define REEVENGI_SDLSURF_FLAGS 0
+#else
+#define REEVENGI_SDLSURF_FLAGS SDL_SWSURFACE
+#endif
+
+#define DISKCACHE_MAGIC		"RBGC"
+#define DISKCACHE_VERSION	2
+#define DISKCACHE_BYTEORDER	0x01020304UL
+
+/* Offset of entries in cache file */
+#define DISKCACHE_ALIGN(x)	(((x)+15) & ~15)
+
+/* Video mode of texture pixels written by prepare_rgb(), 0 for pixels
+   valid in any mode */
+#define DISKCACHE_MODE(bpp,linear,dither)	(0x10000|((bpp)<<8)|((linear)<<1)|(dither))
+
+/* Rooms tried when populating, as game->next_stage() and next_room() */
+#define POPULATE_STAGES	7
+#define POPULATE_ROOMS	0x1d
+
+#define MAX_POPULATE_THREADS	16
+
+enum {
+	ENTRY_SURFACE=0,
+	ENTRY_DATA
+};
+
+/*--- Types ---*/
+
+/* Cache file: header, entries, then index of entries. Everything is in
+   native byte order, so cache file is not valid on other architecture */
+
+#ifdef DISKCACHE_MMAP
+/* Mapping of a cache file, kept until cache file and all surfaces using
+   its pixels release it */
+typedef struct {
+	Uint8 *data;
+	size_t length;
+	int refcount;
+} diskcache_map_t;
+
+typedef struct {
+	SDL_Surface *surface;
+	diskcache_map_t *map;
+} diskcache_mapped_t;
+#endif
+
+typedef struct {
+	char magic[4];
+	Uint32 version;
+	Uint32 byteorder;
+	Uint32 src_length;	/* Game file length */
+	Uint32 src_mtime;	/* Game file modification time */
+	Uint32 num_entries;
+	Uint32 index_offset;
+} diskcache_header_t;
+
+typedef struct {
+	Uint32 num_item;	/* Image or data number in game file */
+	Uint16 type, bpp;
+	Uint16 w, h;
+	Uint32 pitch;
+	Uint32 rmask, gmask, bmask, amask;
+	Uint32 num_colors;	/* Palette is after pixels */
+	Uint32 mode;		/* DISKCACHE_MODE(), or 0 */
+	Uint32 offset, length;
+} diskcache_entry_t;
+
+typedef struct {
+	char *filename;		/* Game file */
+	char *cachename;	/* Cache file */
+	int valid;		/* 0 if cache file can not be used */
+
+	diskcache_header_t header;
+	diskcache_entry_t *entries;
+
+#ifdef DISKCACHE_MMAP
+	diskcache_map_t *map;
+#endif
+} diskcache_file_t;
+
+typedef struct {
+	SDL_Thread *thread;
+	int num_rooms, num_cameras;
+} populate_worker_t;
+
+/*--- Variables ---*/
+
+/* Created by diskcache_init(), if cache enabled */
+static SDL_mutex *mutex = NULL;
+
+static int num_files = 0;
+static diskcache_file_t *files = NULL;
+
+#ifdef DISKCACHE_MMAP
+/* Only surfaces loaded by main thread use mapped pixels, populating
+   threads append entries all the time and would remap files at each load */
+#if SDL_VERSION_ATLEAST(2,0,0)
+static SDL_threadID main_thread;
+#else
+static Uint32 main_thread;
+#endif
+
+/* Surfaces using mapped pixels, until diskcache_free_surface() */
+static int num_mapped = 0;
+static diskcache_mapped_t *mapped = NULL;
+#endif
+
+static int num_hits = 0, num_misses = 0, num_saves = 0;
+
+static int populate_next;
+
+/*--- Functions prototypes ---*/
+
+static int lock_cache(void);
+static void unlock_cache(void);
+
+static diskcache_file_t *get_file(const char *filename);
+static void open_file(diskcache_file_t *file);
+static int read_index(diskcache_file_t *file, FILE *fp, PHYSFS_sint64 length, PHYSFS_sint64 mtime);
+static diskcache_entry_t *find_entry(diskcache_file_t *file, int type, int num_item, Uint32 mode);
+static int append_entry(diskcache_file_t *file, diskcache_entry_t *entry,
+	Uint8 *data, int pitch, int num_rows, void *palette, int palette_length);
+static Uint8 *read_entry(diskcache_file_t *file, diskcache_entry_t *entry, int *allocated);
+
+static Uint32 texture_mode(void);
+static void save_image(const char *filename, int num_image, int bpp, int w, int h,
+	int pitch, Uint32 rmask, Uint32 gmask, Uint32 bmask, Uint32 amask,
+	Uint8 *pixels, SDL_Palette *palette, Uint32 mode);
+static SDL_Surface *entry_surface(diskcache_file_t *file, diskcache_entry_t *entry);
+
+#ifdef DISKCACHE_MMAP
+static void release_map(diskcache_map_t *map);
+#endif
+
+static int populate_thread(void *data);
+static void populate_room(populate_worker_t *worker, int num_stage, int num_room);
+
+/*--- Functions ---*/
+
+void diskcache_init(void)
+{
+	if (!params.diskcache) {
+		return;
+	}
+
+	mutex = SDL_CreateMutex();
+	if (!mutex) {
+		fprintf(stderr, "diskcache: can not create mutex: %s\n", SDL_GetError());
+		params.diskcache = NULL;
+		return;
+	}
+#if defined(HAVE_SYS_STAT_H) && defined(HAVE_MKDIR)
+	mkdir(params.diskcache, 0755);
+#endif
+#ifdef DISKCACHE_MMAP
+	main_thread = SDL_ThreadID();
+#endif
+}
+
+SDL_Surface *diskcache_load_surface(const char *filename, int num_image)
+{
+	diskcache_file_t *file;
+	diskcache_entry_t *entry;
+	SDL_Surface *surface = NULL;
+
+	if (!lock_cache()) {
+		return NULL;
+	}
+
+	file = get_file(filename);
+	if (file) {
+		entry = find_entry(file, ENTRY_SURFACE, num_image, texture_mode());
+		if (entry) {
+			surface = entry_surface(file, entry);
+		}
+	}
+
+	if (surface) {
+		++num_hits;
+	} else {
+		++num_misses;
+	}
+	unlock_cache();
+
+	logMsg(2, "diskcache: %s image %d %s\n", filename, num_image, surface ? "hit" : "miss");
+
+	return surface;
+}
+
+void diskcache_free_surface(SDL_Surface *surface)
+{
+#ifdef DISKCACHE_MMAP
+	int i;
+
+	if (surface && mutex) {
+		SDL_LockMutex(mutex);
+		for (i=0; i<num_mapped; i++) {
+			if (mapped[i].surface == surface) {
+				release_map(mapped[i].map);
+				mapped[i] = mapped[--num_mapped];
+				break;
+			}
+		}
+		SDL_UnlockMutex(mutex);
+	}
+#endif
+
+	SDL_FreeSurface(surface);
+}
+
+void diskcache_save_surface(const char *filename, int num_image, SDL_Surface *surface)
+{
+	SDL_PixelFormat *fmt;
+
+	if (!surface) {
+		return;
+	}
+
+	fmt = surface->format;
+
+	SDL_LockSurface(surface);
+	save_image(filename, num_image, fmt->BitsPerPixel, surface->w, surface->h,
+		surface->pitch, fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask,
+		surface->pixels, fmt->palette, 0);
+	SDL_UnlockSurface(surface);
+}
+
+void diskcache_save_texture(const char *filename, int num_image, render_texture_t *texture)
+{
+	SDL_PixelFormat *fmt;
+
+	/* Palette indexes of 8 bits textures depend on video mode */
+	if (!texture || !texture->pixels || (texture->bpp == 1)) {
+		return;
+	}
+
+	fmt = &(texture->format);
+
+	/* 24 bits textures hold full precision pixels, others are in video
+	   format */
+	save_image(filename, num_image, fmt->BitsPerPixel, texture->w, texture->h,
+		texture->pitch, fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask,
+		texture->pixels, NULL, (texture->bpp == 3) ? 0 : texture_mode());
+}
+
+void *diskcache_load_data(const char *filename, int num_data, int *length)
+{
+	diskcache_file_t *file;
+	diskcache_entry_t *entry;
+	Uint8 *data = NULL;
+
+	if (!lock_cache()) {
+		return NULL;
+	}
+
+	file = get_file(filename);
+	if (file) {
+		entry = find_entry(file, ENTRY_DATA, num_data, 0);
+		if (entry) {
+			int allocated;
+			Uint8 *src = read_entry(file, entry, &allocated);
+
+			if (src && allocated) {
+				data = src;
+				*length = entry->length;
+			} else if (src) {
+				data = (Uint8 *) malloc(entry->length);
+				if (data) {
+					memcpy(data, src, entry->length);
+					*length = entry->length;
+				}
+			}
+		}
+	}
+
+	if (data) {
+		++num_hits;
+	} else {
+		++num_misses;
+	}
+	unlock_cache();
+
+	logMsg(2, "diskcache: %s data %d %s\n", filename, num_data, data ? "hit" : "miss");
+
+	return data;
+}
+
+void diskcache_save_data(const char *filename, int num_data, void *data, int length)
+{
+	diskcache_file_t *file;
+	diskcache_entry_t entry;
+
+	if (!data || (length<=0) || !lock_cache()) {
+		return;
+	}
+
+	file = get_file(filename);
+	if (file && !find_entry(file, ENTRY_DATA, num_data, 0)) {
+		memset(&entry, 0, sizeof(entry));
+		entry.num_item = num_data;
+		entry.type = ENTRY_DATA;
+
+		if (append_entry(file, &entry, data, length, 1, NULL, 0)) {
+			++num_saves;
+		}
+	}
+
+	unlock_cache();
+}
+
+void diskcache_populate(int num_threads)
+{
+	populate_worker_t workers[MAX_POPULATE_THREADS];
+	int i, num_rooms = 0, num_cameras = 0;
+	Uint32 start;
+
+	if (!lock_cache()) {
+		logMsg(0, "diskcache: no cache directory, use -diskcache\n");
+		return;
+	}
+	unlock_cache();
+
+	if (num_threads > MAX_POPULATE_THREADS) {
+		num_threads = MAX_POPULATE_THREADS;
+	}
+
+	logMsg(0, "diskcache: populating %s with %d threads\n", params.diskcache, num_threads);
+
+	start = SDL_GetTicks();
+	populate_next = 0;
+
+	memset(workers, 0, sizeof(workers));
+
+	/* First worker is run by the calling thread */
+	for (i=1; i<num_threads; i++) {
+#if SDL_VERSION_ATLEAST(2,0,0)
+		workers[i].thread = SDL_CreateThread(populate_thread, "diskcache", &workers[i]);
+#else
+		workers[i].thread = SDL_CreateThread(populate_thread, &workers[i]);
+#endif
+		if (!workers[i].thread) {
+			fprintf(stderr, "diskcache: can not create thread: %s\n", SDL_GetError());
+		}
+	}
+
+	populate_thread(&workers[0]);
+
+	for (i=0; i<num_threads; i++) {
+		if ((i>0) && workers[i].thread) {
+			SDL_WaitThread(workers[i].thread, NULL);
+		}
+		num_rooms += workers[i].num_rooms;
+		num_cameras += workers[i].num_cameras;
+	}
+
+	logMsg(0, "diskcache: %d rooms, %d cameras, %d entries saved in %d ms\n",
+		num_rooms, num_cameras, num_saves, SDL_GetTicks()-start);
+}
+
+void diskcache_shutdown(void)
+{
+	int i;
+
+	if (!mutex) {
+		return;
+	}
+
+	logMsg(1, "diskcache: %d hits, %d misses, %d saves\n", num_hits, num_misses, num_saves);
+
+	for (i=0; i<num_files; i++) {
+#ifdef DISKCACHE_MMAP
+		if (files[i].map) {
+			release_map(files[i].map);
+		}
+#endif
+		free(files[i].entries);
+		free(files[i].cachename);
+		free(files[i].filename);
+	}
+	free(files);
+	files = NULL;
+	num_files = 0;
+
+#ifdef DISKCACHE_MMAP
+	/* Surfaces not freed keep their mapping */
+	free(mapped);
+	mapped = NULL;
+	num_mapped = 0;
+#endif
+
+	SDL_DestroyMutex(mutex);
+	mutex = NULL;
+}
+
+/* Return 0 if cache disabled */
+static int lock_cache(void)
+{
+	if (!params.diskcache || !mutex) {
+		return 0;
+	}
+
+	SDL_LockMutex(mutex);
+	return 1;
+}
+
+static void unlock_cache(void)
+{
+	SDL_UnlockMutex(mutex);
+}
+
+static diskcache_file_t *get_file(const char *filename)
+{
+	diskcache_file_t *new_files, *file;
+	char *src;
+	int i;
+
+	for (i=0; i<num_files; i++) {
+		if (strcmp(files[i].filename, filename) == 0) {
+			return (files[i].valid ? &files[i] : NULL);
+		}
+	}
+
+	new_files = (diskcache_file_t *) realloc(files, (num_files+1) * sizeof(diskcache_file_t));
+	if (!new_files) {
+		fprintf(stderr, "diskcache: can not allocate memory for %s\n", filename);
+		return NULL;
+	}
+	files = new_files;
+
+	file = &files[num_files];
+	memset(file, 0, sizeof(diskcache_file_t));
+
+	file->filename = strdup(filename);
+	file->cachename = (char *) malloc(strlen(params.diskcache)+strlen(filename)+32);
+	if (!file->filename || !file->cachename) {
+		free(file->filename);
+		free(file->cachename);
+		fprintf(stderr, "diskcache: can not allocate memory for %s\n", filename);
+		return NULL;
+	}
+	++num_files;
+
+	/* One cache file per game file */
+	sprintf(file->cachename, "%s/%d-%d-", params.diskcache, game->major, game->minor);
+	for (src=(char *) filename, i=strlen(file->cachename); *src; src++) {
+		file->cachename[i++] = ((*src=='/') || (*src=='\\') || (*src==':')) ? '_' : *src;
+	}
+	strcpy(&file->cachename[i], ".bgc");
+
+	open_file(file);
+
+	return (file->valid ? file : NULL);
+}
+
+/* Read cache file index, create new cache file if not valid */
+static void open_file(diskcache_file_t *file)
+{
+	PHYSFS_sint64 length, mtime;
+	FILE *fp;
+
+	if (!FS_Stat(file->filename, &length, &mtime)) {
+		return;
+	}
+
+	fp = fopen(file->cachename, "rb");
+	if (fp) {
+		file->valid = read_index(file, fp, length, mtime);
+		fclose(fp);
+		if (file->valid) {
+			logMsg(1, "diskcache: %s: %d entries\n", file->cachename,
+				file->header.num_entries);
+			return;
+		}
+	}
+
+	memcpy(file->header.magic, DISKCACHE_MAGIC, 4);
+	file->header.version = DISKCACHE_VERSION;
+	file->header.byteorder = DISKCACHE_BYTEORDER;
+	file->header.src_length = length;
+	file->header.src_mtime = mtime;
+	file->header.num_entries = 0;
+	file->header.index_offset = sizeof(diskcache_header_t);
+
+	fp = fopen(file->cachename, "wb");
+	if (!fp) {
+		logMsg(1, "diskcache: can not create %s\n", file->cachename);
+		return;
+	}
+	file->valid = (fwrite(&file->header, sizeof(diskcache_header_t), 1, fp) == 1);
+	fclose(fp);
+
+	logMsg(1, "diskcache: %s: created\n", file->cachename);
+}
+
+static int read_index(diskcache_file_t *file, FILE *fp, PHYSFS_sint64 length, PHYSFS_sint64 mtime)
+{
+	diskcache_header_t *header = &file->header;
+	long file_length;
+	int i;
+
+	if (fread(header, sizeof(diskcache_header_t), 1, fp) != 1) {
+		return 0;
+	}
+
+	if ((memcmp(header->magic, DISKCACHE_MAGIC, 4) != 0)
+	    || (header->version != DISKCACHE_VERSION)
+	    || (header->byteorder != DISKCACHE_BYTEORDER))
+	{
+		logMsg(1, "diskcache: %s: unknown format\n", file->cachename);
+		return 0;
+	}
+
+	if ((header->src_length != (Uint32) length) || (header->src_mtime != (Uint32) mtime)) {
+		logMsg(1, "diskcache: %s: game file changed\n", file->cachename);
+		return 0;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	file_length = ftell(fp);
+
+	if ((header->index_offset < sizeof(diskcache_header_t))
+	    || (header->index_offset + header->num_entries * sizeof(diskcache_entry_t) > file_length))
+	{
+		logMsg(1, "diskcache: %s: truncated\n", file->cachename);
+		return 0;
+	}
+
+	if (header->num_entries == 0) {
+		return 1;
+	}
+
+	file->entries = (diskcache_entry_t *) malloc(header->num_entries * sizeof(diskcache_entry_t));
+	if (!file->entries) {
+		return 0;
+	}
+
+	fseek(fp, header->index_offset, SEEK_SET);
+	if (fread(file->entries, sizeof(diskcache_entry_t), header->num_entries, fp) != header->num_entries) {
+		return 0;
+	}
+
+	for (i=0; i<header->num_entries; i++) {
+		diskcache_entry_t *entry = &file->entries[i];
+
+		if ((entry->offset < sizeof(diskcache_header_t)) || (entry->offset + entry->length > header->index_offset)) {
+			logMsg(1, "diskcache: %s: invalid entry %d\n", file->cachename, i);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* Return entry valid in any mode, or written in given mode */
+static diskcache_entry_t *find_entry(diskcache_file_t *file, int type, int num_item, Uint32 mode)
+{
+	diskcache_entry_t *entry;
+	int i;
+
+	for (i=0; i<file->header.num_entries; i++) {
+		entry = &file->entries[i];
+		if ((entry->type == type) && (entry->num_item == num_item)
+		    && ((entry->mode == 0) || (entry->mode == mode)))
+		{
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static Uint32 texture_mode(void)
+{
+	int linear = (params.linear != 0);
+	int dither = ((video.bpp == 8) && render.dithering);
+
+	return DISKCACHE_MODE(video.bpp, linear, dither);
+}
+
+static void save_image(const char *filename, int num_image, int bpp, int w, int h,
+	int pitch, Uint32 rmask, Uint32 gmask, Uint32 bmask, Uint32 amask,
+	Uint8 *pixels, SDL_Palette *palette, Uint32 mode)
+{
+	diskcache_file_t *file;
+	diskcache_entry_t entry;
+
+	if (!lock_cache()) {
+		return;
+	}
+
+	file = get_file(filename);
+	if (!file || find_entry(file, ENTRY_SURFACE, num_image, mode)) {
+		unlock_cache();
+		return;
+	}
+
+	memset(&entry, 0, sizeof(entry));
+	entry.num_item = num_image;
+	entry.type = ENTRY_SURFACE;
+	entry.bpp = bpp;
+	entry.w = w;
+	entry.h = h;
+	entry.pitch = pitch;
+	entry.rmask = rmask;
+	entry.gmask = gmask;
+	entry.bmask = bmask;
+	entry.amask = amask;
+	entry.mode = mode;
+	if (palette) {
+		entry.num_colors = palette->ncolors;
+	}
+
+	if (append_entry(file, &entry, pixels, pitch, h,
+		palette ? palette->colors : NULL, entry.num_colors * sizeof(SDL_Color)))
+	{
+		++num_saves;
+	}
+
+	unlock_cache();
+}
+
+/* Write entry data at end of cache file, then new index and header */
+static int append_entry(diskcache_file_t *file, diskcache_entry_t *entry,
+	Uint8 *data, int pitch, int num_rows, void *palette, int palette_length)
+{
+	diskcache_entry_t *new_entries;
+	FILE *fp;
+	int y, ok = 1;
+
+	new_entries = (diskcache_entry_t *) realloc(file->entries,
+		(file->header.num_entries+1) * sizeof(diskcache_entry_t));
+	if (!new_entries) {
+		return 0;
+	}
+	file->entries = new_entries;
+
+	fp = fopen(file->cachename, "r+b");
+	if (!fp) {
+		logMsg(1, "diskcache: can not write %s\n", file->cachename);
+		file->valid = 0;
+		return 0;
+	}
+
+	entry->offset = DISKCACHE_ALIGN(file->header.index_offset);
+	entry->length = pitch*num_rows + palette_length;
+
+	fseek(fp, entry->offset, SEEK_SET);
+	for (y=0; (y<num_rows) && ok; y++) {
+		ok = (fwrite(data + y*pitch, pitch, 1, fp) == 1);
+	}
+	if (ok && palette_length) {
+		ok = (fwrite(palette, palette_length, 1, fp) == 1);
+	}
+
+	if (ok) {
+		memcpy(&file->entries[file->header.num_entries++], entry, sizeof(diskcache_entry_t));
+		file->header.index_offset = entry->offset + entry->length;
+
+		ok = (fwrite(file->entries, sizeof(diskcache_entry_t), file->header.num_entries, fp)
+			== file->header.num_entries);
+	}
+	if (ok) {
+		fseek(fp, 0, SEEK_SET);
+		ok = (fwrite(&file->header, sizeof(diskcache_header_t), 1, fp) == 1);
+	}
+
+	if (fclose(fp) != 0) {
+		ok = 0;
+	}
+
+	if (!ok) {
+		/* Header and index may not match anymore */
+		logMsg(1, "diskcache: error writing %s\n", file->cachename);
+		file->valid = 0;
+	}
+
+	return ok;
+}
+
+/* Return pointer to entry data, mapped or allocated */
+static Uint8 *read_entry(diskcache_file_t *file, diskcache_entry_t *entry, int *allocated)
+{
+	Uint8 *data;
+	FILE *fp;
+
+	*allocated = 0;
+
+#ifdef DISKCACHE_MMAP
+	/* Other threads read a copy */
+	if (SDL_ThreadID() == main_thread) {
+		if (!file->map || (entry->offset + entry->length > file->map->length)) {
+			diskcache_map_t *map;
+
+			map = (diskcache_map_t *) calloc(1, sizeof(diskcache_map_t));
+			fp = fopen(file->cachename, "rb");
+			if (map && fp) {
+				map->length = file->header.index_offset;
+				map->data = (Uint8 *) mmap(NULL, map->length, PROT_READ|PROT_WRITE,
+					MAP_PRIVATE, fileno(fp), 0);
+			}
+			if (fp) {
+				fclose(fp);
+			}
+
+			if (map && map->data && (map->data != (Uint8 *) MAP_FAILED)) {
+				/* Map whole file again, with new entries. Previous
+				   mapping stays until its surfaces are freed */
+				if (file->map) {
+					release_map(file->map);
+				}
+
+				map->refcount = 1;
+				file->map = map;
+			} else {
+				free(map);
+			}
+		}
+
+		if (file->map && (entry->offset + entry->length <= file->map->length)) {
+			return file->map->data + entry->offset;
+		}
+	}
+#endif
+
+	/* Read it */
+	data = (Uint8 *) malloc(entry->length);
+	if (!data) {
+		return NULL;
+	}
+
+	fp = fopen(file->cachename, "rb");
+	if (!fp) {
+		free(data);
+		return NULL;
+	}
+	fseek(fp, entry->offset, SEEK_SET);
+	if (fread(data, entry->length, 1, fp) != 1) {
+		free(data);
+		data = NULL;
+	}
+	fclose(fp);
+
+	*allocated = (data != NULL);
+	return data;
+}
+
+static SDL_Surface *entry_surface(diskcache_file_t *file, diskcache_entry_t *entry)
+{
+	SDL_Surface *surface;
+	SDL_Color *palette;
+	Uint8 *data;
+	int allocated;
+
+	/* Pixels and palette must fit in entry */
+	if (((Uint64) entry->pitch * 8 < (Uint64) entry->w * entry->bpp)
+		|| (entry->num_colors > 256)
+		|| ((Uint64) entry->pitch * entry->h + entry->num_colors * sizeof(SDL_Color) > entry->length))
+	{
+		logMsg(1, "diskcache: %s: invalid image %d\n", file->cachename, (int) entry->num_item);
+		return NULL;
+	}
+
+	data = read_entry(file, entry, &allocated);
+	if (!data) {
+		return NULL;
+	}
+
+	if (!allocated) {
+		/* Pixels stay in mapped file */
+		surface = SDL_CreateRGBSurfaceFrom(data, entry->w, entry->h, entry->bpp,
+			entry->pitch, entry->rmask, entry->gmask, entry->bmask, entry->amask);
+#ifdef DISKCACHE_MMAP
+		if (surface) {
+			diskcache_mapped_t *new_mapped;
+
+			new_mapped = (diskcache_mapped_t *) realloc(mapped,
+				(num_mapped+1) * sizeof(diskcache_mapped_t));
+			if (!new_mapped) {
+				SDL_FreeSurface(surface);
+				return NULL;
+			}
+			mapped = new_mapped;
+
+			mapped[num_mapped].surface = surface;
+			mapped[num_mapped].map = file->map;
+			++num_mapped;
+			++file->map->refcount;
+		}
+#endif
+	} else {
+		surface = SDL_CreateRGBSurface(REEVENGI_SDLSURF_FLAGS, entry->w, entry->h, entry->bpp,
+			entry->rmask, entry->gmask, entry->bmask, entry->amask);
+		if (surface) {
+			int y, line_length = entry->pitch;
+
+			if (surface->pitch < line_length) {
+				line_length = surface->pitch;
+			}
+
+			SDL_LockSurface(surface);
+			for (y=0; y<entry->h; y++) {
+				memcpy((Uint8 *) surface->pixels + y*surface->pitch,
+					data + y*entry->pitch, line_length);
+			}
+			SDL_UnlockSurface(surface);
+		}
+	}
+
+	if (surface && entry->num_colors) {
+		palette = (SDL_Color *) (data + entry->pitch*entry->h);
+#if SDL_VERSION_ATLEAST(2,0,0)
+		SDL_SetPaletteColors(surface->format->palette, palette, 0, entry->num_colors);
+#else
+		SDL_SetPalette(surface, SDL_LOGPAL|SDL_PHYSPAL, palette, 0, entry->num_colors);
+#endif
+	}
+
+	if (allocated) {
+		free(data);
+	}
+
+	return surface;
+}
+
+#ifdef DISKCACHE_MMAP
+static void release_map(diskcache_map_t *map)
+{
+	if (--map->refcount > 0) {
+		return;
+	}
+
+	munmap(map->data, map->length);
+	free(map);
+}
+#endif
+
+static int populate_thread(void *data)
+{
+	populate_worker_t *worker = (populate_worker_t *) data;
+
+	for (;;) {
+		int num_task;
+
+		SDL_LockMutex(mutex);
+		num_task = populate_next++;
+		SDL_UnlockMutex(mutex);
+
+		if (num_task >= POPULATE_STAGES*POPULATE_ROOMS) {
+			break;
+		}
+
+		populate_room(worker, 1+(num_task / POPULATE_ROOMS), num_task % POPULATE_ROOMS);
+	}
+
+	return 0;
+}
+
+/* Load all backgrounds and masks of room, loaders store them in cache */
+static void populate_room(populate_worker_t *worker, int num_stage, int num_room)
+{
+	room_t *room;
+	int num_camera, num_cameras;
+
+	room = game->room_ctor(game, num_stage, num_room);
+	if (!room) {
+		return;
+	}
+
+	room->loadFile(room);
+	if (room->file) {
+		num_cameras = room->getNumCameras(room);
+
+		logMsg(1, "diskcache: stage %d room %d: %d cameras\n", num_stage, num_room, num_cameras);
+
+		for (num_camera=0; num_camera<num_cameras; num_camera++) {
+			room->load_background(room, num_stage, num_room, num_camera);
+			if (room->background) {
+				room->background->shutdown(room->background);
+				room->background = NULL;
+			}
+
+			room->load_bgmask(room, num_stage, num_room, num_camera);
+			if (room->bg_mask) {
+				room->bg_mask->shutdown(room->bg_mask);
+				room->bg_mask = NULL;
+			}
+		}
+
+		++worker->num_rooms;
+		worker->num_cameras += num_cameras;
+	}
+
+	room->dtor(room);
+}
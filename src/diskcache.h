@@ -0,0 +1,62 @@
+/*
+	Disk cache of decoded backgrounds
+
+	Copyright (C) 2017	Patrice Mandin
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef DISKCACHE_H
+#define DISKCACHE_H 1
+
+/*--- External types ---*/
+
+struct render_texture_s;
+
+/*--- Functions prototypes ---*/
+
+/* Create cache directory and lock, from main thread before any other
+   thread uses the cache */
+void diskcache_init(void);
+
+/* Return image num_image of game file decoded, or NULL if not in cache.
+   Pixels are mapped from cache file when possible, for main thread, so
+   surface must be freed with diskcache_free_surface() */
+SDL_Surface *diskcache_load_surface(const char *filename, int num_image);
+
+/* Free surface, and its mapping of cache file if last user */
+void diskcache_free_surface(SDL_Surface *surface);
+
+/* Store decoded image num_image of game file */
+void diskcache_save_surface(const char *filename, int num_image, SDL_Surface *surface);
+
+/* Store texture pixels as image num_image of game file */
+void diskcache_save_texture(const char *filename, int num_image,
+	struct render_texture_s *texture);
+
+/* Return data num_data of game file depacked, to be freed by caller,
+   or NULL if not in cache */
+void *diskcache_load_data(const char *filename, int num_data, int *length);
+
+/* Store depacked data num_data of game file */
+void diskcache_save_data(const char *filename, int num_data, void *data, int length);
+
+/* Decode backgrounds and masks of all rooms in cache, using threads */
+void diskcache_populate(int num_threads);
+
+/* Close cache files */
+void diskcache_shutdown(void);
+
+#endif /* DISKCACHE_H */
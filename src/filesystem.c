@@ -26,13 +26,25 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <ctype.h>
 
 #include <SDL.h>
 #include <physfs.h>
 
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP) && defined(HAVE_FCNTL_H) \
+	&& defined(HAVE_UNISTD_H) && defined(HAVE_SYS_STAT_H)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define FS_MMAP 1
+#endif
+
 #include "parameters.h"
 #include "physfsrwops.h"
+#include "filesystem.h"
 #include "log.h"
 
 #include "g_common/fs_ignorecase.h"
@@ -45,12 +57,52 @@
 #define REEVENGI_PHYSFS_21	0
 #endif
 
+/* Buckets of case insensitive path index */
+#define FS_INDEX_BUCKETS	4096
+
+#define FS_PATH_LENGTH	1024
+
+/*--- Types ---*/
+
+typedef struct fs_index_s fs_index_t;
+
+struct fs_index_s {
+	fs_index_t *next;
+	char *lowername;	/* Lowercase path */
+	char *realname;		/* Path as found in search path */
+};
+
+typedef struct {
+	void *addr;
+	size_t length;
+} fs_map_t;
+
 /*--- Global variables ---*/
 
 /*---- Variables ---*/
 
+static SDL_mutex *index_mutex = NULL;
+
+static fs_index_t *index_buckets[FS_INDEX_BUCKETS];
+static int index_valid = 0, index_files = 0;
+static int index_failed = 0;	/* Not enough memory, until search path changes */
+
+/* Files mapped by FS_Map() */
+static SDL_mutex *map_mutex = NULL;
+static int num_maps = 0, size_maps = 0;
+static fs_map_t *maps = NULL;
+
 /*--- Functions prototypes ---*/
 
+static char *locate_file(const char *filename);
+static void *map_file(const char *filename, PHYSFS_sint64 *filelength);
+
+static void index_build(void);
+static void index_dir(char *path, int path_len);
+static void index_add(const char *realname);
+static void index_free(void);
+static Uint32 index_hash(const char *lowername);
+
 /*--- Functions ---*/
 
 int FS_Init(char *argv0)
@@ -75,6 +127,10 @@ int FS_Init(char *argv0)
 	/* Set write directory to current directory */
 	PHYSFS_setWriteDir(".");
 
+	memset(index_buckets, 0, sizeof(index_buckets));
+	index_mutex = SDL_CreateMutex();
+	map_mutex = SDL_CreateMutex();
+
 #if 0
 	userdir = PHYSFS_getUserDir();
 
@@ -113,6 +169,7 @@ int FS_AddArchive(const char *filename)
 #endif
 	{
 		logMsg(1,"fs: Added %s\n", filename);
+		FS_InvalidateIndex();
 		result = 0;
 	} else {
 		fprintf(stderr, "fs: Error adding %s\n", filename);
@@ -122,6 +179,21 @@ int FS_AddArchive(const char *filename)
 
 int FS_Shutdown(void)
 {
+	index_free();
+	if (index_mutex) {
+		SDL_DestroyMutex(index_mutex);
+		index_mutex = NULL;
+	}
+	if (map_mutex) {
+		SDL_DestroyMutex(map_mutex);
+		map_mutex = NULL;
+	}
+	if (maps) {
+		free(maps);
+		maps = NULL;
+	}
+	num_maps = size_maps = 0;
+
 	if (!PHYSFS_deinit()) {
 		fprintf(stderr,"fs: PHYSFS_deinit() failed!\n  reason: %s.\n",
 #if HAVE_PHYSFS_GETLASTERRORCODE
@@ -141,21 +213,18 @@ void *FS_Load(const char *filename, PHYSFS_sint64 *filelength)
 	PHYSFS_file	*curfile;
 	PHYSFS_sint64	curlength;
 	void	*buffer;
-	char *filename2 = strdup(filename);
+	char *filename2;
 
-	filename2 = strdup(filename);
+	filename2 = locate_file(filename);
 	if (!filename2) {
 		return NULL;
 	}
-	if (PHYSFSEXT_locateCorrectCase(filename2) != 0) {
-		free(filename2);
-		return NULL;
-	}
 
 	curfile=PHYSFS_openRead(filename2);
 
 	if (curfile==NULL) {
 		fprintf(stderr, "fs: can not open %s\n", filename);
+		free(filename2);
 		return NULL;
 	}
 
@@ -183,6 +252,49 @@ void *FS_Load(const char *filename, PHYSFS_sint64 *filelength)
 	return(buffer);
 }
 
+void *FS_Map(const char *filename, PHYSFS_sint64 *filelength)
+{
+	void *buffer;
+
+	buffer = map_file(filename, filelength);
+	if (buffer) {
+		return buffer;
+	}
+
+	/* File in archive, read it */
+	return FS_Load(filename, filelength);
+}
+
+void FS_Unmap(void *buffer)
+{
+	int i, mapped = 0;
+
+	if (!buffer) {
+		return;
+	}
+
+	if (map_mutex) {
+		SDL_LockMutex(map_mutex);
+	}
+	for (i=0; i<num_maps; i++) {
+		if (maps[i].addr == buffer) {
+#ifdef FS_MMAP
+			munmap(maps[i].addr, maps[i].length);
+#endif
+			maps[i] = maps[--num_maps];
+			mapped = 1;
+			break;
+		}
+	}
+	if (map_mutex) {
+		SDL_UnlockMutex(map_mutex);
+	}
+
+	if (!mapped) {
+		free(buffer);
+	}
+}
+
 void *FS_LoadRW(SDL_RWops *src, int *filelength)
 {
 	void *buffer;
@@ -222,29 +334,350 @@ int FS_Save(const char *filename, void *buffer, PHYSFS_sint64 length)
 
 	PHYSFS_close(curfile);
 
+	/* New file may be in search path */
+	FS_InvalidateIndex();
+
 	return 1;
 }
 
+int FS_Stat(const char *filename, PHYSFS_sint64 *length, PHYSFS_sint64 *mtime)
+{
+	char *filename2;
+	int retval = 0;
+#if (REEVENGI_PHYSFS_21 == 1)
+	PHYSFS_Stat stat;
+#else
+	PHYSFS_file *curfile;
+#endif
+
+	filename2 = locate_file(filename);
+	if (!filename2) {
+		return 0;
+	}
+
+#if (REEVENGI_PHYSFS_21 == 1)
+	if (PHYSFS_stat(filename2, &stat)) {
+		*length = stat.filesize;
+		*mtime = stat.modtime;
+		retval = 1;
+	}
+#else
+	curfile = PHYSFS_openRead(filename2);
+	if (curfile) {
+		*length = PHYSFS_fileLength(curfile);
+		*mtime = PHYSFS_getLastModTime(filename2);
+		PHYSFS_close(curfile);
+		retval = 1;
+	}
+#endif
+
+	free(filename2);
+	return retval;
+}
+
 SDL_RWops *FS_makeRWops(const char *filename)
 {
 	PHYSFS_file	*curfile;
 	char *filename2;
 
-	filename2 = strdup(filename);
+	filename2 = locate_file(filename);
 	if (!filename2) {
 		return NULL;
 	}
-	if (PHYSFSEXT_locateCorrectCase(filename2) != 0) {
-		free(filename2);
-		return NULL;
-	}
 
 	curfile=PHYSFS_openRead(filename2);
+	free(filename2);
 
 	if (curfile==NULL) {
-		free(filename2);
 		return NULL;
 	}
 
 	return PHYSFSRWOPS_makeRWops(curfile);
 }
+
+int FS_Exists(const char *filename)
+{
+	char *filename2;
+
+	filename2 = locate_file(filename);
+	if (!filename2) {
+		return 0;
+	}
+
+	free(filename2);
+	return 1;
+}
+
+void FS_InvalidateIndex(void)
+{
+	if (index_mutex) {
+		SDL_LockMutex(index_mutex);
+	}
+	index_free();
+	index_failed = 0;
+	if (index_mutex) {
+		SDL_UnlockMutex(index_mutex);
+	}
+}
+
+/* Map file if it is in a directory of search path, return NULL if in
+   archive or mmap() not available */
+static void *map_file(const char *filename, PHYSFS_sint64 *filelength)
+{
+#ifdef FS_MMAP
+	const char *realdir;
+	char *filename2, *realpath;
+	struct stat st;
+	void *buffer = NULL;
+	int fd;
+
+	filename2 = locate_file(filename);
+	if (!filename2) {
+		return NULL;
+	}
+
+	realdir = PHYSFS_getRealDir(filename2);
+	if (!realdir) {
+		free(filename2);
+		return NULL;
+	}
+
+	realpath = (char *) malloc(strlen(realdir)+strlen(filename2)+2);
+	if (!realpath) {
+		free(filename2);
+		return NULL;
+	}
+	sprintf(realpath, "%s%s%s", realdir, PHYSFS_getDirSeparator(), filename2);
+	free(filename2);
+
+	/* Fails if realdir is an archive */
+	fd = open(realpath, O_RDONLY);
+	free(realpath);
+	if (fd<0) {
+		return NULL;
+	}
+
+	if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size>0)) {
+		/* Copy on write, for parsers that swap data in place */
+		buffer = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (buffer == MAP_FAILED) {
+			buffer = NULL;
+		}
+	}
+	close(fd);
+
+	if (!buffer) {
+		return NULL;
+	}
+
+	if (map_mutex) {
+		SDL_LockMutex(map_mutex);
+	}
+	if (num_maps >= size_maps) {
+		fs_map_t *new_maps = (fs_map_t *) realloc(maps, (size_maps+16) * sizeof(fs_map_t));
+		if (new_maps) {
+			maps = new_maps;
+			size_maps += 16;
+		}
+	}
+	if (num_maps < size_maps) {
+		maps[num_maps].addr = buffer;
+		maps[num_maps].length = st.st_size;
+		++num_maps;
+	} else {
+		munmap(buffer, st.st_size);
+		buffer = NULL;
+	}
+	if (map_mutex) {
+		SDL_UnlockMutex(map_mutex);
+	}
+
+	if (buffer && filelength) {
+		*filelength = st.st_size;
+	}
+	logMsg(3, "fs: mapped %s\n", filename);
+
+	return buffer;
+#else
+	return NULL;
+#endif
+}
+
+/* Return path with correct case of file, to be freed by caller, or NULL
+   if file not found */
+static char *locate_file(const char *filename)
+{
+	fs_index_t *entry, *found = NULL;
+	char *lowername, *filename2 = NULL;
+	int i, use_index;
+
+	while (*filename == '/') {
+		filename++;
+	}
+
+	lowername = strdup(filename);
+	if (!lowername) {
+		return NULL;
+	}
+	for (i=0; lowername[i]; i++) {
+		lowername[i] = tolower(lowername[i]);
+	}
+
+	if (index_mutex) {
+		SDL_LockMutex(index_mutex);
+	}
+
+	if (!index_valid && !index_failed) {
+		index_build();
+	}
+
+	use_index = index_valid;
+	if (use_index) {
+		entry = index_buckets[index_hash(lowername) % FS_INDEX_BUCKETS];
+		for (; entry; entry = entry->next) {
+			if (strcmp(entry->lowername, lowername) != 0) {
+				continue;
+			}
+			/* Prefer file with same case, if several ones */
+			if (!found || (strcmp(entry->realname, filename) == 0)) {
+				found = entry;
+			}
+		}
+		if (found) {
+			filename2 = strdup(found->realname);
+		}
+	}
+
+	if (index_mutex) {
+		SDL_UnlockMutex(index_mutex);
+	}
+
+	if (!use_index) {
+		/* No index, search directories */
+		filename2 = strdup(filename);
+		if (filename2 && (PHYSFSEXT_locateCorrectCase(filename2) != 0)) {
+			free(filename2);
+			filename2 = NULL;
+		}
+	}
+
+	free(lowername);
+	return filename2;
+}
+
+static void index_build(void)
+{
+	char path[FS_PATH_LENGTH];
+
+	index_valid = 1;
+
+	path[0] = '\0';
+	index_dir(path, 0);
+
+	if (!index_valid) {
+		fprintf(stderr, "fs: can not allocate memory for file index\n");
+		index_free();
+		index_failed = 1;
+		return;
+	}
+
+	logMsg(1, "fs: %d files indexed\n", index_files);
+}
+
+/* Add all files of directory and its sub-directories to index */
+static void index_dir(char *path, int path_len)
+{
+	char **rc, **i;
+	int name_len;
+#if (REEVENGI_PHYSFS_21 == 1)
+	PHYSFS_Stat stat;
+#endif
+
+	rc = PHYSFS_enumerateFiles(path_len>0 ? path : "/");
+	if (!rc) {
+		return;
+	}
+
+	for (i=rc; *i && index_valid; i++) {
+		name_len = strlen(*i);
+		if (path_len + name_len + 2 > FS_PATH_LENGTH) {
+			logMsg(1, "fs: path too long in %s\n", path);
+			continue;
+		}
+
+		if (path_len>0) {
+			path[path_len] = '/';
+			strcpy(&path[path_len+1], *i);
+		} else {
+			strcpy(path, *i);
+		}
+
+		index_add(path);
+
+#if (REEVENGI_PHYSFS_21 == 1)
+		if (PHYSFS_stat(path, &stat) && (stat.filetype == PHYSFS_FILETYPE_DIRECTORY))
+#else
+		if (PHYSFS_isDirectory(path))
+#endif
+		{
+			index_dir(path, strlen(path));
+		}
+	}
+	path[path_len] = '\0';
+
+	PHYSFS_freeList(rc);
+}
+
+static void index_add(const char *realname)
+{
+	fs_index_t *entry;
+	Uint32 hash;
+	int i, length = strlen(realname);
+
+	entry = (fs_index_t *) malloc(sizeof(fs_index_t) + (length+1)*2);
+	if (!entry) {
+		index_valid = 0;
+		return;
+	}
+
+	entry->lowername = (char *) &entry[1];
+	entry->realname = entry->lowername + length+1;
+	for (i=0; i<=length; i++) {
+		entry->lowername[i] = tolower(realname[i]);
+	}
+	strcpy(entry->realname, realname);
+
+	hash = index_hash(entry->lowername) % FS_INDEX_BUCKETS;
+	entry->next = index_buckets[hash];
+	index_buckets[hash] = entry;
+
+	++index_files;
+}
+
+static void index_free(void)
+{
+	fs_index_t *entry, *next;
+	int i;
+
+	for (i=0; i<FS_INDEX_BUCKETS; i++) {
+		for (entry=index_buckets[i]; entry; entry=next) {
+			next = entry->next;
+			free(entry);
+		}
+		index_buckets[i] = NULL;
+	}
+
+	index_valid = 0;
+	index_files = 0;
+}
+
+static Uint32 index_hash(const char *lowername)
+{
+	Uint32 hash = 5381;
+
+	while (*lowername) {
+		hash = hash*33 + (Uint8) *lowername++;
+	}
+
+	return hash;
+}
@@ -34,8 +34,25 @@ int FS_Shutdown(void);
 void *FS_Load(const char *filename, PHYSFS_sint64 *filelength);
 void *FS_LoadRW(SDL_RWops *src, int *filelength);
 
+/* Return file content, mapped in memory if file is in a directory, or
+   loaded like FS_Load() if in archive. Must be released with FS_Unmap() */
+void *FS_Map(const char *filename, PHYSFS_sint64 *filelength);
+
+/* Release buffer from FS_Map(), or free buffer from FS_Load() */
+void FS_Unmap(void *buffer);
+
 int FS_Save(const char *filename, void *buffer, PHYSFS_sint64 length);
 
+/* Read length and modification time of file, return 0 if not found */
+int FS_Stat(const char *filename, PHYSFS_sint64 *length, PHYSFS_sint64 *mtime);
+
 SDL_RWops *FS_makeRWops(const char *filename);
 
+/* Return 1 if file exists, searched case insensitive */
+int FS_Exists(const char *filename);
+
+/* Forget case insensitive index of files, rebuilt on next access.
+   To be called when files are added to search path */
+void FS_InvalidateIndex(void);
+
 #endif /* FILESYSTEM_H */
@@ -0,0 +1,268 @@
+/*
+	Cache of decoded backgrounds
+
+	Copyright (C) 2017	Patrice Mandin
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+#include "../log.h"
+#include "../parameters.h"
+
+#include "../r_common/render_texture.h"
+
+#include "game.h"
+#include "bgcache.h"
+
+/*--- Types ---*/
+
+typedef struct {
+	int kind;
+	int major, minor;	/* Game version */
+	int num_stage, num_room, num_camera;
+
+	render_texture_t *texture;
+	int size;		/* Memory used by texture */
+	int refcount;		/* Rooms using the texture */
+	Uint32 last_use;
+} bgcache_entry_t;
+
+/*--- Variables ---*/
+
+static int num_entries = 0, size_entries = 0;
+static bgcache_entry_t *entries = NULL;
+
+static int cache_size = 0;	/* Memory used by all textures */
+static Uint32 cur_use = 0;
+
+static int num_hits = 0, num_misses = 0, num_evictions = 0;
+
+static const char *kind_names[2]={
+	"background", "bgmask"
+};
+
+/*--- Functions prototypes ---*/
+
+static int texture_size(render_texture_t *texture);
+static bgcache_entry_t *find_entry(int kind, int num_stage, int num_room, int num_camera);
+static bgcache_entry_t *find_texture(render_texture_t *texture);
+static void evict(void);
+static void free_entry(int num_entry);
+
+/*--- Functions ---*/
+
+static int texture_size(render_texture_t *texture)
+{
+	int size = sizeof(render_texture_t);
+
+	size += texture->pitchw * texture->pitchh * texture->bpp;
+	if (texture->scaled) {
+		size += texture->scaled->pitch * texture->scaled->h;
+	}
+
+	return size;
+}
+
+render_texture_t *bgcache_get(int kind, int num_stage, int num_room, int num_camera)
+{
+	bgcache_entry_t *entry;
+
+	if (params.bgcache <= 0) {
+		return NULL;
+	}
+
+	entry = find_entry(kind, num_stage, num_room, num_camera);
+	if (entry) {
+		++num_hits;
+		++entry->refcount;
+		entry->last_use = ++cur_use;
+	} else {
+		++num_misses;
+	}
+
+	logMsg(1, "bgcache: %s %s stage %d room %d camera %d (%d hits, %d misses, %d KB used)\n",
+		kind_names[kind], entry ? "hit" : "miss", num_stage, num_room, num_camera,
+		num_hits, num_misses, cache_size>>10);
+
+	return (entry ? entry->texture : NULL);
+}
+
+int bgcache_present(int kind, int num_stage, int num_room, int num_camera)
+{
+	return (find_entry(kind, num_stage, num_room, num_camera) != NULL);
+}
+
+void bgcache_add(int kind, int num_stage, int num_room, int num_camera, render_texture_t *texture)
+{
+	bgcache_entry_t *entry;
+
+	if ((params.bgcache <= 0) || !texture) {
+		return;
+	}
+
+	if (num_entries >= size_entries) {
+		int new_size = size_entries + 16;
+		bgcache_entry_t *new_entries = (bgcache_entry_t *)
+			realloc(entries, new_size * sizeof(bgcache_entry_t));
+
+		if (!new_entries) {
+			fprintf(stderr, "bgcache: can not allocate memory for entries\n");
+			return;
+		}
+
+		entries = new_entries;
+		size_entries = new_size;
+	}
+
+	entry = &entries[num_entries++];
+	entry->kind = kind;
+	entry->major = game->major;
+	entry->minor = game->minor;
+	entry->num_stage = num_stage;
+	entry->num_room = num_room;
+	entry->num_camera = num_camera;
+	entry->texture = texture;
+	entry->size = texture_size(texture);
+	entry->refcount = 1;
+	entry->last_use = ++cur_use;
+
+	cache_size += entry->size;
+
+	evict();
+}
+
+int bgcache_release(render_texture_t *texture)
+{
+	bgcache_entry_t *entry;
+
+	entry = find_texture(texture);
+	if (!entry) {
+		return 0;
+	}
+
+	--entry->refcount;
+
+	/* Scaled version may have been created since */
+	cache_size -= entry->size;
+	entry->size = texture_size(texture);
+	cache_size += entry->size;
+
+	evict();
+	return 1;
+}
+
+void bgcache_shutdown(void)
+{
+	logMsg(1, "bgcache: %d hits, %d misses, %d evictions, %d KB used\n",
+		num_hits, num_misses, num_evictions, cache_size>>10);
+
+	/* Textures still used by a room will be freed by it */
+	while (num_entries>0) {
+		if (entries[num_entries-1].refcount > 0) {
+			--num_entries;
+			continue;
+		}
+		entries[num_entries-1].texture->download(entries[num_entries-1].texture);
+		free_entry(num_entries-1);
+	}
+	cache_size = 0;
+
+	if (entries) {
+		free(entries);
+		entries = NULL;
+	}
+	size_entries = 0;
+}
+
+static bgcache_entry_t *find_entry(int kind, int num_stage, int num_room, int num_camera)
+{
+	int i;
+
+	for (i=0; i<num_entries; i++) {
+		if ((entries[i].kind == kind) && (entries[i].major == game->major)
+		    && (entries[i].minor == game->minor)
+		    && (entries[i].num_stage == num_stage) && (entries[i].num_room == num_room)
+		    && (entries[i].num_camera == num_camera))
+		{
+			return &entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+static bgcache_entry_t *find_texture(render_texture_t *texture)
+{
+	int i;
+
+	if (!texture) {
+		return NULL;
+	}
+
+	for (i=0; i<num_entries; i++) {
+		if (entries[i].texture == texture) {
+			return &entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Free least recently used textures not used by a room, until cache fits */
+static void evict(void)
+{
+	int max_size = params.bgcache<<20;
+
+	while (cache_size > max_size) {
+		int i, lru = -1;
+
+		for (i=0; i<num_entries; i++) {
+			if (entries[i].refcount > 0) {
+				continue;
+			}
+			if ((lru<0) || (entries[i].last_use < entries[lru].last_use)) {
+				lru = i;
+			}
+		}
+
+		if (lru<0) {
+			/* All used */
+			break;
+		}
+
+		logMsg(2, "bgcache: evict %s stage %d room %d camera %d\n",
+			kind_names[entries[lru].kind], entries[lru].num_stage,
+			entries[lru].num_room, entries[lru].num_camera);
+
+		entries[lru].texture->download(entries[lru].texture);
+		free_entry(lru);
+		++num_evictions;
+	}
+}
+
+static void free_entry(int num_entry)
+{
+	bgcache_entry_t *entry = &entries[num_entry];
+
+	cache_size -= entry->size;
+	entry->texture->shutdown(entry->texture);
+
+	/* Keep array packed */
+	entries[num_entry] = entries[--num_entries];
+}
@@ -0,0 +1,54 @@
+/*
+	Cache of decoded backgrounds
+
+	Copyright (C) 2017	Patrice Mandin
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef BGCACHE_H
+#define BGCACHE_H 1
+
+/*--- Defines ---*/
+
+#define BGCACHE_BACKGROUND	0
+#define BGCACHE_BGMASK	1
+
+/*--- External types ---*/
+
+struct render_texture_s;
+
+/*--- Functions prototypes ---*/
+
+/* Return cached texture for camera of current game, or NULL if not in
+   cache. Texture stays in cache until released */
+struct render_texture_s *bgcache_get(int kind, int num_stage, int num_room, int num_camera);
+
+/* Check if texture for camera is in cache, without using it */
+int bgcache_present(int kind, int num_stage, int num_room, int num_camera);
+
+/* Add texture for camera of current game, same as bgcache_get() after */
+void bgcache_add(int kind, int num_stage, int num_room, int num_camera, struct render_texture_s *texture);
+
+/* Texture no longer used, least recently used ones are freed when cache
+   is full. Return 0 if texture is not in cache, and must be freed by
+   caller */
+int bgcache_release(struct render_texture_s *texture);
+
+/* Free textures not used anymore, print statistics. Must be called
+   while renderer still running */
+void bgcache_shutdown(void);
+
+#endif /* BGCACHE_H */
@@ -0,0 +1,619 @@
+/*
+	Prefetch backgrounds of cameras the player may switch to
+
+	Copyright (C) 2017	Patrice Mandin
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <string.h>
+#include <SDL.h>
+
+#include "../log.h"
+#include "../parameters.h"
+
+#include "../r_common/render_texture.h"
+
+#include "game.h"
+#include "room.h"
+#include "room_camswitch.h"
+#include "room_door.h"
+#include "bgcache.h"
+#include "bgprefetch.h"
+
+/*--- Defines ---*/
+
+#define MAX_PREFETCH_JOBS	16
+#define MAX_PREFETCH_ROOMS	8
+
+/* Prefetch when player is nearer than this to a camera switch zone,
+   about half a second of walk */
+#define PREFETCH_DISTANCE	2500.0f
+
+enum {
+	JOB_CAMERA=0,	/* Load background and mask of room camera */
+	JOB_ROOM	/* Load room file, and background and mask of camera */
+};
+
+enum {
+	JOB_FREE=0,
+	JOB_QUEUED,
+	JOB_RUNNING,
+	JOB_DONE
+};
+
+/*--- Types ---*/
+
+typedef struct {
+	int type, state;
+	Uint32 order;	/* Jobs are processed in queued order */
+	int num_stage, num_room, num_camera;
+
+	/* Copy of room, textures are loaded in it */
+	room_t room;
+
+	/* Room created by JOB_ROOM */
+	room_t *new_room;
+} bgprefetch_job_t;
+
+/*--- Variables ---*/
+
+static bgprefetch_job_t jobs[MAX_PREFETCH_JOBS];
+static Uint32 next_order = 0;
+
+static SDL_Thread *thread = NULL;
+static SDL_mutex *mutex = NULL;
+static SDL_cond *cond = NULL;
+static int quit_thread = 0;
+
+static int num_switches = 0, num_prefetched = 0, num_waited = 0;
+
+/*--- Functions prototypes ---*/
+
+static int start_thread(void);
+static int prefetch_thread(void *data);
+
+static float camswitch_distance(room_camswitch_t *camswitch, float x, float y);
+static bgprefetch_job_t *find_job(int type, int num_stage, int num_room, int num_camera);
+static bgprefetch_job_t *new_job(int type, int num_stage, int num_room, int num_camera);
+static void queue_job(room_t *room, int num_camera);
+static void collect_jobs(void);
+static void add_texture(bgprefetch_job_t *job, int kind, render_texture_t *texture);
+static void load_room(bgprefetch_job_t *job);
+static int door_target(room_t *room, int num_stage, int num_room);
+
+/*--- Functions ---*/
+
+void bgprefetch_update(room_t *room, int num_camera, float x, float y)
+{
+	int i;
+
+	if (!params.prefetch || (params.bgcache <= 0) || !room) {
+		return;
+	}
+
+	collect_jobs();
+
+	for (i=0; i<room->getNumCamSwitches(room); i++) {
+		room_camswitch_t camswitch;
+
+		room->getCamSwitch(room, i, &camswitch);
+
+		if ((camswitch.from != num_camera) || (camswitch.to == num_camera)) {
+			continue;
+		}
+
+		if (camswitch_distance(&camswitch, x, y) > PREFETCH_DISTANCE*PREFETCH_DISTANCE) {
+			continue;
+		}
+
+		queue_job(room, camswitch.to);
+	}
+}
+
+void bgprefetch_switch(room_t *room, int num_camera)
+{
+	int i;
+
+	if (!params.prefetch || (params.bgcache <= 0) || !room) {
+		return;
+	}
+
+	++num_switches;
+
+	if (mutex) {
+		SDL_LockMutex(mutex);
+		for (i=0; i<MAX_PREFETCH_JOBS; i++) {
+			bgprefetch_job_t *job = &jobs[i];
+
+			if ((job->state == JOB_FREE) || (job->type != JOB_CAMERA)
+			    || (job->num_stage != room->num_stage)
+			    || (job->num_room != room->num_room) || (job->num_camera != num_camera))
+			{
+				continue;
+			}
+
+			if (job->state == JOB_QUEUED) {
+				/* Too late, will be loaded now */
+				job->state = JOB_FREE;
+				continue;
+			}
+
+			if (job->state == JOB_RUNNING) {
+				++num_waited;
+				while (job->state == JOB_RUNNING) {
+					SDL_CondWait(cond, mutex);
+				}
+			}
+		}
+		SDL_UnlockMutex(mutex);
+
+		collect_jobs();
+	}
+
+	if (bgcache_present(BGCACHE_BACKGROUND, room->num_stage, room->num_room, num_camera)) {
+		++num_prefetched;
+	}
+
+	logMsg(1, "bgprefetch: switch to camera %d, %d/%d prefetched, %d waited\n",
+		num_camera, num_prefetched, num_switches, num_waited);
+}
+
+void bgprefetch_rooms(room_t *room)
+{
+	int i, num_rooms = 0, max_rooms;
+
+	if (!params.prefetch || (params.prefetch_rooms <= 0) || !room) {
+		return;
+	}
+
+	max_rooms = params.prefetch_rooms;
+	if (max_rooms > MAX_PREFETCH_ROOMS) {
+		max_rooms = MAX_PREFETCH_ROOMS;
+	}
+
+	/* Free loaded rooms that can not be entered from this one */
+	if (mutex) {
+		SDL_LockMutex(mutex);
+		for (i=0; i<MAX_PREFETCH_JOBS; i++) {
+			bgprefetch_job_t *job = &jobs[i];
+
+			if ((job->type != JOB_ROOM) || (job->state == JOB_FREE) || (job->state == JOB_RUNNING)
+			    || door_target(room, job->num_stage, job->num_room))
+			{
+				continue;
+			}
+
+			if (job->new_room) {
+				job->new_room->dtor(job->new_room);
+				job->new_room = NULL;
+			}
+			job->state = JOB_FREE;
+		}
+		SDL_UnlockMutex(mutex);
+	}
+
+	for (i=0; (i<room->num_doors) && (num_rooms<max_rooms); i++) {
+		room_door_t *door = &room->doors[i];
+		int j, already_done = 0;
+
+		if ((door->next_stage == room->num_stage) && (door->next_room == room->num_room)) {
+			continue;
+		}
+
+		for (j=0; j<i; j++) {
+			if ((room->doors[j].next_stage == door->next_stage)
+			    && (room->doors[j].next_room == door->next_room))
+			{
+				already_done = 1;
+				break;
+			}
+		}
+		if (already_done) {
+			continue;
+		}
+
+		++num_rooms;
+
+		if (!start_thread()) {
+			return;
+		}
+
+		SDL_LockMutex(mutex);
+		if (!find_job(JOB_ROOM, door->next_stage, door->next_room, -1)) {
+			bgprefetch_job_t *job = new_job(JOB_ROOM, door->next_stage, door->next_room,
+				door->next_camera);
+			if (job) {
+				logMsg(2, "bgprefetch: queue stage %d room %d\n",
+					door->next_stage, door->next_room);
+				job->new_room = NULL;
+				SDL_CondBroadcast(cond);
+			}
+		}
+		SDL_UnlockMutex(mutex);
+	}
+}
+
+room_t *bgprefetch_get_room(int num_stage, int num_room)
+{
+	bgprefetch_job_t *job;
+	room_t *room = NULL;
+
+	if (!mutex) {
+		return NULL;
+	}
+
+	SDL_LockMutex(mutex);
+	job = find_job(JOB_ROOM, num_stage, num_room, -1);
+	if (job) {
+		if (job->state == JOB_QUEUED) {
+			/* Too late, will be loaded now */
+			job->state = JOB_FREE;
+		} else {
+			while (job->state == JOB_RUNNING) {
+				SDL_CondWait(cond, mutex);
+			}
+
+			room = job->new_room;
+			job->new_room = NULL;
+
+			if (room) {
+				/* Camera textures go to cache, to be used by setCamera() */
+				add_texture(job, BGCACHE_BACKGROUND, room->background);
+				add_texture(job, BGCACHE_BGMASK, room->bg_mask);
+				room->background = NULL;
+				room->bg_mask = NULL;
+			}
+
+			/* Slot can be reused once textures are in cache */
+			job->state = JOB_FREE;
+		}
+	}
+	SDL_UnlockMutex(mutex);
+
+	logMsg(1, "bgprefetch: stage %d room %d %s\n", num_stage, num_room,
+		room ? "was preloaded" : "not preloaded");
+
+	return room;
+}
+
+void bgprefetch_stop(void)
+{
+	int i;
+
+	if (!mutex) {
+		return;
+	}
+
+	SDL_LockMutex(mutex);
+	for (i=0; i<MAX_PREFETCH_JOBS; i++) {
+		if ((jobs[i].type == JOB_CAMERA) && (jobs[i].state == JOB_QUEUED)) {
+			jobs[i].state = JOB_FREE;
+		}
+		while ((jobs[i].type == JOB_CAMERA) && (jobs[i].state == JOB_RUNNING)) {
+			SDL_CondWait(cond, mutex);
+		}
+	}
+	SDL_UnlockMutex(mutex);
+
+	collect_jobs();
+}
+
+void bgprefetch_shutdown(void)
+{
+	int i;
+
+	if (num_switches>0) {
+		logMsg(1, "bgprefetch: %d/%d switches prefetched, %d waited\n",
+			num_prefetched, num_switches, num_waited);
+	}
+
+	if (!mutex) {
+		return;
+	}
+
+	bgprefetch_stop();
+
+	if (thread) {
+		SDL_LockMutex(mutex);
+		quit_thread = 1;
+		SDL_CondBroadcast(cond);
+		SDL_UnlockMutex(mutex);
+
+		SDL_WaitThread(thread, NULL);
+		thread = NULL;
+	}
+
+	for (i=0; i<MAX_PREFETCH_JOBS; i++) {
+		if (jobs[i].new_room) {
+			jobs[i].new_room->dtor(jobs[i].new_room);
+			jobs[i].new_room = NULL;
+		}
+		jobs[i].state = JOB_FREE;
+	}
+
+	SDL_DestroyCond(cond);
+	cond = NULL;
+	SDL_DestroyMutex(mutex);
+	mutex = NULL;
+}
+
+static int start_thread(void)
+{
+	if (thread) {
+		return 1;
+	}
+
+	if (!mutex) {
+		mutex = SDL_CreateMutex();
+		cond = SDL_CreateCond();
+		if (!mutex || !cond) {
+			fprintf(stderr, "bgprefetch: can not create mutex: %s\n", SDL_GetError());
+			params.prefetch = 0;
+			return 0;
+		}
+	}
+
+	quit_thread = 0;
+#if SDL_VERSION_ATLEAST(2,0,0)
+	thread = SDL_CreateThread(prefetch_thread, "bgprefetch", NULL);
+#else
+	thread = SDL_CreateThread(prefetch_thread, NULL);
+#endif
+	if (!thread) {
+		fprintf(stderr, "bgprefetch: can not create thread: %s\n", SDL_GetError());
+		params.prefetch = 0;
+		return 0;
+	}
+
+	return 1;
+}
+
+static int prefetch_thread(void *data)
+{
+	SDL_LockMutex(mutex);
+	while (!quit_thread) {
+		bgprefetch_job_t *job = NULL;
+		int i;
+
+		for (i=0; i<MAX_PREFETCH_JOBS; i++) {
+			if (jobs[i].state != JOB_QUEUED) {
+				continue;
+			}
+			if (!job || ((Sint32) (jobs[i].order - job->order) < 0)) {
+				job = &jobs[i];
+			}
+		}
+
+		if (!job) {
+			SDL_CondWait(cond, mutex);
+			continue;
+		}
+
+		job->state = JOB_RUNNING;
+		SDL_UnlockMutex(mutex);
+
+		if (job->type == JOB_ROOM) {
+			load_room(job);
+		} else {
+			job->room.load_background(&job->room, job->num_stage, job->num_room, job->num_camera);
+			job->room.load_bgmask(&job->room, job->num_stage, job->num_room, job->num_camera);
+		}
+
+		SDL_LockMutex(mutex);
+		job->state = JOB_DONE;
+		SDL_CondBroadcast(cond);
+	}
+	SDL_UnlockMutex(mutex);
+
+	return 0;
+}
+
+/* Return squared distance from point to zone, 0 if inside */
+static float camswitch_distance(room_camswitch_t *camswitch, float x, float y)
+{
+	float dist = -1.0f;
+	int j, is_inside = 1;
+
+	for (j=0; j<4; j++) {
+		float dx1,dy1,dx2,dy2, len, t, d;
+
+		dx1 = camswitch->x[(j+1) & 3] - camswitch->x[j];
+		dy1 = camswitch->y[(j+1) & 3] - camswitch->y[j];
+
+		dx2 = x - camswitch->x[j];
+		dy2 = y - camswitch->y[j];
+
+		if (dx1*dy2-dy1*dx2 >= 0) {
+			is_inside = 0;
+		}
+
+		/* Nearest point on edge */
+		t = 0.0f;
+		len = dx1*dx1+dy1*dy1;
+		if (len > 0.0f) {
+			t = (dx1*dx2+dy1*dy2) / len;
+			if (t < 0.0f) {
+				t = 0.0f;
+			} else if (t > 1.0f) {
+				t = 1.0f;
+			}
+		}
+
+		dx2 -= t*dx1;
+		dy2 -= t*dy1;
+		d = dx2*dx2+dy2*dy2;
+		if ((dist<0.0f) || (d<dist)) {
+			dist = d;
+		}
+	}
+
+	return (is_inside ? 0.0f : dist);
+}
+
+/* Find job, any camera if num_camera<0. Must be called with mutex locked */
+static bgprefetch_job_t *find_job(int type, int num_stage, int num_room, int num_camera)
+{
+	int i;
+
+	for (i=0; i<MAX_PREFETCH_JOBS; i++) {
+		if ((jobs[i].state != JOB_FREE) && (jobs[i].type == type)
+		    && (jobs[i].num_stage == num_stage) && (jobs[i].num_room == num_room)
+		    && ((num_camera<0) || (jobs[i].num_camera == num_camera)))
+		{
+			return &jobs[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Queue a new job. Must be called with mutex locked */
+static bgprefetch_job_t *new_job(int type, int num_stage, int num_room, int num_camera)
+{
+	int i;
+
+	for (i=0; i<MAX_PREFETCH_JOBS; i++) {
+		bgprefetch_job_t *job = &jobs[i];
+
+		if (job->state != JOB_FREE) {
+			continue;
+		}
+
+		job->type = type;
+		job->num_stage = num_stage;
+		job->num_room = num_room;
+		job->num_camera = num_camera;
+		job->order = next_order++;
+		job->state = JOB_QUEUED;
+		return job;
+	}
+
+	return NULL;
+}
+
+static void queue_job(room_t *room, int num_camera)
+{
+	if (bgcache_present(BGCACHE_BACKGROUND, room->num_stage, room->num_room, num_camera)) {
+		return;
+	}
+
+	if (!start_thread()) {
+		return;
+	}
+
+	SDL_LockMutex(mutex);
+	if (!find_job(JOB_CAMERA, room->num_stage, room->num_room, num_camera)) {
+		bgprefetch_job_t *job = new_job(JOB_CAMERA, room->num_stage, room->num_room, num_camera);
+
+		if (job) {
+			logMsg(2, "bgprefetch: queue stage %d room %d camera %d\n",
+				room->num_stage, room->num_room, num_camera);
+
+			/* Shallow copy, file data and other pointers are shared
+			   with the room used by the main thread. It stays valid
+			   only because setRoom() calls bgprefetch_stop(), which
+			   waits for camera jobs, before destroying the room */
+			memcpy(&job->room, room, sizeof(room_t));
+			job->room.background = NULL;
+			job->room.bg_mask = NULL;
+			job->room.rdr_mask = NULL;
+
+			SDL_CondBroadcast(cond);
+		}
+	}
+	SDL_UnlockMutex(mutex);
+}
+
+/* Move loaded textures to background cache */
+static void collect_jobs(void)
+{
+	int i;
+
+	if (!mutex) {
+		return;
+	}
+
+	SDL_LockMutex(mutex);
+	for (i=0; i<MAX_PREFETCH_JOBS; i++) {
+		bgprefetch_job_t *job = &jobs[i];
+
+		if ((job->type != JOB_CAMERA) || (job->state != JOB_DONE)) {
+			continue;
+		}
+
+		add_texture(job, BGCACHE_BACKGROUND, job->room.background);
+		add_texture(job, BGCACHE_BGMASK, job->room.bg_mask);
+		job->state = JOB_FREE;
+	}
+	SDL_UnlockMutex(mutex);
+}
+
+static void add_texture(bgprefetch_job_t *job, int kind, render_texture_t *texture)
+{
+	if (!texture) {
+		return;
+	}
+
+	/* Loaded meanwhile by main thread, or cache disabled */
+	if ((params.bgcache <= 0)
+	    || bgcache_present(kind, job->num_stage, job->num_room, job->num_camera))
+	{
+		texture->shutdown(texture);
+		return;
+	}
+
+	bgcache_add(kind, job->num_stage, job->num_room, job->num_camera, texture);
+	bgcache_release(texture);
+}
+
+/* Load room file, and textures of first camera, as game->setRoom() does */
+static void load_room(bgprefetch_job_t *job)
+{
+	room_t *room;
+
+	room = game->room_ctor(game, job->num_stage, job->num_room);
+	if (!room) {
+		return;
+	}
+
+	room->loadFile(room);
+	if (!room->file) {
+		room->dtor(room);
+		return;
+	}
+
+	if (params.bgcache > 0) {
+		room->load_background(room, job->num_stage, job->num_room, job->num_camera);
+		room->load_bgmask(room, job->num_stage, job->num_room, job->num_camera);
+	}
+
+	job->new_room = room;
+}
+
+static int door_target(room_t *room, int num_stage, int num_room)
+{
+	int i;
+
+	for (i=0; i<room->num_doors; i++) {
+		if ((room->doors[i].next_stage == num_stage)
+		    && (room->doors[i].next_room == num_room))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,50 @@
+/*
+	Prefetch backgrounds of cameras the player may switch to
+
+	Copyright (C) 2017	Patrice Mandin
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef BGPREFETCH_H
+#define BGPREFETCH_H 1
+
+/*--- External types ---*/
+
+struct room_s;
+
+/*--- Functions prototypes ---*/
+
+/* Load, in background cache, backgrounds and masks of cameras whose
+   switch zone is near player position */
+void bgprefetch_update(struct room_s *room, int num_camera, float x, float y);
+
+/* Player switches to camera: wait for it if being loaded, update statistics */
+void bgprefetch_switch(struct room_s *room, int num_camera);
+
+/* Load, in background, rooms that can be entered from doors of room */
+void bgprefetch_rooms(struct room_s *room);
+
+/* Return loaded room, or NULL if not loaded. Room textures are moved
+   to background cache */
+struct room_s *bgprefetch_get_room(int num_stage, int num_room);
+
+/* Cancel pending camera loads, wait for current one */
+void bgprefetch_stop(void);
+
+/* Stop thread, print statistics */
+void bgprefetch_shutdown(void);
+
+#endif /* BGPREFETCH_H */
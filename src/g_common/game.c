@@ -25,6 +25,7 @@
 
 #include "../parameters.h"
 #include "../log.h"
+#include "../filesystem.h"
 
 #include "room.h"
 #include "room_map.h"
@@ -33,7 +34,7 @@
 #include "player.h"
 #include "menu.h"
 #include "game.h"
-#include "fs_ignorecase.h"
+#include "bgprefetch.h"
 
 #include "../r_common/render_skel.h"
 #include "../r_common/render_texture.h"
@@ -151,12 +152,9 @@ static void dtor(game_t *this)
 
 int game_file_exists(const char *filename)
 {
-	char *filename2;
-
-	filename2 = strdup(filename);
 	logMsg(2, "fs: Checking %s file\n", filename);
 
-	return (PHYSFSEXT_locateCorrectCase(filename2) == 0);
+	return FS_Exists(filename);
 }
 
 static void load_font(game_t *this)
@@ -176,17 +174,22 @@ static void setRoom(game_t *this, int new_stage, int new_room)
 {
 	room_t *room;
 
+	bgprefetch_stop();
+
 	if (this->room) {
 		this->room->dtor(this->room);
 		this->room = NULL;
 	}
 
-	room = game->room_ctor(game, new_stage, new_room);
+	room = bgprefetch_get_room(new_stage, new_room);
 	if (!room) {
-		return;
-	}
+		room = game->room_ctor(game, new_stage, new_room);
+		if (!room) {
+			return;
+		}
 
-	room->loadFile(room);
+		room->loadFile(room);
+	}
 	if (!room->file) {
 		room->dtor(room);
 		return;
@@ -25,8 +25,11 @@
 #include "../parameters.h"
 #include "../filesystem.h"
 
+#include "../r_common/render_texture.h"
+
 #include "room.h"
 #include "game.h"
+#include "bgcache.h"
 
 #include "room_script.h"
 #include "room_camswitch.h"
@@ -53,6 +56,8 @@ static void postLoad(room_t *this);
 static void load_background(room_t *this, int stage, int room, int camera);
 static void load_bgmask(room_t *this, int stage, int room, int camera);
 static void setCamera(room_t *this, int num_camera);
+static void setBackground(room_t *this, int num_camera);
+static void setBgmask(room_t *this, int num_camera);
 
 static void unload(room_t *this);
 static void unload_background(room_t *this);
@@ -93,6 +98,8 @@ room_t *room_ctor(game_t *game, int num_stage, int num_room)
 	this->load_background = load_background;
 	this->load_bgmask = load_bgmask;
 	this->setCamera = setCamera;
+	this->setBackground = setBackground;
+	this->setBgmask = setBgmask;
 
 	this->getNumCameras = getNumCameras;
 	this->getCamera = getCamera;
@@ -151,7 +158,7 @@ static void loadFile(room_t *this)
 
 	logMsg(1, "room: Loading %s ...\n", filename);
 
-	file = FS_Load(filename, &length);
+	file = FS_Map(filename, &length);
 	if (file) {
 		if (length>=8) {
 			this->file = file;
@@ -159,7 +166,7 @@ static void loadFile(room_t *this)
 
 			retval = 1;
 		} else {
-			free(file);
+			FS_Unmap(file);
 		}
 	}
 
@@ -203,7 +210,7 @@ static void unload(room_t *this)
 	}
 
 	if (this->file) {
-		free(this->file);
+		FS_Unmap(this->file);
 		this->file=NULL;
 		this->file_length=0;
 	}
@@ -214,7 +221,9 @@ static void unload_background(room_t *this)
 	logMsg(2, "room: unloadbackground\n");
 
 	if (this->background) {
-		free(this->background);
+		if (!bgcache_release(this->background)) {
+			this->background->shutdown(this->background);
+		}
 		this->background=NULL;
 	}
 }
@@ -224,7 +233,9 @@ static void unload_bgmask(room_t *this)
 	logMsg(2, "room: unloadbgmask\n");
 
 	if (this->bg_mask) {
-		free(this->bg_mask);
+		if (!bgcache_release(this->bg_mask)) {
+			this->bg_mask->shutdown(this->bg_mask);
+		}
 		this->bg_mask=NULL;
 	}
 	if (this->rdr_mask) {
@@ -235,12 +246,38 @@ static void unload_bgmask(room_t *this)
 
 static void setCamera(room_t *this, int num_camera)
 {
-	this->load_background(this, this->num_stage, this->num_room, num_camera);
-	this->load_bgmask(this, this->num_stage, this->num_room, num_camera);
+	this->setBackground(this, num_camera);
+	this->setBgmask(this, num_camera);
 
 	this->initMasks(this, num_camera);
 }
 
+static void setBackground(room_t *this, int num_camera)
+{
+	unload_background(this);
+
+	this->background = bgcache_get(BGCACHE_BACKGROUND, this->num_stage, this->num_room, num_camera);
+	if (this->background) {
+		return;
+	}
+
+	this->load_background(this, this->num_stage, this->num_room, num_camera);
+	bgcache_add(BGCACHE_BACKGROUND, this->num_stage, this->num_room, num_camera, this->background);
+}
+
+static void setBgmask(room_t *this, int num_camera)
+{
+	unload_bgmask(this);
+
+	this->bg_mask = bgcache_get(BGCACHE_BGMASK, this->num_stage, this->num_room, num_camera);
+	if (this->bg_mask) {
+		return;
+	}
+
+	this->load_bgmask(this, this->num_stage, this->num_room, num_camera);
+	bgcache_add(BGCACHE_BGMASK, this->num_stage, this->num_room, num_camera, this->bg_mask);
+}
+
 static int getNumCameras(room_t *this)
 {
 	return 0;
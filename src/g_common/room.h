@@ -74,6 +74,10 @@ struct room_s {
 	void (*load_bgmask)(room_t *this, int stage, int room, int camera);
 	void (*setCamera)(room_t *this, int camera);
 
+	/* Set background and mask for camera, from cache or loading them */
+	void (*setBackground)(room_t *this, int camera);
+	void (*setBgmask)(room_t *this, int camera);
+
 	/* Background image for current camera */
 	struct render_texture_s *background;
 
@@ -28,6 +28,7 @@
 #include "../log.h"
 #include "../parameters.h"
 #include "../background_tim.h"
+#include "../diskcache.h"
 
 #include "../g_common/player.h"
 #include "../g_common/room.h"
@@ -43,6 +44,9 @@
 
 #define NUM_COUNTRIES 8
 
+/* Depacked background is a 320x240 15 bits TIM image */
+#define PAK_BG_SIZE (sizeof(tim_header_t)+sizeof(tim_size_t)+320*240*2)
+
 /*--- Types ---*/
 
 /*--- Constant ---*/
@@ -109,6 +113,7 @@ static int get_row_offset(int re1_stage, int num_stage, int num_room, int num_ca
 
 static void load_background(room_t *this, int num_stage, int num_room, int num_camera);
 static int load_pak_bg(room_t *this, const char *filename, int row_offset);
+static SDL_Surface *depack_pak_bg(const char *filename, int row_offset);
 
 #if 0
 static void load_bgmask(room_t *this, int num_stage, int num_room, int num_camera);
@@ -232,36 +237,52 @@ static void load_background(room_t *this, int num_stage, int num_room, int num_c
 
 static int load_pak_bg(room_t *this, const char *filename, int row_offset)
 {
-	SDL_RWops *src;
+	SDL_Surface *image;
 	int retval = 0;
+
+	image = diskcache_load_surface(filename, 0);
+	if (!image) {
+		image = depack_pak_bg(filename, row_offset);
+		diskcache_save_surface(filename, 0, image);
+	}
+
+	if (image) {
+		this->background = render.createTexture(RENDER_TEXTURE_CACHEABLE);
+		if (this->background) {
+			this->background->load_from_surf(this->background, image);
+			retval = 1;
+		}
+		diskcache_free_surface(image);
+	}
+
+	return retval;
+}
+
+static SDL_Surface *depack_pak_bg(const char *filename, int row_offset)
+{
+	Uint8 *src;
+	PHYSFS_sint64 length;
+	SDL_Surface *image = NULL;
 	
-	src = FS_makeRWops(filename);
+	src = (Uint8 *) FS_Load(filename, &length);
 	if (src) {
 		Uint8 *dstBuffer;
 		int dstBufLen;
 
-		pak_depack(src, &dstBuffer, &dstBufLen);
+		pak_depack_mem(src, length, &dstBuffer, &dstBufLen, PAK_BG_SIZE);
 
 		if (dstBuffer && dstBufLen) {
 			SDL_RWops *tim_src = SDL_RWFromMem(dstBuffer, dstBufLen);
 			if (tim_src) {
-				SDL_Surface *image = background_tim_load(tim_src, row_offset);
-				if (image) {
-					this->background = render.createTexture(RENDER_TEXTURE_CACHEABLE);
-					if (this->background) {
-						this->background->load_from_surf(this->background, image);
-						retval = 1;
-					}
-					SDL_FreeSurface(image);
-				}
+				image = background_tim_load(tim_src, row_offset);
 				SDL_FreeRW(tim_src);
 			}
 			free(dstBuffer);
 		}
-		SDL_RWclose(src);
+		free(src);
 	}
 
-	return retval;
+	return image;
 }
 
 #if 0
@@ -362,7 +383,7 @@ static render_skel_t *load_model(player_t *this, int num_model)
 
 	logMsg(1, "emd: Start loading model %s...\n", filepath);
 
-	emd = FS_Load(filepath, &emd_length);
+	emd = FS_Map(filepath, &emd_length);
 	if (emd) {
 		model = model_emd_load(emd, emd_length);
 		/*free(emd);*/
@@ -204,7 +204,7 @@ static void load_background(room_t *this, int num_stage, int num_room, int num_c
 	logMsg(1, "bss: Start loading %s ...\n", filepath);
 
 	logMsg(1, "bss: %s loading %s ...\n",
-		background_bss_load(filepath, CHUNK_SIZE, row_offset) ? "Done" : "Failed",
+		background_bss_load(this, filepath, num_camera, CHUNK_SIZE, row_offset) ? "Done" : "Failed",
 		filepath);
 
 	free(filepath);
@@ -246,7 +246,7 @@ static render_skel_t *load_model(player_t *this, int num_model)
 
 	logMsg(1, "emd: Start loading model %s ...\n", filepath);
 
-	emd = FS_Load(filepath, &emd_length);
+	emd = FS_Map(filepath, &emd_length);
 	if (emd) {
 		model = model_emd_load(emd, emd_length);
 		/*free(emd);*/
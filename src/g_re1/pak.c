@@ -21,18 +21,228 @@
 */
 
 #include <stdio.h>
-#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <SDL.h>
 
+#include "pak.h"
+
 /*--- Defines ---*/
 
 #define CHUNK_SIZE 32768
 
 #define DECODE_SIZE 35024
 
+#define PAK_CODE_END	0x100
+#define PAK_CODE_BITS	0x101
+#define PAK_CODE_RESET	0x102
+#define PAK_CODE_FIRST	0x103
+
+#define PAK_MAX_BITS	16
+
+/* Read num_bits code, MSB first, past end of data reads as 0 */
+#define PAK_READ_BITS(value, num_bits)	\
+	{	\
+		while (bitcnt <= 24) {	\
+			bitbuf |= (Uint32) (src<src_end ? *src++ : 0) << (24-bitcnt);	\
+			bitcnt += 8;	\
+		}	\
+		value = bitbuf >> (32-(num_bits));	\
+		bitbuf <<= (num_bits);	\
+		bitcnt -= (num_bits);	\
+	}
+
 /*--- Types ---*/
 
+/* String table: each code is a previous code followed by a byte */
+typedef struct {
+	Uint16 prefix[DECODE_SIZE];
+	Uint8 suffix[DECODE_SIZE];
+	int length[DECODE_SIZE];
+} pak_table_t;
+
+/*--- Functions prototypes ---*/
+
+static int pak_reserve(Uint8 **dst, int *dstBufLen, int length);
+
+/*--- Functions ---*/
+
+void pak_depack(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength)
+{
+	Uint8 *srcBuffer;
+	int srcLength, start;
+
+	*dstBufPtr = NULL;
+	*dstLength = 0;
+
+	start = SDL_RWseek(src, 0, RW_SEEK_CUR);
+	srcLength = SDL_RWseek(src, 0, RW_SEEK_END) - start;
+	SDL_RWseek(src, start, RW_SEEK_SET);
+	if (srcLength <= 0) {
+		return;
+	}
+
+	srcBuffer = (Uint8 *) malloc(srcLength);
+	if (!srcBuffer) {
+		fprintf(stderr, "pak: can not allocate %d bytes\n", srcLength);
+		return;
+	}
+
+	srcLength = SDL_RWread(src, srcBuffer, 1, srcLength);
+
+	pak_depack_mem(srcBuffer, srcLength, dstBufPtr, dstLength, 0);
+
+	free(srcBuffer);
+}
+
+/* Grow buffer if needed to write length bytes, return 0 if failed */
+static int pak_reserve(Uint8 **dst, int *dstBufLen, int length)
+{
+	Uint8 *newBuf;
+	int newLen = *dstBufLen;
+
+	if (length <= newLen) {
+		return 1;
+	}
+
+	while (newLen < length) {
+		newLen = (newLen>0 ? newLen*2 : CHUNK_SIZE);
+	}
+
+	newBuf = (Uint8 *) realloc(*dst, newLen);
+	if (!newBuf) {
+		fprintf(stderr, "pak: can not allocate %d bytes\n", newLen);
+		return 0;
+	}
+
+	*dst = newBuf;
+	*dstBufLen = newLen;
+	return 1;
+}
+
+void pak_depack_mem(const Uint8 *src, int srcLength, Uint8 **dstBufPtr, int *dstLength,
+	int dstSize)
+{
+	const Uint8 *src_end = src + srcLength;
+	pak_table_t *table;
+	Uint8 *dst = NULL, *str;
+	int dstBufLen = 0, dstOffset = 0;
+	int num_bits_to_read, i;
+	int lzwnew, c, lzwold, lzwnext, code;
+	Uint32 bitbuf = 0;
+	int bitcnt = 0;
+	int stop = 0;
+
+	*dstBufPtr = NULL;
+	*dstLength = 0;
+
+	table = (pak_table_t *) malloc(sizeof(pak_table_t));
+	if (!table) {
+		fprintf(stderr, "pak: can not allocate %d bytes\n", (int) sizeof(pak_table_t));
+		return;
+	}
+
+	for (i=0; i<256; i++) {
+		table->length[i] = 1;
+	}
+
+	if (!pak_reserve(&dst, &dstBufLen, dstSize)) {
+		free(table);
+		return;
+	}
+
+	while (!stop) {
+		lzwnext = PAK_CODE_FIRST;
+		num_bits_to_read = 9;
+
+		PAK_READ_BITS(lzwold, num_bits_to_read);
+		c = lzwold;
+
+		/* First code after reset is a byte */
+		if (lzwold > 255) {
+			break;
+		}
+
+		if (!pak_reserve(&dst, &dstBufLen, dstOffset+1)) {
+			break;
+		}
+		dst[dstOffset++] = c;
+
+		for(;;) {
+			PAK_READ_BITS(lzwnew, num_bits_to_read);
+
+			if (lzwnew == PAK_CODE_END) {
+				stop = 1;
+				break;
+			}
+
+			if (lzwnew == PAK_CODE_RESET) {
+				break;
+			}
+
+			if (lzwnew == PAK_CODE_BITS) {
+				if (++num_bits_to_read > PAK_MAX_BITS) {
+					stop = 1;
+					break;
+				}
+				continue;
+			}
+
+			/* Invalid code, or table full */
+			if ((lzwnew > lzwnext) || (lzwnext >= DECODE_SIZE)) {
+				stop = 1;
+				break;
+			}
+
+			/* Code not yet in table: previous string, followed by its first byte */
+			code = (lzwnew == lzwnext ? lzwold : lzwnew);
+
+			if (!pak_reserve(&dst, &dstBufLen, dstOffset+table->length[code]+1)) {
+				stop = 1;
+				break;
+			}
+
+			/* Write string backward, from last byte to first one */
+			str = &dst[dstOffset + table->length[code] - 1];
+			dstOffset += table->length[code];
+			while (code>255) {
+				*str-- = table->suffix[code];
+				code = table->prefix[code];
+			}
+			*str = code;
+
+			if (lzwnew == lzwnext) {
+				dst[dstOffset++] = c;
+			} else {
+				c = code;
+			}
+
+			table->prefix[lzwnext] = lzwold;
+			table->suffix[lzwnext] = c;
+			table->length[lzwnext] = table->length[lzwold] + 1;
+			lzwnext++;
+
+			lzwold = lzwnew;
+		}
+	}
+
+	free(table);
+
+	if (dstOffset == 0) {
+		free(dst);
+		return;
+	}
+
+	/* Return depacked buffer */
+	*dstBufPtr = dst;
+	*dstLength = dstOffset;
+}
+
+#ifdef ENABLE_PAK_REFERENCE
+
+/*--- Previous decoder, reading one bit at a time from stream ---*/
+
 typedef struct {
 	long flag;
 	long index;
@@ -107,7 +317,7 @@ static void pak_write_dest(Uint8 value)
 	dstPointer[dstOffset++] = value;
 }
 
-void pak_depack(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength)
+void pak_depack_ref(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength)
 {
 	int num_bits_to_read, i;
 	int lzwnew, c, lzwold, lzwnext;
@@ -178,3 +388,5 @@ void pak_depack(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength)
 	*dstBufPtr = (Uint8 *) dstPointer;
 	*dstLength = dstOffset;
 }
+
+#endif /* ENABLE_PAK_REFERENCE */
@@ -23,4 +23,14 @@
 
 void pak_depack(SDL_RWops *src, Uint8 **dstPointer, int *dstLength);
 
+/* Same, from packed data already in memory, dstSize is expected depacked
+   length if known, or 0 */
+void pak_depack_mem(const Uint8 *src, int srcLength, Uint8 **dstPointer, int *dstLength,
+	int dstSize);
+
+#ifdef ENABLE_PAK_REFERENCE
+/* Previous decoder, reading data from stream */
+void pak_depack_ref(SDL_RWops *src, Uint8 **dstPointer, int *dstLength);
+#endif
+
 #endif /* DEPACK_PAK_H */
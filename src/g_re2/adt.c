@@ -19,10 +19,13 @@
 */
 
 #include <stdio.h>
-#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <SDL.h>
 
+#include "adt.h"
+
 /*--- Defines ---*/
 
 #if SDL_VERSION_ATLEAST(2,0,0)
@@ -31,6 +34,477 @@
 #define REEVENGI_SDLSURF_FLAGS SDL_SWSURFACE
 #endif
 
+#define ADT_TABLE_BITS	10	/* Codes up to this length are decoded with a single lookup */
+#define ADT_MAX_BITS	16
+#define ADT_MAX_SYMBOLS	512
+
+#define ADT_WINDOW_SIZE	16384
+#define ADT_CHUNK_SIZE	16384	/* Packed data read at once from file */
+#define ADT_DST_CHUNK	0x8000	/* Depacked buffer grows by this size */
+
+/* Write depacked byte in window and output */
+#define ADT_WRITE(adt, out, value)	\
+	{	\
+		Uint8 byte = (value);	\
+		(adt)->window[(adt)->window_pos++] = byte;	\
+		(adt)->window_pos &= ADT_WINDOW_SIZE-1;	\
+		if ((out)->run == 0) {	\
+			(out)->nextRun(out);	\
+		}	\
+		*(out)->dst++ = byte;	\
+		(out)->run--;	\
+	}
+
+/*--- Types ---*/
+
+/* Canonical code: codes of same length are consecutive, in symbol order */
+typedef struct {
+	int num_symbols;
+	int length[ADT_MAX_SYMBOLS];	/* Code length of each symbol */
+
+	Uint16 start[ADT_MAX_BITS+2];	/* First code of each length */
+	Uint16 count[ADT_MAX_BITS+2];	/* Number of codes of each length */
+	Uint16 first[ADT_MAX_BITS+2];	/* Index in symbols[] of first code of each length */
+	Uint16 symbols[ADT_MAX_SYMBOLS];	/* Symbols, sorted by code */
+
+	/* (length<<16)|symbol for each ADT_TABLE_BITS prefix, 0 for longer codes */
+	Uint32 table[1<<ADT_TABLE_BITS];
+} adt_huffman_t;
+
+typedef struct adt_output_s adt_output_t;
+
+struct adt_output_s {
+	/* Set dst and run for next depacked bytes, at linear position pos */
+	void (*nextRun)(adt_output_t *this);
+
+	Uint8 *dst;	/* Write position */
+	int run;	/* Bytes that can be written at dst */
+	int pos;	/* Linear position of next run */
+	int failed;
+
+	Uint8 *buffer;	/* Depacked buffer */
+
+	SDL_Surface *surface;	/* Or image */
+	int reorganize;
+
+	Uint8 scratch[512];	/* Discarded bytes */
+};
+
+typedef struct {
+	SDL_RWops *src;
+	const Uint8 *src_ptr, *src_end;
+	Uint8 src_buffer[ADT_CHUNK_SIZE];
+
+	Uint32 bitbuf;	/* Next bits, MSB first */
+	int bitcnt;	/* Valid bits in bitbuf */
+
+	adt_huffman_t array1, array2, array3;
+
+	Uint8 window[ADT_WINDOW_SIZE];
+	int window_pos;
+} adt_context_t;
+
+/*--- Functions prototypes ---*/
+
+static void adt_fill_bits(adt_context_t *adt);
+static int adt_read_bits(adt_context_t *adt, int num_bits);
+static int adt_read_bit(adt_context_t *adt);
+static int adt_read_bitfield(adt_context_t *adt);
+static int adt_read_symbol(adt_context_t *adt, adt_huffman_t *huff);
+static void adt_init_huffman(adt_huffman_t *huff);
+static void adt_read_lengths(adt_context_t *adt, adt_huffman_t *huff);
+static void adt_read_lengths2(adt_context_t *adt);
+static int adt_decode(SDL_RWops *src, adt_output_t *output);
+
+static void next_run_buffer(adt_output_t *this);
+static void next_run_surface(adt_output_t *this);
+
+/*--- Functions ---*/
+
+/* Have at least 25 bits in bitbuf, past end of data reads as 0 */
+static void adt_fill_bits(adt_context_t *adt)
+{
+	while (adt->bitcnt <= 24) {
+		Uint32 value = 0;
+
+		if ((adt->src_ptr == adt->src_end) && adt->src) {
+			int length = SDL_RWread(adt->src, adt->src_buffer, 1, ADT_CHUNK_SIZE);
+			if (length > 0) {
+				adt->src_ptr = adt->src_buffer;
+				adt->src_end = adt->src_buffer + length;
+			} else {
+				adt->src = NULL;
+			}
+		}
+		if (adt->src_ptr < adt->src_end) {
+			value = *adt->src_ptr++;
+		}
+
+		adt->bitbuf |= value << (24-adt->bitcnt);
+		adt->bitcnt += 8;
+	}
+}
+
+/* Read up to 16 bits */
+static int adt_read_bits(adt_context_t *adt, int num_bits)
+{
+	int value;
+
+	if (num_bits <= 0) {
+		return 0;
+	}
+	if (adt->bitcnt < num_bits) {
+		adt_fill_bits(adt);
+	}
+
+	value = adt->bitbuf >> (32-num_bits);
+	adt->bitbuf <<= num_bits;
+	adt->bitcnt -= num_bits;
+	return value;
+}
+
+static int adt_read_bit(adt_context_t *adt)
+{
+	return adt_read_bits(adt, 1);
+}
+
+/* Number of 0 bits, then same number of bits after a 1 bit */
+static int adt_read_bitfield(adt_context_t *adt)
+{
+	int numZeroBits = 0;
+
+	while (adt_read_bit(adt)==0) {
+		if (++numZeroBits >= ADT_MAX_BITS) {
+			break;
+		}
+	}
+
+	return (1<<numZeroBits) | adt_read_bits(adt, numZeroBits);
+}
+
+static int adt_read_symbol(adt_context_t *adt, adt_huffman_t *huff)
+{
+	Uint32 entry;
+	int length, code;
+
+	if (adt->bitcnt < ADT_MAX_BITS) {
+		adt_fill_bits(adt);
+	}
+
+	entry = huff->table[adt->bitbuf >> (32-ADT_TABLE_BITS)];
+	if (entry) {
+		adt->bitbuf <<= entry>>16;
+		adt->bitcnt -= entry>>16;
+		return entry & 0xffff;
+	}
+
+	/* Longer code */
+	code = adt->bitbuf >> (32-ADT_MAX_BITS);
+	for (length=ADT_TABLE_BITS+1; length<=ADT_MAX_BITS; length++) {
+		int index = (code >> (ADT_MAX_BITS-length)) - huff->start[length];
+
+		if ((index >= 0) && (index < huff->count[length])) {
+			adt->bitbuf <<= length;
+			adt->bitcnt -= length;
+			return huff->symbols[huff->first[length] + index];
+		}
+	}
+
+	/* Invalid code */
+	adt_read_bit(adt);
+	return 0;
+}
+
+/* Assign codes from lengths, same order as original decoder, build lookup table */
+static void adt_init_huffman(adt_huffman_t *huff)
+{
+	Uint16 rank[ADT_MAX_BITS+2];
+	int i, length;
+
+	memset(huff->count, 0, sizeof(huff->count));
+	for (i=0; i<huff->num_symbols; i++) {
+		length = huff->length[i];
+		if ((length>0) && (length<=ADT_MAX_BITS)) {
+			huff->count[length]++;
+		}
+	}
+
+	huff->start[1] = 0;
+	huff->first[1] = 0;
+	for (length=1; length<=ADT_MAX_BITS; length++) {
+		huff->start[length+1] = (huff->start[length] + huff->count[length])<<1;
+		huff->first[length+1] = huff->first[length] + huff->count[length];
+	}
+
+	memset(rank, 0, sizeof(rank));
+	memset(huff->table, 0, sizeof(huff->table));
+	for (i=0; i<huff->num_symbols; i++) {
+		int code, shift, j;
+
+		length = huff->length[i];
+		if ((length<=0) || (length>ADT_MAX_BITS)) {
+			continue;
+		}
+
+		huff->symbols[huff->first[length] + rank[length]] = i;
+		code = huff->start[length] + rank[length]++;
+
+		if ((length>ADT_TABLE_BITS) || (code >= (1<<length))) {
+			continue;
+		}
+
+		/* Fill all entries starting with this code */
+		shift = ADT_TABLE_BITS-length;
+		for (j=0; j<(1<<shift); j++) {
+			huff->table[(code<<shift) + j] = (length<<16) | i;
+		}
+	}
+}
+
+/* Lengths of array 1 and 3: same as previous, or changed bits */
+static void adt_read_lengths(adt_context_t *adt, adt_huffman_t *huff)
+{
+	int i, prevValue = 0;
+
+	for (i=0; i<huff->num_symbols; i++) {
+		if (adt_read_bit(adt)) {
+			prevValue ^= adt_read_bitfield(adt);
+		}
+		huff->length[i] = prevValue;
+	}
+
+	adt_init_huffman(huff);
+}
+
+/* Lengths of array 2: runs of changed bits coded with array 1, and runs of no change */
+static void adt_read_lengths2(adt_context_t *adt)
+{
+	adt_huffman_t *huff = &adt->array2;
+	int curBit, count, i, j, prevValue = 0;
+
+	curBit = adt_read_bit(adt);
+	j = 0;
+	while (j < huff->num_symbols) {
+		count = adt_read_bitfield(adt);
+		if (count > huff->num_symbols - j) {
+			count = huff->num_symbols - j;
+		}
+
+		for (i=0; i<count; i++) {
+			if (curBit) {
+				prevValue ^= adt_read_symbol(adt, &adt->array1);
+			}
+			huff->length[j++] = prevValue;
+		}
+
+		curBit ^= 1;
+	}
+
+	adt_init_huffman(huff);
+}
+
+/* Read each block and depack it to output */
+static int adt_decode(SDL_RWops *src, adt_output_t *output)
+{
+	adt_context_t *adt;
+	int blockLength;
+
+	adt = (adt_context_t *) calloc(1, sizeof(adt_context_t));
+	if (!adt) {
+		fprintf(stderr, "adt: can not allocate %d bytes\n", (int) sizeof(adt_context_t));
+		return 0;
+	}
+
+	adt->src = src;
+	adt->array1.num_symbols = 16;
+	adt->array2.num_symbols = ADT_MAX_SYMBOLS;
+	adt->array3.num_symbols = 16;
+
+	SDL_RWseek(src, 4, RW_SEEK_CUR);
+
+	blockLength = adt_read_bits(adt, 8);
+	blockLength |= adt_read_bits(adt, 8)<<8;
+	while ((blockLength>0) && !output->failed) {
+		int curBlockLength;
+
+		adt_read_lengths(adt, &adt->array1);
+		adt_read_lengths2(adt);
+		adt_read_lengths(adt, &adt->array3);
+
+		for (curBlockLength=0; curBlockLength<blockLength; curBlockLength++) {
+			int symbol = adt_read_symbol(adt, &adt->array2);
+
+			if (symbol < 256) {
+				ADT_WRITE(adt, output, symbol)
+			} else {
+				int numValues = symbol - 0xfd;
+				int distance = adt_read_symbol(adt, &adt->array3);
+				int startOffset;
+
+				if (distance != 0) {
+					distance = adt_read_bits(adt, distance-1) + (1<<(distance-1));
+				}
+
+				startOffset = (adt->window_pos-distance-1) & (ADT_WINDOW_SIZE-1);
+				while (numValues-- > 0) {
+					ADT_WRITE(adt, output, adt->window[startOffset])
+					startOffset = (startOffset+1) & (ADT_WINDOW_SIZE-1);
+				}
+			}
+		}
+
+		blockLength = adt_read_bits(adt, 8);
+		blockLength |= adt_read_bits(adt, 8)<<8;
+	}
+
+	free(adt);
+	return !output->failed;
+}
+
+/* Grow buffer by ADT_DST_CHUNK */
+static void next_run_buffer(adt_output_t *this)
+{
+	Uint8 *buffer;
+
+	this->dst = this->scratch;
+	this->run = sizeof(this->scratch);
+	if (this->failed) {
+		return;
+	}
+
+	buffer = (Uint8 *) realloc(this->buffer, this->pos + ADT_DST_CHUNK);
+	if (!buffer) {
+		fprintf(stderr, "adt: can not allocate %d bytes\n", this->pos + ADT_DST_CHUNK);
+		this->failed = 1;
+		return;
+	}
+
+	this->buffer = buffer;
+	this->dst = &buffer[this->pos];
+	this->run = ADT_DST_CHUNK;
+	this->pos += ADT_DST_CHUNK;
+}
+
+void adt_depack(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength)
+{
+	adt_output_t output;
+
+	*dstBufPtr = NULL;
+	*dstLength = 0;
+
+	memset(&output, 0, sizeof(output));
+	output.nextRun = next_run_buffer;
+
+	if (!adt_decode(src, &output)) {
+		free(output.buffer);
+		return;
+	}
+
+	/* Length is a multiple of ADT_DST_CHUNK, like original decoder */
+	if (output.run > 0) {
+		memset(output.dst, 0, output.run);
+	}
+
+	*dstBufPtr = output.buffer;
+	*dstLength = output.pos;
+}
+
+/*
+	Find where next bytes go in image, same layout as adt_surface(),
+	bytes out of image are discarded
+*/
+static void next_run_surface(adt_output_t *this)
+{
+	int pixel = this->pos>>1;
+	int x, y = 240, width;
+
+	if (this->reorganize) {
+		if (pixel < 256*256) {
+			/* First 256x256 block */
+			x = pixel & 255;
+			y = pixel>>8;
+			width = 256-x;
+		} else if (pixel < 256*256+128*128) {
+			/* Then 2x64x128 inside 128x128 */
+			pixel -= 256*256;
+			x = pixel & 127;
+			y = pixel>>7;
+			if (x < 64) {
+				width = 64-x;
+			} else {
+				width = 128-x;
+				x -= 64;
+				y += 128;
+			}
+			x += 256;
+		} else {
+			width = sizeof(this->scratch)>>1;
+		}
+	} else {
+		x = pixel % 320;
+		y = pixel / 320;
+		width = 320-x;
+	}
+
+	if (y < 240) {
+		this->dst = (Uint8 *) this->surface->pixels;
+		this->dst += y*this->surface->pitch + x*2;
+	} else {
+		this->dst = this->scratch;
+		if (width > (int) (sizeof(this->scratch)>>1)) {
+			width = sizeof(this->scratch)>>1;
+		}
+	}
+
+	this->run = width*2;
+	this->pos += width*2;
+}
+
+SDL_Surface *adt_depack_surface(SDL_RWops *src, int reorganize)
+{
+	adt_output_t output;
+	SDL_Surface *surface;
+	int min_length;
+
+	surface = SDL_CreateRGBSurface(REEVENGI_SDLSURF_FLAGS,320,240,16,31,31<<5,31<<10,0);
+	if (!surface) {
+		return NULL;
+	}
+
+	memset(&output, 0, sizeof(output));
+	output.nextRun = next_run_surface;
+	output.surface = surface;
+	output.reorganize = reorganize;
+
+	/* Up to last pixel of image */
+	min_length = (reorganize ? 256*256+(111*128+127)+1 : 320*240) * 2;
+
+	if (!adt_decode(src, &output) || (output.pos-output.run < min_length)) {
+		SDL_FreeSurface(surface);
+		return NULL;
+	}
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+	{
+		int x,y;
+
+		for (y=0; y<240; y++) {
+			Uint16 *surface_line = (Uint16 *) ((Uint8 *) surface->pixels + y*surface->pitch);
+
+			for (x=0; x<320; x++) {
+				surface_line[x] = SDL_SwapLE16(surface_line[x]);
+			}
+		}
+	}
+#endif
+
+	return surface;
+}
+
+#ifdef ENABLE_ADT_REFERENCE
+
+/*--- Previous decoder, reading data from stream ---*/
+
 /*--- Variables */
 
 static Uint8 *dstPointer;
@@ -345,7 +819,7 @@ static void initUnpackBlock(SDL_RWops *src)
 }
 
 /* Initialize temporary tables, read each block and depack it */
-void adt_depack(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength)
+void adt_depack_ref(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength)
 {
 	int blockLength;
 
@@ -440,6 +914,8 @@ void adt_depack(SDL_RWops *src, Uint8 **dstBufPtr, int *dstLength)
 	*dstBufPtr = dstPointer;
 }
 
+#endif /* ENABLE_ADT_REFERENCE */
+
 SDL_Surface *adt_surface(Uint16 *source, int reorganize)
 {
 	SDL_Surface *surface;
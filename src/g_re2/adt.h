@@ -30,6 +30,19 @@
 */
 void adt_depack(SDL_RWops *src, Uint8 **dstPointer, int *dstLength);
 
+/*
+	Depack an ADT file directly in a 320x240 SDL_Surface, same as
+	adt_depack() followed by adt_surface()
+	src		Source file
+	reorganize	Same as adt_surface()
+*/
+SDL_Surface *adt_depack_surface(SDL_RWops *src, int reorganize);
+
+#ifdef ENABLE_ADT_REFERENCE
+/* Previous decoder */
+void adt_depack_ref(SDL_RWops *src, Uint8 **dstPointer, int *dstLength);
+#endif
+
 /*
 	Create a SDL_Surface, for a depacked ADT file
 	source		Pointer to depacked file
@@ -26,6 +26,7 @@
 
 #include "../filesystem.h"
 #include "../parameters.h"
+#include "../diskcache.h"
 #include "../log.h"
 
 #include "../g_common/player.h"
@@ -137,30 +138,26 @@ static void load_background(room_t *this, int num_stage, int num_room, int num_c
 static int load_adt_bg(room_t *this, const char *filename)
 {
 	SDL_RWops *src;
+	SDL_Surface *image;
 	int retval = 0;
 
-	src = FS_makeRWops(filename);
-	if (src) {
-		Uint8 *dstBuffer;
-		int dstBufLen;
-
-		adt_depack(src, &dstBuffer, &dstBufLen);
-
-		if (dstBuffer && dstBufLen) {
-			if (dstBufLen == 320*256*2) {
-				SDL_Surface *image = adt_surface((Uint16 *) dstBuffer, 1);
-				if (image) {
-					this->background = render.createTexture(RENDER_TEXTURE_CACHEABLE);
-					if (this->background) {
-						this->background->load_from_surf(this->background, image);
-						retval = 1;
-					}
-					SDL_FreeSurface(image);
-				}
-			}
-			free(dstBuffer);
+	image = diskcache_load_surface(filename, 0);
+	if (!image) {
+		src = FS_makeRWops(filename);
+		if (src) {
+			image = adt_depack_surface(src, 1);
+			diskcache_save_surface(filename, 0, image);
+			SDL_RWclose(src);
 		}
-		SDL_RWclose(src);
+	}
+
+	if (image) {
+		this->background = render.createTexture(RENDER_TEXTURE_CACHEABLE);
+		if (this->background) {
+			this->background->load_from_surf(this->background, image);
+			retval = 1;
+		}
+		diskcache_free_surface(image);
 	}
 
 	return retval;
@@ -190,26 +187,29 @@ static void load_bgmask(room_t *this, int num_stage, int num_room, int num_camer
 static int load_adt_bgmask(room_t *this, const char *filename)
 {
 	SDL_RWops *src;
+	Uint8 *dstBuffer;
+	int dstBufLen = 0;
 	int retval = 0;
-	
-	src = FS_makeRWops(filename);
-	if (src) {
-		Uint8 *dstBuffer;
-		int dstBufLen;
-
-		adt_depack(src, &dstBuffer, &dstBufLen);
-
-		if (dstBuffer && dstBufLen) {
-			this->bg_mask = render.createTexture(RENDER_TEXTURE_MUST_POT);
-			if (this->bg_mask) {
-				this->bg_mask->load_from_tim(this->bg_mask, dstBuffer);
-
-				retval = 1;
-			}
-			free(dstBuffer);
+
+	dstBuffer = (Uint8 *) diskcache_load_data(filename, 0, &dstBufLen);
+	if (!dstBuffer) {
+		src = FS_makeRWops(filename);
+		if (src) {
+			adt_depack(src, &dstBuffer, &dstBufLen);
+			diskcache_save_data(filename, 0, dstBuffer, dstBufLen);
+			SDL_RWclose(src);
+		}
+	}
+
+	if (dstBuffer && dstBufLen) {
+		this->bg_mask = render.createTexture(RENDER_TEXTURE_MUST_POT);
+		if (this->bg_mask) {
+			this->bg_mask->load_from_tim(this->bg_mask, dstBuffer);
+
+			retval = 1;
 		}
-		SDL_RWclose(src);
 	}
+	free(dstBuffer);
 
 	return retval;
 }
@@ -235,13 +235,13 @@ static render_skel_t *load_model(player_t *this, int num_model)
 
 	logMsg(1, "emd: Start loading model %s ...\n", filepath);
 
-	emd = FS_Load(filepath, &emd_length);
+	emd = FS_Map(filepath, &emd_length);
 	if (emd) {
 		sprintf(filepath, re2pcdemo_model, num_model, "tim");
-		tim = FS_Load(filepath, &tim_length);
+		tim = FS_Map(filepath, &tim_length);
 		if (tim) {
 			model = model_emd2_load(emd, tim, emd_length, tim_length);
-			free(tim);
+			FS_Unmap(tim);
 		}
 		/*free(emd);*/
 	}	
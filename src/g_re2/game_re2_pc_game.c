@@ -27,6 +27,7 @@
 #include "../filesystem.h"
 #include "../log.h"
 #include "../parameters.h"
+#include "../diskcache.h"
 
 #include "../g_common/player.h"
 #include "../g_common/room.h"
@@ -277,34 +278,33 @@ static void load_background(room_t *this, int num_stage, int num_room, int num_c
 static int load_image(room_t *this, int num_image)
 {
 	SDL_RWops *src;
+	SDL_Surface *image;
 	int retval = 0;
 
 	if (!re2_images[num_image].length) {
 		return 0;
 	}
-	
-	src = FS_makeRWops(re2pcgame_bg_archive);
-	if (src) {
-		Uint8 *dstBuffer;
-		int dstBufLen;
-
-		SDL_RWseek(src, re2_images[num_image].offset, RW_SEEK_SET);
-
-		adt_depack(src, &dstBuffer, &dstBufLen);
-
-		if (dstBuffer && dstBufLen) {
-			SDL_Surface *image = adt_surface((Uint16 *) dstBuffer, 1);
-			if (image) {
-				this->background = render.createTexture(RENDER_TEXTURE_CACHEABLE);
-				if (this->background) {
-					this->background->load_from_surf(this->background, image);
-					retval = 1;
-				}
-				SDL_FreeSurface(image);
-			}
-			free(dstBuffer);
+
+	image = diskcache_load_surface(re2pcgame_bg_archive, num_image);
+	if (!image) {
+		src = FS_makeRWops(re2pcgame_bg_archive);
+		if (src) {
+			SDL_RWseek(src, re2_images[num_image].offset, RW_SEEK_SET);
+
+			image = adt_depack_surface(src, 1);
+			diskcache_save_surface(re2pcgame_bg_archive, num_image, image);
+
+			SDL_RWclose(src);
 		}
-		SDL_RWclose(src);
+	}
+
+	if (image) {
+		this->background = render.createTexture(RENDER_TEXTURE_CACHEABLE);
+		if (this->background) {
+			this->background->load_from_surf(this->background, image);
+			retval = 1;
+		}
+		diskcache_free_surface(image);
 	}
 
 	return retval;
@@ -337,7 +337,7 @@ static render_skel_t *load_model(player_t *this, int num_model)
 
 	logMsg(1, "emd: Start loading model %s ...\n", filepath);
 
-	emd = FS_Load(filepath, &emd_length);
+	emd = FS_Map(filepath, &emd_length);
 	if (emd) {
 		sprintf(filepath, re2pcgame_model,
 			game_player, game_player, game_player,
@@ -345,10 +345,10 @@ static render_skel_t *load_model(player_t *this, int num_model)
 		for (i=0; i<strlen(filepath); i++) {
 			filepath[i] = toupper(filepath[i]);
 		}
-		tim = FS_Load(filepath, &tim_length);
+		tim = FS_Map(filepath, &tim_length);
 		if (tim) {
 			model = model_emd2_load(emd, tim, emd_length, tim_length);
-			free(tim);
+			FS_Unmap(tim);
 		}
 		/*free(emd);*/
 	}	
@@ -34,6 +34,7 @@
 #include "../filesystem.h"
 #include "../parameters.h"
 #include "../log.h"
+#include "../diskcache.h"
 
 #include "../g_common/game.h"
 #include "../g_common/player.h"
@@ -124,7 +125,7 @@ static void load_background(room_t *this, int num_stage, int num_room, int num_c
 static int load_jpg_bg(room_t *this, const char *filename);
 
 static void load_bgmask(room_t *this, int num_stage, int num_room, int num_camera);
-static int load_tim_bgmask(room_t *this, const char *filename);
+static int load_tim_bgmask(room_t *this, const char *filename, int num_camera);
 
 static render_skel_t *load_model(player_t *this, int num_model);
 static void get_model_name(player_t *this, char name[32]);
@@ -219,22 +220,28 @@ int load_jpg_bg(room_t *this, const char *filename)
 {
 #ifdef HAVE_SDLIMAGE
 	SDL_RWops *src;
+	SDL_Surface *image;
 	int retval = 0;
-	
-	src = FS_makeRWops(filename);
-	if (src) {
-		SDL_Surface *image = IMG_Load_RW(src, 0);
-		if (image) {
-			this->background = render.createTexture(RENDER_TEXTURE_CACHEABLE);
-			if (this->background) {
-				this->background->load_from_surf(this->background, image);
-				retval = 1;
-			}
 
-			SDL_FreeSurface(image);
+	image = diskcache_load_surface(filename, 0);
+	if (!image) {
+		src = FS_makeRWops(filename);
+		if (src) {
+			image = IMG_Load_RW(src, 0);
+			diskcache_save_surface(filename, 0, image);
+
+			SDL_RWclose(src);
 		}
+	}
 
-		SDL_RWclose(src);
+	if (image) {
+		this->background = render.createTexture(RENDER_TEXTURE_CACHEABLE);
+		if (this->background) {
+			this->background->load_from_surf(this->background, image);
+			retval = 1;
+		}
+
+		diskcache_free_surface(image);
 	}
 
 	return retval;
@@ -257,17 +264,30 @@ void load_bgmask(room_t *this, int num_stage, int num_room, int num_camera)
 	logMsg(1, "sld: Start loading %s ...\n", filepath);
 
 	logMsg(1, "sld: %s loading %s ...\n",
-		load_tim_bgmask(this, filepath) ? "Done" : "Failed",
+		load_tim_bgmask(this, filepath, num_camera) ? "Done" : "Failed",
 		filepath);
 
 	free(filepath);
 }
 
-int load_tim_bgmask(room_t *this, const char *filename)
+int load_tim_bgmask(room_t *this, const char *filename, int num_camera)
 {
 	SDL_RWops *src;
 	int retval = 0;
 	PHYSFS_sint64 length;
+	Uint8 *dstBuffer;
+	int dstBufLen;
+
+	dstBuffer = (Uint8 *) diskcache_load_data(filename, num_camera, &dstBufLen);
+	if (dstBuffer) {
+		this->bg_mask = render.createTexture(RENDER_TEXTURE_MUST_POT);
+		if (this->bg_mask) {
+			this->bg_mask->load_from_tim(this->bg_mask, dstBuffer);
+			retval = 1;
+		}
+		free(dstBuffer);
+		return retval;
+	}
 
 	src = FS_makeRWops(filename);
 	if (src) {
@@ -289,12 +309,10 @@ int load_tim_bgmask(room_t *this, const char *filename)
 
 			if (fileLen) {
 				/* Read file we need */
-				if (num_file == game->num_camera) {
-					Uint8 *dstBuffer;
-					int dstBufLen;
-
+				if (num_file == num_camera) {
 					sld_depack(src, &dstBuffer, &dstBufLen);
 					if (dstBuffer && dstBufLen) {
+						diskcache_save_data(filename, num_camera, dstBuffer, dstBufLen);
 
 						this->bg_mask = render.createTexture(RENDER_TEXTURE_MUST_POT);
 						if (this->bg_mask) {
@@ -313,7 +331,7 @@ int load_tim_bgmask(room_t *this, const char *filename)
 				fileLen = 8;
 
 				/* No mask for this camera */
-				if (num_file == game->num_camera) {
+				if (num_file == num_camera) {
 					retval = 1;
 					break;
 				}
@@ -366,14 +384,14 @@ static render_skel_t *load_model(player_t *this, int num_model)
 
 	logMsg(1, "emd: Start loading model %s ...\n", filepath);
 
-	emd = FS_Load(filepath, &emd_length);
+	emd = FS_Map(filepath, &emd_length);
 	if (emd) {
 		sprintf(filepath, re3pc_model, num_model, "tim");
-		tim = FS_Load(filepath, &tim_length);
+		tim = FS_Map(filepath, &tim_length);
 		if (tim) {
 			model = model_emd3_load(emd, tim, emd_length, tim_length);
 
-			free(tim);
+			FS_Unmap(tim);
 		}
 		/*free(emd);*/
 	}	
@@ -113,7 +113,7 @@ static void load_background(room_t *this, int num_stage, int num_room, int num_c
 	logMsg(1, "bss: Start loading %s ...\n", filepath);
 
 	logMsg(1, "bss: %s loading %s ...\n",
-		background_bss_load(filepath, CHUNK_SIZE, 0) ? "Done" : "Failed",
+		background_bss_load(this, filepath, num_camera, CHUNK_SIZE, 0) ? "Done" : "Failed",
 		filepath);
 
 	free(filepath);
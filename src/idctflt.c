@@ -0,0 +1,294 @@
+/*
+	Floating point AAN IDCT, with dequantization
+
+	Copyright (C) 2017	Patrice Mandin
+
+	Based on jidctflt.c
+	Copyright (C) 1994-1998, Thomas G. Lane.
+	This file is part of the Independent JPEG Group's software.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*
+	Same algorithm as idctfst.c, but all computations are done in
+	floats, so there is no loss of precision in the scaled
+	dequantization values and the multiplications. Dequantization is
+	done while loading coefficients for the first pass.
+
+	The SSE2 version computes 4 columns (then 4 rows) at a time, doing
+	the same operations in same order as the C version, so both give
+	the same result. Define ENABLE_IDCT_C to also build the C version
+	when SSE2 is used, to compare them.
+*/
+
+/*--- Includes ---*/
+
+#include <SDL.h>
+
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(IDCT_NO_SIMD)
+#define IDCT_X86_SSE 1
+#include <emmintrin.h>
+#endif
+
+#include "idctflt.h"
+
+/*--- Defines ---*/
+
+#define	DCTSIZE	8
+#define	DCTSIZE2	64
+
+#define FIX_1_082392200  1.082392200f
+#define FIX_1_414213562  1.414213562f
+#define FIX_1_847759065  1.847759065f
+#define FIX_2_613125930  2.613125930f
+
+/*
+	Round to nearest by truncating a positive value: values are clamped
+	to [-ROUND_BIAS,ROUND_BIAS] first, far outside of 8 bits samples
+*/
+#define	ROUND_BIAS	4096
+
+/*--- Variables ---*/
+
+/* cos(k*PI/16)*sqrt(2), k=1..7, 1 for k=0 */
+static const float aanscalefactor[DCTSIZE] = {
+	1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+	1.0f, 0.785694958f, 0.541196100f, 0.275899379f
+};
+
+/*--- Functions ---*/
+
+static int IDCT_round(float x)
+{
+	if (x < -ROUND_BIAS) {
+		x = -ROUND_BIAS;
+	} else if (x > ROUND_BIAS) {
+		x = ROUND_BIAS;
+	}
+
+	return (int) (x + (ROUND_BIAS+0.5f)) - ROUND_BIAS;
+}
+
+void IDCT_scaleDequant(float *dequant)
+{
+	int row, col;
+
+	for (row=0; row<DCTSIZE; row++) {
+		for (col=0; col<DCTSIZE; col++) {
+			*dequant++ *= aanscalefactor[row] * aanscalefactor[col] * 0.125f;
+		}
+	}
+}
+
+#ifdef IDCT_X86_SSE
+
+/* 1D IDCT on 4 columns, in[] and out[] can be the same array */
+#define IDCT_1D_SSE(in, out)	\
+{	\
+	__m128 tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;	\
+	__m128 z5, z10, z11, z12, z13;	\
+	\
+	/* Even part */	\
+	z10 = _mm_add_ps(in[0], in[4]);	\
+	z11 = _mm_sub_ps(in[0], in[4]);	\
+	z13 = _mm_add_ps(in[2], in[6]);	\
+	z12 = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(in[2], in[6]), c_1_414213562), z13);	\
+	\
+	tmp0 = _mm_add_ps(z10, z13);	\
+	tmp3 = _mm_sub_ps(z10, z13);	\
+	tmp1 = _mm_add_ps(z11, z12);	\
+	tmp2 = _mm_sub_ps(z11, z12);	\
+	\
+	/* Odd part */	\
+	z13 = _mm_add_ps(in[3], in[5]);	\
+	z10 = _mm_sub_ps(in[3], in[5]);	\
+	z11 = _mm_add_ps(in[1], in[7]);	\
+	z12 = _mm_sub_ps(in[1], in[7]);	\
+	\
+	z5 = _mm_mul_ps(_mm_sub_ps(z12, z10), c_1_847759065);	\
+	tmp7 = _mm_add_ps(z11, z13);	\
+	tmp6 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(z10, c_2_613125930), z5), tmp7);	\
+	tmp5 = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(z11, z13), c_1_414213562), tmp6);	\
+	tmp4 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(z12, c_1_082392200), z5), tmp5);	\
+	\
+	out[0] = _mm_add_ps(tmp0, tmp7);	\
+	out[7] = _mm_sub_ps(tmp0, tmp7);	\
+	out[1] = _mm_add_ps(tmp1, tmp6);	\
+	out[6] = _mm_sub_ps(tmp1, tmp6);	\
+	out[2] = _mm_add_ps(tmp2, tmp5);	\
+	out[5] = _mm_sub_ps(tmp2, tmp5);	\
+	out[4] = _mm_add_ps(tmp3, tmp4);	\
+	out[3] = _mm_sub_ps(tmp3, tmp4);	\
+}
+
+/* Transpose 4x4 quarter of the block, from rows a[] to rows b[] */
+#define TRANSPOSE_SSE(a0,a1,a2,a3, b0,b1,b2,b3)	\
+{	\
+	__m128 t0 = _mm_unpacklo_ps(a0, a1);	\
+	__m128 t1 = _mm_unpacklo_ps(a2, a3);	\
+	__m128 t2 = _mm_unpackhi_ps(a0, a1);	\
+	__m128 t3 = _mm_unpackhi_ps(a2, a3);	\
+	b0 = _mm_movelh_ps(t0, t1);	\
+	b1 = _mm_movehl_ps(t1, t0);	\
+	b2 = _mm_movelh_ps(t2, t3);	\
+	b3 = _mm_movehl_ps(t3, t2);	\
+}
+
+static void IDCT_sse2(BLOCK *blk, const float *dequant)
+{
+	const __m128 c_1_082392200 = _mm_set1_ps(FIX_1_082392200);
+	const __m128 c_1_414213562 = _mm_set1_ps(FIX_1_414213562);
+	const __m128 c_1_847759065 = _mm_set1_ps(FIX_1_847759065);
+	const __m128 c_2_613125930 = _mm_set1_ps(FIX_2_613125930);
+	const __m128 bias = _mm_set1_ps(ROUND_BIAS+0.5f);
+	const __m128i ibias = _mm_set1_epi32(ROUND_BIAS);
+	const __m128 min = _mm_set1_ps(-ROUND_BIAS);
+	const __m128 max = _mm_set1_ps(ROUND_BIAS);
+	__m128 left[DCTSIZE], right[DCTSIZE];	/* columns 0-3, 4-7 */
+	__m128 top[DCTSIZE], bottom[DCTSIZE];	/* rows 0-3, 4-7, transposed */
+	int i;
+
+	/* Pass 1: dequantize, process columns */
+	for (i=0; i<DCTSIZE; i++) {
+		left[i] = _mm_mul_ps(
+			_mm_cvtepi32_ps(_mm_loadu_si128((__m128i *) &blk[i*DCTSIZE])),
+			_mm_loadu_ps(&dequant[i*DCTSIZE]));
+		right[i] = _mm_mul_ps(
+			_mm_cvtepi32_ps(_mm_loadu_si128((__m128i *) &blk[i*DCTSIZE+4])),
+			_mm_loadu_ps(&dequant[i*DCTSIZE+4]));
+	}
+
+	IDCT_1D_SSE(left, left)
+	IDCT_1D_SSE(right, right)
+
+	/* Pass 2: process rows */
+	TRANSPOSE_SSE(left[0],left[1],left[2],left[3], top[0],top[1],top[2],top[3])
+	TRANSPOSE_SSE(right[0],right[1],right[2],right[3], top[4],top[5],top[6],top[7])
+	TRANSPOSE_SSE(left[4],left[5],left[6],left[7], bottom[0],bottom[1],bottom[2],bottom[3])
+	TRANSPOSE_SSE(right[4],right[5],right[6],right[7], bottom[4],bottom[5],bottom[6],bottom[7])
+
+	IDCT_1D_SSE(top, top)
+	IDCT_1D_SSE(bottom, bottom)
+
+	TRANSPOSE_SSE(top[0],top[1],top[2],top[3], left[0],left[1],left[2],left[3])
+	TRANSPOSE_SSE(top[4],top[5],top[6],top[7], right[0],right[1],right[2],right[3])
+	TRANSPOSE_SSE(bottom[0],bottom[1],bottom[2],bottom[3], left[4],left[5],left[6],left[7])
+	TRANSPOSE_SSE(bottom[4],bottom[5],bottom[6],bottom[7], right[4],right[5],right[6],right[7])
+
+	/* Clamp, round and store */
+	for (i=0; i<DCTSIZE; i++) {
+		left[i] = _mm_min_ps(_mm_max_ps(left[i], min), max);
+		right[i] = _mm_min_ps(_mm_max_ps(right[i], min), max);
+		_mm_storeu_si128((__m128i *) &blk[i*DCTSIZE],
+			_mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(left[i], bias)), ibias));
+		_mm_storeu_si128((__m128i *) &blk[i*DCTSIZE+4],
+			_mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(right[i], bias)), ibias));
+	}
+}
+
+#endif /* IDCT_X86_SSE */
+
+#if !defined(IDCT_X86_SSE) || defined(ENABLE_IDCT_C)
+
+/* 1D IDCT on 8 values, every 'step' in in[] and out[] */
+#define IDCT_1D(in, out, step)	\
+{	\
+	float tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;	\
+	float z5, z10, z11, z12, z13;	\
+	\
+	/* Even part */	\
+	z10 = in[step*0] + in[step*4];	\
+	z11 = in[step*0] - in[step*4];	\
+	z13 = in[step*2] + in[step*6];	\
+	z12 = (in[step*2] - in[step*6]) * FIX_1_414213562 - z13;	\
+	\
+	tmp0 = z10 + z13;	\
+	tmp3 = z10 - z13;	\
+	tmp1 = z11 + z12;	\
+	tmp2 = z11 - z12;	\
+	\
+	/* Odd part */	\
+	z13 = in[step*3] + in[step*5];	\
+	z10 = in[step*3] - in[step*5];	\
+	z11 = in[step*1] + in[step*7];	\
+	z12 = in[step*1] - in[step*7];	\
+	\
+	z5 = (z12 - z10) * FIX_1_847759065;	\
+	tmp7 = z11 + z13;	\
+	tmp6 = z10 * FIX_2_613125930 + z5 - tmp7;	\
+	tmp5 = (z11 - z13) * FIX_1_414213562 - tmp6;	\
+	tmp4 = z12 * FIX_1_082392200 - z5 + tmp5;	\
+	\
+	out[step*0] = tmp0 + tmp7;	\
+	out[step*7] = tmp0 - tmp7;	\
+	out[step*1] = tmp1 + tmp6;	\
+	out[step*6] = tmp1 - tmp6;	\
+	out[step*2] = tmp2 + tmp5;	\
+	out[step*5] = tmp2 - tmp5;	\
+	out[step*4] = tmp3 + tmp4;	\
+	out[step*3] = tmp3 - tmp4;	\
+}
+
+static void IDCT_c(BLOCK *blk, const float *dequant)
+{
+	float workspace[DCTSIZE2];
+	float *ptr;
+	int i;
+
+	/* Pass 1: dequantize, process columns */
+	for (i=0; i<DCTSIZE2; i++) {
+		workspace[i] = blk[i] * dequant[i];
+	}
+
+	ptr = workspace;
+	for (i=0; i<DCTSIZE; i++, ptr++) {
+		IDCT_1D(ptr, ptr, DCTSIZE)
+	}
+
+	/* Pass 2: process rows */
+	ptr = workspace;
+	for (i=0; i<DCTSIZE; i++, ptr+=DCTSIZE) {
+		IDCT_1D(ptr, ptr, 1)
+	}
+
+	/* Round and store */
+	for (i=0; i<DCTSIZE2; i++) {
+		blk[i] = IDCT_round(workspace[i]);
+	}
+}
+
+#endif /* !IDCT_X86_SSE || ENABLE_IDCT_C */
+
+void IDCT_dequant(BLOCK *blk, const float *dequant, int k)
+{
+	int i;
+
+	/* Only DC: all outputs are the same */
+	if (k==1) {
+		int val = IDCT_round(blk[0] * dequant[0]);
+
+		for (i=0; i<DCTSIZE2; i++) {
+			blk[i] = val;
+		}
+		return;
+	}
+
+#ifdef IDCT_X86_SSE
+	IDCT_sse2(blk, dequant);
+#else
+	IDCT_c(blk, dequant);
+#endif
+}
@@ -0,0 +1,45 @@
+/*
+	Floating point AAN IDCT, with dequantization
+
+	Copyright (C) 2017	Patrice Mandin
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef IDCTFLT_H
+#define IDCTFLT_H
+
+#include "idctfst.h"
+
+/*--- Functions ---*/
+
+/*
+	Multiply dequantization table (natural order) by AAN scale
+	factors and final 1/8 descaling, so IDCT_dequant() can use it.
+*/
+void IDCT_scaleDequant(float *dequant);
+
+/*
+	Dequantize and inverse DCT one block of quantized coefficients
+	(natural order), k is index of last coefficient in zigzag order+1.
+	Result is clamped to [-4096,4096], rounded to nearest, and is same
+	for SSE2 and C versions.
+	Error is at most 1 against an exact IDCT, and at most 7 against
+	integer dequantization and IDCT(), which truncates its results
+	(6 measured), see extra/idctbench.c
+*/
+void IDCT_dequant(BLOCK *blk, const float *dequant, int k);
+
+#endif /* IDCTFLT_H */
@@ -28,6 +28,8 @@
 #include "g_common/game.h"
 #include "g_common/menu.h"
 #include "g_common/room.h"
+#include "g_common/bgcache.h"
+#include "g_common/bgprefetch.h"
 
 #include "g_re1/game_re1.h"
 #include "g_re2/game_re2.h"
@@ -40,7 +42,11 @@
 #include "r_opengl/render.h"
 #include "r_soft/render.h"
 
+#include "benchmark.h"
+#include "diskcache.h"
 #include "clock.h"
+#include "depack_mdec.h"
+#include "depack_vlc.h"
 #include "parameters.h"
 #include "filesystem.h"
 #include "log.h"
@@ -126,6 +132,14 @@ int main(int argc, char **argv)
 #endif
 	}
 
+	if (params.viewmode != VIEWMODE_BACKGROUND) {
+		params.benchmark = 0;
+		params.populate = 0;
+	}
+	if (params.benchmark || params.populate) {
+		benchmark_setenv();
+	}
+
 	if (SDL_Init(SDL_INIT_VIDEO)<0) {
 		fprintf(stderr, "Can not initialize SDL: %s\n", SDL_GetError());
 		FS_Shutdown();
@@ -134,6 +148,11 @@ int main(int argc, char **argv)
 	atexit(SDL_Quit);
 	logEnableTicks();
 
+	/* Decoder tables and disk cache, before any thread uses them */
+	mdec_init();
+	vlc_init();
+	diskcache_init();
+
 	/* Try to load OpenGL library first */
 	if (params.use_opengl) {
 		params.use_opengl = video_opengl_loadlib();
@@ -190,6 +209,14 @@ int main(int argc, char **argv)
 
 	/* Viewer loop */
 	quit = 0;
+	if (params.benchmark) {
+		benchmark_run();
+		quit = 1;
+	}
+	if (params.populate) {
+		diskcache_populate(params.populate);
+		quit = 1;
+	}
 	while (!quit) {
 		quit = viewer_loop();
 		viewer_update();
@@ -207,11 +234,16 @@ int main(int argc, char **argv)
 			break;
 	}
 
+	bgprefetch_shutdown();
+	bgcache_shutdown();
+
 	video.shutDown();
 	render.shutdown();
 
 	game->dtor(game);
 
+	diskcache_shutdown();
+
 	logMsg(0,"fs: shutdown\n");
 	FS_Shutdown();
 
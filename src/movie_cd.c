@@ -0,0 +1,293 @@
+/*
+	Emulate raw CD sectors for PS1 movies
+
+	Movie files are stored as 2048 bytes data sectors, but STR demuxer
+	needs raw 2352 bytes sectors, with XA subheader telling if sector
+	is video or audio.
+
+	Copyright (C) 2007	Patrice Mandin
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*--- Includes ---*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+#include "log.h"
+#include "movie_cd.h"
+
+/*--- Defines ---*/
+
+#define CD_SYNC_SIZE 12
+#define CD_SEC_SIZE 4
+#define CD_XA_SIZE 8
+#define CD_DATA_SIZE 2048
+
+#define CD_HEADER_SIZE	(CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE)
+#define CD_EDC_SIZE	(RAW_CD_SECTOR_SIZE-CD_HEADER_SIZE-CD_DATA_SIZE)
+
+/* Data sectors read from file at once */
+#define CD_READ_SECTORS	16
+
+#define STR_MAGIC 0x60010180
+
+/*--- Variables ---*/
+
+/* Sync, sector header, XA subheader with submode for video or audio */
+
+static const Uint8 header_video[CD_HEADER_SIZE]={
+	0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00,
+	0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static const Uint8 header_audio[CD_HEADER_SIZE]={
+	0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00,
+	0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/*--- Functions prototypes ---*/
+
+static int fill_sectors(movie_cd_t *this, int sector);
+static void expand_sector(Uint8 *raw, const Uint8 *data);
+
+/*--- Functions ---*/
+
+int movie_cd_init(movie_cd_t *this, SDL_RWops *src)
+{
+	memset(this, 0, sizeof(movie_cd_t));
+
+	this->data = (Uint8 *) malloc(CD_READ_SECTORS * (CD_DATA_SIZE + RAW_CD_SECTOR_SIZE));
+	if (!this->data) {
+		fprintf(stderr, "cd: can not allocate memory for sectors\n");
+		return 0;
+	}
+	this->raw = &this->data[CD_READ_SECTORS * CD_DATA_SIZE];
+
+	this->src = src;
+	this->file_length = SDL_RWseek(src, 0, RW_SEEK_END);
+	SDL_RWseek(src, 0, RW_SEEK_SET);
+	this->file_sector = 0;
+
+	return 1;
+}
+
+void movie_cd_shutdown(movie_cd_t *this)
+{
+	if (this->data) {
+		free(this->data);
+	}
+	memset(this, 0, sizeof(movie_cd_t));
+}
+
+int movie_cd_read(movie_cd_t *this, Uint8 *buf, int buf_size)
+{
+	int size_read = 0;
+
+	logMsg(2, "cd: pos %d, read %d\n", (int) this->pos, buf_size);
+	if (this->pos<0) {
+		return -1;
+	}
+
+	while (size_read<buf_size) {
+		int sector = this->pos / RAW_CD_SECTOR_SIZE;
+		int offset, length;
+
+		if ((sector<this->first_sector) || (sector>=this->first_sector+this->num_sectors)) {
+			if (!fill_sectors(this, sector)) {
+				break;
+			}
+		}
+
+		/* Copy as much as possible from raw sectors */
+		offset = this->pos - this->first_sector * RAW_CD_SECTOR_SIZE;
+		length = this->num_sectors * RAW_CD_SECTOR_SIZE - offset;
+		if (length > buf_size-size_read) {
+			length = buf_size-size_read;
+		}
+
+		memcpy(&buf[size_read], &this->raw[offset], length);
+		size_read += length;
+		this->pos += length;
+	}
+
+	logMsg(2, "cd: after read: pos %d, read %d\n", (int) this->pos, size_read);
+	return (size_read>0 ? size_read : -1);
+}
+
+Sint64 movie_cd_seek(movie_cd_t *this, Sint64 offset, int whence)
+{
+	logMsg(2, "cd: seek %d, %d\n", (int) offset, whence);
+
+	switch(whence) {
+		case RW_SEEK_SET:
+			this->pos = offset;
+			break;
+		case RW_SEEK_CUR:
+			this->pos += offset;
+			break;
+		case RW_SEEK_END:
+			this->pos = movie_cd_length(this) + offset;
+			break;
+	}
+
+	/* File is read from matching data sector on next read */
+	return this->pos;
+}
+
+Sint64 movie_cd_length(movie_cd_t *this)
+{
+	Sint64 num_sectors = (this->file_length + CD_DATA_SIZE-1) / CD_DATA_SIZE;
+
+	return num_sectors * RAW_CD_SECTOR_SIZE;
+}
+
+/* Read data sectors in one go, and expand them to raw sectors */
+static int fill_sectors(movie_cd_t *this, int sector)
+{
+	Sint64 file_offset = (Sint64) sector * CD_DATA_SIZE;
+	int i, length;
+
+	if (file_offset >= this->file_length) {
+		return 0;
+	}
+
+	if (this->file_sector != sector) {
+		if (SDL_RWseek(this->src, file_offset, RW_SEEK_SET) != file_offset) {
+			this->file_sector = -1;
+			return 0;
+		}
+	}
+
+	length = SDL_RWread(this->src, this->data, 1, CD_READ_SECTORS * CD_DATA_SIZE);
+	if (length<=0) {
+		this->file_sector = -1;
+		return 0;
+	}
+
+	/* Pad last sector */
+	this->num_sectors = (length + CD_DATA_SIZE-1) / CD_DATA_SIZE;
+	if (length % CD_DATA_SIZE) {
+		memset(&this->data[length], 0, this->num_sectors * CD_DATA_SIZE - length);
+	}
+
+	for (i=0; i<this->num_sectors; i++) {
+		expand_sector(&this->raw[i * RAW_CD_SECTOR_SIZE], &this->data[i * CD_DATA_SIZE]);
+	}
+
+	this->first_sector = sector;
+	this->file_sector = sector + this->num_sectors;
+
+	logMsg(3, "cd: read sectors %d to %d\n", sector, this->file_sector-1);
+	return 1;
+}
+
+static void expand_sector(Uint8 *raw, const Uint8 *data)
+{
+	Uint32 magic = (data[0]<<24)|(data[1]<<16)|(data[2]<<8)|data[3];
+
+	memcpy(raw, (magic == STR_MAGIC) ? header_video : header_audio, CD_HEADER_SIZE);
+	memcpy(&raw[CD_HEADER_SIZE], data, CD_DATA_SIZE);
+	memset(&raw[CD_HEADER_SIZE+CD_DATA_SIZE], 0, CD_EDC_SIZE);
+}
+
+#ifdef ENABLE_CD_REFERENCE
+
+/*--- Previous version, generating sectors byte per byte ---*/
+
+int movie_cd_read_ref(movie_cd_t *this, Uint8 *buf, int buf_size)
+{
+	int size_read = 0;
+	int emul_cd_pos = (int) this->pos;
+	void *opaque = this->src;
+
+	{
+		logMsg(2, "cd: pos %d, read %d\n", emul_cd_pos, buf_size);
+		if (emul_cd_pos<0)
+			return -1;
+
+		while (buf_size>0) {
+			int sector_pos = emul_cd_pos % RAW_CD_SECTOR_SIZE;
+			int max_size;
+			int pos_data_type = -1; /* need to set data type */
+			int is_video = 0;
+
+			logMsg(2,"cd:  generate sector %d, pos %d, remains %d\n",
+				emul_cd_pos / RAW_CD_SECTOR_SIZE, sector_pos,
+				buf_size);
+			while ((sector_pos<CD_SYNC_SIZE) && (buf_size>0)) {
+				buf[size_read++] = ((sector_pos==0) || (sector_pos==11)) ? 0 : 0xff;
+				buf_size--;
+				sector_pos++;
+				emul_cd_pos++;
+			}
+			while ((sector_pos<CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE) && (buf_size>0)) {
+				if (sector_pos == 0x12) {
+					pos_data_type = size_read;
+				}
+				buf[size_read++] = 0;
+				buf_size--;
+				sector_pos++;
+				emul_cd_pos++;
+			}
+			while ((sector_pos<CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE+CD_DATA_SIZE) && (buf_size>0)) {
+				max_size = CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE+CD_DATA_SIZE-sector_pos;
+				max_size = (max_size>buf_size) ? buf_size : max_size;
+				logMsg(3, "cd: reading real data at 0x%08x in file, %d\n", SDL_RWtell((SDL_RWops *)opaque), max_size);
+				if (SDL_RWread((SDL_RWops *)opaque, &buf[size_read], max_size, 1)<1) {
+					return -1;
+				}
+				if ((sector_pos == CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE) && (max_size>=4)) {
+					/* Read first bytes */
+					Uint32 magic = *((Uint32 *) &buf[size_read]);
+					is_video = (SDL_SwapBE32(magic) == STR_MAGIC);
+				}
+				buf_size -= max_size;
+				size_read += max_size;
+				sector_pos += max_size;
+				emul_cd_pos += max_size;
+			}
+			while ((sector_pos<RAW_CD_SECTOR_SIZE) && (buf_size>0)) {
+				buf[size_read++] = 0;
+				buf_size--;
+				sector_pos++;
+				emul_cd_pos++;
+			}
+
+			/* set data type */
+			if (pos_data_type>=0) {
+				if (is_video) {
+					logMsg(3, "cd: generate video\n");
+					buf[pos_data_type] = 0x08;
+				} else {
+					logMsg(3, "cd: generate audio\n");
+					buf[pos_data_type] = 0x04;
+				}
+			}
+		}
+	}
+
+	this->pos = emul_cd_pos;
+
+	logMsg(2, "cd: after read: pos %d, read %d\n", emul_cd_pos, size_read);
+	return size_read;
+}
+
+#endif /* ENABLE_CD_REFERENCE */
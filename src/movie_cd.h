@@ -0,0 +1,62 @@
+/*
+	Emulate raw CD sectors for PS1 movies
+
+	Copyright (C) 2007	Patrice Mandin
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef MOVIE_CD_H
+#define MOVIE_CD_H 1
+
+/*--- Defines ---*/
+
+#define RAW_CD_SECTOR_SIZE	2352
+#define DATA_CD_SECTOR_SIZE	2048
+
+/*--- Types ---*/
+
+typedef struct {
+	SDL_RWops *src;		/* File of 2048 bytes sectors */
+	Sint64 pos;		/* Position in raw sectors */
+	Sint64 file_length;
+
+	Uint8 *data;		/* Data sectors read from file */
+	Uint8 *raw;		/* Same sectors, as raw sectors */
+	int first_sector, num_sectors;	/* Sectors in raw buffer */
+	int file_sector;	/* Sector at current file position */
+} movie_cd_t;
+
+/*--- Functions prototypes ---*/
+
+/* Return 0 if not enough memory */
+int movie_cd_init(movie_cd_t *this, SDL_RWops *src);
+void movie_cd_shutdown(movie_cd_t *this);
+
+/* Read raw sectors, return bytes read or -1 */
+int movie_cd_read(movie_cd_t *this, Uint8 *buf, int buf_size);
+
+/* Seek in raw sectors, return new position */
+Sint64 movie_cd_seek(movie_cd_t *this, Sint64 offset, int whence);
+
+/* Length of raw sectors */
+Sint64 movie_cd_length(movie_cd_t *this);
+
+#ifdef ENABLE_CD_REFERENCE
+/* Previous version, generating sectors byte per byte */
+int movie_cd_read_ref(movie_cd_t *this, Uint8 *buf, int buf_size);
+#endif
+
+#endif /* MOVIE_CD_H */
@@ -43,6 +43,13 @@
 #define DEFAULT_STAGE 1
 #define DEFAULT_ROOM 0
 #define DEFAULT_CAMERA 0
+#define DEFAULT_THREADS 1
+#define DEFAULT_MDEC_THREADS 1
+#define DEFAULT_BGCACHE 32
+#define DEFAULT_PREFETCH_ROOMS 4
+#define DEFAULT_BENCHMARK_FRAMES 16
+#define DEFAULT_POPULATE_THREADS 4
+#define DEFAULT_MOVIE_FRAMES 8
 
 #ifdef HAVE_DESIGNATED_INITIALIZERS
 # define SFINIT(f, v) f = v
@@ -68,9 +75,19 @@ params_t params = {
 	SFINIT(.height, 0),
 	SFINIT(.bpp, 0),
 	SFINIT(.fps, 0),
+	SFINIT(.threads, DEFAULT_THREADS),
+	SFINIT(.mdec_threads, DEFAULT_MDEC_THREADS),
+	SFINIT(.bgcache, DEFAULT_BGCACHE),
+	SFINIT(.prefetch, 1),
+	SFINIT(.prefetch_rooms, DEFAULT_PREFETCH_ROOMS),
+	SFINIT(.diskcache, NULL),
+	SFINIT(.populate, 0),
+	SFINIT(.movie_frames, DEFAULT_MOVIE_FRAMES),
 	SFINIT(.stage, DEFAULT_STAGE),
 	SFINIT(.room, DEFAULT_ROOM),
-	SFINIT(.camera, DEFAULT_CAMERA)
+	SFINIT(.camera, DEFAULT_CAMERA),
+	SFINIT(.benchmark, 0),
+	SFINIT(.benchmark_csv, NULL)
 };
 
 /*---- Variables ---*/
@@ -122,6 +139,14 @@ int CheckParm(int argc,char **argv)
 		params.viewmode = VIEWMODE_MOVIE;
 	}
 
+	p = ParmPresent("-movieframes", argc, argv);
+	if (p && p < argc-1) {
+		params.movie_frames = atoi(argv[p+1]);
+		if (params.movie_frames<1) {
+			params.movie_frames = 1;
+		}
+	}
+
 	/*--- Check for OpenGL ---*/
 	p = ParmPresent("-opengl", argc, argv);
 	if (p) {
@@ -185,6 +210,60 @@ int CheckParm(int argc,char **argv)
 		params.fps = 1;
 	}
 
+	/*--- Check for software renderer threads ---*/
+	p = ParmPresent("-threads", argc, argv);
+	if (p && p < argc-1) {
+		params.threads = atoi(argv[p+1]);
+		if (params.threads<1) {
+			params.threads = 1;
+		}
+	}
+
+	/*--- Check for MDEC decoding threads ---*/
+	p = ParmPresent("-mdecthreads", argc, argv);
+	if (p && p < argc-1) {
+		params.mdec_threads = atoi(argv[p+1]);
+		if (params.mdec_threads<1) {
+			params.mdec_threads = 1;
+		}
+	}
+
+	/*--- Check for background cache size ---*/
+	p = ParmPresent("-bgcache", argc, argv);
+	if (p && p < argc-1) {
+		params.bgcache = atoi(argv[p+1]);
+		if (params.bgcache<0) {
+			params.bgcache = 0;
+		}
+	}
+
+	p = ParmPresent("-noprefetch", argc, argv);
+	if (p) {
+		params.prefetch = 0;
+	}
+
+	p = ParmPresent("-prefetchrooms", argc, argv);
+	if (p && p < argc-1) {
+		params.prefetch_rooms = atoi(argv[p+1]);
+		if (params.prefetch_rooms<0) {
+			params.prefetch_rooms = 0;
+		}
+	}
+
+	/*--- Check for disk cache ---*/
+	p = ParmPresent("-diskcache", argc, argv);
+	if (p && p < argc-1) {
+		params.diskcache = argv[p+1];
+	}
+
+	p = ParmPresent("-populate", argc, argv);
+	if (p) {
+		params.populate = DEFAULT_POPULATE_THREADS;
+		if ((p < argc-1) && (atoi(argv[p+1])>0)) {
+			params.populate = atoi(argv[p+1]);
+		}
+	}
+
 	/*--- Check for stage/room/camera ---*/
 	p = ParmPresent("-stage", argc, argv);
 	if (p && p < argc-1) {
@@ -201,6 +280,20 @@ int CheckParm(int argc,char **argv)
 		params.camera = atoi(argv[p+1]);
 	}
 
+	/*--- Check for benchmark mode ---*/
+	p = ParmPresent("-benchmark", argc, argv);
+	if (p) {
+		params.benchmark = DEFAULT_BENCHMARK_FRAMES;
+		if ((p < argc-1) && (atoi(argv[p+1])>0)) {
+			params.benchmark = atoi(argv[p+1]);
+		}
+	}
+
+	p = ParmPresent("-benchcsv", argc, argv);
+	if (p && p < argc-1) {
+		params.benchmark_csv = argv[p+1];
+	}
+
 	return 1;
 }
 
@@ -211,6 +304,7 @@ void DisplayUsage(void)
 	printf("Usage:\n");
 	printf("  [-basedir </path/to/gamedir>] (default=%s)\n", DEFAULT_BASEDIR);
 	printf("  [-movie] (switch to movie player mode)\n");
+	printf("  [-movieframes <n>] (movie frames decoded in advance, default=%d)\n", DEFAULT_MOVIE_FRAMES);
 	printf("  [-verbose <n>] (log verbosity, default=%d)\n", DEFAULT_VERBOSE);
 	printf("  [-logfile <filename>] (default=%s.log)\n", PACKAGE_NAME);
 	printf("  [-opengl] (enable opengl mode)\n");
@@ -221,9 +315,18 @@ void DisplayUsage(void)
 	printf("  [-height <h>] (height of video mode, default=%d)\n", DEFAULT_HEIGHT);
 	printf("  [-bpp <b>] (bits per pixel for video mode, default=%d)\n", DEFAULT_BPP);
 	printf("  [-fps] (enable fps display)\n");
+	printf("  [-threads <n>] (threads for software renderer, default=%d)\n", DEFAULT_THREADS);
+	printf("  [-mdecthreads <n>] (threads for MDEC background decoding, default=%d)\n", DEFAULT_MDEC_THREADS);
+	printf("  [-bgcache <MB>] (memory for cached backgrounds, 0 to disable, default=%d)\n", DEFAULT_BGCACHE);
+	printf("  [-noprefetch] (disable loading next cameras and rooms in a thread)\n");
+	printf("  [-prefetchrooms <n>] (rooms behind doors to load in advance, default=%d)\n", DEFAULT_PREFETCH_ROOMS);
+	printf("  [-diskcache <dir>] (store decoded backgrounds in directory)\n");
+	printf("  [-populate [<n>]] (decode all backgrounds in disk cache with n threads, then quit, default=%d)\n", DEFAULT_POPULATE_THREADS);
 	printf("  [-stage <n>] (stage, default=%d)\n", DEFAULT_STAGE);
 	printf("  [-room <n>] (room, default=%d)\n", DEFAULT_ROOM);
 	printf("  [-camera <n>] (camera, default=%d)\n", DEFAULT_CAMERA);
+	printf("  [-benchmark [<n>]] (render n frames for each camera of each room, then quit, default=%d)\n", DEFAULT_BENCHMARK_FRAMES);
+	printf("  [-benchcsv <filename>] (write benchmark results to csv file)\n");
 #ifdef ENABLE_SCRIPT_DISASM
 	printf("  [-dumpscript] (enable script dump when loading room)\n");
 #endif
@@ -44,9 +44,19 @@ typedef struct {
 	int height;
 	int bpp;
 	int fps;		/* Display frames per second */
+	int threads;		/* Threads for software renderer */
+	int mdec_threads;	/* Threads for MDEC decoding */
+	int bgcache;		/* Background cache size in MB */
+	int prefetch;		/* Prefetch backgrounds of next cameras */
+	int prefetch_rooms;	/* Rooms behind doors to load in advance */
+	const char *diskcache;	/* Directory of decoded backgrounds cache */
+	int populate;		/* Threads to fill disk cache, then quit */
+	int movie_frames;	/* Movie frames decoded in advance */
 	int stage;
 	int room;
 	int camera;
+	int benchmark;		/* Frames to render per camera in benchmark mode */
+	const char *benchmark_csv;	/* Benchmark results file */
 } params_t;
 
 /*--- Variables ---*/
@@ -67,6 +67,7 @@ static void set_dithering(int enable);
 static void set_depth(int enable);
 static void set_useDirtyRects(int enable);
 static void set_pers_corr(int perscorr);
+static void set_threads(int num_threads);
 
 static void sortBackToFront(int num_vtx, int *num_idx, vertex_t *vtx);
 
@@ -118,11 +119,13 @@ void render_init(render_t *this)
 	this->set_depth = set_depth;
 	this->set_useDirtyRects = set_useDirtyRects;
 	this->set_pers_corr = set_pers_corr;
+	this->set_threads = set_threads;
 
 	this->depth_test = 1;
 
 	this->sortBackToFront = sortBackToFront;
 
+	list_render_texture_init();
 	render_bitmap_init(&this->bitmap);
 
 	this->tex_pal = -1;
@@ -245,6 +248,10 @@ static void set_pers_corr(int perscorr)
 {
 }
 
+static void set_threads(int num_threads)
+{
+}
+
 static void set_render(int num_render)
 {
 }
@@ -107,6 +107,7 @@ struct render_s {
 	void (*set_depth)(int enable);
 	void (*set_useDirtyRects)(int enable);
 	void (*set_pers_corr)(int perscorr);
+	void (*set_threads)(int num_threads);
 
 	int render_mode;
 	int dithering;
@@ -132,6 +133,10 @@ struct render_s {
 	render_texture_t *texture;
 	int tex_pal;	/* Palette to use */
 
+	/* Statistics of mesh drawing */
+	Uint32 num_draw_calls;		/* Draw calls sent to video card */
+	Uint32 num_vertex_uploads;	/* Vertices sent to video card */
+
 	/* Display depth buffer */
 	int render_depth;
 	void (*setRenderDepth)(int show_depth);
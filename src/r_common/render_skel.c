@@ -24,6 +24,7 @@
 #include <SDL.h>
 
 #include "../log.h"
+#include "../filesystem.h"
 
 #include "render.h"
 #include "render_mesh.h"
@@ -117,7 +118,7 @@ static void shutdown(render_skel_t *this)
 	}
 
 	if (this->emd_file) {
-		free(this->emd_file);
+		FS_Unmap(this->emd_file);
 	}
 
 	logMsg(3, "render_skel: skel 0x%p destroyed\n", this);
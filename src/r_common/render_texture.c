@@ -55,6 +55,7 @@ static void load_from_tim(render_texture_t *this, void *tim_ptr);
 static void read_rgba(Uint16 color, int *r, int *g, int *b, int *a);
 
 static void load_from_surf(render_texture_t *this, SDL_Surface *surf);
+static int prepare_rgb(render_texture_t *this, int w, int h);
 
 /* Keep texture in surface format */
 static void copy_tex_palette(render_texture_t *this, SDL_Surface *surf);
@@ -87,6 +88,7 @@ render_texture_t *render_texture_create(int flags)
 	tex->resize = resize;
 	tex->load_from_tim = load_from_tim;
 	tex->load_from_surf = load_from_surf;
+	tex->prepare_rgb = prepare_rgb;
 /*	tex->mark_trans = mark_trans;*/
 
 	tex->must_pot = flags & RENDER_TEXTURE_MUST_POT;
@@ -496,6 +498,86 @@ static void load_from_surf(render_texture_t *this, SDL_Surface *surf)
 	this->download(this);
 }
 
+/*
+	Same format as convert_surf_to_tex() would give for a 24 bits surface.
+	Cacheable textures stay in 24 bits RGB only when rescaling with
+	-linear, or dithering, needs full precision pixels
+*/
+
+static int prepare_rgb(render_texture_t *this, int w, int h)
+{
+	SDL_PixelFormat *fmt = NULL;
+	int i, dithering;
+
+	if (!this) {
+		return 0;
+	}
+
+	if (video.screen && !params.use_opengl) {
+		fmt = video.screen->format;
+	}
+
+	this->num_palettes = this->paletted = 0;
+
+	dithering = ((video.bpp==8) && render.dithering);
+	if (fmt && (params.linear || dithering)) {
+		if (this->cacheable) {
+			fmt = NULL;
+		} else if (dithering) {
+			/* Error diffusion needs the whole image */
+			return 0;
+		}
+	}
+
+	if (!fmt) {
+		logMsg(2, "texture: direct write to 24bits RGB\n");
+
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+		this->format.Rmask = 255;
+		this->format.Gmask = 255<<8;
+		this->format.Bmask = 255<<16;
+#else
+		this->format.Rmask = 255<<16;
+		this->format.Gmask = 255<<8;
+		this->format.Bmask = 255;
+#endif
+		this->format.Amask = 0;
+		this->format.BitsPerPixel = 24;
+		this->format.BytesPerPixel = this->bpp = 3;
+	} else if (video.bpp==8) {
+		logMsg(2, "texture: direct write to 8bits dither palette\n");
+
+		memcpy(&(this->format), fmt, sizeof(SDL_PixelFormat));
+		this->format.BitsPerPixel = 8;
+		this->format.BytesPerPixel = this->bpp = 1;
+
+		this->num_palettes = this->paletted = 1;
+		for (i=0; i<256; i++) {
+			Uint8 r,g,b;
+
+			dither_getrgb(i, &r,&g,&b);
+
+			this->palettes[0][i] = SDL_MapRGBA(fmt, r,g,b,0xff);
+			this->alpha_palettes[0][i] = 0xff;
+		}
+	} else {
+		logMsg(2, "texture: direct write to video format\n");
+
+		memcpy(&(this->format), fmt, sizeof(SDL_PixelFormat));
+		if (this->format.BytesPerPixel == 3) {
+			/* Convert textures to 32bits, for 24bits video mode */
+			this->format.BytesPerPixel = 4;
+			this->format.BitsPerPixel = 32;
+		}
+		this->bpp = this->format.BytesPerPixel;
+	}
+	this->format.palette = NULL;
+
+	this->resize(this, w,h);
+
+	return (this->pixels && (this->w == w) && (this->h == h));
+}
+
 /* Copy surface data to texture in original format */
 
 static void copy_tex_palette(render_texture_t *this, SDL_Surface *surf)
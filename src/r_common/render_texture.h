@@ -52,6 +52,10 @@ struct render_texture_s {
 	void (*load_from_tim)(render_texture_t *this, void *tim_ptr);
 	void (*load_from_surf)(render_texture_t *this, SDL_Surface *surf);
 
+	/* Set format and size to write w*h RGB pixels directly in texture,
+	   call download() when done. Return 0 if load_from_surf() needed */
+	int (*prepare_rgb)(render_texture_t *this, int w, int h);
+
 	/* Mark a zone transparent for a specific palette */
 	/*void (*mark_trans)(render_texture_t *this, int num_pal, int x1,int y1, int x2,int y2);*/
 
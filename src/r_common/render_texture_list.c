@@ -31,9 +31,30 @@
 static render_texture_t **render_texture_list = NULL;
 static int render_texture_list_size = 0;
 
+/* Textures may be created and freed by background prefetch thread */
+static SDL_mutex *render_texture_list_mutex = NULL;
+
+/*--- Functions prototypes ---*/
+
+static void list_add(render_texture_t *texture);
+
 /*--- Functions ---*/
 
+void list_render_texture_init(void)
+{
+	if (!render_texture_list_mutex) {
+		render_texture_list_mutex = SDL_CreateMutex();
+	}
+}
+
 void list_render_texture_add(render_texture_t *texture)
+{
+	SDL_LockMutex(render_texture_list_mutex);
+	list_add(texture);
+	SDL_UnlockMutex(render_texture_list_mutex);
+}
+
+static void list_add(render_texture_t *texture)
 {
 	int i;
 	render_texture_t **new_list;
@@ -72,28 +93,44 @@ void list_render_texture_remove(render_texture_t *texture)
 {
 	int i;
 
-	if (!render_texture_list) {
-		return;
-	}
-
+	SDL_LockMutex(render_texture_list_mutex);
 	for (i=0; i<render_texture_list_size; i++) {
 		if (render_texture_list[i] == texture) {
 			logMsg(2, "render_texture_list: remove texture 0x%p at position %d\n", texture, i);
 
 			render_texture_list[i] = NULL;
-			return;
+			break;
 		}
 	}
+	SDL_UnlockMutex(render_texture_list_mutex);
 }
 
-void list_render_texture_download(void)
+render_texture_t *list_render_texture_realloc(render_texture_t *texture, int size)
 {
+	render_texture_t *new_texture;
 	int i;
 
-	if (!render_texture_list) {
-		return;
+	/* Other threads must not see old pointer once freed */
+	SDL_LockMutex(render_texture_list_mutex);
+	new_texture = (render_texture_t *) realloc(texture, size);
+	if (new_texture) {
+		for (i=0; i<render_texture_list_size; i++) {
+			if (render_texture_list[i] == texture) {
+				render_texture_list[i] = new_texture;
+				break;
+			}
+		}
 	}
+	SDL_UnlockMutex(render_texture_list_mutex);
+
+	return new_texture;
+}
+
+void list_render_texture_download(void)
+{
+	int i;
 
+	SDL_LockMutex(render_texture_list_mutex);
 	for (i=0; i<render_texture_list_size; i++) {
 		render_texture_t *texture = render_texture_list[i];
 		if (texture) {
@@ -102,6 +139,7 @@ void list_render_texture_download(void)
 			texture->download(texture);
 		}
 	}
+	SDL_UnlockMutex(render_texture_list_mutex);
 }
 
 void list_render_texture_shutdown(void)
@@ -110,4 +148,8 @@ void list_render_texture_shutdown(void)
 		free(render_texture_list);
 		render_texture_list = NULL;
 	}
+	if (render_texture_list_mutex) {
+		SDL_DestroyMutex(render_texture_list_mutex);
+		render_texture_list_mutex = NULL;
+	}
 }
@@ -27,12 +27,18 @@ struct render_texture_s;
 
 /*--- Functions prototypes ---*/
 
+/* Init list of textures, before any thread creates one */
+void list_render_texture_init(void);
+
 /* Add a texture to the list */
 void list_render_texture_add(struct render_texture_s *texture);
 
 /* Remove texture from list */
 void list_render_texture_remove(struct render_texture_s *texture);
 
+/* Reallocate texture to size bytes, keeping its place in the list */
+struct render_texture_s *list_render_texture_realloc(struct render_texture_s *texture, int size);
+
 /* Download all textures for video hardware */
 void list_render_texture_download(void);
 
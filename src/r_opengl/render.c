@@ -516,6 +516,7 @@ static void quad_fill(vertex_t *v1, vertex_t *v2, vertex_t *v3, vertex_t *v4)
 static void set_texture(int num_pal, render_texture_t *render_tex)
 {
 	render_texture_gl_t *gl_tex;
+	GLint filter;
 
 	render.tex_pal = num_pal;
 	render.texture = render_tex;
@@ -527,8 +528,10 @@ static void set_texture(int num_pal, render_texture_t *render_tex)
 
 	render_tex->upload(render_tex, num_pal);
 
- 	gl.TexParameteri(gl_tex->textureTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
- 	gl.TexParameteri(gl_tex->textureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	/* Colour indexes can not be interpolated */
+	filter = (gl_tex->palette_lookup ? GL_NEAREST : GL_LINEAR);
+ 	gl.TexParameteri(gl_tex->textureTarget, GL_TEXTURE_MAG_FILTER, filter);
+ 	gl.TexParameteri(gl_tex->textureTarget, GL_TEXTURE_MIN_FILTER, filter);
  	gl.TexParameteri(gl_tex->textureTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
  	gl.TexParameteri(gl_tex->textureTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
@@ -549,7 +552,7 @@ static void triangle_tex(vertex_t *v1, vertex_t *v2, vertex_t *v3)
 	gl.LoadIdentity();
 	gl.MatrixMode(GL_MODELVIEW);
 
-	gl.Enable(gl_tex->textureTarget);
+	render_texture_gl_enable(texture);
 
 	gl.Begin(GL_TRIANGLES);
 	if (gl_tex->textureTarget == GL_TEXTURE_2D) {
@@ -569,7 +572,7 @@ static void triangle_tex(vertex_t *v1, vertex_t *v2, vertex_t *v3)
 	}
 	gl.End();
 
-	gl.Disable(gl_tex->textureTarget);
+	render_texture_gl_disable(texture);
 }
 
 static void quad_tex(vertex_t *v1, vertex_t *v2, vertex_t *v3, vertex_t *v4)
@@ -586,7 +589,7 @@ static void quad_tex(vertex_t *v1, vertex_t *v2, vertex_t *v3, vertex_t *v4)
 	gl.LoadIdentity();
 	gl.MatrixMode(GL_MODELVIEW);
 
-	gl.Enable(gl_tex->textureTarget);
+	render_texture_gl_enable(texture);
 
 	gl.Begin(GL_QUADS);
 	if (gl_tex->textureTarget == GL_TEXTURE_2D) {
@@ -610,7 +613,7 @@ static void quad_tex(vertex_t *v1, vertex_t *v2, vertex_t *v3, vertex_t *v4)
 	}
 	gl.End();
 
-	gl.Disable(gl_tex->textureTarget);
+	render_texture_gl_disable(texture);
 }
 
 static void copyDepthToColor(void)
@@ -117,7 +117,7 @@ static void drawImage(void)
 	render.bitmap.dstRect.x -= video.viewport.x;
 	render.bitmap.dstRect.y -= video.viewport.y;
 
-	gl.Enable(gl_tex->textureTarget);
+	render_texture_gl_enable(tex);
 	if (render.bitmap.depth_test) {
 		gl.Enable(GL_DEPTH_TEST);
 /*
@@ -184,7 +184,7 @@ f/(f-n) * 1-n/z
 		gl.Vertex2f(0.0f, 1.0f);
 	gl.End();
 
-	gl.Disable(gl_tex->textureTarget);
+	render_texture_gl_disable(tex);
 	gl.Enable(GL_DEPTH_TEST);
 	gl.ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 }
@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <SDL.h>
 #include <SDL_opengl.h>
 
@@ -43,6 +44,11 @@
 /*--- Defines ---*/
 
 #define INVALID_LIST 0xffffffffUL
+#define INVALID_BUFFER 0xffffffffUL
+
+/* Offset of field in buffer */
+#define BUFFER_OFFSET(field) \
+	((GLvoid *) &(((render_mesh_gl_vertex_t *) NULL)->field))
 
 /*--- Functions prototypes ---*/
 
@@ -51,6 +57,15 @@ static void download(render_mesh_t *this);
 
 static void draw(render_mesh_t *this);
 
+static Uint32 get_color_from_texture(render_texture_t *texture, int num_pal, int u, int v);
+static void set_color_from_texture(render_texture_t *texture, int num_pal, int u, int v);
+
+static void upload_list(render_mesh_t *this);
+static int upload_buffers(render_mesh_t *this);
+static void set_buffer_vertex(render_mesh_t *this, render_mesh_gl_vertex_t *vtx,
+	int num_v, int num_tx, Uint32 color);
+static void draw_buffers(render_mesh_t *this);
+
 /*--- Functions ---*/
 
 render_mesh_t *render_mesh_gl_create(render_texture_t *texture)
@@ -77,18 +92,21 @@ render_mesh_t *render_mesh_gl_create(render_texture_t *texture)
 	mesh->draw = draw;
 
 	gl_mesh->num_list = INVALID_LIST;
+	gl_mesh->list_draws = 0;
+	gl_mesh->vbo_id = gl_mesh->ibo_id = INVALID_BUFFER;
+	gl_mesh->num_groups = 0;
 
 	logMsg(2, "render_mesh_gl: created\n");
 
 	return mesh;
 }
 
-static void set_color_from_texture(render_texture_t *texture, int num_pal, int u, int v)
+static Uint32 get_color_from_texture(render_texture_t *texture, int num_pal, int u, int v)
 {
 	Uint32 color = 0xffffffff;
 
 	if (!texture) {
-		return;
+		return color;
 	}
 
 	if (texture->paletted) {
@@ -108,11 +126,36 @@ static void set_color_from_texture(render_texture_t *texture, int num_pal, int u
 		color = (r<<16)|(g<<8)|b;
 	}
 
+	return color;
+}
+
+static void set_color_from_texture(render_texture_t *texture, int num_pal, int u, int v)
+{
+	Uint32 color;
+
+	if (!texture) {
+		return;
+	}
+
+	color = get_color_from_texture(texture, num_pal, u, v);
+
 	gl.Color4ub((color>>16) & 0xff, (color>>8) & 0xff,
 		color & 0xff, (color>>24) & 0xff);
 }
 
 static void upload(render_mesh_t *this)
+{
+	/* Wireframe needs quads outline, without diagonal */
+	if (video.has_gl_arb_vertex_buffer_object && (render.render_mode != RENDER_WIREFRAME)) {
+		if (upload_buffers(this)) {
+			return;
+		}
+	}
+
+	upload_list(this);
+}
+
+static void upload_list(render_mesh_t *this)
 {
 	render_mesh_gl_t *gl_mesh = (render_mesh_gl_t *) this;
 	int i, j, prevpal=0;
@@ -123,6 +166,7 @@ static void upload(render_mesh_t *this)
 	logMsg(2, "render_mesh_gl: creating new list\n");
 
 	gl_mesh->num_list = gl.GenLists(1);
+	gl_mesh->list_draws = 0;
 
 	/*gl.EnableClientState(GL_VERTEX_ARRAY);
 	gl.VertexPointer(3, GL_SHORT, 0, this->vertex.data);
@@ -145,6 +189,7 @@ static void upload(render_mesh_t *this)
 
 	if (this->num_tris>0) {
 		gl.Begin(GL_TRIANGLES);
+		++gl_mesh->list_draws;
 
 		for (i=0; i<this->num_tris; i++) {
 			render_mesh_tri_t *tri = &(this->triangles[i]);
@@ -161,6 +206,7 @@ static void upload(render_mesh_t *this)
 						render.set_texture(tri->txpal, this->texture);
 						prevpal = tri->txpal;
 						gl.Begin(GL_TRIANGLES);
+						++gl_mesh->list_draws;
 					}
 					break;
 			}
@@ -183,6 +229,7 @@ static void upload(render_mesh_t *this)
 
 	if (this->num_quads>0) {
 		gl.Begin(GL_QUADS);
+		++gl_mesh->list_draws;
 
 		for (i=0; i<this->num_quads; i++) {
 			render_mesh_quad_t *quad = &(this->quads[i]);
@@ -199,6 +246,7 @@ static void upload(render_mesh_t *this)
 						render.set_texture(quad->txpal, this->texture);
 						prevpal = quad->txpal;
 						gl.Begin(GL_QUADS);
+						++gl_mesh->list_draws;
 					}
 					break;
 			}
@@ -224,12 +272,23 @@ static void upload(render_mesh_t *this)
 	}
 
 	gl.EndList();
+
+	render.num_vertex_uploads += this->num_tris*3 + this->num_quads*4;
 }
 
 static void download(render_mesh_t *this)
 {
 	render_mesh_gl_t *gl_mesh = (render_mesh_gl_t *) this;
 
+	if (gl_mesh->vbo_id != INVALID_BUFFER) {
+		logMsg(2, "render_mesh_gl: destroying buffers\n");
+
+		gl.DeleteBuffersARB(1, &gl_mesh->vbo_id);
+		gl.DeleteBuffersARB(1, &gl_mesh->ibo_id);
+		gl_mesh->vbo_id = gl_mesh->ibo_id = INVALID_BUFFER;
+		gl_mesh->num_groups = 0;
+	}
+
 	if (gl_mesh->num_list == INVALID_LIST) {
 		return;
 	}
@@ -248,11 +307,200 @@ static void draw(render_mesh_t *this)
 		return;
 	}
 
-	if (gl_mesh->num_list == INVALID_LIST) {
+	if ((gl_mesh->num_list == INVALID_LIST) && (gl_mesh->vbo_id == INVALID_BUFFER)) {
 		this->upload(this);
 	}
 
+	if (gl_mesh->vbo_id != INVALID_BUFFER) {
+		draw_buffers(this);
+		return;
+	}
+
 	gl.CallList(gl_mesh->num_list);
+	render.num_draw_calls += gl_mesh->list_draws;
+}
+
+/*
+	Vertex and index buffers: vertices of each triangle/quad are uploaded
+	once, quads split in 2 triangles. Triangles are sorted by palette, to
+	draw them with a single call per palette.
+*/
+
+static int upload_buffers(render_mesh_t *this)
+{
+	render_mesh_gl_t *gl_mesh = (render_mesh_gl_t *) this;
+	render_mesh_gl_vertex_t *vertices;
+	Uint16 *indexes;
+	int num_vertices = this->num_tris*3 + this->num_quads*4;
+	int num_indexes = this->num_tris*3 + this->num_quads*6;
+	int first[MAX_TEX_PALETTE], count[MAX_TEX_PALETTE];
+	int i, j, num_vtx = 0;
+	Sint16 *srcTx = (Sint16 *) this->texcoord.data;
+
+	/* Indexes must fit in 16 bits */
+	if ((num_vertices == 0) || (num_vertices > 65536)) {
+		return 0;
+	}
+
+	vertices = (render_mesh_gl_vertex_t *) malloc(num_vertices * sizeof(render_mesh_gl_vertex_t));
+	indexes = (Uint16 *) malloc(num_indexes * sizeof(Uint16));
+	if (!vertices || !indexes) {
+		fprintf(stderr, "Can not allocate memory for mesh buffers\n");
+		free(vertices);
+		free(indexes);
+		return 0;
+	}
+
+	/* Count indexes per palette */
+	memset(count, 0, sizeof(count));
+	for (i=0; i<this->num_tris; i++) {
+		count[this->triangles[i].txpal % MAX_TEX_PALETTE] += 3;
+	}
+	for (i=0; i<this->num_quads; i++) {
+		count[this->quads[i].txpal % MAX_TEX_PALETTE] += 6;
+	}
+
+	gl_mesh->num_groups = 0;
+	for (i=j=0; i<MAX_TEX_PALETTE; i++) {
+		first[i] = j;
+		j += count[i];
+
+		if (count[i]>0) {
+			render_mesh_gl_group_t *group = &gl_mesh->groups[gl_mesh->num_groups++];
+
+			group->num_pal = i;
+			group->first = first[i];
+			group->count = count[i];
+		}
+	}
+
+	/* Vertices, with colour for flat or gouraud shading */
+	for (i=0; i<this->num_tris; i++) {
+		render_mesh_tri_t *tri = &(this->triangles[i]);
+		Sint16 *srcTxi = &srcTx[tri->tx[0]*(this->texcoord.stride>>1)];
+		Uint16 *dstIdx = &indexes[first[tri->txpal % MAX_TEX_PALETTE]];
+		Uint32 color = get_color_from_texture(this->texture, tri->txpal, srcTxi[0], srcTxi[1]);
+
+		for (j=0; j<3; j++) {
+			if (render.render_mode == RENDER_GOURAUD) {
+				srcTxi = &srcTx[tri->tx[j]*(this->texcoord.stride>>1)];
+				color = get_color_from_texture(this->texture, tri->txpal, srcTxi[0], srcTxi[1]);
+			}
+			set_buffer_vertex(this, &vertices[num_vtx+j], tri->v[j], tri->tx[j], color);
+			*dstIdx++ = num_vtx+j;
+		}
+
+		first[tri->txpal % MAX_TEX_PALETTE] += 3;
+		num_vtx += 3;
+	}
+
+	for (i=0; i<this->num_quads; i++) {
+		render_mesh_quad_t *quad = &(this->quads[i]);
+		Sint16 *srcTxi = &srcTx[quad->tx[0]*(this->texcoord.stride>>1)];
+		Uint16 *dstIdx = &indexes[first[quad->txpal % MAX_TEX_PALETTE]];
+		Uint32 color = get_color_from_texture(this->texture, quad->txpal, srcTxi[0], srcTxi[1]);
+
+		for (j=0; j<4; j++) {
+			if (render.render_mode == RENDER_GOURAUD) {
+				srcTxi = &srcTx[quad->tx[j]*(this->texcoord.stride>>1)];
+				color = get_color_from_texture(this->texture, quad->txpal, srcTxi[0], srcTxi[1]);
+			}
+			set_buffer_vertex(this, &vertices[num_vtx+j], quad->v[j], quad->tx[j], color);
+		}
+
+		/* Quad 0,1,3,2 split along 0-3 diagonal, like GL_QUADS */
+		*dstIdx++ = num_vtx;
+		*dstIdx++ = num_vtx+1;
+		*dstIdx++ = num_vtx+3;
+		*dstIdx++ = num_vtx;
+		*dstIdx++ = num_vtx+3;
+		*dstIdx++ = num_vtx+2;
+
+		first[quad->txpal % MAX_TEX_PALETTE] += 6;
+		num_vtx += 4;
+	}
+
+	logMsg(2, "render_mesh_gl: creating buffers, %d vertices, %d palettes\n",
+		num_vertices, gl_mesh->num_groups);
+
+	gl.GenBuffersARB(1, &gl_mesh->vbo_id);
+	gl.BindBufferARB(GL_ARRAY_BUFFER_ARB, gl_mesh->vbo_id);
+	gl.BufferDataARB(GL_ARRAY_BUFFER_ARB, num_vertices * sizeof(render_mesh_gl_vertex_t),
+		vertices, GL_STATIC_DRAW_ARB);
+	gl.BindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+
+	gl.GenBuffersARB(1, &gl_mesh->ibo_id);
+	gl.BindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, gl_mesh->ibo_id);
+	gl.BufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, num_indexes * sizeof(Uint16),
+		indexes, GL_STATIC_DRAW_ARB);
+	gl.BindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+
+	render.num_vertex_uploads += num_vertices;
+
+	free(vertices);
+	free(indexes);
+	return 1;
+}
+
+static void set_buffer_vertex(render_mesh_t *this, render_mesh_gl_vertex_t *vtx,
+	int num_v, int num_tx, Uint32 color)
+{
+	Sint16 *srcVtx = &((Sint16 *) this->vertex.data)[num_v*(this->vertex.stride>>1)];
+	Sint16 *srcTx = &((Sint16 *) this->texcoord.data)[num_tx*(this->texcoord.stride>>1)];
+
+	vtx->x = srcVtx[0];
+	vtx->y = srcVtx[1];
+	vtx->z = srcVtx[2];
+	vtx->pad = 0;
+	vtx->u = srcTx[0];
+	vtx->v = srcTx[1];
+	vtx->r = (color>>16) & 0xff;
+	vtx->g = (color>>8) & 0xff;
+	vtx->b = color & 0xff;
+	vtx->a = (color>>24) & 0xff;
+}
+
+static void draw_buffers(render_mesh_t *this)
+{
+	render_mesh_gl_t *gl_mesh = (render_mesh_gl_t *) this;
+	int i;
+
+	gl.BindBufferARB(GL_ARRAY_BUFFER_ARB, gl_mesh->vbo_id);
+	gl.BindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, gl_mesh->ibo_id);
+
+	gl.EnableClientState(GL_VERTEX_ARRAY);
+	gl.VertexPointer(3, GL_SHORT, sizeof(render_mesh_gl_vertex_t), BUFFER_OFFSET(x));
+
+	if (render.render_mode == RENDER_TEXTURED) {
+		gl.EnableClientState(GL_TEXTURE_COORD_ARRAY);
+		gl.TexCoordPointer(2, GL_SHORT, sizeof(render_mesh_gl_vertex_t), BUFFER_OFFSET(u));
+
+		for (i=0; i<gl_mesh->num_groups; i++) {
+			render_mesh_gl_group_t *group = &gl_mesh->groups[i];
+
+			render.set_texture(group->num_pal, this->texture);
+			gl.DrawElements(GL_TRIANGLES, group->count, GL_UNSIGNED_SHORT,
+				(GLvoid *) (group->first * sizeof(Uint16)));
+			++render.num_draw_calls;
+		}
+
+		gl.DisableClientState(GL_TEXTURE_COORD_ARRAY);
+	} else {
+		gl.EnableClientState(GL_COLOR_ARRAY);
+		gl.ColorPointer(4, GL_UNSIGNED_BYTE, sizeof(render_mesh_gl_vertex_t), BUFFER_OFFSET(r));
+
+		/* Palettes only used for colours, already in vertices */
+		gl.DrawElements(GL_TRIANGLES, this->num_tris*3 + this->num_quads*6,
+			GL_UNSIGNED_SHORT, (GLvoid *) 0);
+		++render.num_draw_calls;
+
+		gl.DisableClientState(GL_COLOR_ARRAY);
+	}
+
+	gl.DisableClientState(GL_VERTEX_ARRAY);
+
+	gl.BindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+	gl.BindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
 }
 
 #endif /* ENABLE_OPENGL */
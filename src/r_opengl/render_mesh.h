@@ -29,12 +29,30 @@ struct render_mesh_s;
 
 /*--- Types ---*/
 
+typedef struct {
+	Sint16 x,y,z, pad;
+	Sint16 u,v;
+	Uint8 r,g,b,a;
+} render_mesh_gl_vertex_t;
+
+typedef struct {
+	int num_pal;
+	int first, count;	/* Indexes of triangles using this palette */
+} render_mesh_gl_group_t;
+
 typedef struct render_mesh_gl_s render_mesh_gl_t;
 
 struct render_mesh_gl_s {
 	struct render_mesh_s render_mesh;
 
+	/* Display list, when no vertex buffer */
 	GLuint	num_list;
+	int	list_draws;
+
+	/* Vertex and index buffers, triangles sorted by palette */
+	GLuint	vbo_id, ibo_id;
+	int	num_groups;
+	render_mesh_gl_group_t groups[MAX_TEX_PALETTE];
 };
 
 /*--- Functions prototypes ---*/
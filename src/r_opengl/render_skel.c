@@ -109,7 +109,9 @@ static void draw(render_skel_t *this, int num_parent)
 
 					gl.MatrixMode(GL_MODELVIEW);
 
-					gl.Enable(gl_tex->textureTarget);
+					/* Create texture objects, to enable matching texturing */
+					this->texture->upload(this->texture, 0);
+					render_texture_gl_enable(this->texture);
 				}
 				break;
 		}
@@ -123,11 +125,7 @@ static void draw(render_skel_t *this, int num_parent)
 				gl.PolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 				break;
 			case RENDER_TEXTURED:
-				{
-					render_texture_gl_t *gl_tex = (render_texture_gl_t *) this->texture;
-
-					gl.Disable(gl_tex->textureTarget);
-				}
+				render_texture_gl_disable(this->texture);
 				break;
 		}
 	}
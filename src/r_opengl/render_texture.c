@@ -41,6 +41,30 @@
 #include "dyngl.h"
 #include "render_texture.h"
 
+/*--- Defines ---*/
+
+#define LOOKUP_2D	0
+#define LOOKUP_RECT	1
+
+/*--- Variables ---*/
+
+/* Read colour index, then its colour in line of palette
+   palette.x,y: scale and offset of index to middle of palette texel
+   palette.z: middle of palette line */
+
+static const char *lookup_program_source =
+	"!!ARBfp1.0\n"
+	"PARAM palette = program.local[0];\n"
+	"TEMP index;\n"
+	"TEX index, fragment.texcoord[0], texture[0], %s;\n"
+	"MAD index.x, index.x, palette.x, palette.y;\n"
+	"MOV index.y, palette.z;\n"
+	"TEX result.color, index, texture[1], 2D;\n"
+	"END\n";
+
+static GLuint lookup_program[2] = {0, 0};
+static int num_lookup_textures = 0;
+
 /*--- Functions prototypes ---*/
 
 static void upload(render_texture_t *this, int num_pal);
@@ -48,6 +72,11 @@ static void update_init(render_texture_t *this, int num_pal);
 static void update(render_texture_t *this, int num_pal);
 static void download(render_texture_t *this);
 
+static GLuint get_lookup_program(GLenum textureTarget);
+static int init_palette_lookup(render_texture_t *this);
+static void update_palette_lookup(render_texture_t *this);
+static void bind_palette_lookup(render_texture_t *this, int num_pal);
+
 static void prepare_resize(render_texture_t *this, int *w, int *h);
 
 /*static void mark_trans(render_texture_t *this, int num_pal, int x1,int y1, int x2,int y2);*/
@@ -65,14 +94,13 @@ render_texture_t *render_texture_gl_create(int flags)
 		return NULL;
 	}
 
-	gl_tex = realloc(tex, sizeof(render_texture_gl_t));
+	gl_tex = (render_texture_gl_t *) list_render_texture_realloc(tex, sizeof(render_texture_gl_t));
 	if (!gl_tex) {
 		fprintf(stderr, "Can not allocate memory for render_texture\n");
+		tex->shutdown(tex);
 		return NULL;
 	}
 
-	list_render_texture_remove(tex);
-
 	tex = (render_texture_t *) gl_tex;
 
 	tex->upload = upload;
@@ -87,8 +115,8 @@ render_texture_t *render_texture_gl_create(int flags)
 	for (i=0; i<MAX_TEX_PALETTE; i++) {
 		gl_tex->texture_id[i] = 0xffffffffUL;
 	}
-
-	list_render_texture_add((render_texture_t *) gl_tex);
+	gl_tex->palette_lookup = 0;
+	gl_tex->palette_id = 0xffffffffUL;
 
 	return tex;
 }
@@ -98,12 +126,23 @@ static void upload(render_texture_t *this, int num_pal)
 	render_texture_gl_t *texgl = (render_texture_gl_t *) this;
 	int i = this->paletted ? num_pal : 0;
 
+	/* Same texture for all palettes */
+	if (texgl->palette_lookup) {
+		bind_palette_lookup(this, num_pal);
+		return;
+	}
+
 	/* Already uploaded ? */
 	if (texgl->texture_id[i] != 0xFFFFFFFFUL) {
 		gl.BindTexture(texgl->textureTarget, texgl->texture_id[i]);
 		return;
 	}
 
+	if (init_palette_lookup(this)) {
+		bind_palette_lookup(this, num_pal);
+		return;
+	}
+
 	/* Create new texture object, and upload texture */
 	gl.GenTextures(1, &texgl->texture_id[i]);
 
@@ -205,6 +244,12 @@ static void update(render_texture_t *this, int num_pal)
 	texgl = (render_texture_gl_t *) this;
 	i = this->paletted ? num_pal : 0;
 
+	if (texgl->palette_lookup) {
+		update_palette_lookup(this);
+		bind_palette_lookup(this, num_pal);
+		return;
+	}
+
 	assert(texgl->texture_id[i] != 0xFFFFFFFFUL);
 
 	/* Create new texture object, and upload texture */
@@ -293,6 +338,183 @@ static void download(render_texture_t *this)
 			texgl->texture_id[i] = 0xFFFFFFFFUL;
 		}
 	}	
+
+	if (texgl->palette_id != 0xFFFFFFFFUL) {
+		gl.DeleteTextures(1, &texgl->palette_id);
+		texgl->palette_id = 0xFFFFFFFFUL;
+	}
+
+	if (texgl->palette_lookup) {
+		texgl->palette_lookup = 0;
+
+		/* Programs go with last texture, before any change of OpenGL context */
+		if (--num_lookup_textures == 0) {
+			for (i=0; i<2; i++) {
+				if (lookup_program[i]) {
+					gl.DeleteProgramsARB(1, &lookup_program[i]);
+					lookup_program[i] = 0;
+				}
+			}
+		}
+	}
+}
+
+void render_texture_gl_enable(render_texture_t *this)
+{
+	render_texture_gl_t *texgl = (render_texture_gl_t *) this;
+
+	if (texgl->palette_lookup) {
+		gl.Enable(GL_FRAGMENT_PROGRAM_ARB);
+		return;
+	}
+
+	gl.Enable(texgl->textureTarget);
+}
+
+void render_texture_gl_disable(render_texture_t *this)
+{
+	render_texture_gl_t *texgl = (render_texture_gl_t *) this;
+
+	if (texgl->palette_lookup) {
+		gl.Disable(GL_FRAGMENT_PROGRAM_ARB);
+		return;
+	}
+
+	gl.Disable(texgl->textureTarget);
+}
+
+/*
+	Paletted textures using fragment program: indexes are uploaded once,
+	all palettes in a 256xMAX_TEX_PALETTE texture, so changing palette
+	only changes a program parameter
+*/
+
+static GLuint get_lookup_program(GLenum textureTarget)
+{
+	int num_prog = (textureTarget == GL_TEXTURE_2D ? LOOKUP_2D : LOOKUP_RECT);
+	char source[512];
+	GLint error_pos;
+
+	if (lookup_program[num_prog]) {
+		return lookup_program[num_prog];
+	}
+
+	sprintf(source, lookup_program_source, (num_prog == LOOKUP_2D ? "2D" : "RECT"));
+
+	gl.GenProgramsARB(1, &lookup_program[num_prog]);
+	gl.BindProgramARB(GL_FRAGMENT_PROGRAM_ARB, lookup_program[num_prog]);
+	gl.ProgramStringARB(GL_FRAGMENT_PROGRAM_ARB, GL_PROGRAM_FORMAT_ASCII_ARB,
+		strlen(source), source);
+
+	gl.GetIntegerv(GL_PROGRAM_ERROR_POSITION_ARB, &error_pos);
+	if (error_pos != -1) {
+		fprintf(stderr, "texture: can not compile palette program: %s\n",
+			gl.GetString(GL_PROGRAM_ERROR_STRING_ARB));
+		gl.DeleteProgramsARB(1, &lookup_program[num_prog]);
+		lookup_program[num_prog] = 0;
+	}
+
+	return lookup_program[num_prog];
+}
+
+static int init_palette_lookup(render_texture_t *this)
+{
+	render_texture_gl_t *texgl = (render_texture_gl_t *) this;
+
+	if (!video.has_gl_arb_fragment_program || !this->paletted || (this->bpp != 1)) {
+		return 0;
+	}
+#if defined(GL_EXT_paletted_texture)
+	if (video.has_gl_ext_paletted_texture && (texgl->textureTarget==GL_TEXTURE_2D)) {
+		return 0;
+	}
+#endif
+	if (!get_lookup_program(texgl->textureTarget)) {
+		return 0;
+	}
+
+	logMsg(2, "texture: palette lookup, %d palettes\n", this->num_palettes);
+
+	texgl->palette_lookup = 1;
+	++num_lookup_textures;
+
+	/* Indexes */
+	gl.GenTextures(1, &texgl->texture_id[0]);
+	gl.BindTexture(texgl->textureTarget, texgl->texture_id[0]);
+
+	gl.TexParameteri(texgl->textureTarget, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	gl.TexParameteri(texgl->textureTarget, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+	gl.TexImage2D(texgl->textureTarget,0, GL_LUMINANCE8,
+		this->pitchw, this->pitchh, 0,
+		GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL
+	);
+
+	/* Palettes */
+	gl.GenTextures(1, &texgl->palette_id);
+	gl.BindTexture(GL_TEXTURE_2D, texgl->palette_id);
+
+	gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	gl.TexImage2D(GL_TEXTURE_2D,0, GL_RGBA,
+		256, MAX_TEX_PALETTE, 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, NULL
+	);
+
+	update_palette_lookup(this);
+	return 1;
+}
+
+static void update_palette_lookup(render_texture_t *this)
+{
+	render_texture_gl_t *texgl = (render_texture_gl_t *) this;
+	Uint8 mapP[MAX_TEX_PALETTE*256*4];
+	Uint8 *pMap = mapP;
+	int i, j;
+
+	gl.BindTexture(texgl->textureTarget, texgl->texture_id[0]);
+	gl.PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	gl.TexSubImage2D(texgl->textureTarget,0,
+		0,0,this->pitchw, this->pitchh,
+		GL_LUMINANCE, GL_UNSIGNED_BYTE, this->pixels
+	);
+	gl.PixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	memset(mapP, 0, sizeof(mapP));
+	for (j=0; j<this->num_palettes; j++) {
+		for (i=0; i<256; i++) {
+			Uint32 color = this->palettes[j][i];
+
+			*pMap++ = (color>>16) & 0xff;
+			*pMap++ = (color>>8) & 0xff;
+			*pMap++ = color & 0xff;
+			*pMap++ = (color>>24) & 0xff;
+		}
+	}
+
+	gl.BindTexture(GL_TEXTURE_2D, texgl->palette_id);
+	gl.TexSubImage2D(GL_TEXTURE_2D,0,
+		0,0,256, MAX_TEX_PALETTE,
+		GL_RGBA, GL_UNSIGNED_BYTE, mapP
+	);
+}
+
+static void bind_palette_lookup(render_texture_t *this, int num_pal)
+{
+	render_texture_gl_t *texgl = (render_texture_gl_t *) this;
+
+	gl.ActiveTextureARB(GL_TEXTURE1_ARB);
+	gl.BindTexture(GL_TEXTURE_2D, texgl->palette_id);
+	gl.ActiveTextureARB(GL_TEXTURE0_ARB);
+	gl.BindTexture(texgl->textureTarget, texgl->texture_id[0]);
+
+	gl.BindProgramARB(GL_FRAGMENT_PROGRAM_ARB, get_lookup_program(texgl->textureTarget));
+	gl.ProgramLocalParameter4fARB(GL_FRAGMENT_PROGRAM_ARB, 0,
+		255.0f / 256.0f, 0.5f / 256.0f,
+		(num_pal + 0.5f) / MAX_TEX_PALETTE, 0.0f);
 }
 
 static void prepare_resize(render_texture_t *this, int *w, int *h)
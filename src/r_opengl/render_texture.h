@@ -35,6 +35,11 @@ struct render_texture_gl_s {
 
 	GLenum textureTarget;
 	GLuint texture_id[MAX_TEX_PALETTE];
+
+	/* Paletted texture: indexes in texture_id[0], colour of each
+	   palette in a line of palette_id, read by fragment program */
+	int palette_lookup;
+	GLuint palette_id;
 };
 
 /*--- Functions prototypes ---*/
@@ -42,4 +47,8 @@ struct render_texture_gl_s {
 /* Create a texture */
 struct render_texture_s *render_texture_gl_create(int flags);
 
+/* Enable/disable texturing, using uploaded texture */
+void render_texture_gl_enable(struct render_texture_s *this);
+void render_texture_gl_disable(struct render_texture_s *this);
+
 #endif /* RENDER_TEXTURE_OPENGL_H */
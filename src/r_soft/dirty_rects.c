@@ -35,6 +35,13 @@ dirty_rects_t *upload_rects[2];
 static void resize(dirty_rects_t *this, int w, int h);
 static void setDirty(dirty_rects_t *this, int x, int y, int w, int h);
 static void clear(dirty_rects_t *this);
+static int getRects(dirty_rects_t *this, SDL_Rect *rects);
+
+static int first_bit(Uint32 value);
+static int find_bit(Uint32 *row, int num_words, int x, Uint32 invert);
+static void set_bits(Uint32 *row, int x1, int x2);
+static void clear_bits(Uint32 *row, int x1, int x2);
+static int test_bits(Uint32 *row, int x1, int x2);
 
 /*--- Functions ---*/
 
@@ -48,6 +55,7 @@ dirty_rects_t *dirty_rects_create(int w, int h)
 	this->resize = resize;
 	this->setDirty = setDirty;
 	this->clear = clear;
+	this->getRects = getRects;
 
 	this->resize(this, w,h);
 	return this;
@@ -63,6 +71,10 @@ void dirty_rects_destroy(dirty_rects_t *this)
 		free(this->markers);
 		this->markers = NULL;
 	}
+	if (this->scan) {
+		free(this->scan);
+		this->scan = NULL;
+	}
 
 	free(this);
 }
@@ -87,9 +99,12 @@ static void resize(dirty_rects_t *this, int w, int h)
 
 	this->width = w;
 	this->height = h;
+	this->pitch = (w+31)>>5;
 
-	this->markers = (Uint8 *) realloc(this->markers, w*h*sizeof(Uint8));
+	this->markers = (Uint32 *) realloc(this->markers, this->pitch*h*sizeof(Uint32));
+	this->scan = (Uint32 *) realloc(this->scan, this->pitch*h*sizeof(Uint32));
 
+	clear(this);
 	setDirty(this, 0,0,w<<4,h<<4);
 }
 
@@ -120,10 +135,12 @@ static void setDirty(dirty_rects_t *this, int x, int y, int w, int h)
 	x2 = MIN(this->width, MAX(x2,0));
 	y2 = MIN(this->height, MAX(y2,0));
 
+	if (x1>=x2) {
+		return;
+	}
+
 	for (y=y1; y<y2; y++) {
-		for(x=x1; x<x2; x++) {
-			this->markers[y*this->width+x]=1;
-		}
+		set_bits(&this->markers[y*this->pitch], x1,x2);
 	}
 }
 
@@ -131,7 +148,131 @@ static void clear(dirty_rects_t *this)
 {
 	if (this) {
 		if (this->markers) {
-			memset(this->markers, 0, this->width*this->height*sizeof(Uint8));
+			memset(this->markers, 0, this->pitch*this->height*sizeof(Uint32));
+		}
+	}
+}
+
+/*
+	Each horizontal run of dirty blocks is extended downwards as long
+	as the rows below are dirty on the same columns. Blocks already
+	merged are removed from a copy of the markers.
+*/
+
+static int getRects(dirty_rects_t *this, SDL_Rect *rects)
+{
+	int x1, x2, y1, y2, num_rects = 0;
+
+	if (!this) {
+		return 0;
+	}
+	if (!this->markers || !this->scan) {
+		return 0;
+	}
+
+	memcpy(this->scan, this->markers, this->pitch*this->height*sizeof(Uint32));
+
+	for (y1=0; y1<this->height; y1++) {
+		Uint32 *row = &this->scan[y1*this->pitch];
+
+		x1 = find_bit(row, this->pitch, 0, 0);
+		while (x1 < this->width) {
+			x2 = MIN(this->width, find_bit(row, this->pitch, x1, 0xffffffffUL));
+
+			for (y2=y1+1; y2<this->height; y2++) {
+				Uint32 *next_row = &this->scan[y2*this->pitch];
+
+				if (!test_bits(next_row, x1,x2)) {
+					break;
+				}
+				clear_bits(next_row, x1,x2);
+			}
+
+			rects[num_rects].x = x1;
+			rects[num_rects].y = y1;
+			rects[num_rects].w = x2-x1;
+			rects[num_rects].h = y2-y1;
+			num_rects++;
+
+			x1 = find_bit(row, this->pitch, x2, 0);
+		}
+	}
+
+	return num_rects;
+}
+
+/* Position of lowest set bit, value must not be 0 */
+static int first_bit(Uint32 value)
+{
+#if defined(__GNUC__)
+	return __builtin_ctz(value);
+#else
+	int n = 0;
+
+	while ((value & 1)==0) {
+		value >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+/* Find first set (or cleared if invert is all ones) bit from x, num_words*32 if none */
+static int find_bit(Uint32 *row, int num_words, int x, Uint32 invert)
+{
+	int i = x>>5;
+	Uint32 bits;
+
+	if (i >= num_words) {
+		return num_words<<5;
+	}
+
+	bits = (row[i] ^ invert) & (0xffffffffUL << (x & 31));
+	while (bits == 0) {
+		if (++i >= num_words) {
+			return num_words<<5;
 		}
+		bits = row[i] ^ invert;
 	}
+
+	return (i<<5) + first_bit(bits);
+}
+
+/* Mask of bits x1 to x2-1 in word i */
+#define RANGE_MASK(i, x1, x2) \
+	((((i)<<5) > (x1) ? 0xffffffffUL : 0xffffffffUL << ((x1) & 31)) \
+	& ((((i)+1)<<5) <= (x2) ? 0xffffffffUL : ~(0xffffffffUL << ((x2) & 31))))
+
+static void set_bits(Uint32 *row, int x1, int x2)
+{
+	int i;
+
+	for (i=x1>>5; i<=(x2-1)>>5; i++) {
+		row[i] |= RANGE_MASK(i, x1, x2);
+	}
+}
+
+static void clear_bits(Uint32 *row, int x1, int x2)
+{
+	int i;
+
+	for (i=x1>>5; i<=(x2-1)>>5; i++) {
+		row[i] &= ~RANGE_MASK(i, x1, x2);
+	}
+}
+
+/* Check if bits x1 to x2-1 are all set */
+static int test_bits(Uint32 *row, int x1, int x2)
+{
+	int i;
+
+	for (i=x1>>5; i<=(x2-1)>>5; i++) {
+		Uint32 mask = RANGE_MASK(i, x1, x2);
+
+		if ((row[i] & mask) != mask) {
+			return 0;
+		}
+	}
+
+	return 1;
 }
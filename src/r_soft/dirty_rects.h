@@ -21,17 +21,28 @@
 #ifndef DIRTY_RECTS
 #define DIRTY_RECTS 1
 
+/*--- Defines ---*/
+
+/* Check if 16x16 block x,y is dirty */
+#define DIRTY_RECTS_ISDIRTY(this, x, y) \
+	((this)->markers[(y)*(this)->pitch + ((x)>>5)] & (1U<<((x) & 31)))
+
 /*--- Types ---*/
 
 typedef struct dirty_rects_s dirty_rects_t;
 
 struct dirty_rects_s {
 	int width, height;	/* Dimensions in 16x16 blocks */
-	Uint8 *markers;
+	int pitch;		/* Number of 32 bits words per row */
+	Uint32 *markers;	/* One bit per block */
+	Uint32 *scan;		/* Markers being merged by getRects */
 
 	void (*resize)(dirty_rects_t *this, int w, int h);
 	void (*setDirty)(dirty_rects_t *this, int x, int y, int w, int h);
 	void (*clear)(dirty_rects_t *this);
+
+	/* Merge dirty blocks in rectangles (in blocks), return number of rectangles */
+	int (*getRects)(dirty_rects_t *this, SDL_Rect *rects);
 };
 
 /*--- Global variables ---*/
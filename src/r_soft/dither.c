@@ -75,6 +75,17 @@ int dither_nearest_index(int r, int g, int b)
 	return 16+FIND_COLOR_INDEX(r,g,b);
 }
 
+void dither_getrgb(int index, Uint8 *r, Uint8 *g, Uint8 *b)
+{
+	index -= 16;
+	if ((index<0) || (index>=216)) {
+		*r = *g = *b = 0;
+		return;
+	}
+
+	FIND_APPROX(index, *r,*g,*b);
+}
+
 void dither(SDL_Surface *src, SDL_Surface *dest)
 {
 	void *errbuffer;
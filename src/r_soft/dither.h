@@ -32,6 +32,9 @@ void dither_setpalette(SDL_Surface *src);
 /* Find nearest color in 216 color palette */
 int dither_nearest_index(int r, int g, int b);
 
+/* Get color of index in 216 color palette */
+void dither_getrgb(int index, Uint8 *r, Uint8 *g, Uint8 *b);
+
 /* Dither image */
 void dither(SDL_Surface *src, SDL_Surface *dest);
 
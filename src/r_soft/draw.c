@@ -48,6 +48,7 @@ static void resize(draw_t *this, int w, int h, int bpp);
 static void startFrame(draw_t *this);
 static void endFrame(draw_t *this);
 static void set_depth(draw_t *this, int enable);
+static void set_threads(draw_t *this, int num_threads);
 
 static void line(draw_t *this, draw_vertex_t *v1, draw_vertex_t *v2);
 static void triangle(draw_t *this, draw_vertex_t v[3]);
@@ -73,6 +74,7 @@ void draw_init(draw_t *this)
 	this->endFrame = endFrame;
 
 	this->set_depth = set_depth;
+	this->set_threads = set_threads;
 
 	this->line = line;
 	this->triangle = triangle;
@@ -108,6 +110,10 @@ static void set_depth(draw_t *this, int enable)
 {
 }
 
+static void set_threads(draw_t *this, int num_threads)
+{
+}
+
 static void line(draw_t *this, draw_vertex_t *v1, draw_vertex_t *v2)
 {
 }
@@ -44,6 +44,9 @@ struct draw_s {
 
 	void (*set_depth)(draw_t *this, int enable);
 
+	/* Number of threads for rasterization */
+	void (*set_threads)(draw_t *this, int num_threads);
+
 	/* Wireframe */
 	void (*line)(draw_t *this, draw_vertex_t *v1, draw_vertex_t *v2);
 	void (*triangle)(draw_t *this, draw_vertex_t v[3]);
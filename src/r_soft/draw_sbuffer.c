@@ -28,6 +28,7 @@
 
 #include "../video.h"
 #include "../parameters.h"
+#include "../log.h"
 
 #include "../r_common/render.h"
 #include "../r_common/r_misc.h"
@@ -53,8 +54,16 @@
 #define DEBUG_PRINT(what)
 #endif
 
-#define MAX_SEGMENTS 128
-#define MAX_SPANS 256
+/* Initial and max number of segments, spans for a row */
+#define INIT_SEGMENTS 8
+#define INIT_SPANS 16
+#define MAX_ROW_ITEMS 32767
+
+/* Max number of spans inserted while checking new segment against a span */
+#define MAX_SPANS_PER_PASS 4
+
+/* Minimal size of a block allocated for row storage */
+#define ARENA_BLOCK_SIZE (256<<10)
 
 #define SPAN_INVALID -1
 
@@ -63,6 +72,15 @@
 #define SEG1_CLIP_LEFT 2
 #define SEG1_CLIP_RIGHT 3
 
+#define MAX_SBUFFER_THREADS 16
+
+#define SBUFFER_CMD_POLY	0
+#define SBUFFER_CMD_POLYLINE	1
+#define SBUFFER_CMD_MASK	2
+
+/* Number of frames to average for timing report */
+#define FRAME_TIMING_COUNT 64
+
 /*--- Types ---*/
 
 typedef struct {
@@ -76,17 +94,64 @@ typedef struct {
 } sbuffer_span_t;
 
 typedef struct {
-	Uint16 num_segs;
-	Uint16 num_spans;
-	Uint8 seg_full;
-	Uint8 span_full;
+	Uint16 num_segs, size_segs;
+	Uint16 num_spans, size_spans;
+	Uint8 seg_full;		/* Could not grow segment list */
+	Uint8 span_full;	/* Could not grow span list */
 	Sint16 first_span;
-	sbuffer_segment_t segment[MAX_SEGMENTS];
-	sbuffer_span_t span[MAX_SPANS];
+	sbuffer_segment_t *segment;
+	sbuffer_span_t *span;
 } sbuffer_row_t;
 
+/* Memory block of an arena, data follows */
+typedef struct sbuffer_block_s sbuffer_block_t;
+
+struct sbuffer_block_s {
+	sbuffer_block_t *next;
+	size_t size;
+};
+
+/* Storage for rows content, emptied each frame */
+typedef struct {
+	sbuffer_block_t *first;
+	sbuffer_block_t *current;
+	size_t pos;		/* Position in current block */
+	size_t used;		/* Bytes allocated this frame */
+	int max_segs;		/* Max segments in a row */
+	int max_spans;		/* Max spans in a row */
+} sbuffer_arena_t;
+
 typedef void (*sbuffer_draw_f)(SDL_Surface *surf, Uint8 *dst_line, sbuffer_segment_t *segment, int x1,int x2);
 
+typedef int (*sbuffer_gen_f)(int y, const sbuffer_segment_t *segment);
+
+/* Deferred polygon, rasterized by the band(s) it covers */
+typedef struct {
+	Uint8 type;
+	Uint8 depth_test;
+	Uint16 num_vtx;
+	int first_vtx;	/* Index in cmd_vtx array */
+	int y;		/* Row for mask segment */
+	sbuffer_segment_t segment;
+} sbuffer_cmd_t;
+
+/* Horizontal band of rows, owned by a thread */
+typedef struct {
+	int y1, y2;		/* First, last row */
+	int num_cmds;
+	int size_cmds;
+	int *cmds;		/* Index in cmds array */
+	SDL_Thread *thread;
+	SDL_sem *start;
+} sbuffer_band_t;
+
+#ifdef SBUFFER_X86_SIMD
+/* C span renderer, and its SSE2 replacement */
+typedef struct {
+	sbuffer_draw_f c, sse2;
+} sbuffer_simd_span_t;
+#endif
+
 /*--- Variables ---*/
 
 /* for poly rendering */
@@ -101,21 +166,84 @@ static sbuffer_draw_f draw_render_fill;
 static sbuffer_draw_f draw_render_gouraud;
 static sbuffer_draw_f draw_render_textured;
 
-static int (*gen_seg_spans)(int y, const sbuffer_segment_t *segment);
+static int use_simd_spans = 0;
+
+#ifdef SBUFFER_X86_SIMD
+static const sbuffer_simd_span_t simd_span_list[]={
+	{draw_render_fill16, draw_render_fill16sse2},
+	{draw_render_gouraud16_pc0, draw_render_gouraud16_pc0sse2},
+	{draw_render_gouraud16_pc1, draw_render_gouraud16_pc1sse2},
+	{draw_render_gouraud16_pc3, draw_render_gouraud16_pc3sse2},
+	{draw_render_textured16_pc0trans, draw_render_textured16_pc0transsse2},
+	{draw_render_textured16_pc1trans, draw_render_textured16_pc1transsse2},
+	{draw_render_textured16_pc2trans, draw_render_textured16_pc2transsse2},
+	{draw_render_textured16_pc3trans, draw_render_textured16_pc3transsse2},
+
+	{draw_render_fill32, draw_render_fill32sse2},
+	{draw_render_gouraud32_pc0, draw_render_gouraud32_pc0sse2},
+	{draw_render_gouraud32_pc1, draw_render_gouraud32_pc1sse2},
+	{draw_render_gouraud32_pc3, draw_render_gouraud32_pc3sse2},
+	{draw_render_textured32_pc0trans, draw_render_textured32_pc0transsse2},
+	{draw_render_textured32_pc1trans, draw_render_textured32_pc1transsse2},
+	{draw_render_textured32_pc2trans, draw_render_textured32_pc2transsse2},
+	{draw_render_textured32_pc3trans, draw_render_textured32_pc3transsse2}
+};
+#endif
+
+static int depth_test = 1;
+static sbuffer_gen_f gen_seg_spans;
+
+/* Banded rendering */
+static int num_threads_req = 1;
+static int num_bands = 0;
+static sbuffer_band_t bands[MAX_SBUFFER_THREADS];
+static SDL_sem *bands_done = NULL;
+static sbuffer_arena_t arenas[MAX_SBUFFER_THREADS];	/* One per band */
+static SBUFFER_THREAD_LOCAL sbuffer_arena_t *cur_arena = &arenas[0];
+static volatile int bands_quit = 0;
+
+static int num_cmds = 0, size_cmds = 0;
+static sbuffer_cmd_t *cmds = NULL;
+static int num_cmd_vtx = 0, size_cmd_vtx = 0;
+static vertexf_t *cmd_vtx = NULL;
+
+/* Frame timing */
+static Uint32 frame_start, frame_ticks;
+static int frame_count;
+
+/* Peak usage of row storage */
+static size_t peak_arena_used = 0;
+static int peak_row_segs = 0, peak_row_spans = 0;
 
 /*--- Functions prototypes ---*/
 
 static void draw_shutdown(draw_t *this);
 
 static void clear_sbuffer(void);
+static void clear_rows(int first, int last);
+static void *arena_alloc(sbuffer_arena_t *arena, size_t size);
+static void arena_reset(sbuffer_arena_t *arena);
+static void arena_free(sbuffer_arena_t *arena);
+static void update_arena_stats(void);
+static int row_reserve(sbuffer_row_t *row, int num_segs, int num_spans);
 static void dump_sbuffer(void);
 static void flush_sbuffer(draw_t *this);
+static void flush_rows(SDL_Surface *surf, Uint8 *dst, int y1, int y2);
 static void set_depth(draw_t *this, int enable);
+static void set_threads(draw_t *this, int num_threads);
+
+static void start_bands(int num_threads);
+static void stop_bands(void);
+static int band_thread(void *data);
+static void render_band(sbuffer_band_t *band);
+static void queue_cmd(int type, const sbuffer_segment_t *segment,
+	vertexf_t *vtx, int num_vtx, int y, int miny, int maxy);
 
 static void draw_resize(draw_t *this, int w, int h, int bpp);
 static void draw_startFrame(draw_t *this);
 static void draw_endFrame(draw_t *this);
 
+static void add_base_segment(int y, const sbuffer_segment_t *segment);
 static int gen_seg_spans_ztest(int y, const sbuffer_segment_t *segment);
 static int gen_seg_spans_noztest(int y, const sbuffer_segment_t *segment);
 
@@ -123,6 +251,15 @@ static void draw_poly_sbuffer(draw_t *this, vertexf_t *vtx, int num_vtx);
 static void draw_poly_sbuffer_line(draw_t *this, vertexf_t *vtx, int num_vtx);
 static void draw_mask_segment(draw_t *this, int y, int x1, int x2, float w);
 
+static void raster_poly(const sbuffer_segment_t *state, sbuffer_gen_f gen,
+	vertexf_t *vtx, int num_vtx, int band_y1, int band_y2, SDL_Rect *bounds);
+static void raster_poly_line(const sbuffer_segment_t *state, sbuffer_gen_f gen,
+	vertexf_t *vtx, int num_vtx, int band_y1, int band_y2, SDL_Rect *bounds);
+static void mark_dirty(const SDL_Rect *bounds);
+
+static void detect_simd_spans(void);
+static sbuffer_draw_f select_simd_span(sbuffer_draw_f span);
+
 /*--- Functions ---*/
 
 void draw_init_sbuffer(draw_t *this)
@@ -135,6 +272,7 @@ void draw_init_sbuffer(draw_t *this)
 	this->startFrame = draw_startFrame;
 	this->endFrame = draw_endFrame;
 	this->set_depth = set_depth;
+	this->set_threads = set_threads;
 
 	this->polyLine = draw_poly_sbuffer_line;
 	this->polyFill = draw_poly_sbuffer;
@@ -146,13 +284,36 @@ void draw_init_sbuffer(draw_t *this)
 	draw_render_gouraud = draw_render_gouraud8_pc0;
 	draw_render_textured = draw_render_textured8_pc0trans;
 
+	depth_test = 1;
 	gen_seg_spans = gen_seg_spans_ztest;
 
+	detect_simd_spans();
+
+	set_threads(this, params.threads);
+
 	clear_sbuffer();
 }
 
 static void draw_shutdown(draw_t *this)
 {
+	stop_bands();
+
+	logMsg(1, "sbuffer: peak row storage %d KB, %d segments, %d spans per row\n",
+		(int) (peak_arena_used>>10), peak_row_segs, peak_row_spans);
+	arena_free(&arenas[0]);
+
+	if (cmds) {
+		free(cmds);
+		cmds = NULL;
+	}
+	num_cmds = size_cmds = 0;
+
+	if (cmd_vtx) {
+		free(cmd_vtx);
+		cmd_vtx = NULL;
+	}
+	num_cmd_vtx = size_cmd_vtx = 0;
+
 	if (sbuffer_rows) {
 		free(sbuffer_rows);
 		sbuffer_rows = NULL;
@@ -191,6 +352,28 @@ static void draw_resize(draw_t *this, int w, int h, int bpp)
 
 static void draw_startFrame(draw_t *this)
 {
+	int i;
+
+	frame_start = SDL_GetTicks();
+
+	/* Thread count changed ? */
+	if (num_threads_req != MAX(num_bands, 1)) {
+		logMsg(1, "sbuffer: %d thread(s)\n", num_threads_req);
+
+		stop_bands();
+		if (num_threads_req > 1) {
+			start_bands(num_threads_req);
+		}
+
+		frame_ticks = frame_count = 0;
+	}
+
+	/* Rows content from previous frame is not needed anymore */
+	for (i=0; i<MAX(num_bands, 1); i++) {
+		arena_reset(&arenas[i]);
+	}
+	cur_arena = &arenas[0];
+
 	switch(video.bpp) {
 		case 15:
 		case 16:
@@ -316,22 +499,277 @@ static void draw_startFrame(draw_t *this)
 			break;
 	}
 
-	clear_sbuffer();
+	draw_render_fill = select_simd_span(draw_render_fill);
+	draw_render_gouraud = select_simd_span(draw_render_gouraud);
+	draw_render_textured = select_simd_span(draw_render_textured);
+
+	if (num_bands > 1) {
+		/* Split viewport in bands, rows are cleared by their owner */
+		for (i=0; i<num_bands; i++) {
+			bands[i].y1 = (video.viewport.h * i) / num_bands;
+			bands[i].y2 = ((video.viewport.h * (i+1)) / num_bands) - 1;
+			bands[i].num_cmds = 0;
+		}
+		num_cmds = num_cmd_vtx = 0;
+	} else {
+		clear_sbuffer();
+	}
 }
 
 static void draw_endFrame(draw_t *this)
 {
 	/*dump_sbuffer();*/
 	flush_sbuffer(this);
+
+	update_arena_stats();
+
+	/* Report average frame time for current thread count */
+	frame_ticks += SDL_GetTicks() - frame_start;
+	if (++frame_count >= FRAME_TIMING_COUNT) {
+		logMsg(2, "sbuffer: %d thread(s), %.2f ms/frame\n",
+			MAX(num_bands, 1), (float) frame_ticks / frame_count);
+		logMsg(2, "sbuffer: peak row storage %d KB, %d segments, %d spans per row\n",
+			(int) (peak_arena_used>>10), peak_row_segs, peak_row_spans);
+		frame_ticks = frame_count = 0;
+	}
 }
 
 static void set_depth(draw_t *this, int enable)
 {
+	depth_test = enable;
 	gen_seg_spans = (enable ?
 		gen_seg_spans_ztest :
 		gen_seg_spans_noztest);
 }
 
+static void set_threads(draw_t *this, int num_threads)
+{
+#ifdef SBUFFER_NO_THREADS
+	num_threads = 1;
+#endif
+	num_threads_req = MAX(1, MIN(num_threads, MAX_SBUFFER_THREADS));
+}
+
+static void detect_simd_spans(void)
+{
+	use_simd_spans = 0;
+
+#ifdef SBUFFER_X86_SIMD
+	if (SDL_HasSSE2()) {
+		use_simd_spans = 1;
+		logMsg(1, "sbuffer: using SSE2 span renderers\n");
+	}
+#endif
+}
+
+/* Replace C span renderer by SIMD one, if any */
+static sbuffer_draw_f select_simd_span(sbuffer_draw_f span)
+{
+#ifdef SBUFFER_X86_SIMD
+	int i;
+
+	if (!use_simd_spans) {
+		return span;
+	}
+
+	for (i=0; i<sizeof(simd_span_list)/sizeof(sbuffer_simd_span_t); i++) {
+		if (simd_span_list[i].c == span) {
+			return simd_span_list[i].sse2;
+		}
+	}
+#endif
+
+	return span;
+}
+
+static void start_bands(int num_threads)
+{
+	int i;
+
+	bands_quit = 0;
+	bands_done = SDL_CreateSemaphore(0);
+	if (!bands_done) {
+		fprintf(stderr, "sbuffer: can not create semaphore: %s\n", SDL_GetError());
+		num_threads_req = 1;
+		return;
+	}
+
+	/* Band 0 is rendered by the calling thread */
+	memset(bands, 0, sizeof(bands));
+	for (i=1; i<num_threads; i++) {
+		bands[i].start = SDL_CreateSemaphore(0);
+		if (!bands[i].start) {
+			break;
+		}
+#if SDL_VERSION_ATLEAST(2,0,0)
+		bands[i].thread = SDL_CreateThread(band_thread, "sbuffer", &bands[i]);
+#else
+		bands[i].thread = SDL_CreateThread(band_thread, &bands[i]);
+#endif
+		if (!bands[i].thread) {
+			SDL_DestroySemaphore(bands[i].start);
+			bands[i].start = NULL;
+			break;
+		}
+	}
+
+	num_bands = i;
+	if (num_bands < num_threads) {
+		fprintf(stderr, "sbuffer: only %d thread(s) started: %s\n", num_bands, SDL_GetError());
+		num_threads_req = num_bands;
+	}
+}
+
+static void stop_bands(void)
+{
+	int i;
+
+	bands_quit = 1;
+	for (i=1; i<num_bands; i++) {
+		SDL_SemPost(bands[i].start);
+		SDL_WaitThread(bands[i].thread, NULL);
+		SDL_DestroySemaphore(bands[i].start);
+	}
+	for (i=0; i<num_bands; i++) {
+		if (bands[i].cmds) {
+			free(bands[i].cmds);
+		}
+		if (i>0) {
+			arena_free(&arenas[i]);
+		}
+	}
+	memset(bands, 0, sizeof(bands));
+	num_bands = 0;
+
+	if (bands_done) {
+		SDL_DestroySemaphore(bands_done);
+		bands_done = NULL;
+	}
+}
+
+static int band_thread(void *data)
+{
+	sbuffer_band_t *band = (sbuffer_band_t *) data;
+
+	for (;;) {
+		SDL_SemWait(band->start);
+		if (bands_quit) {
+			break;
+		}
+
+		render_band(band);
+
+		SDL_SemPost(bands_done);
+	}
+
+	return 0;
+}
+
+/* Rasterize and draw all commands binned in a band */
+static void render_band(sbuffer_band_t *band)
+{
+	SDL_Surface *surf = video.screen;
+	Uint8 *dst = (Uint8 *) surf->pixels;
+	SDL_Rect bounds;
+	int i;
+
+	cur_arena = &arenas[band - bands];
+	clear_rows(band->y1, band->y2);
+
+	for (i=0; i<band->num_cmds; i++) {
+		sbuffer_cmd_t *cmd = &cmds[band->cmds[i]];
+		sbuffer_gen_f gen = (cmd->depth_test ?
+			gen_seg_spans_ztest :
+			gen_seg_spans_noztest);
+
+		switch(cmd->type) {
+			case SBUFFER_CMD_POLY:
+				raster_poly(&cmd->segment, gen,
+					&cmd_vtx[cmd->first_vtx], cmd->num_vtx,
+					band->y1, band->y2, &bounds);
+				break;
+			case SBUFFER_CMD_POLYLINE:
+				raster_poly_line(&cmd->segment, gen,
+					&cmd_vtx[cmd->first_vtx], cmd->num_vtx,
+					band->y1, band->y2, &bounds);
+				break;
+			case SBUFFER_CMD_MASK:
+				if ((*gen)(cmd->y, &cmd->segment)) {
+					add_base_segment(cmd->y, &cmd->segment);
+				}
+				break;
+		}
+	}
+
+	dst += video.viewport.y * surf->pitch;
+	dst += video.viewport.x * surf->format->BytesPerPixel;
+
+	flush_rows(surf, dst, band->y1, band->y2);
+}
+
+/* Store a command, and bin it in bands covering rows miny to maxy */
+static void queue_cmd(int type, const sbuffer_segment_t *segment,
+	vertexf_t *vtx, int num_vtx, int y, int miny, int maxy)
+{
+	sbuffer_cmd_t *cmd;
+	int i;
+
+	miny = MAX(miny, 0);
+	maxy = MIN(maxy, video.viewport.h-1);
+	if (miny > maxy) {
+		return;
+	}
+
+	if (num_cmds >= size_cmds) {
+		size_cmds += 256;
+		cmds = realloc(cmds, size_cmds * sizeof(sbuffer_cmd_t));
+	}
+	if (num_cmd_vtx+num_vtx > size_cmd_vtx) {
+		size_cmd_vtx += 1024;
+		cmd_vtx = realloc(cmd_vtx, size_cmd_vtx * sizeof(vertexf_t));
+	}
+	if (!cmds || !cmd_vtx) {
+		fprintf(stderr, "Not enough memory for Sbuffer commands\n");
+		num_cmds = size_cmds = num_cmd_vtx = size_cmd_vtx = 0;
+		return;
+	}
+
+	cmd = &cmds[num_cmds];
+	cmd->type = type;
+	cmd->depth_test = depth_test;
+	cmd->num_vtx = num_vtx;
+	cmd->first_vtx = num_cmd_vtx;
+	cmd->y = y;
+	memcpy(&cmd->segment, segment, sizeof(sbuffer_segment_t));
+
+	if (num_vtx>0) {
+		memcpy(&cmd_vtx[num_cmd_vtx], vtx, num_vtx * sizeof(vertexf_t));
+		num_cmd_vtx += num_vtx;
+	}
+
+	for (i=0; i<num_bands; i++) {
+		sbuffer_band_t *band = &bands[i];
+
+		if ((maxy < band->y1) || (miny > band->y2)) {
+			continue;
+		}
+
+		if (band->num_cmds >= band->size_cmds) {
+			band->size_cmds += 256;
+			band->cmds = realloc(band->cmds, band->size_cmds * sizeof(int));
+			if (!band->cmds) {
+				fprintf(stderr, "Not enough memory for Sbuffer commands\n");
+				band->num_cmds = band->size_cmds = 0;
+				continue;
+			}
+		}
+
+		band->cmds[band->num_cmds++] = num_cmds;
+	}
+
+	++num_cmds;
+}
+
 
 static void dump_sbuffer(void)
 {
@@ -362,34 +800,208 @@ static void dump_sbuffer(void)
 
 static void clear_sbuffer(void)
 {
-	int i;
-
 	DEBUG_PRINT(("----------clearing sbuffer\n"));
 
-	for (i=0; i<sbuffer_numrows; i++) {
+	clear_rows(0, sbuffer_numrows-1);
+}
+
+static void clear_rows(int first, int last)
+{
+	int i;
+
+	for (i=first; i<=last; i++) {
 		sbuffer_rows[i].num_segs =
+			sbuffer_rows[i].size_segs =
 			sbuffer_rows[i].num_spans =
+			sbuffer_rows[i].size_spans =
 			sbuffer_rows[i].seg_full =
 			sbuffer_rows[i].span_full = 0;
 		sbuffer_rows[i].first_span = SPAN_INVALID;
+		sbuffer_rows[i].segment = NULL;
+		sbuffer_rows[i].span = NULL;
 	}
 }
 
+/* Allocate memory for current frame, never moved until arena is reset */
+static void *arena_alloc(sbuffer_arena_t *arena, size_t size)
+{
+	sbuffer_block_t *block = arena->current;
+	void *ptr;
+
+	size = (size+7) & ~7;
+
+	if (!block || (arena->pos+size > block->size)) {
+		sbuffer_block_t *next = (block ? block->next : arena->first);
+
+		/* Insert a new block if next one too small */
+		if (!next || (next->size < size)) {
+			size_t block_size = MAX(size, ARENA_BLOCK_SIZE);
+			sbuffer_block_t *new_block;
+
+			new_block = (sbuffer_block_t *) malloc(sizeof(sbuffer_block_t) + block_size);
+			if (!new_block) {
+				fprintf(stderr, "Not enough memory for Sbuffer rows\n");
+				return NULL;
+			}
+
+			new_block->next = next;
+			new_block->size = block_size;
+			if (block) {
+				block->next = new_block;
+			} else {
+				arena->first = new_block;
+			}
+			next = new_block;
+		}
+
+		block = arena->current = next;
+		arena->pos = 0;
+	}
+
+	ptr = ((Uint8 *) (block+1)) + arena->pos;
+	arena->pos += size;
+	arena->used += size;
+
+	return ptr;
+}
+
+/* Keep blocks, for next frame */
+static void arena_reset(sbuffer_arena_t *arena)
+{
+	arena->current = NULL;
+	arena->pos = arena->used = 0;
+	arena->max_segs = arena->max_spans = 0;
+}
+
+static void arena_free(sbuffer_arena_t *arena)
+{
+	sbuffer_block_t *block = arena->first;
+
+	while (block) {
+		sbuffer_block_t *next = block->next;
+
+		free(block);
+		block = next;
+	}
+
+	memset(arena, 0, sizeof(sbuffer_arena_t));
+}
+
+/* Called once all bands are done */
+static void update_arena_stats(void)
+{
+	size_t used = 0;
+	int i;
+
+	for (i=0; i<MAX(num_bands, 1); i++) {
+		used += arenas[i].used;
+		peak_row_segs = MAX(peak_row_segs, arenas[i].max_segs);
+		peak_row_spans = MAX(peak_row_spans, arenas[i].max_spans);
+	}
+
+	peak_arena_used = MAX(peak_arena_used, used);
+}
+
+/* Make room for more segments and spans in a row, doubling its size as needed.
+   Previous storage is not freed, so pointers to row content are invalid after
+   it grows */
+static int row_reserve(sbuffer_row_t *row, int num_segs, int num_spans)
+{
+	int size;
+
+	if (row->num_segs+num_segs > row->size_segs) {
+		sbuffer_segment_t *new_segs;
+
+		size = MAX(row->size_segs*2, INIT_SEGMENTS);
+		size = MIN(size, MAX_ROW_ITEMS);
+		if (row->num_segs+num_segs > size) {
+			row->seg_full = 1;
+			return 0;
+		}
+
+		new_segs = (sbuffer_segment_t *) arena_alloc(cur_arena, size * sizeof(sbuffer_segment_t));
+		if (!new_segs) {
+			row->seg_full = 1;
+			return 0;
+		}
+
+		if (row->num_segs>0) {
+			memcpy(new_segs, row->segment, row->num_segs * sizeof(sbuffer_segment_t));
+		}
+		row->segment = new_segs;
+		row->size_segs = size;
+	}
+
+	if (row->num_spans+num_spans > row->size_spans) {
+		sbuffer_span_t *new_spans;
+
+		size = MAX(row->size_spans*2, INIT_SPANS);
+		size = MIN(size, MAX_ROW_ITEMS);
+		if (row->num_spans+num_spans > size) {
+			row->span_full = 1;
+			return 0;
+		}
+
+		new_spans = (sbuffer_span_t *) arena_alloc(cur_arena, size * sizeof(sbuffer_span_t));
+		if (!new_spans) {
+			row->span_full = 1;
+			return 0;
+		}
+
+		if (row->num_spans>0) {
+			memcpy(new_spans, row->span, row->num_spans * sizeof(sbuffer_span_t));
+		}
+		row->span = new_spans;
+		row->size_spans = size;
+	}
+
+	return 1;
+}
+
 static void flush_sbuffer(draw_t *this)
 {
 	SDL_Surface *surf = video.screen;
-	int i,j;
 	Uint8 *dst = (Uint8 *) surf->pixels;
+	int i;
 
 	if (SDL_MUSTLOCK(surf)) {
 		SDL_LockSurface(surf);
 	}
 
-	dst += video.viewport.y * surf->pitch;
-	dst += video.viewport.x * surf->format->BytesPerPixel;
+	if (num_bands > 1) {
+		/* Wake up band threads, and render first band ourselves */
+		for (i=1; i<num_bands; i++) {
+			SDL_SemPost(bands[i].start);
+		}
+
+		render_band(&bands[0]);
+
+		for (i=1; i<num_bands; i++) {
+			SDL_SemWait(bands_done);
+		}
+	} else {
+		dst += video.viewport.y * surf->pitch;
+		dst += video.viewport.x * surf->format->BytesPerPixel;
+
+		flush_rows(surf, dst, 0, sbuffer_numrows-1);
+	}
+
+	if (SDL_MUSTLOCK(surf)) {
+		SDL_UnlockSurface(surf);
+	}
+
+	/*clear_sbuffer();*/
+}
+
+/* Draw rows y1 to y2, dst pointing to row 0 */
+static void flush_rows(SDL_Surface *surf, Uint8 *dst, int y1, int y2)
+{
+	int i,j;
+
+	dst += y1 * surf->pitch;
 
 	/* For each row */
-	for (i=0; i<sbuffer_numrows; i++, dst += surf->pitch) {
+	for (i=y1; i<=y2; i++, dst += surf->pitch) {
 		sbuffer_row_t *row = &sbuffer_rows[i];
 		sbuffer_span_t *span = row->span;
 		sbuffer_segment_t *segments = row->segment;
@@ -399,6 +1011,8 @@ static void flush_sbuffer(draw_t *this)
 		}
 
 		DEBUG_PRINT(("row %d: %d segs, %d spans\n",i,row->num_segs,row->num_spans));
+		cur_arena->max_segs = MAX(cur_arena->max_segs, row->num_segs);
+		cur_arena->max_spans = MAX(cur_arena->max_spans, row->num_spans);
 #if 0
 		if (row->seg_full) {
 			fprintf(stderr,"Not enough segments for row %d\n",i);
@@ -449,12 +1063,6 @@ static void flush_sbuffer(draw_t *this)
 			j = last;
 		}
 	}
-
-	if (SDL_MUSTLOCK(surf)) {
-		SDL_UnlockSurface(surf);
-	}
-
-	/*clear_sbuffer();*/
 }
 
 /* Calc w coordinate for a given x */
@@ -525,11 +1133,12 @@ static void add_base_segment(int y, const sbuffer_segment_t *segment)
 	sbuffer_row_t *row = &sbuffer_rows[y];
 	sbuffer_segment_t *new_seg = &(row->segment[row->num_segs]);
 
+	/* Room reserved by gen_seg_spans() */
+	assert(row->num_segs < row->size_segs);
+
 	memcpy(new_seg, segment, sizeof(sbuffer_segment_t));
 
 	++row->num_segs;
-
-	row->seg_full |= (row->num_segs>=MAX_SEGMENTS);
 }
 
 static void write_first_span(int num_seg, sbuffer_row_t *row, int x1, int x2)
@@ -570,7 +1179,8 @@ static int insert_new_span(int num_seg, sbuffer_row_t *row, int x1, int x2,
 		prev_span->next = row->num_spans;	/* Link previous to new */
 	}
 
-	assert(!(row->span_full));
+	/* Room reserved by caller */
+	assert(row->num_spans < row->size_spans);
 
 	new_span = &(row->span[row->num_spans]);
 	new_span->id = num_seg;
@@ -578,7 +1188,7 @@ static int insert_new_span(int num_seg, sbuffer_row_t *row, int x1, int x2,
 	new_span->x1 = x1;
 	new_span->x2 = x2;
 
-	row->span_full |= ((++row->num_spans)>=MAX_SPANS);
+	++row->num_spans;
 	return 1;
 }
 
@@ -586,7 +1196,7 @@ static void overwrite_span(int num_seg, sbuffer_row_t *row, int x1, int x2, int
 {
 	sbuffer_span_t *new_span;
 
-	assert(csi<MAX_SPANS);
+	assert(csi<row->num_spans);
 
 	new_span = &(row->span[csi]);
 	new_span->id = num_seg;
@@ -603,7 +1213,7 @@ static int gen_seg_spans_ztest(int y, const sbuffer_segment_t *segment)
 	int clip_seg, clip_pos;
 
 	/* Still room for common segment data ? */
-	if (row->seg_full || row->span_full) {
+	if (!row_reserve(row, 1, 1)) {
 		return 0;
 	}
 
@@ -637,9 +1247,17 @@ static int gen_seg_spans_ztest(int y, const sbuffer_segment_t *segment)
 	
 	for (nsi=row->first_span ; (nsi!=SPAN_INVALID) && (nx1<=nx2); psi=nsi, nsi=row->span[nsi].next) {
 		int clip_x1, clip_x2, span_inserted;
-		sbuffer_span_t *current = &(row->span[nsi]);
-		int cx1 = current->x1;
-		int cx2 = current->x2;
+		sbuffer_span_t *current;
+		int cx1, cx2;
+
+		/* Room for all spans this pass may insert, so current stays valid */
+		if (!row_reserve(row, 0, MAX_SPANS_PER_PASS)) {
+			return segbase_inserted;
+		}
+
+		current = &(row->span[nsi]);
+		cx1 = current->x1;
+		cx2 = current->x2;
 
 		DEBUG_PRINT(("--new %d,%d against %d:%d,%d\n",nx1,nx2, nsi,cx1, cx2));
 
@@ -681,9 +1299,6 @@ static int gen_seg_spans_ztest(int y, const sbuffer_segment_t *segment)
 			span_inserted = insert_new_span(row->num_segs,row, nx1,cx1-1, psi,nsi);
 			segbase_inserted |= span_inserted;
 
-			if (row->span_full)
-				return segbase_inserted;
-
 			nx1 = cx1;
 
 			if (span_inserted) {
@@ -717,9 +1332,6 @@ static int gen_seg_spans_ztest(int y, const sbuffer_segment_t *segment)
 			insert_new_span(current->id,row, cx1,clip_x1-1, psi,nsi);
 			current->x1 = cx1 = clip_x1;
 
-			if (row->span_full)
-				return segbase_inserted;
-
 			/* Update previous with new inserted */
 			psi = (	psi==SPAN_INVALID ?
 				row->first_span :
@@ -813,7 +1425,7 @@ static int gen_seg_spans_ztest(int y, const sbuffer_segment_t *segment)
 	}
 
 	DEBUG_PRINT(("--remain %d,%d\n",nx1,nx2));
-	if (nx1<=nx2) {
+	if ((nx1<=nx2) && row_reserve(row, 0, 1)) {
 		/* Insert last */
 		insert_new_span(row->num_segs,row, nx1,nx2, psi, nsi);
 		segbase_inserted=1;
@@ -829,7 +1441,7 @@ static int gen_seg_spans_noztest(int y, const sbuffer_segment_t *segment)
 	int segbase_inserted = 0;
 
 	/* Still room for common segment data ? */
-	if (row->seg_full || row->span_full) {
+	if (!row_reserve(row, 1, 1)) {
 		return 0;
 	}
 
@@ -863,9 +1475,17 @@ static int gen_seg_spans_noztest(int y, const sbuffer_segment_t *segment)
 	
 	for (nsi=row->first_span ; (nsi!=SPAN_INVALID) && (nx1<=nx2); psi=nsi, nsi=row->span[nsi].next) {
 		int clip_x1, clip_x2, span_inserted;
-		sbuffer_span_t *current = &(row->span[nsi]);
-		int cx1 = current->x1;
-		int cx2 = current->x2;
+		sbuffer_span_t *current;
+		int cx1, cx2;
+
+		/* Room for all spans this pass may insert, so current stays valid */
+		if (!row_reserve(row, 0, MAX_SPANS_PER_PASS)) {
+			return segbase_inserted;
+		}
+
+		current = &(row->span[nsi]);
+		cx1 = current->x1;
+		cx2 = current->x2;
 
 		DEBUG_PRINT(("--new %d,%d against %d:%d,%d\n",nx1,nx2, nsi,cx1, cx2));
 
@@ -907,9 +1527,6 @@ static int gen_seg_spans_noztest(int y, const sbuffer_segment_t *segment)
 			span_inserted = insert_new_span(row->num_segs,row, nx1,cx1-1, psi,nsi);
 			segbase_inserted |= span_inserted;
 
-			if (row->span_full)
-				return segbase_inserted;
-
 			nx1 = cx1;
 
 			if (span_inserted) {
@@ -941,9 +1558,6 @@ static int gen_seg_spans_noztest(int y, const sbuffer_segment_t *segment)
 			insert_new_span(current->id,row, cx1,clip_x1-1, psi,nsi);
 			current->x1 = cx1 = clip_x1;
 
-			if (row->span_full)
-				return segbase_inserted;
-
 			/* Update previous with new inserted */
 			psi = (	psi==SPAN_INVALID ?
 				row->first_span :
@@ -982,7 +1596,7 @@ static int gen_seg_spans_noztest(int y, const sbuffer_segment_t *segment)
 	}
 
 	DEBUG_PRINT(("--remain %d,%d\n",nx1,nx2));
-	if (nx1<=nx2) {
+	if ((nx1<=nx2) && row_reserve(row, 0, 1)) {
 		/* Insert last */
 		insert_new_span(row->num_segs,row, nx1,nx2, psi, nsi);
 		segbase_inserted=1;
@@ -992,11 +1606,56 @@ static int gen_seg_spans_noztest(int y, const sbuffer_segment_t *segment)
 }
 
 static void draw_poly_sbuffer(draw_t *this, vertexf_t *vtx, int num_vtx)
+{
+	sbuffer_segment_t segment;
+	SDL_Rect bounds;
+
+	segment.render_mode = render.render_mode;
+	segment.tex_num_pal = render.tex_pal;
+	segment.texture = render.texture;
+	segment.masking = render.bitmap.masking;
+
+	if (num_bands > 1) {
+		int i, miny = video.viewport.h-1, maxy = 0;
+		int minx = video.viewport.w-1, maxx = 0;
+
+		/* Same rows as raster_poly() will process */
+		for (i=0; i<num_vtx; i++) {
+			float w = 1.0f / vtx[i].pos[3];
+			int x = vtx[i].pos[0] * w;
+			int y = vtx[i].pos[1] * w;
+
+			minx = MIN(x, minx);
+			maxx = MAX(x, maxx);
+			miny = MIN(y, miny);
+			maxy = MAX(y, maxy);
+		}
+
+		queue_cmd(SBUFFER_CMD_POLY, &segment, vtx, num_vtx, 0, miny, maxy);
+
+		minx = MAX(minx, 0);
+		maxx = MIN(maxx, video.viewport.w-1);
+		miny = MAX(miny, 0);
+		maxy = MIN(maxy, video.viewport.h-1);
+
+		bounds.x = minx;
+		bounds.y = miny;
+		bounds.w = maxx-minx+1;
+		bounds.h = maxy-miny+1;
+	} else {
+		raster_poly(&segment, gen_seg_spans, vtx, num_vtx,
+			0, video.viewport.h-1, &bounds);
+	}
+
+	mark_dirty(&bounds);
+}
+
+/* Generate segments of a filled poly, for rows band_y1 to band_y2 */
+static void raster_poly(const sbuffer_segment_t *state, sbuffer_gen_f gen,
+	vertexf_t *vtx, int num_vtx, int band_y1, int band_y2, SDL_Rect *bounds)
 {
 	int miny = video.viewport.h-1, maxy = 0;
-#ifdef DIRTY_RECTS
 	int minx = video.viewport.w-1, maxx = 0;
-#endif
 	int y, p1, p2;
 	sbuffer_segment_t segment;
 	int num_array = 1; /* max array */
@@ -1007,7 +1666,7 @@ static void draw_poly_sbuffer(draw_t *this, vertexf_t *vtx, int num_vtx)
 		int v1 = p1;
 		int v2 = p2;
 		int x1,y1, x2,y2;
-		int dy;
+		int dy, ys, ye;
 		float w1, w2;
 
 		num_array = 1; /* max */
@@ -1066,21 +1725,21 @@ static void draw_poly_sbuffer(draw_t *this, vertexf_t *vtx, int num_vtx)
 			dv = tv2-tv1;
 			dw = w2-w1;
 
-			for (y=0; y<=dy; y++) {
-				float coef_dy;
+			/* Only walk rows on screen, and owned by this band */
+			ys = MAX(y1, MAX(band_y1, 0));
+			ye = MIN(y2, MIN(band_y2, video.viewport.h-1));
 
-				if ((y1<0) || (y1>=video.viewport.h)) {
-					continue;
-				}
+			for (y=ys; y<=ye; y++) {
+				float coef_dy;
 
-				coef_dy = (float) y / dy;
-				poly_hlines[y1].sbp[num_array].r = r1 + (dr * coef_dy);
-				poly_hlines[y1].sbp[num_array].g = g1 + (dg * coef_dy);
-				poly_hlines[y1].sbp[num_array].b = b1 + (db * coef_dy);
-				poly_hlines[y1].sbp[num_array].u = tu1 + (du * coef_dy);
-				poly_hlines[y1].sbp[num_array].v = tv1 + (dv * coef_dy);
-				poly_hlines[y1].sbp[num_array].w = w1 + (dw * coef_dy);
-				poly_hlines[y1++].sbp[num_array].x = x1 + (dx * coef_dy);
+				coef_dy = (float) (y-y1) / dy;
+				poly_hlines[y].sbp[num_array].r = r1 + (dr * coef_dy);
+				poly_hlines[y].sbp[num_array].g = g1 + (dg * coef_dy);
+				poly_hlines[y].sbp[num_array].b = b1 + (db * coef_dy);
+				poly_hlines[y].sbp[num_array].u = tu1 + (du * coef_dy);
+				poly_hlines[y].sbp[num_array].v = tv1 + (dv * coef_dy);
+				poly_hlines[y].sbp[num_array].w = w1 + (dw * coef_dy);
+				poly_hlines[y].sbp[num_array].x = x1 + (dx * coef_dy);
 			}
 		}
 
@@ -1091,17 +1750,23 @@ static void draw_poly_sbuffer(draw_t *this, vertexf_t *vtx, int num_vtx)
 	miny=MAX(miny, 0);
 	maxy=MIN(maxy, video.viewport.h-1);
 
+	bounds->y = miny;
+	bounds->h = maxy-miny+1;
+
 	/* Copy to other array for a single segment */
 	if (num_vtx==2) {
-		for (y=miny; y<maxy; y++) {
+		for (y=MAX(miny, band_y1); (y<maxy) && (y<=band_y2); y++) {
 			poly_hlines[y].sbp[num_array ^ 1] = poly_hlines[y].sbp[num_array];
 		}
 	}
 
-	segment.render_mode = render.render_mode;
-	segment.tex_num_pal = render.tex_pal;
-	segment.texture = render.texture;
-	segment.masking = render.bitmap.masking;
+	miny=MAX(miny, band_y1);
+	maxy=MIN(maxy, band_y2);
+
+	segment.render_mode = state->render_mode;
+	segment.tex_num_pal = state->tex_num_pal;
+	segment.texture = state->texture;
+	segment.masking = state->masking;
 
 	for (y=miny; y<=maxy; y++) {
 		int pminx = poly_hlines[y].sbp[0].x;
@@ -1111,47 +1776,84 @@ static void draw_poly_sbuffer(draw_t *this, vertexf_t *vtx, int num_vtx)
 			continue;
 		}
 
-#ifdef DIRTY_RECTS
 		minx=MIN(minx, pminx);
 		maxx=MAX(maxx, pmaxx);
-#endif
 
 		segment.start = poly_hlines[y].sbp[0];
 		segment.end = poly_hlines[y].sbp[1];
 
-		if (gen_seg_spans(y, &segment)) {
+		if ((*gen)(y, &segment)) {
 			add_base_segment(y, &segment);
 		}
 	}
 
-#ifdef DIRTY_RECTS
 	minx=MAX(minx, 0);
 	maxx=MIN(maxx, video.viewport.w-1);
 
-	/* Mark dirty rectangle */
-	dirty_rects[video.numfb]->setDirty(dirty_rects[video.numfb],
-		minx+video.viewport.x, miny+video.viewport.y, maxx-minx+1, maxy-miny+1);
-	upload_rects[video.numfb]->setDirty(upload_rects[video.numfb],
-		minx+video.viewport.x, miny+video.viewport.y, maxx-minx+1, maxy-miny+1);
-#endif
+	bounds->x = minx;
+	bounds->w = maxx-minx+1;
 }
 
 /* Specific version for non filled polys */
 static void draw_poly_sbuffer_line(draw_t *this, vertexf_t *vtx, int num_vtx)
 {
-	int miny = video.viewport.h-1, maxy = 0;
-#ifdef DIRTY_RECTS
-	int minx = video.viewport.w-1, maxx = 0;
-#endif
-	int p1,p2;
 	sbuffer_segment_t segment;
-	sbuffer_point_t *sp1, *sp2;
+	SDL_Rect bounds;
 
 	segment.render_mode = render.render_mode;
 	segment.tex_num_pal = render.tex_pal;
 	segment.texture = render.texture;
 	segment.masking = render.bitmap.masking;
 
+	if (num_bands > 1) {
+		int i, miny = video.viewport.h-1, maxy = 0;
+		int minx = video.viewport.w-1, maxx = 0;
+
+		/* Same rows as raster_poly_line() will process */
+		for (i=0; i<num_vtx; i++) {
+			int x = vtx[i].pos[0] / vtx[i].pos[3];
+			int y = vtx[i].pos[1] / vtx[i].pos[3];
+
+			minx = MIN(x, minx);
+			maxx = MAX(x, maxx);
+			miny = MIN(y, miny);
+			maxy = MAX(y, maxy);
+		}
+
+		queue_cmd(SBUFFER_CMD_POLYLINE, &segment, vtx, num_vtx, 0, miny, maxy);
+
+		minx = MAX(minx, 0);
+		maxx = MIN(maxx, video.viewport.w-1);
+		miny = MAX(miny, 0);
+		maxy = MIN(maxy, video.viewport.h-1);
+
+		bounds.x = minx;
+		bounds.y = miny;
+		bounds.w = maxx-minx+1;
+		bounds.h = maxy-miny+1;
+	} else {
+		raster_poly_line(&segment, gen_seg_spans, vtx, num_vtx,
+			0, video.viewport.h-1, &bounds);
+	}
+
+	mark_dirty(&bounds);
+}
+
+/* Generate segments of a non filled poly, for rows band_y1 to band_y2 */
+static void raster_poly_line(const sbuffer_segment_t *state, sbuffer_gen_f gen,
+	vertexf_t *vtx, int num_vtx, int band_y1, int band_y2, SDL_Rect *bounds)
+{
+	int miny = video.viewport.h-1, maxy = 0;
+	int minx = video.viewport.w-1, maxx = 0;
+	int p1,p2;
+	sbuffer_segment_t segment;
+	sbuffer_point_t *sp1, *sp2;
+
+	segment.render_mode = state->render_mode;
+	segment.tex_num_pal = state->tex_num_pal;
+	segment.texture = state->texture;
+	segment.masking = state->masking;
+
 	p1 = num_vtx-1;
 	for (p2=0; p2<num_vtx; p2++) {
 		int v1 = p1;
@@ -1187,7 +1889,6 @@ static void draw_poly_sbuffer_line(draw_t *this, vertexf_t *vtx, int num_vtx)
 
 		miny = MIN(y1, miny);
 		maxy = MAX(y2, maxy);
-#ifdef DIRTY_RECTS
 		if (x1<=x2) {
 			minx = MIN(x1, minx);
 			maxx = MAX(x2, maxx);
@@ -1195,7 +1896,6 @@ static void draw_poly_sbuffer_line(draw_t *this, vertexf_t *vtx, int num_vtx)
 			minx = MIN(x2, minx);
 			maxx = MAX(x2, maxx);
 		}
-#endif
 
 		r1 = vtx[v1].col[0];	r2 = vtx[v2].col[0];
 		g1 = vtx[v1].col[1];	g2 = vtx[v2].col[1];
@@ -1241,8 +1941,8 @@ static void draw_poly_sbuffer_line(draw_t *this, vertexf_t *vtx, int num_vtx)
 			sp2->w = w2;
 			sp2->x = x2;
 
-			if ((y1>=0) && (y1<video.viewport.h)) {
-				if (gen_seg_spans(y1, &segment)) {
+			if ((y1>=band_y1) && (y1<=band_y2)) {
+				if ((*gen)(y1, &segment)) {
 					add_base_segment(y1, &segment);
 				}
 			}
@@ -1255,7 +1955,7 @@ static void draw_poly_sbuffer_line(draw_t *this, vertexf_t *vtx, int num_vtx)
 			sp2 = &segment.end;
 
 			for (y=0; y<=dy; y++,y1++) {
-				if ((y1<0) || (y1>=video.viewport.h)) {
+				if ((y1<band_y1) || (y1>band_y2)) {
 					continue;
 				}
 
@@ -1268,7 +1968,7 @@ static void draw_poly_sbuffer_line(draw_t *this, vertexf_t *vtx, int num_vtx)
 				sp1->w = sp2->w = w1 + (dw * coef_dy);
 				sp1->x = sp2->x = x1 + (dx * coef_dy);
 
-				if (gen_seg_spans(y1, &segment)) {
+				if ((*gen)(y1, &segment)) {
 					add_base_segment(y1, &segment);
 				}
 			}
@@ -1319,8 +2019,8 @@ static void draw_poly_sbuffer_line(draw_t *this, vertexf_t *vtx, int num_vtx)
 				sp2->v = tv1 + dv * coef_dx;
 				sp2->w = w1 + dw * coef_dx;
 
-				if ((y>=0) && (y<video.viewport.h)) {
-					if (gen_seg_spans(y, &segment)) {
+				if ((y>=band_y1) && (y<=band_y2)) {
+					if ((*gen)(y, &segment)) {
 						add_base_segment(y, &segment);
 					}
 				}
@@ -1333,16 +2033,24 @@ static void draw_poly_sbuffer_line(draw_t *this, vertexf_t *vtx, int num_vtx)
 		p1 = p2;
 	}
 
-#ifdef DIRTY_RECTS
 	minx=MAX(minx, 0);
 	maxx=MIN(maxx, video.viewport.w-1);
+	miny=MAX(miny, 0);
+	maxy=MIN(maxy, video.viewport.h-1);
+
+	bounds->x = minx;
+	bounds->y = miny;
+	bounds->w = maxx-minx+1;
+	bounds->h = maxy-miny+1;
+}
 
+static void mark_dirty(const SDL_Rect *bounds)
+{
 	/* Mark dirty rectangle */
 	dirty_rects[video.numfb]->setDirty(dirty_rects[video.numfb],
-		minx+video.viewport.x, miny+video.viewport.y, maxx-minx+1, maxy-miny+1);
+		bounds->x+video.viewport.x, bounds->y+video.viewport.y, bounds->w, bounds->h);
 	upload_rects[video.numfb]->setDirty(upload_rects[video.numfb],
-		minx+video.viewport.x, miny+video.viewport.y, maxx-minx+1, maxy-miny+1);
-#endif
+		bounds->x+video.viewport.x, bounds->y+video.viewport.y, bounds->w, bounds->h);
 }
 
 static void draw_mask_segment(draw_t *this, int y, int x1, int x2, float w)
@@ -1361,6 +2069,11 @@ static void draw_mask_segment(draw_t *this, int y, int x1, int x2, float w)
 	segment.start.w = segment.end.w = w;
 	segment.masking = 1;
 
+	if (num_bands > 1) {
+		queue_cmd(SBUFFER_CMD_MASK, &segment, NULL, 0, y, y, y);
+		return;
+	}
+
 	if (gen_seg_spans(y, &segment)) {
 		add_base_segment(y, &segment);
 	}
@@ -22,6 +22,23 @@
 #ifndef DRAW_SBUFFER_H
 #define DRAW_SBUFFER_H 1
 
+/*--- Defines ---*/
+
+/* Span renderers working variables must be per thread for banded rendering */
+#if defined(__GNUC__) && !defined(__m68k__)
+#define SBUFFER_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define SBUFFER_THREAD_LOCAL __declspec(thread)
+#else
+#define SBUFFER_THREAD_LOCAL
+#define SBUFFER_NO_THREADS 1
+#endif
+
+/* SSE2 span renderers, selected at runtime */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SBUFFER_X86_SIMD 1
+#endif
+
 /*--- External types ---*/
 
 struct draw_s;
@@ -36,6 +36,10 @@
 #include "draw.h"
 #include "draw_sbuffer.h"
 
+#ifdef SBUFFER_X86_SIMD
+#include <immintrin.h>
+#endif
+
 /*--- Defines ---*/
 
 #define CONCAT2(x,y)	x ## y
@@ -44,6 +48,8 @@
 #define FNDEF3(name,bpp,perscorr)	CONCAT3(name,bpp,perscorr)
 #define CONCAT4(x,y,z,w)	x ## y ## z ## w
 #define FNDEF4(name,bpp,perscorr,alphatest)	CONCAT4(name,bpp,perscorr,alphatest)
+#define CONCAT5(x,y,z,w,s)	x ## y ## z ## w ## s
+#define FNDEF5(name,bpp,perscorr,alphatest,simd)	CONCAT5(name,bpp,perscorr,alphatest,simd)
 
 #define BPP 32
 #define PIXEL_TYPE	Uint32
@@ -56,16 +62,20 @@
 	output++;
 #define PIXEL_FROM_RGB(color, r,g,b) \
 	color = SDL_MapRGB(surf->format, r,g,b);
+#define SIMD_LOAD4(src) \
+	_mm_loadu_si128((__m128i *) (src))
+#define SIMD_STORE4(dst, pixels) \
+	_mm_storeu_si128((__m128i *) (dst), pixels);
 
 /*--- Variables ---*/
 
-static Uint32 color;
-static float r,g,b, dr,dg,db;
-static float r1,g1,b1, r2,g2,b2;
-static float u,v, du,dv;
-static float u1,v1, u2,v2;
-static float w, dw;
-static float w1, w2;
+static SBUFFER_THREAD_LOCAL Uint32 color;
+static SBUFFER_THREAD_LOCAL float r,g,b, dr,dg,db;
+static SBUFFER_THREAD_LOCAL float r1,g1,b1, r2,g2,b2;
+static SBUFFER_THREAD_LOCAL float u,v, du,dv;
+static SBUFFER_THREAD_LOCAL float u1,v1, u2,v2;
+static SBUFFER_THREAD_LOCAL float w, dw;
+static SBUFFER_THREAD_LOCAL float w1, w2;
 
 /*--- Functions ---*/
 
@@ -98,3 +108,10 @@ static float w1, w2;
 	}
 
 #include "span_textured.inc.c"
+
+#ifdef SBUFFER_X86_SIMD
+#include "span_simd.x86.inc.c"
+#include "span_fill.x86.inc.c"
+#include "span_gouraud.x86.inc.c"
+#include "span_textured.x86.inc.c"
+#endif
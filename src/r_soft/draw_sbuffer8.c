@@ -59,13 +59,13 @@
 
 /*--- Variables ---*/
 
-static Uint32 color;
-static float r,g,b, dr,dg,db;
-static float r1,g1,b1, r2,g2,b2;
-static float u,v, du,dv;
-static float u1,v1, u2,v2;
-static float w, dw;
-static float w1, w2;
+static SBUFFER_THREAD_LOCAL Uint32 color;
+static SBUFFER_THREAD_LOCAL float r,g,b, dr,dg,db;
+static SBUFFER_THREAD_LOCAL float r1,g1,b1, r2,g2,b2;
+static SBUFFER_THREAD_LOCAL float u,v, du,dv;
+static SBUFFER_THREAD_LOCAL float u1,v1, u2,v2;
+static SBUFFER_THREAD_LOCAL float w, dw;
+static SBUFFER_THREAD_LOCAL float w1, w2;
 
 /*--- Functions ---*/
 
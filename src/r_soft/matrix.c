@@ -24,6 +24,11 @@
 
 #include <SDL.h>
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MTX_X86_SSE 1
+#include <emmintrin.h>
+#endif
+
 #include "../video.h"
 #include "../r_common/render.h"
 
@@ -453,6 +458,109 @@ void mtx_multMtxVtx(float m1[4][4], int num_vtx, vertexf_t *vtx, vertexf_t *resu
 	}
 }
 
+/*
+	Batch versions, vertices stored as structure of arrays, which gives
+	same results as mtx_multMtxVtx() and mtx_clipTriangle() tests.
+	src and dst can be same arrays.
+*/
+
+void mtx_multMtxSoA(float m1[4][4], int num_vtx, float *src[4], float *dst[4])
+{
+	int i = 0, row;
+
+#ifdef MTX_X86_SSE
+	__m128 m4[4][4];
+
+	for (row=0; row<4; row++) {
+		m4[0][row] = _mm_set1_ps(m1[0][row]);
+		m4[1][row] = _mm_set1_ps(m1[1][row]);
+		m4[2][row] = _mm_set1_ps(m1[2][row]);
+		m4[3][row] = _mm_set1_ps(m1[3][row]);
+	}
+
+	for (; num_vtx-i>=4; i+=4) {
+		__m128 x = _mm_loadu_ps(&src[0][i]);
+		__m128 y = _mm_loadu_ps(&src[1][i]);
+		__m128 z = _mm_loadu_ps(&src[2][i]);
+		__m128 w = _mm_loadu_ps(&src[3][i]);
+
+		for (row=0; row<4; row++) {
+			__m128 r;
+
+			r = _mm_mul_ps(m4[0][row], x);
+			r = _mm_add_ps(r, _mm_mul_ps(m4[1][row], y));
+			r = _mm_add_ps(r, _mm_mul_ps(m4[2][row], z));
+			r = _mm_add_ps(r, _mm_mul_ps(m4[3][row], w));
+
+			_mm_storeu_ps(&dst[row][i], r);
+		}
+	}
+#endif
+
+	for (; i<num_vtx; i++) {
+		float x = src[0][i];
+		float y = src[1][i];
+		float z = src[2][i];
+		float w = src[3][i];
+
+		for (row=0; row<4; row++) {
+			dst[row][i] = m1[0][row]*x
+				+ m1[1][row]*y
+				+ m1[2][row]*z
+				+ m1[3][row]*w;
+		}
+	}
+}
+
+/* Set bit n of code if vertex outside of clip plane n */
+void mtx_clipCodesSoA(float clip[6][4], int num_vtx, float *pos[4], Uint8 *codes)
+{
+	int i = 0, j;
+
+#ifdef MTX_X86_SSE
+	for (; num_vtx-i>=4; i+=4) {
+		__m128 x = _mm_loadu_ps(&pos[0][i]);
+		__m128 y = _mm_loadu_ps(&pos[1][i]);
+		__m128 z = _mm_loadu_ps(&pos[2][i]);
+		__m128 w = _mm_loadu_ps(&pos[3][i]);
+		__m128i code4 = _mm_setzero_si128();
+		int lanes[4];
+
+		for (j=0; j<6; j++) {
+			__m128 d;
+
+			d = _mm_mul_ps(_mm_set1_ps(clip[j][0]), x);
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(clip[j][1]), y));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(clip[j][2]), z));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(clip[j][3]), w));
+
+			d = _mm_cmplt_ps(d, _mm_setzero_ps());
+			code4 = _mm_or_si128(code4,
+				_mm_and_si128(_mm_castps_si128(d), _mm_set1_epi32(1<<j)));
+		}
+
+		_mm_storeu_si128((__m128i *) lanes, code4);
+		codes[i] = lanes[0];
+		codes[i+1] = lanes[1];
+		codes[i+2] = lanes[2];
+		codes[i+3] = lanes[3];
+	}
+#endif
+
+	for (; i<num_vtx; i++) {
+		Uint8 code = 0;
+
+		for (j=0; j<6; j++) {
+			if (pos[0][i]*clip[j][0] + pos[1][i]*clip[j][1]
+			    + pos[2][i]*clip[j][2] + pos[3][i]*clip[j][3] < 0.0f) {
+				code |= 1<<j;
+			}
+		}
+
+		codes[i] = code;
+	}
+}
+
 /* Calc dot product against vector (0,0,1) to see if face visible */
 float mtx_faceVisible(float points[4][4])
 {
@@ -667,7 +775,7 @@ static void mtx_clipSegPlaneVf(vertexf_t *vtx0, vertexf_t *vtx1, float clip[4])
 
 int mtx_clipTriangle(vertexf_t tri1[3], int *num_vtx, vertexf_t tri2[16], float clip[6][4])
 {
-	int i;
+	int i, result = CLIPPING_INSIDE;
 	int cur_num_vtx = *num_vtx;
 	vertexf_t tmp_poly[16];
 	int flag_inside[16];
@@ -705,6 +813,8 @@ int mtx_clipTriangle(vertexf_t tri1[3], int *num_vtx, vertexf_t tri2[16], float
 			continue;
 		}
 
+		result = CLIPPING_NEEDED;
+
 		/* For each segment */
 		new_num_vtx = 0;
 		p1 = cur_num_vtx-1;
@@ -769,5 +879,5 @@ int mtx_clipTriangle(vertexf_t tri1[3], int *num_vtx, vertexf_t tri2[16], float
 
 	*num_vtx = cur_num_vtx;
 
-	return CLIPPING_INSIDE;
+	return result;
 }
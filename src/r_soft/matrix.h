@@ -66,6 +66,12 @@ void mtx_picking(int x, int y, int width, int height,
 
 void mtx_multMtxVtx(float m1[4][4], int num_vtx, struct vertexf_s *vtx, struct vertexf_s *result);
 
+/* Transform vertices stored as x,y,z,w arrays */
+void mtx_multMtxSoA(float m1[4][4], int num_vtx, float *src[4], float *dst[4]);
+
+/* Calculate bitmask of view frustum planes each vertex is outside of */
+void mtx_clipCodesSoA(float clip[6][4], int num_vtx, float *pos[4], Uint8 *codes);
+
 /* Calculate if face visible using dot product */
 float mtx_faceVisible(float points[4][4]);
 
@@ -81,7 +87,7 @@ int mtx_clipCheck(float points[][4], int num_points, float clip[6][4]);
 /* Clip segment against one of view frustum planes */
 int mtx_clipSegment(float points[4][4], float clip[6][4]);
 
-/* Clip a list of triangles */
+/* Clip a list of triangles, return CLIPPING_INSIDE if poly is a copy of tri1 */
 int mtx_clipTriangle(struct vertexf_s tri1[3], int *num_vtx, struct vertexf_s poly[16], float clip[6][4]);
 
 #endif /* MATRIX_H */
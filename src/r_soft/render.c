@@ -26,6 +26,7 @@
 #include <assert.h>
 
 #include "../video.h"
+#include "../log.h"
 
 #include "../r_common/render_texture_list.h"
 #include "../r_common/render_skel_list.h"
@@ -35,6 +36,7 @@
 #include "dither.h"
 #include "draw.h"
 #include "draw_sbuffer.h"
+#include "render.h"
 #include "render_mask.h"
 #include "render_mesh.h"
 #include "render_texture.h"
@@ -44,6 +46,19 @@
 
 #define MAX_MODELVIEW_MTX 32
 
+/* Number of frames to average for vertex count report */
+#define FRAME_STATS_COUNT 64
+
+/*
+	Pixels allowed outside viewport before a poly is clipped against
+	left/right/top/bottom planes. Rasterizer clamps rows and columns of
+	polys that stay within this band.
+*/
+#define GUARD_BAND_SIZE 2048
+
+/* Far and near bits of mtx_clipCodesSoA() clip codes */
+#define CLIP_NEAR_FAR	((1<<4)|(1<<5))
+
 /*--- Variables ---*/
 
 static float modelview_mtx[MAX_MODELVIEW_MTX][4][4];	/* 16 4x4 matrices */
@@ -55,7 +70,11 @@ static float viewport_mtx[4][4]; /* viewport matrix */
 static float frustum_mtx[4][4]; /* frustum = viewport*projection*camera */
 static float clip_planes[6][4]; /* view frustum clip planes */
 
-static int gouraud;
+static float guard_band[4];	/* min x, max x, min y, max y on screen */
+
+static int num_vtx_transformed;	/* Since last report */
+static int num_poly_inside, num_poly_guard, num_poly_clipped, num_poly_rejected;
+static int num_stats_frames;
 
 /*--- Functions prototypes ---*/
 
@@ -87,6 +106,7 @@ static void set_proj_matrix(float mtx[4][4]);
 static void set_model_matrix(float mtx[4][4]);
 
 static void recalc_frustum_mtx(void);
+static int inside_guard_band(render_soft_vtx_t *vtx, int *idx, int num_vtx);
 
 static void set_color(Uint32 color);
 static void set_render(int num_render);
@@ -94,8 +114,9 @@ static void set_dithering(int enable);
 static void set_depth(int enable);
 static void set_useDirtyRects(int enable);
 static void set_pers_corr(int perscorr);
+static void set_threads(int num_threads);
 
-static Uint32 get_color_from_texture(vertex_t *v1);
+static Uint32 get_color_from_texture(int u, int v);
 
 static void sortBackToFront(int num_vtx, int *num_idx, vertex_t *vtx);
 
@@ -103,11 +124,14 @@ static void line(vertex_t *v1, vertex_t *v2);
 static void triangle(vertex_t *v1, vertex_t *v2, vertex_t *v3);
 static void quad(vertex_t *v1, vertex_t *v2, vertex_t *v3, vertex_t *v4);
 
-static void triangle_fill(vertex_t *v1, vertex_t *v2, vertex_t *v3);
-static void quad_fill(vertex_t *v1, vertex_t *v2, vertex_t *v3, vertex_t *v4);
+static void triangle_render(vertex_t *v1, vertex_t *v2, vertex_t *v3);
+static void quad_render(vertex_t *v1, vertex_t *v2, vertex_t *v3, vertex_t *v4);
 
-static void triangle_tex(vertex_t *v1, vertex_t *v2, vertex_t *v3);
-static void quad_tex(vertex_t *v1, vertex_t *v2, vertex_t *v3, vertex_t *v4);
+static void draw_vertex_poly(vertex_t **v, int num_vtx, int render_mode);
+static void set_poly_colors(vertexf_t *poly, int num_vtx, int render_mode);
+static void draw_poly(render_soft_vtx_t *vtx, int *idx, vertexf_t *poly, int num_vtx,
+	int render_mode);
+static void transform_vtx(float m[4][4], int num_vtx, vertexf_t *vtx, vertexf_t *result);
 
 /*--- Functions ---*/
 
@@ -149,6 +173,7 @@ void render_soft_init(render_t *this)
 	this->set_depth = set_depth;
 	this->set_useDirtyRects = set_useDirtyRects;
 	this->set_pers_corr = set_pers_corr;
+	this->set_threads = set_threads;
 
 	this->sortBackToFront = sortBackToFront;
 
@@ -163,11 +188,13 @@ void render_soft_init(render_t *this)
 
 	draw_init_sbuffer(&draw);
 
-	gouraud = 0;
+	num_vtx_transformed = num_stats_frames = 0;
+	num_poly_inside = num_poly_guard = num_poly_clipped = num_poly_rejected = 0;
 }
 
 static void shutdown(void)
 {
+	render_mesh_soft_shutdown();
 	draw.shutdown(&draw);
 	baseShutdown();
 }
@@ -194,6 +221,17 @@ static void render_endFrame(void)
 
 	draw.endFrame(&draw);
 
+	/* Report average number of vertices transformed per frame */
+	if (++num_stats_frames >= FRAME_STATS_COUNT) {
+		logMsg(2, "render: %d vertices transformed/frame\n",
+			num_vtx_transformed / num_stats_frames);
+		logMsg(2, "render: %d inside, %d guard band, %d clipped, %d rejected polys/frame\n",
+			num_poly_inside / num_stats_frames, num_poly_guard / num_stats_frames,
+			num_poly_clipped / num_stats_frames, num_poly_rejected / num_stats_frames);
+		num_vtx_transformed = num_stats_frames = 0;
+		num_poly_inside = num_poly_guard = num_poly_clipped = num_poly_rejected = 0;
+	}
+
 #if SDL_VERSION_ATLEAST(2,0,0)
 	/*SDL_RenderPresent(renderer);*/
 #endif
@@ -216,6 +254,11 @@ static void set_viewport(int x, int y, int w, int h)
 	viewport_mtx[3][0] = w*0.5f;
 	viewport_mtx[1][1] = -h*0.5f;
 	viewport_mtx[3][1] = h*0.5f;
+
+	guard_band[0] = -GUARD_BAND_SIZE;
+	guard_band[1] = w+GUARD_BAND_SIZE;
+	guard_band[2] = -GUARD_BAND_SIZE;
+	guard_band[3] = h+GUARD_BAND_SIZE;
 }
 
 static void set_projection(float angle, float aspect, float z_near, float z_far)
@@ -386,6 +429,11 @@ static void set_pers_corr(int perscorr)
 	draw.correctPerspective = perscorr;
 }
 
+static void set_threads(int num_threads)
+{
+	draw.set_threads(&draw, num_threads);
+}
+
 static void set_render(int num_render)
 {
 	render.line = line;
@@ -394,29 +442,11 @@ static void set_render(int num_render)
 
 	render.render_mode = num_render;
 
-	switch(num_render) {
-		case RENDER_WIREFRAME:
-			render.triangle = triangle;
-			render.quad = quad;
-			break;
-		case RENDER_FILLED:
-			gouraud = 0;
-			render.triangle = triangle_fill;
-			render.quad = quad_fill;
-			break;
-		case RENDER_GOURAUD:
-			gouraud = 1;
-			render.triangle = triangle_fill;
-			render.quad = quad_fill;
-			break;
-		case RENDER_TEXTURED:
-			render.triangle = triangle_tex;
-			render.quad = quad_tex;
-			break;
-	}
+	render.triangle = triangle_render;
+	render.quad = quad_render;
 }
 
-static Uint32 get_color_from_texture(vertex_t *v1)
+static Uint32 get_color_from_texture(int u, int v)
 {
 	render_texture_t *texture = render.texture;
 	Uint32 color = 0xffffffff;
@@ -431,19 +461,19 @@ static Uint32 get_color_from_texture(vertex_t *v1)
 	switch(texture->bpp) {
 		case 1:
 			{
-				Uint8 pix = texture->pixels[(texture->pitch * v1->v) + v1->u];
+				Uint8 pix = texture->pixels[(texture->pitch * v) + u];
 				color = texture->palettes[render.tex_pal][pix];
 				fmt = video.screen->format;
 			}
 			break;
 		case 2:
-			color = ((Uint16 *) texture->pixels)[((texture->pitch>>1) * v1->v) + v1->u];
+			color = ((Uint16 *) texture->pixels)[((texture->pitch>>1) * v) + u];
 			break;
 		case 3:
 			/* TODO */
 			break;
 		case 4:
-			color = ((Uint32 *) texture->pixels)[((texture->pitch>>2) * v1->v) + v1->u];
+			color = ((Uint32 *) texture->pixels)[((texture->pitch>>2) * v) + u];
 			break;
 	}
 
@@ -470,8 +500,8 @@ static void sortBackToFront(int num_vtx, int *num_idx, vertex_t *vtx)
 		vtx1[i].pos[2] = vtx[i].z;
 		vtx1[i].pos[3] = 1.0f;
 	}
-	mtx_multMtxVtx(modelview_mtx[num_modelview_mtx], num_vtx, vtx1, vtx2);
-	mtx_multMtxVtx(frustum_mtx, num_vtx, vtx2, vtx1);
+	transform_vtx(modelview_mtx[num_modelview_mtx], num_vtx, vtx1, vtx2);
+	transform_vtx(frustum_mtx, num_vtx, vtx2, vtx1);
 
 	/* Then sort them */
 	for (i=0; i<num_vtx-1; i++) {
@@ -502,7 +532,7 @@ static void sortBackToFront(int num_vtx, int *num_idx, vertex_t *vtx)
 }
 
 /*
-	Wireframe triangles/quads
+	Wireframe lines
 */
 
 static void line(vertex_t *v1, vertex_t *v2)
@@ -512,7 +542,7 @@ static void line(vertex_t *v1, vertex_t *v2)
 	Uint32 color = 0xffffffff;
 
 	if (render.texture) {
-		color = get_color_from_texture(v1);
+		color = get_color_from_texture(v1->u, v1->v);
 		set_color(color);
 	} else {
 		Uint8 r,g,b,a;
@@ -543,7 +573,7 @@ static void line(vertex_t *v1, vertex_t *v2)
 	tri1[1].col[2] = tri1[0].col[2];
 	tri1[1].col[3] = tri1[0].col[3];
 
-	mtx_multMtxVtx(modelview_mtx[num_modelview_mtx], 2, tri1, poly);
+	transform_vtx(modelview_mtx[num_modelview_mtx], 2, tri1, poly);
 
 	num_vtx = 2;
 	clip_result = mtx_clipTriangle(poly, &num_vtx, poly2, clip_planes);
@@ -552,491 +582,258 @@ static void line(vertex_t *v1, vertex_t *v2)
 	}
 
 	/* Project poly in frustum */
-	mtx_multMtxVtx(frustum_mtx, num_vtx, poly2, poly);
+	transform_vtx(frustum_mtx, num_vtx, poly2, poly);
 
 	/* Draw polygon */
 	draw.polyLine(&draw, poly, num_vtx);
 }
 
+/*
+	Triangles/quads
+*/
+
 static void triangle(vertex_t *v1, vertex_t *v2, vertex_t *v3)
 {
-	float segment[4][4], result[4][4];
-	vertexf_t tri1[3], poly[16], poly2[16];
-	int clip_result, i, num_vtx;
-	Uint32 color = 0xffffffff;
+	vertex_t *v[3];
 
-	if (render.texture) {
-		color = get_color_from_texture(v1);
-		set_color(color);
-	} else {
-		Uint8 r,g,b,a;
-
-		SDL_GetRGBA(render.color, video.screen->format, &r,&g,&b,&a);
-		color = (a<<24)|(r<<16)|(g<<8)|b;
-	}
+	v[0] = v1;
+	v[1] = v2;
+	v[2] = v3;
 
-	/*color = get_color_from_texture(v1);
-	set_color(color);*/
+	draw_vertex_poly(v, 3, RENDER_WIREFRAME);
+}
 
-	tri1[0].pos[0] = v1->x;
-	tri1[0].pos[1] = v1->y;
-	tri1[0].pos[2] = v1->z;
-	tri1[0].pos[3] = 1.0f;
-	tri1[0].tx[0] = v1->u;
-	tri1[0].tx[1] = v1->v;
-	tri1[0].col[0] = (color>>16) & 0xff;
-	tri1[0].col[1] = (color>>8) & 0xff;
-	tri1[0].col[2] = color & 0xff;
-	tri1[0].col[3] = (color>>24) & 0xff;
+static void quad(vertex_t *v1, vertex_t *v2, vertex_t *v3, vertex_t *v4)
+{
+	vertex_t *v[4];
 
-	tri1[1].pos[0] = v2->x;
-	tri1[1].pos[1] = v2->y;
-	tri1[1].pos[2] = v2->z;
-	tri1[1].pos[3] = 1.0f;
-	tri1[1].tx[0] = v2->u;
-	tri1[1].tx[1] = v2->v;
-	tri1[1].col[0] = tri1[0].col[0];
-	tri1[1].col[1] = tri1[0].col[1];
-	tri1[1].col[2] = tri1[0].col[2];
-	tri1[1].col[3] = tri1[0].col[3];
+	v[0] = v1;
+	v[1] = v2;
+	v[2] = v3;
+	v[3] = v4;
 
-	tri1[2].pos[0] = v3->x;
-	tri1[2].pos[1] = v3->y;
-	tri1[2].pos[2] = v3->z;
-	tri1[2].pos[3] = 1.0f;
-	tri1[2].tx[0] = v3->u;
-	tri1[2].tx[1] = v3->v;
-	tri1[2].col[0] = tri1[0].col[0];
-	tri1[2].col[1] = tri1[0].col[1];
-	tri1[2].col[2] = tri1[0].col[2];
-	tri1[2].col[3] = tri1[0].col[3];
+	draw_vertex_poly(v, 4, RENDER_WIREFRAME);
+}
 
-	mtx_multMtxVtx(modelview_mtx[num_modelview_mtx], 3, tri1, poly);
+static void triangle_render(vertex_t *v1, vertex_t *v2, vertex_t *v3)
+{
+	vertex_t *v[3];
 
-	num_vtx = 3;
-	clip_result = mtx_clipTriangle(poly, &num_vtx, poly2, clip_planes);
-	if (clip_result == CLIPPING_OUTSIDE) {
-		return;
-	}
+	v[0] = v1;
+	v[1] = v2;
+	v[2] = v3;
 
-	/* Check face visible */
-	memset(result, 0, sizeof(float)*4*4);
-	for (i=0; i<3; i++) {
-		result[i][0] = poly[i].pos[0];
-		result[i][1] = poly[i].pos[1];
-		result[i][2] = poly[i].pos[2];
-		result[i][3] = poly[i].pos[3];
-	}
+	draw_vertex_poly(v, 3, render.render_mode);
+}
 
-	mtx_mult(frustum_mtx, result, segment);
+static void quad_render(vertex_t *v1, vertex_t *v2, vertex_t *v3, vertex_t *v4)
+{
+	vertex_t *v[4];
 
-	/* Project poly in frustum */
-	mtx_multMtxVtx(frustum_mtx, num_vtx, poly2, poly);
-	if (mtx_faceVisibleVtx(poly)<0.0f) {
-		return;
-	}
+	v[0] = v1;
+	v[1] = v2;
+	v[2] = v3;
+	v[3] = v4;
 
-	/* Draw polygon */
-	draw.polyLine(&draw, poly, num_vtx);
+	draw_vertex_poly(v, 4, render.render_mode);
 }
 
-static void quad(vertex_t *v1, vertex_t *v2, vertex_t *v3, vertex_t *v4)
+static void draw_vertex_poly(vertex_t **v, int num_vtx, int render_mode)
 {
-	float segment[4][4], result[4][4];
-	vertexf_t tri1[4], poly[16], poly2[16];
-	int clip_result, i, num_vtx;
-	Uint32 color = 0xffffffff;
+	float pos[4][4], eye[4][4], proj[4][4], *pos_p[4];
+	Uint8 clip[4];
+	render_soft_vtx_t vtx;
+	vertexf_t poly[4];
+	int i, idx[4];
 
-	if (render.texture) {
-		color = get_color_from_texture(v1);
-		set_color(color);
-	} else {
-		Uint8 r,g,b,a;
+	for (i=0; i<4; i++) {
+		pos_p[i] = pos[i];
+		vtx.eye[i] = eye[i];
+		vtx.proj[i] = proj[i];
+	}
+	vtx.clip = clip;
 
-		SDL_GetRGBA(render.color, video.screen->format, &r,&g,&b,&a);
-		color = (a<<24)|(r<<16)|(g<<8)|b;
+	for (i=0; i<num_vtx; i++) {
+		pos[0][i] = v[i]->x;
+		pos[1][i] = v[i]->y;
+		pos[2][i] = v[i]->z;
+		pos[3][i] = 1.0f;
+		poly[i].tx[0] = v[i]->u;
+		poly[i].tx[1] = v[i]->v;
+		idx[i] = i;
 	}
 
-	tri1[0].pos[0] = v1->x;
-	tri1[0].pos[1] = v1->y;
-	tri1[0].pos[2] = v1->z;
-	tri1[0].pos[3] = 1.0f;
-	tri1[0].tx[0] = v1->u;
-	tri1[0].tx[1] = v1->v;
-	tri1[0].col[0] = (color>>16) & 0xff;
-	tri1[0].col[1] = (color>>8) & 0xff;
-	tri1[0].col[2] = color & 0xff;
-	tri1[0].col[3] = (color>>24) & 0xff;
+	render_soft_transform(num_vtx, pos_p, &vtx);
 
-	tri1[1].pos[0] = v2->x;
-	tri1[1].pos[1] = v2->y;
-	tri1[1].pos[2] = v2->z;
-	tri1[1].pos[3] = 1.0f;
-	tri1[1].tx[0] = v2->u;
-	tri1[1].tx[1] = v2->v;
-	tri1[1].col[0] = tri1[0].col[0];
-	tri1[1].col[1] = tri1[0].col[1];
-	tri1[1].col[2] = tri1[0].col[2];
-	tri1[1].col[3] = tri1[0].col[3];
+	draw_poly(&vtx, idx, poly, num_vtx, render_mode);
+}
 
-	tri1[2].pos[0] = v3->x;
-	tri1[2].pos[1] = v3->y;
-	tri1[2].pos[2] = v3->z;
-	tri1[2].pos[3] = 1.0f;
-	tri1[2].tx[0] = v3->u;
-	tri1[2].tx[1] = v3->v;
-	tri1[2].col[0] = tri1[0].col[0];
-	tri1[2].col[1] = tri1[0].col[1];
-	tri1[2].col[2] = tri1[0].col[2];
-	tri1[2].col[3] = tri1[0].col[3];
-
-	tri1[3].pos[0] = v4->x;
-	tri1[3].pos[1] = v4->y;
-	tri1[3].pos[2] = v4->z;
-	tri1[3].pos[3] = 1.0f;
-	tri1[3].tx[0] = v4->u;
-	tri1[3].tx[1] = v4->v;
-	tri1[3].col[0] = tri1[0].col[0];
-	tri1[3].col[1] = tri1[0].col[1];
-	tri1[3].col[2] = tri1[0].col[2];
-	tri1[3].col[3] = tri1[0].col[3];
-
-	mtx_multMtxVtx(modelview_mtx[num_modelview_mtx], 4, tri1, poly);
-
-	num_vtx = 4;
-	clip_result = mtx_clipTriangle(poly, &num_vtx, poly2, clip_planes);
-	if (clip_result == CLIPPING_OUTSIDE) {
-		return;
-	}
+/* Set vertex colors for current texture, as needed by render mode */
+static void set_poly_colors(vertexf_t *poly, int num_vtx, int render_mode)
+{
+	Uint32 color = 0xffffffff;
+	int i;
 
-	/* Check face visible */
-	memset(result, 0, sizeof(float)*4*4);
-	for (i=0; i<3; i++) {
-		result[i][0] = poly[i].pos[0];
-		result[i][1] = poly[i].pos[1];
-		result[i][2] = poly[i].pos[2];
-		result[i][3] = poly[i].pos[3];
+	switch(render_mode) {
+		case RENDER_WIREFRAME:
+			if (render.texture) {
+				color = get_color_from_texture(poly[0].tx[0], poly[0].tx[1]);
+				set_color(color);
+			} else {
+				Uint8 r,g,b,a;
+
+				SDL_GetRGBA(render.color, video.screen->format, &r,&g,&b,&a);
+				color = (a<<24)|(r<<16)|(g<<8)|b;
+			}
+			break;
+		case RENDER_FILLED:
+			color = get_color_from_texture(poly[0].tx[0], poly[0].tx[1]);
+			set_color(color);
+			break;
+		case RENDER_GOURAUD:
+			break;
+		default:
+			return;
 	}
 
-	mtx_mult(frustum_mtx, result, segment);
+	for (i=0; i<num_vtx; i++) {
+		if (render_mode == RENDER_GOURAUD) {
+			color = get_color_from_texture(poly[i].tx[0], poly[i].tx[1]);
+		}
 
-	/* Project poly in frustum */
-	mtx_multMtxVtx(frustum_mtx, num_vtx, poly2, poly);
-	if (mtx_faceVisibleVtx(poly)<0.0f) {
-		return;
+		poly[i].col[0] = (color>>16) & 0xff;
+		poly[i].col[1] = (color>>8) & 0xff;
+		poly[i].col[2] = color & 0xff;
+		poly[i].col[3] = (color>>24) & 0xff;
 	}
-
-	/* Draw polygon */
-	draw.polyLine(&draw, poly, num_vtx);
 }
 
-/*
-	Filled triangles/quads
-*/
-
-static void triangle_fill(vertex_t *v1, vertex_t *v2, vertex_t *v3)
+/* Draw a polygon from transformed vertices, clipping it only if needed */
+static void draw_poly(render_soft_vtx_t *vtx, int *idx, vertexf_t *poly, int num_vtx,
+	int render_mode)
 {
-	float segment[4][4], result[4][4];
-	vertexf_t tri1[3], poly[16], poly2[16];
-	int clip_result, i, num_vtx;
-	Uint32 color;
+	vertexf_t poly2[16], poly3[16], *result;
+	int clip_or = 0, clip_and = 0xff, i, j;
 
-	color = get_color_from_texture(v1);
-	if (!gouraud) {
-		set_color(color);
-	}
+	set_poly_colors(poly, num_vtx, render_mode);
 
-	tri1[0].pos[0] = v1->x;
-	tri1[0].pos[1] = v1->y;
-	tri1[0].pos[2] = v1->z;
-	tri1[0].pos[3] = 1.0f;
-	tri1[0].tx[0] = v1->u;
-	tri1[0].tx[1] = v1->v;
-	tri1[0].col[0] = (color>>16) & 0xff;
-	tri1[0].col[1] = (color>>8) & 0xff;
-	tri1[0].col[2] = color & 0xff;
-	tri1[0].col[3] = (color>>24) & 0xff;
-
-	if (gouraud) {
-		color = get_color_from_texture(v2);
+	for (i=0; i<num_vtx; i++) {
+		clip_or |= vtx->clip[idx[i]];
+		clip_and &= vtx->clip[idx[i]];
 	}
-	tri1[1].pos[0] = v2->x;
-	tri1[1].pos[1] = v2->y;
-	tri1[1].pos[2] = v2->z;
-	tri1[1].pos[3] = 1.0f;
-	tri1[1].tx[0] = v2->u;
-	tri1[1].tx[1] = v2->v;
-	tri1[1].col[0] = (color>>16) & 0xff;
-	tri1[1].col[1] = (color>>8) & 0xff;
-	tri1[1].col[2] = color & 0xff;
-	tri1[1].col[3] = (color>>24) & 0xff;
 
-	if (gouraud) {
-		color = get_color_from_texture(v3);
-	}
-	tri1[2].pos[0] = v3->x;
-	tri1[2].pos[1] = v3->y;
-	tri1[2].pos[2] = v3->z;
-	tri1[2].pos[3] = 1.0f;
-	tri1[2].tx[0] = v3->u;
-	tri1[2].tx[1] = v3->v;
-	tri1[2].col[0] = (color>>16) & 0xff;
-	tri1[2].col[1] = (color>>8) & 0xff;
-	tri1[2].col[2] = color & 0xff;
-	tri1[2].col[3] = (color>>24) & 0xff;
-
-	mtx_multMtxVtx(modelview_mtx[num_modelview_mtx], 3, tri1, poly);
-
-	num_vtx = 3;
-	clip_result = mtx_clipTriangle(poly, &num_vtx, poly2, clip_planes);
-	if (clip_result == CLIPPING_OUTSIDE) {
+	/* All vertices outside of same clip plane */
+	if (clip_and) {
+		++num_poly_rejected;
 		return;
 	}
 
-	/* Check face visible */
-	memset(result, 0, sizeof(float)*4*4);
-	for (i=0; i<3; i++) {
-		result[i][0] = poly[i].pos[0];
-		result[i][1] = poly[i].pos[1];
-		result[i][2] = poly[i].pos[2];
-		result[i][3] = poly[i].pos[3];
-	}
-
-	mtx_mult(frustum_mtx, result, segment);
-
-	/* Project poly in frustum */
-	mtx_multMtxVtx(frustum_mtx, num_vtx, poly2, poly);
-	if (mtx_faceVisibleVtx(poly)<0.0f) {
-		return;
-	}
+	if (!clip_or || (!(clip_or & CLIP_NEAR_FAR) && inside_guard_band(vtx, idx, num_vtx))) {
+		/* All inside, or only crossing screen sides, use already projected vertices */
+		for (i=0; i<num_vtx; i++) {
+			for (j=0; j<4; j++) {
+				poly[i].pos[j] = vtx->proj[j][idx[i]];
+			}
+		}
+		result = poly;
 
-	/* Draw polygon */
-	if (gouraud) {
-		draw.polyGouraud(&draw, poly, num_vtx);
+		if (clip_or) {
+			++num_poly_guard;
+		} else {
+			++num_poly_inside;
+		}
 	} else {
-		draw.polyFill(&draw, poly, num_vtx);
-	}
-}
+		++num_poly_clipped;
 
-static void quad_fill(vertex_t *v1, vertex_t *v2, vertex_t *v3, vertex_t *v4)
-{
-	float segment[4][4], result[4][4];
-	vertexf_t tri1[4], poly[16], poly2[16];
-	int clip_result, i, num_vtx;
-	Uint32 color;
-
-	color = get_color_from_texture(v1);
-	if (!gouraud) {
-		set_color(color);
-	}
-
-	tri1[0].pos[0] = v1->x;
-	tri1[0].pos[1] = v1->y;
-	tri1[0].pos[2] = v1->z;
-	tri1[0].pos[3] = 1.0f;
-	tri1[0].tx[0] = v1->u;
-	tri1[0].tx[1] = v1->v;
-	tri1[0].col[0] = (color>>16) & 0xff;
-	tri1[0].col[1] = (color>>8) & 0xff;
-	tri1[0].col[2] = color & 0xff;
-	tri1[0].col[3] = (color>>24) & 0xff;
-
-	if (gouraud) {
-		color = get_color_from_texture(v2);
-	}
-	tri1[1].pos[0] = v2->x;
-	tri1[1].pos[1] = v2->y;
-	tri1[1].pos[2] = v2->z;
-	tri1[1].pos[3] = 1.0f;
-	tri1[1].tx[0] = v2->u;
-	tri1[1].tx[1] = v2->v;
-	tri1[1].col[0] = (color>>16) & 0xff;
-	tri1[1].col[1] = (color>>8) & 0xff;
-	tri1[1].col[2] = color & 0xff;
-	tri1[1].col[3] = (color>>24) & 0xff;
+		for (i=0; i<num_vtx; i++) {
+			for (j=0; j<4; j++) {
+				poly[i].pos[j] = vtx->eye[j][idx[i]];
+			}
+		}
 
-	if (gouraud) {
-		color = get_color_from_texture(v3);
-	}
-	tri1[2].pos[0] = v3->x;
-	tri1[2].pos[1] = v3->y;
-	tri1[2].pos[2] = v3->z;
-	tri1[2].pos[3] = 1.0f;
-	tri1[2].tx[0] = v3->u;
-	tri1[2].tx[1] = v3->v;
-	tri1[2].col[0] = (color>>16) & 0xff;
-	tri1[2].col[1] = (color>>8) & 0xff;
-	tri1[2].col[2] = color & 0xff;
-	tri1[2].col[3] = (color>>24) & 0xff;
-
-	if (gouraud) {
-		color = get_color_from_texture(v4);
-	}
-	tri1[3].pos[0] = v4->x;
-	tri1[3].pos[1] = v4->y;
-	tri1[3].pos[2] = v4->z;
-	tri1[3].pos[3] = 1.0f;
-	tri1[3].tx[0] = v4->u;
-	tri1[3].tx[1] = v4->v;
-	tri1[3].col[0] = (color>>16) & 0xff;
-	tri1[3].col[1] = (color>>8) & 0xff;
-	tri1[3].col[2] = color & 0xff;
-	tri1[3].col[3] = (color>>24) & 0xff;
-
-	mtx_multMtxVtx(modelview_mtx[num_modelview_mtx], 4, tri1, poly);
-
-	num_vtx = 4;
-	clip_result = mtx_clipTriangle(poly, &num_vtx, poly2, clip_planes);
-	if (clip_result == CLIPPING_OUTSIDE) {
-		return;
-	}
+		if (mtx_clipTriangle(poly, &num_vtx, poly2, clip_planes) == CLIPPING_OUTSIDE) {
+			return;
+		}
 
-	/* Check face visible */
-	memset(result, 0, sizeof(float)*4*4);
-	for (i=0; i<3; i++) {
-		result[i][0] = poly[i].pos[0];
-		result[i][1] = poly[i].pos[1];
-		result[i][2] = poly[i].pos[2];
-		result[i][3] = poly[i].pos[3];
+		/* Project poly in frustum */
+		transform_vtx(frustum_mtx, num_vtx, poly2, poly3);
+		result = poly3;
 	}
 
-	mtx_mult(frustum_mtx, result, segment);
-
-	/* Project poly in frustum */
-	mtx_multMtxVtx(frustum_mtx, num_vtx, poly2, poly);
-	if (mtx_faceVisibleVtx(poly)<0.0f) {
+	if (mtx_faceVisibleVtx(result)<0.0f) {
 		return;
 	}
 
 	/* Draw polygon */
-	if (gouraud) {
-		draw.polyGouraud(&draw, poly, num_vtx);
-	} else {
-		draw.polyFill(&draw, poly, num_vtx);
+	switch(render_mode) {
+		case RENDER_WIREFRAME:
+			draw.polyLine(&draw, result, num_vtx);
+			break;
+		case RENDER_FILLED:
+			draw.polyFill(&draw, result, num_vtx);
+			break;
+		case RENDER_GOURAUD:
+			draw.polyGouraud(&draw, result, num_vtx);
+			break;
+		case RENDER_TEXTURED:
+			draw.polyTexture(&draw, result, num_vtx);
+			break;
 	}
 }
 
-/*
-	Textured triangles/quads
-*/
-
-static void triangle_tex(vertex_t *v1, vertex_t *v2, vertex_t *v3)
+/* Check if projected vertices of a poly in front of camera stay in guard band */
+static int inside_guard_band(render_soft_vtx_t *vtx, int *idx, int num_vtx)
 {
-	float segment[4][4], result[4][4];
-	vertexf_t tri1[3], poly[16], poly2[16];
-	int clip_result, i, num_vtx;
+	int i;
 
-	tri1[0].pos[0] = v1->x;
-	tri1[0].pos[1] = v1->y;
-	tri1[0].pos[2] = v1->z;
-	tri1[0].pos[3] = 1.0f;
-	tri1[0].tx[0] = v1->u;
-	tri1[0].tx[1] = v1->v;
-
-	tri1[1].pos[0] = v2->x;
-	tri1[1].pos[1] = v2->y;
-	tri1[1].pos[2] = v2->z;
-	tri1[1].pos[3] = 1.0f;
-	tri1[1].tx[0] = v2->u;
-	tri1[1].tx[1] = v2->v;
-
-	tri1[2].pos[0] = v3->x;
-	tri1[2].pos[1] = v3->y;
-	tri1[2].pos[2] = v3->z;
-	tri1[2].pos[3] = 1.0f;
-	tri1[2].tx[0] = v3->u;
-	tri1[2].tx[1] = v3->v;
-
-	mtx_multMtxVtx(modelview_mtx[num_modelview_mtx], 3, tri1, poly);
-
-	num_vtx = 3;
-	clip_result = mtx_clipTriangle(poly, &num_vtx, poly2, clip_planes);
-	if (clip_result == CLIPPING_OUTSIDE) {
-		return;
-	}
-
-	/* Check face visible */
-	memset(result, 0, sizeof(float)*4*4);
-	for (i=0; i<3; i++) {
-		result[i][0] = poly[i].pos[0];
-		result[i][1] = poly[i].pos[1];
-		result[i][2] = poly[i].pos[2];
-		result[i][3] = poly[i].pos[3];
-	}
-
-	mtx_mult(frustum_mtx, result, segment);
+	for (i=0; i<num_vtx; i++) {
+		float x = vtx->proj[0][idx[i]];
+		float y = vtx->proj[1][idx[i]];
+		float w = vtx->proj[3][idx[i]];
 
-	/* Project poly in frustum */
-	mtx_multMtxVtx(frustum_mtx, num_vtx, poly2, poly);
-	if (mtx_faceVisibleVtx(poly)<0.0f) {
-		return;
+		if (w <= 0.0f) {
+			return 0;
+		}
+		if ((x < guard_band[0]*w) || (x > guard_band[1]*w)
+		    || (y < guard_band[2]*w) || (y > guard_band[3]*w))
+		{
+			return 0;
+		}
 	}
 
-	/* Draw polygon */
-	draw.polyTexture(&draw, poly, num_vtx);
+	return 1;
 }
 
-static void quad_tex(vertex_t *v1, vertex_t *v2, vertex_t *v3, vertex_t *v4)
+/* Transform vertices by a matrix, counting them */
+static void transform_vtx(float m[4][4], int num_vtx, vertexf_t *vtx, vertexf_t *result)
 {
-	float segment[4][4], result[4][4];
-	vertexf_t tri1[4], poly[16], poly2[16];
-	int clip_result, i, num_vtx;
+	mtx_multMtxVtx(m, num_vtx, vtx, result);
 
-	tri1[0].pos[0] = v1->x;
-	tri1[0].pos[1] = v1->y;
-	tri1[0].pos[2] = v1->z;
-	tri1[0].pos[3] = 1.0f;
-	tri1[0].tx[0] = v1->u;
-	tri1[0].tx[1] = v1->v;
-
-	tri1[1].pos[0] = v2->x;
-	tri1[1].pos[1] = v2->y;
-	tri1[1].pos[2] = v2->z;
-	tri1[1].pos[3] = 1.0f;
-	tri1[1].tx[0] = v2->u;
-	tri1[1].tx[1] = v2->v;
-
-	tri1[2].pos[0] = v3->x;
-	tri1[2].pos[1] = v3->y;
-	tri1[2].pos[2] = v3->z;
-	tri1[2].pos[3] = 1.0f;
-	tri1[2].tx[0] = v3->u;
-	tri1[2].tx[1] = v3->v;
-
-	tri1[3].pos[0] = v4->x;
-	tri1[3].pos[1] = v4->y;
-	tri1[3].pos[2] = v4->z;
-	tri1[3].pos[3] = 1.0f;
-	tri1[3].tx[0] = v4->u;
-	tri1[3].tx[1] = v4->v;
-
-	mtx_multMtxVtx(modelview_mtx[num_modelview_mtx], 4, tri1, poly);
+	num_vtx_transformed += num_vtx;
+}
 
-	num_vtx = 4;
-	clip_result = mtx_clipTriangle(poly, &num_vtx, poly2, clip_planes);
-	if (clip_result == CLIPPING_OUTSIDE) {
-		return;
-	}
+/*
+	Transform vertex array in eye space, check it against view frustum,
+	and project it. pos is model space x,y,z,w arrays.
+*/
 
-	/* Check face visible */
-	memset(result, 0, sizeof(float)*4*4);
-	for (i=0; i<3; i++) {
-		result[i][0] = poly[i].pos[0];
-		result[i][1] = poly[i].pos[1];
-		result[i][2] = poly[i].pos[2];
-		result[i][3] = poly[i].pos[3];
-	}
+void render_soft_transform(int num_vtx, float *pos[4], render_soft_vtx_t *vtx)
+{
+	mtx_multMtxSoA(modelview_mtx[num_modelview_mtx], num_vtx, pos, vtx->eye);
+	mtx_clipCodesSoA(clip_planes, num_vtx, vtx->eye, vtx->clip);
+	mtx_multMtxSoA(frustum_mtx, num_vtx, vtx->eye, vtx->proj);
 
-	mtx_mult(frustum_mtx, result, segment);
+	num_vtx_transformed += num_vtx<<1;
+}
 
-	/* Project poly in frustum */
-	mtx_multMtxVtx(frustum_mtx, num_vtx, poly2, poly);
-	if (mtx_faceVisibleVtx(poly)<0.0f) {
-		return;
-	}
+/*
+	Draw polygon from vertices transformed by render_soft_transform(),
+	idx being their indexes. poly holds texture coords of each vertex.
+*/
 
-	/* Draw polygon */
-	draw.polyTexture(&draw, poly, num_vtx);
+void render_soft_poly(render_soft_vtx_t *vtx, int *idx, vertexf_t *poly, int num_vtx)
+{
+	draw_poly(vtx, idx, poly, num_vtx, render.render_mode);
 }
 
 /*
@@ -1053,6 +850,6 @@ void project_point(vertex_t *v1, vertexf_t *poly)
 	tri1.pos[2] = v1->z;
 	tri1.pos[3] = 1.0f;
 
-	mtx_multMtxVtx(modelview_mtx[num_modelview_mtx], 1, &tri1, poly2);
-	mtx_multMtxVtx(frustum_mtx, 1, poly2, poly);
+	transform_vtx(modelview_mtx[num_modelview_mtx], 1, &tri1, poly2);
+	transform_vtx(frustum_mtx, 1, poly2, poly);
 }
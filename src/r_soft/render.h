@@ -27,10 +27,25 @@ struct render_s;
 struct vertex_s;
 struct vertexf_s;
 
+/*--- Types ---*/
+
+/* Transformed vertices, as x,y,z,w arrays */
+typedef struct {
+	float *eye[4];		/* Eye space */
+	float *proj[4];		/* Projected */
+	Uint8 *clip;		/* View frustum planes each vertex is outside of */
+} render_soft_vtx_t;
+
 /*--- Functions ---*/
 
 void render_soft_init(struct render_s *this);
 
 void project_point(struct vertex_s *v1, struct vertexf_s *poly);
 
+/* Transform vertex array in eye space, and project it */
+void render_soft_transform(int num_vtx, float *pos[4], render_soft_vtx_t *vtx);
+
+/* Draw triangle/quad from vertices given by render_soft_transform() */
+void render_soft_poly(render_soft_vtx_t *vtx, int *idx, struct vertexf_s *poly, int num_vtx);
+
 #endif /* RENDER_SOFT_H */
@@ -348,7 +348,7 @@ static void bitmapScaledScDirty(SDL_Rect *src_rect, SDL_Rect *dst_rect)
 
 			blt_src_rect.w = blt_dst_rect.w = num_cols;
 
-			if (dirty_rects[video.numfb]->markers[dy*dirty_rects[video.numfb]->width + dx] == 0) {
+			if (!DIRTY_RECTS_ISDIRTY(dirty_rects[video.numfb], dx, dy)) {
 				continue;
 			}
 
@@ -386,7 +386,7 @@ static void bitmapScaledRtDirty(SDL_Rect *src_rect, SDL_Rect *dst_rect)
 
 			blt_src_rect.w = blt_dst_rect.w = num_cols;
 
-			if (dirty_rects[video.numfb]->markers[dy*dirty_rects[video.numfb]->width + dx] == 0) {
+			if (!DIRTY_RECTS_ISDIRTY(dirty_rects[video.numfb], dx, dy)) {
 				continue;
 			}
 
@@ -553,8 +553,8 @@ static void refresh_scaled_version(render_texture_t *texture, int new_w, int new
 		rescale_nearest(texture, texture->scaled);
 	}
 
-	/* Dither if needed */
-	if (video.bpp == 8) {
+	/* Dither if needed, 8 bits textures keep their own palette */
+	if ((video.bpp == 8) && (texture->bpp > 1)) {
 		SDL_Surface *dithered_surf = SDL_CreateRGBSurface(REEVENGI_SDLSURF_FLAGS,
 			texture->scaled->w,texture->scaled->h,8, 0,0,0,0);
 		if (!dithered_surf) {
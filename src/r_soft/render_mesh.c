@@ -31,10 +31,22 @@
 #include "../r_common/render_mesh.h"
 #include "../r_common/render_texture.h"
 
+#include "render.h"
 #include "render_mesh.h"
 
+/*--- Variables ---*/
+
+static int size_vtx_cache = 0;
+static float *vtx_buffer = NULL;	/* Model, eye space and projected x,y,z,w arrays */
+static Uint8 *vtx_clip = NULL;
+static float *vtx_pos[4];
+static render_soft_vtx_t vtx_cache;
+
 /*--- Functions prototypes ---*/
 
+static int transform_vertices(render_mesh_t *this);
+static void set_texcoord(render_mesh_t *this, vertexf_t *poly, int tx_idx);
+
 static void draw(render_mesh_t *this);
 
 /*--- Functions ---*/
@@ -56,125 +68,149 @@ render_mesh_t *render_mesh_soft_create(render_texture_t *texture)
 	return mesh;
 }
 
-static void draw(render_mesh_t *this)
+/* Transformed vertices are shared by all meshes */
+void render_mesh_soft_shutdown(void)
 {
-	int i, j, prevpal=-1;
-	vertex_t v[4];
+	if (vtx_buffer) {
+		free(vtx_buffer);
+		vtx_buffer = NULL;
+	}
+	if (vtx_clip) {
+		free(vtx_clip);
+		vtx_clip = NULL;
+	}
+	size_vtx_cache = 0;
+}
 
-	for (i=0; i<this->num_tris; i++) {
-		render_mesh_tri_t *tri = &(this->triangles[i]);
+/* Transform and project whole vertex array of mesh */
+static int transform_vertices(render_mesh_t *this)
+{
+	int i, num_vtx = this->vertex.items;
+
+	if (num_vtx>size_vtx_cache) {
+		vtx_buffer = realloc(vtx_buffer, 12 * num_vtx * sizeof(float));
+		vtx_clip = realloc(vtx_clip, num_vtx * sizeof(Uint8));
+		size_vtx_cache = num_vtx;
+	}
+
+	if (!vtx_buffer || !vtx_clip) {
+		fprintf(stderr, "Not enough memory for mesh vertices\n");
+		render_mesh_soft_shutdown();
+		return 0;
+	}
 
-		if (this->vertex.data) {
-			switch(this->vertex.type) {
-				case RENDER_ARRAY_BYTE:
-					{
-						Uint8 *src = (Uint8 *) this->vertex.data;
-						for (j=0; j<3; j++) {
-							v[j].x = src[(tri->v[j]*this->vertex.stride)+0];
-							v[j].y = src[(tri->v[j]*this->vertex.stride)+1];
-							v[j].z = src[(tri->v[j]*this->vertex.stride)+2];
-						}
-					}
-					break;
-				case RENDER_ARRAY_SHORT:
-					{
-						Sint16 *src = (Sint16 *) this->vertex.data;
-						for (j=0; j<3; j++) {
-							v[j].x = src[(tri->v[j]*(this->vertex.stride>>1))+0];
-							v[j].y = src[(tri->v[j]*(this->vertex.stride>>1))+1];
-							v[j].z = src[(tri->v[j]*(this->vertex.stride>>1))+2];
-						}
-					}
-					break;
+	for (i=0; i<4; i++) {
+		vtx_pos[i] = &vtx_buffer[i * size_vtx_cache];
+		vtx_cache.eye[i] = &vtx_buffer[(i+4) * size_vtx_cache];
+		vtx_cache.proj[i] = &vtx_buffer[(i+8) * size_vtx_cache];
+	}
+	vtx_cache.clip = vtx_clip;
+
+	switch(this->vertex.type) {
+		case RENDER_ARRAY_BYTE:
+			{
+				Uint8 *src = (Uint8 *) this->vertex.data;
+				for (i=0; i<num_vtx; i++) {
+					vtx_pos[0][i] = src[0];
+					vtx_pos[1][i] = src[1];
+					vtx_pos[2][i] = src[2];
+					vtx_pos[3][i] = 1.0f;
+					src += this->vertex.stride;
+				}
 			}
-		}
+			break;
+		case RENDER_ARRAY_SHORT:
+			{
+				Sint16 *src = (Sint16 *) this->vertex.data;
+				for (i=0; i<num_vtx; i++) {
+					vtx_pos[0][i] = src[0];
+					vtx_pos[1][i] = src[1];
+					vtx_pos[2][i] = src[2];
+					vtx_pos[3][i] = 1.0f;
+					src += this->vertex.stride>>1;
+				}
+			}
+			break;
+	}
+
+	render_soft_transform(num_vtx, vtx_pos, &vtx_cache);
+
+	return 1;
+}
+
+static void set_texcoord(render_mesh_t *this, vertexf_t *poly, int tx_idx)
+{
+	poly->tx[0] = poly->tx[1] = 0.0f;
+
+	if (!this->texcoord.data) {
+		return;
+	}
 
-		if (this->texcoord.data) {
-			switch(this->texcoord.type) {
-				case RENDER_ARRAY_BYTE:
-					{
-						Uint8 *src = (Uint8 *) this->texcoord.data;
-						for (j=0; j<3; j++) {
-							v[j].u = src[(tri->tx[j]*this->texcoord.stride)+0];
-							v[j].v = src[(tri->tx[j]*this->texcoord.stride)+1];
-						}
-					}
-					break;
-				case RENDER_ARRAY_SHORT:
-					{
-						Sint16 *src = (Sint16 *) this->texcoord.data;
-						for (j=0; j<3; j++) {
-							v[j].u = src[(tri->tx[j]*(this->texcoord.stride>>1))+0];
-							v[j].v = src[(tri->tx[j]*(this->texcoord.stride>>1))+1];
-						}
-					}
-					break;
+	switch(this->texcoord.type) {
+		case RENDER_ARRAY_BYTE:
+			{
+				Uint8 *src = (Uint8 *) this->texcoord.data;
+				poly->tx[0] = src[(tx_idx*this->texcoord.stride)+0];
+				poly->tx[1] = src[(tx_idx*this->texcoord.stride)+1];
 			}
+			break;
+		case RENDER_ARRAY_SHORT:
+			{
+				Sint16 *src = (Sint16 *) this->texcoord.data;
+				poly->tx[0] = (Uint16) src[(tx_idx*(this->texcoord.stride>>1))+0];
+				poly->tx[1] = (Uint16) src[(tx_idx*(this->texcoord.stride>>1))+1];
+			}
+			break;
+	}
+}
+
+static void draw(render_mesh_t *this)
+{
+	int i, j, prevpal=-1, idx[4];
+	vertexf_t poly[4];
+
+	if (!this->vertex.data) {
+		return;
+	}
+
+	/* Vertices are shared between faces, transform them only once */
+	if (!transform_vertices(this)) {
+		return;
+	}
+
+	for (i=0; i<this->num_tris; i++) {
+		render_mesh_tri_t *tri = &(this->triangles[i]);
+
+		for (j=0; j<3; j++) {
+			idx[j] = tri->v[j];
+			set_texcoord(this, &poly[j], tri->tx[j]);
 		}
 
 		if (tri->txpal != prevpal) {
 			render.set_texture(tri->txpal, this->texture);
 			prevpal = tri->txpal;
 		}
-		render.triangle(&v[0], &v[1], &v[2]);
+		render_soft_poly(&vtx_cache, idx, poly, 3);
 	}
 	/*return;*/
 
 	for (i=0; i<this->num_quads; i++) {
 		render_mesh_quad_t *quad = &(this->quads[i]);
 
-		if (this->vertex.data) {
-			switch(this->vertex.type) {
-				case RENDER_ARRAY_BYTE:
-					{
-						Uint8 *src = (Uint8 *) this->vertex.data;
-						for (j=0; j<4; j++) {
-							v[j].x = src[(quad->v[j]*this->vertex.stride)+0];
-							v[j].y = src[(quad->v[j]*this->vertex.stride)+1];
-							v[j].z = src[(quad->v[j]*this->vertex.stride)+2];
-						}
-					}
-					break;
-				case RENDER_ARRAY_SHORT:
-					{
-						Sint16 *src = (Sint16 *) this->vertex.data;
-						for (j=0; j<4; j++) {
-							v[j].x = src[(quad->v[j]*(this->vertex.stride>>1))+0];
-							v[j].y = src[(quad->v[j]*(this->vertex.stride>>1))+1];
-							v[j].z = src[(quad->v[j]*(this->vertex.stride>>1))+2];
-						}
-					}
-					break;
-			}
-		}
-
-		if (this->texcoord.data) {
-			switch(this->texcoord.type) {
-				case RENDER_ARRAY_BYTE:
-					{
-						Uint8 *src = (Uint8 *) this->texcoord.data;
-						for (j=0; j<4; j++) {
-							v[j].u = src[(quad->tx[j]*this->texcoord.stride)+0];
-							v[j].v = src[(quad->tx[j]*this->texcoord.stride)+1];
-						}
-					}
-					break;
-				case RENDER_ARRAY_SHORT:
-					{
-						Sint16 *src = (Sint16 *) this->texcoord.data;
-						for (j=0; j<4; j++) {
-							v[j].u = src[(quad->tx[j]*(this->texcoord.stride>>1))+0];
-							v[j].v = src[(quad->tx[j]*(this->texcoord.stride>>1))+1];
-						}
-					}
-					break;
-			}
-		}
+		/* Vertices 2,3 swapped to draw quad as polygon */
+		idx[0] = quad->v[0];
+		idx[1] = quad->v[1];
+		idx[2] = quad->v[3];
+		idx[3] = quad->v[2];
+		set_texcoord(this, &poly[0], quad->tx[0]);
+		set_texcoord(this, &poly[1], quad->tx[1]);
+		set_texcoord(this, &poly[2], quad->tx[3]);
+		set_texcoord(this, &poly[3], quad->tx[2]);
 
 		if (quad->txpal != prevpal) {
 			render.set_texture(quad->txpal, this->texture);
 			prevpal = quad->txpal;
 		}
-		render.quad(&v[0], &v[1], &v[3], &v[2]);
+		render_soft_poly(&vtx_cache, idx, poly, 4);
 	}
 }
@@ -31,4 +31,7 @@ struct render_mesh_s;
 /* Create a mesh */
 struct render_mesh_s *render_mesh_soft_create(struct render_texture_s *texture);
 
+/* Free memory used to transform meshes */
+void render_mesh_soft_shutdown(void);
+
 #endif /* RENDER_MESH_SOFT_H */
@@ -0,0 +1,40 @@
+/*#define CONCAT3(x,y,z)	x ## y ## z
+#define FNDEF3(name,bpp,perscorr)	CONCAT3(name,bpp,perscorr)
+
+#define BPP 32
+#define PIXEL_TYPE	Uint32
+#define WRITE_PIXEL_GONEXT(output, color)
+		*output++ = color;
+#define PIXEL_FROM_RGB(color, r,g,b) \
+	color = SDL_MapRGB(surf->format, r,g,b);
+#define SIMD_STORE4(dst, pixels) \
+	_mm_storeu_si128((__m128i *) (dst), pixels);
+*/
+
+void FNDEF3(draw_render_fill, BPP, sse2) (SDL_Surface *surf, Uint8 *dst_line, sbuffer_segment_t *segment, int x1,int x2)
+{
+	PIXEL_TYPE *dst_col = (PIXEL_TYPE *) dst_line;
+	__m128i color4;
+	int i;
+
+	r = segment->start.r;
+	g = segment->start.g;
+	b = segment->start.b;
+	if (draw.correctPerspective>0) {
+		r /= segment->start.w;
+		g /= segment->start.w;
+		b /= segment->start.w;
+	}
+
+	PIXEL_FROM_RGB(color, r,g,b)
+
+	color4 = _mm_set1_epi32(color);
+	for (i=x1; x2-i>=3; i+=4) {
+		SIMD_STORE4(dst_col, color4)
+		dst_col += 4;
+	}
+
+	for ( ; i<=x2; i++) {
+		WRITE_PIXEL_GONEXT(dst_col, color)
+	}
+}
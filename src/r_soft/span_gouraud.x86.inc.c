@@ -0,0 +1,186 @@
+/*#define CONCAT3(x,y,z)	x ## y ## z
+#define FNDEF3(name,bpp,perscorr)	CONCAT3(name,bpp,perscorr)
+#define CONCAT4(x,y,z,w)	x ## y ## z ## w
+#define FNDEF4(name,bpp,perscorr,alphatest)	CONCAT4(name,bpp,perscorr,alphatest)
+
+#define BPP 32
+#define PIXEL_TYPE	Uint32
+#define WRITE_PIXEL_GONEXT(output, color)
+		*output++ = color;
+#define PIXEL_FROM_RGB(color, r,g,b) \
+	color = SDL_MapRGB(surf->format, r,g,b);
+#define SIMD_STORE4(dst, pixels) \
+	_mm_storeu_si128((__m128i *) (dst), pixels);
+*/
+
+/* Draw span from r,g,b,dr,dg,db */
+static void FNDEF3(span_simd_gouraud, BPP, _run) (SDL_Surface *surf, PIXEL_TYPE *dst_col, int x1,int x2)
+{
+	span_simd_fmt_t sf;
+	int i;
+
+	span_simd_fmt_init(&sf, surf->format);
+
+	for (i=x1; x2-i>=3; i+=4) {
+		float r_1 = r+dr, r_2 = r_1+dr, r_3 = r_2+dr;
+		float g_1 = g+dg, g_2 = g_1+dg, g_3 = g_2+dg;
+		float b_1 = b+db, b_2 = b_1+db, b_3 = b_2+db;
+
+		SIMD_STORE4(dst_col, span_simd_maprgb(&sf,
+			_mm_setr_ps(r, r_1, r_2, r_3),
+			_mm_setr_ps(g, g_1, g_2, g_3),
+			_mm_setr_ps(b, b_1, b_2, b_3)))
+		dst_col += 4;
+
+		r = r_3+dr;
+		g = g_3+dg;
+		b = b_3+db;
+	}
+
+	for ( ; i<=x2; i++) {
+		PIXEL_FROM_RGB(color, r,g,b)
+		WRITE_PIXEL_GONEXT(dst_col, color)
+
+		r += dr;
+		g += dg;
+		b += db;
+	}
+}
+
+void FNDEF4(draw_render_gouraud, BPP, _pc0, sse2) (SDL_Surface *surf, Uint8 *dst_line, sbuffer_segment_t *segment, int x1,int x2)
+{
+	int dxtotal, dx;
+
+	if (surf->format->palette) {
+		FNDEF3(draw_render_gouraud, BPP, _pc0)(surf, dst_line, segment, x1, x2);
+		return;
+	}
+
+	dxtotal = segment->end.x - segment->start.x + 1;
+	dx = x1-segment->start.x;
+
+	r1 = segment->start.r;
+	g1 = segment->start.g;
+	b1 = segment->start.b;
+	r2 = segment->end.r;
+	g2 = segment->end.g;
+	b2 = segment->end.b;
+
+	dr = (r2-r1)/dxtotal;
+	dg = (g2-g1)/dxtotal;
+	db = (b2-b1)/dxtotal;
+
+	r = r1 + dr * dx;
+	g = g1 + dg * dx;
+	b = b1 + db * dx;
+
+	FNDEF3(span_simd_gouraud, BPP, _run)(surf, (PIXEL_TYPE *) dst_line, x1, x2);
+}
+
+void FNDEF4(draw_render_gouraud, BPP, _pc1, sse2) (SDL_Surface *surf, Uint8 *dst_line, sbuffer_segment_t *segment, int x1,int x2)
+{
+	float invw;
+	int dxtotal, dx;
+
+	if (surf->format->palette) {
+		FNDEF3(draw_render_gouraud, BPP, _pc1)(surf, dst_line, segment, x1, x2);
+		return;
+	}
+
+	dxtotal = segment->end.x - segment->start.x + 1;
+	dx = x1-segment->start.x;
+
+	invw = 1.0f / segment->start.w;
+	r1 = segment->start.r * invw;
+	g1 = segment->start.g * invw;
+	b1 = segment->start.b * invw;
+	invw = 1.0f / segment->end.w;
+	r2 = segment->end.r * invw;
+	g2 = segment->end.g * invw;
+	b2 = segment->end.b * invw;
+
+	dr = (r2-r1)/dxtotal;
+	dg = (g2-g1)/dxtotal;
+	db = (b2-b1)/dxtotal;
+
+	r = r1 + dr * dx;
+	g = g1 + dg * dx;
+	b = b1 + db * dx;
+
+	FNDEF3(span_simd_gouraud, BPP, _run)(surf, (PIXEL_TYPE *) dst_line, x1, x2);
+}
+
+void FNDEF4(draw_render_gouraud, BPP, _pc3, sse2) (SDL_Surface *surf, Uint8 *dst_line, sbuffer_segment_t *segment, int x1,int x2)
+{
+	span_simd_fmt_t sf;
+	int dxtotal, dx, i;
+	PIXEL_TYPE *dst_col = (PIXEL_TYPE *) dst_line;
+
+	if (surf->format->palette) {
+		FNDEF3(draw_render_gouraud, BPP, _pc3)(surf, dst_line, segment, x1, x2);
+		return;
+	}
+
+	span_simd_fmt_init(&sf, surf->format);
+
+	dxtotal = segment->end.x - segment->start.x + 1;
+	dx = x1-segment->start.x;
+
+	r1 = segment->start.r;
+	g1 = segment->start.g;
+	b1 = segment->start.b;
+	w1 = segment->start.w;
+	r2 = segment->end.r;
+	g2 = segment->end.g;
+	b2 = segment->end.b;
+	w2 = segment->end.w;
+
+	dr = (r2-r1)/dxtotal;
+	dg = (g2-g1)/dxtotal;
+	db = (b2-b1)/dxtotal;
+	dw = (w2-w1)/dxtotal;
+
+	r = r1 + dr * dx;
+	g = g1 + dg * dx;
+	b = b1 + db * dx;
+	w = w1 + dw * dx;
+
+	for (i=x1; x2-i>=3; i+=4) {
+		float r_1 = r+dr, r_2 = r_1+dr, r_3 = r_2+dr;
+		float g_1 = g+dg, g_2 = g_1+dg, g_3 = g_2+dg;
+		float b_1 = b+db, b_2 = b_1+db, b_3 = b_2+db;
+		float w_1 = w+dw, w_2 = w_1+dw, w_3 = w_2+dw;
+		__m128 invw;
+
+		invw = _mm_div_ps(_mm_set1_ps(1.0f), _mm_setr_ps(w, w_1, w_2, w_3));
+
+		SIMD_STORE4(dst_col, span_simd_maprgb(&sf,
+			_mm_mul_ps(_mm_setr_ps(r, r_1, r_2, r_3), invw),
+			_mm_mul_ps(_mm_setr_ps(g, g_1, g_2, g_3), invw),
+			_mm_mul_ps(_mm_setr_ps(b, b_1, b_2, b_3), invw)))
+		dst_col += 4;
+
+		r = r_3+dr;
+		g = g_3+dg;
+		b = b_3+db;
+		w = w_3+dw;
+	}
+
+	for ( ; i<=x2; i++) {
+		int rr,gg,bb;
+		float invw;
+
+		invw = 1.0f / w;
+		rr = r * invw;
+		gg = g * invw;
+		bb = b * invw;
+
+		PIXEL_FROM_RGB(color, rr,gg,bb)
+		WRITE_PIXEL_GONEXT(dst_col, color)
+
+		r += dr;
+		g += dg;
+		b += db;
+		w += dw;
+	}
+}
@@ -0,0 +1,217 @@
+/*#define BPP 32
+#define PIXEL_TYPE	Uint32
+#define TEXTURE_PIXEL_TYPE	Uint32
+#define SIMD_LOAD4(src) \
+	_mm_loadu_si128((__m128i *) (src))
+#define SIMD_STORE4(dst, pixels) \
+	_mm_storeu_si128((__m128i *) (dst), pixels);
+#define WRITE_ALPHATESTED_PIXEL	(trans version)
+
+	Helpers for x86-64 SSE2 span renderers. They must give the
+	same result as the C ones, so all float interpolations are still
+	done serially, only conversions, texel addressing and pixel writes
+	are done on vectors.
+*/
+
+/*--- Types ---*/
+
+typedef struct {
+	int paletted;
+	Uint32 *palette;
+	Uint8 *alpha_pal;
+	Uint8 *pixels8;
+	TEXTURE_PIXEL_TYPE *pixels;
+	Uint32 ubits, umask, vmask;
+	__m128i umask4, vmask4, vshift;
+} span_simd_tex_t;
+
+typedef struct {
+	__m128i rloss, gloss, bloss;
+	__m128i rshift, gshift, bshift;
+	__m128i amask;
+} span_simd_fmt_t;
+
+/*--- Functions ---*/
+
+static void span_simd_tex_init(span_simd_tex_t *st, sbuffer_segment_t *segment)
+{
+	render_texture_t *tex = segment->texture;
+	Uint32 vbits;
+
+	st->paletted = tex->paletted;
+	st->palette = tex->palettes[segment->tex_num_pal];
+	st->alpha_pal = tex->alpha_palettes[segment->tex_num_pal];
+	st->pixels8 = (Uint8 *) tex->pixels;
+	st->pixels = (TEXTURE_PIXEL_TYPE *) tex->pixels;
+
+	st->ubits = logbase2(tex->pitchw);
+	st->umask = (1<<st->ubits)-1;
+	vbits = logbase2(tex->pitchh);
+	st->vmask = (1<<vbits)-1;
+	st->vmask <<= st->ubits;
+
+	st->umask4 = _mm_set1_epi32(st->umask);
+	st->vmask4 = _mm_set1_epi32(st->vmask);
+	st->vshift = _mm_cvtsi32_si128(16-st->ubits);
+}
+
+static void span_simd_fmt_init(span_simd_fmt_t *sf, const SDL_PixelFormat *format)
+{
+	sf->rloss = _mm_cvtsi32_si128(format->Rloss);
+	sf->gloss = _mm_cvtsi32_si128(format->Gloss);
+	sf->bloss = _mm_cvtsi32_si128(format->Bloss);
+	sf->rshift = _mm_cvtsi32_si128(format->Rshift);
+	sf->gshift = _mm_cvtsi32_si128(format->Gshift);
+	sf->bshift = _mm_cvtsi32_si128(format->Bshift);
+	sf->amask = _mm_set1_epi32(format->Amask);
+}
+
+/* Same as SDL_MapRGB() for non paletted formats, from truncated floats */
+static inline __m128i span_simd_maprgb(const span_simd_fmt_t *sf, __m128 r, __m128 g, __m128 b)
+{
+	const __m128i mask = _mm_set1_epi32(0xff);
+	__m128i ri, gi, bi;
+
+	ri = _mm_and_si128(_mm_cvttps_epi32(r), mask);
+	gi = _mm_and_si128(_mm_cvttps_epi32(g), mask);
+	bi = _mm_and_si128(_mm_cvttps_epi32(b), mask);
+
+	ri = _mm_sll_epi32(_mm_srl_epi32(ri, sf->rloss), sf->rshift);
+	gi = _mm_sll_epi32(_mm_srl_epi32(gi, sf->gloss), sf->gshift);
+	bi = _mm_sll_epi32(_mm_srl_epi32(bi, sf->bloss), sf->bshift);
+
+	return _mm_or_si128(_mm_or_si128(ri, gi), _mm_or_si128(bi, sf->amask));
+}
+
+/* Texel offsets in texture for 4 fixed point u,v coords */
+static inline __m128i span_simd_texidx(const span_simd_tex_t *st, __m128i ui, __m128i vi)
+{
+	__m128i pu, pv;
+
+	pu = _mm_and_si128(_mm_srli_epi32(ui, 16), st->umask4);	/* 0000---X */
+	pv = _mm_and_si128(_mm_srl_epi32(vi, st->vshift), st->vmask4);	/* 000YYYY- */
+
+	return _mm_or_si128(pu, pv);
+}
+
+/* Read 4 texels, write them if visible */
+static inline void span_simd_put4(const span_simd_tex_t *st, PIXEL_TYPE *dst_col, __m128i texidx)
+{
+	Uint32 idx[4];
+	__m128i pixels;
+
+	_mm_storeu_si128((__m128i *) idx, texidx);
+
+	if (st->paletted) {
+		Uint8 c0 = st->pixels8[idx[0]];
+		Uint8 c1 = st->pixels8[idx[1]];
+		Uint8 c2 = st->pixels8[idx[2]];
+		Uint8 c3 = st->pixels8[idx[3]];
+		__m128i visible;
+
+		visible = _mm_set_epi32(st->alpha_pal[c3], st->alpha_pal[c2],
+			st->alpha_pal[c1], st->alpha_pal[c0]);
+		visible = _mm_cmpeq_epi32(visible, _mm_setzero_si128());
+
+		pixels = _mm_set_epi32(st->palette[c3], st->palette[c2],
+			st->palette[c1], st->palette[c0]);
+		pixels = _mm_or_si128(_mm_andnot_si128(visible, pixels),
+			_mm_and_si128(visible, SIMD_LOAD4(dst_col)));
+	} else {
+		pixels = _mm_set_epi32(st->pixels[idx[3]], st->pixels[idx[2]],
+			st->pixels[idx[1]], st->pixels[idx[0]]);
+	}
+
+	SIMD_STORE4(dst_col, pixels)
+}
+
+/* Remaining pixels of a span, as the C renderer does */
+static void span_simd_run_tail(PIXEL_TYPE *dst_col, int count,
+	Uint32 ui, Uint32 vi, Uint32 dui, Uint32 dvi, const span_simd_tex_t *st)
+{
+	Uint32 ubits = st->ubits, umask = st->umask, vmask = st->vmask;
+	int i;
+
+	if (st->paletted) {
+		Uint32 *palette = st->palette;
+		Uint8 *alpha_pal = st->alpha_pal;
+		Uint8 *tex_pixels = st->pixels8;
+
+		for (i=0; i<count; i++) {
+			Uint32 pu,pv;
+
+			pu = ui>>16;		/* 0000XXXX */
+			pu &= umask;		/* 0000---X */
+			pv = vi>>(16-ubits);	/* 000YYYYy */
+			pv &= vmask;		/* 000YYYY- */
+
+			WRITE_ALPHATESTED_PIXEL
+
+			ui += dui;
+			vi += dvi;
+		}
+	} else {
+		TEXTURE_PIXEL_TYPE *tex_pixels = st->pixels;
+
+		for (i=0; i<count; i++) {
+			Uint32 pu,pv;
+
+			pu = ui>>16;		/* 0000XXXX */
+			pu &= umask;		/* 0000---X */
+			pv = vi>>(16-ubits);	/* 000YYYYy */
+			pv &= vmask;		/* 000YYYY- */
+
+			color = tex_pixels[pv|pu];
+			WRITE_PIXEL_GONEXT(dst_col, color)
+
+			ui += dui;
+			vi += dvi;
+		}
+	}
+}
+
+/* 16 pixels with fixed point u,v stepping */
+static inline void span_simd_run16_sse2(PIXEL_TYPE *dst_col,
+	Uint32 ui, Uint32 vi, Uint32 dui, Uint32 dvi, const span_simd_tex_t *st)
+{
+	__m128i ui4, vi4, dui4, dvi4;
+	int i;
+
+	ui4 = _mm_add_epi32(_mm_set1_epi32(ui), _mm_set_epi32(dui*3, dui*2, dui, 0));
+	vi4 = _mm_add_epi32(_mm_set1_epi32(vi), _mm_set_epi32(dvi*3, dvi*2, dvi, 0));
+	dui4 = _mm_set1_epi32(dui*4);
+	dvi4 = _mm_set1_epi32(dvi*4);
+
+	for (i=0; i<16; i+=4) {
+		span_simd_put4(st, dst_col, span_simd_texidx(st, ui4, vi4));
+		dst_col += 4;
+
+		ui4 = _mm_add_epi32(ui4, dui4);
+		vi4 = _mm_add_epi32(vi4, dvi4);
+	}
+}
+
+/* Texture span with fixed point u,v stepping */
+static inline void span_simd_run_sse2(PIXEL_TYPE *dst_col, int count,
+	Uint32 ui, Uint32 vi, Uint32 dui, Uint32 dvi, const span_simd_tex_t *st)
+{
+	__m128i ui4, vi4, dui4, dvi4;
+	int i;
+
+	ui4 = _mm_set_epi32(ui+dui*3, ui+dui*2, ui+dui, ui);
+	vi4 = _mm_set_epi32(vi+dvi*3, vi+dvi*2, vi+dvi, vi);
+	dui4 = _mm_set1_epi32(dui*4);
+	dvi4 = _mm_set1_epi32(dvi*4);
+
+	for (i=0; count-i>=4; i+=4) {
+		span_simd_put4(st, dst_col, span_simd_texidx(st, ui4, vi4));
+		dst_col += 4;
+
+		ui4 = _mm_add_epi32(ui4, dui4);
+		vi4 = _mm_add_epi32(vi4, dvi4);
+	}
+
+	ui += dui*i;
+	vi += dvi*i;
+	span_simd_run_tail(dst_col, count-i, ui, vi, dui, dvi, st);
+}
@@ -0,0 +1,272 @@
+/*#define CONCAT4(x,y,z,w)	x ## y ## z ## w
+#define FNDEF4(name,bpp,perscorr,alphatest)	CONCAT4(name,bpp,perscorr,alphatest)
+#define CONCAT5(x,y,z,w,s)	x ## y ## z ## w ## s
+#define FNDEF5(name,bpp,perscorr,alphatest,simd)	CONCAT5(name,bpp,perscorr,alphatest,simd)
+
+#define BPP 32
+#define PIXEL_TYPE	Uint32
+#define TEXTURE_PIXEL_TYPE	Uint32
+#define FUNC_SUFFIX trans
+#define WRITE_ALPHATESTED_PIXEL	(trans version)
+
+	Needs span_simd.x86.inc.c
+*/
+
+void FNDEF5(draw_render_textured, BPP, _pc0, FUNC_SUFFIX, sse2) (SDL_Surface *surf, Uint8 *dst_line, sbuffer_segment_t *segment, int x1,int x2)
+{
+	span_simd_tex_t st;
+	int dxtotal, dx;
+	Uint32 ui,vi,dui,dvi;
+
+	dxtotal = segment->end.x - segment->start.x + 1;
+	dx = x1-segment->start.x;
+
+	u1 = segment->start.u * 65536.0f;
+	v1 = segment->start.v * 65536.0f;
+	u2 = segment->end.u * 65536.0f;
+	v2 = segment->end.v * 65536.0f;
+
+	du = (u2-u1)/dxtotal;
+	dv = (v2-v1)/dxtotal;
+
+	ui = u1 + du * dx;
+	vi = v1 + dv * dx;
+	dui = du;
+	dvi = dv;
+
+	span_simd_tex_init(&st, segment);
+
+	span_simd_run_sse2((PIXEL_TYPE *) dst_line, x2-x1+1, ui,vi, dui,dvi, &st);
+}
+
+void FNDEF5(draw_render_textured, BPP, _pc1, FUNC_SUFFIX, sse2) (SDL_Surface *surf, Uint8 *dst_line, sbuffer_segment_t *segment, int x1,int x2)
+{
+	span_simd_tex_t st;
+	float invw;
+	int dxtotal, dx;
+	Uint32 ui,vi,dui,dvi;
+
+	dxtotal = segment->end.x - segment->start.x + 1;
+	dx = x1-segment->start.x;
+
+	invw = 65536.0f / segment->start.w;
+	u1 = segment->start.u * invw;
+	v1 = segment->start.v * invw;
+	invw = 65536.0f / segment->end.w;
+	u2 = segment->end.u * invw;
+	v2 = segment->end.v * invw;
+
+	du = (u2-u1)/dxtotal;
+	dv = (v2-v1)/dxtotal;
+
+	ui = u1 + du * dx;
+	vi = v1 + dv * dx;
+	dui = du;
+	dvi = dv;
+
+	span_simd_tex_init(&st, segment);
+
+	span_simd_run_sse2((PIXEL_TYPE *) dst_line, x2-x1+1, ui,vi, dui,dvi, &st);
+}
+
+void FNDEF5(draw_render_textured, BPP, _pc2, FUNC_SUFFIX, sse2) (SDL_Surface *surf, Uint8 *dst_line, sbuffer_segment_t *segment, int x1,int x2)
+{
+	span_simd_tex_t st;
+	float invw;
+	float du16,dv16,dw16;
+	int dxtotal, dx, i;
+	PIXEL_TYPE *dst_col = (PIXEL_TYPE *) dst_line;
+	Uint32 ui,vi,dui,dvi;
+	float uuf, vvf, uu2f, vv2f;
+
+	dxtotal = segment->end.x - segment->start.x + 1;
+	dx = x1-segment->start.x;
+
+	u1 = segment->start.u;
+	v1 = segment->start.v;
+	w1 = segment->start.w;
+
+	u2 = segment->end.u;
+	v2 = segment->end.v;
+	w2 = segment->end.w;
+
+	du = (u2-u1)/dxtotal;
+	dv = (v2-v1)/dxtotal;
+	dw = (w2-w1)/dxtotal;
+
+	u1 += du * dx;
+	v1 += dv * dx;
+	w1 += dw * dx;
+
+	du16 = du * 16.0f;
+	dv16 = dv * 16.0f;
+	dw16 = dw * 16.0f;
+
+	span_simd_tex_init(&st, segment);
+
+	for (i=x1; x2-i>=16; i+=16) {
+		u2 = u1 + du16;
+		v2 = v1 + dv16;
+		w2 = w1 + dw16;
+
+		invw = 65536.0f / w1;
+		uuf = u1 * invw;
+		vvf = v1 * invw;
+		invw = 65536.0f / w2;
+		uu2f = u2 * invw;
+		vv2f = v2 * invw;
+
+		dui = (uu2f-uuf)/16.0f;
+		dvi = (vv2f-vvf)/16.0f;
+		ui = uuf;
+		vi = vvf;
+
+		span_simd_run16_sse2(dst_col, ui,vi, dui,dvi, &st);
+		dst_col += 16;
+
+		u1 = u2;
+		v1 = v2;
+		w1 = w2;
+	}
+
+	/* Remaining part */
+	u2 = u1 + du16;
+	v2 = v1 + dv16;
+	w2 = w1 + dw16;
+
+	invw = 65536.0f / w1;
+	uuf = u1 * invw;
+	vvf = v1 * invw;
+	invw = 65536.0f / w2;
+	uu2f = u2 * invw;
+	vv2f = v2 * invw;
+
+	dui = (uu2f-uuf)/16.0f;
+	dvi = (vv2f-vvf)/16.0f;
+	ui = uuf;
+	vi = vvf;
+
+	span_simd_run_sse2(dst_col, x2-i+1, ui,vi, dui,dvi, &st);
+}
+
+void FNDEF5(draw_render_textured, BPP, _pc3, FUNC_SUFFIX, sse2) (SDL_Surface *surf, Uint8 *dst_line, sbuffer_segment_t *segment, int x1,int x2)
+{
+	const __m128 absmask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const __m128 limit = _mm_set1_ps(2147483648.0f);
+	span_simd_tex_t st;
+	float invw;
+	int dxtotal, i;
+	Uint32 ubits, umask, vmask;
+	PIXEL_TYPE *dst_col = (PIXEL_TYPE *) dst_line;
+
+	dxtotal = segment->end.x - segment->start.x + 1;
+
+	u1 = segment->start.u;
+	v1 = segment->start.v;
+	w1 = segment->start.w;
+	u2 = segment->end.u;
+	v2 = segment->end.v;
+	w2 = segment->end.w;
+
+	du = (u2-u1)/dxtotal;
+	dv = (v2-v1)/dxtotal;
+	dw = (w2-w1)/dxtotal;
+
+	u = u1 + du * (x1-segment->start.x);
+	v = v1 + dv * (x1-segment->start.x);
+	w = w1 + dw * (x1-segment->start.x);
+
+	span_simd_tex_init(&st, segment);
+	ubits = st.ubits;
+	umask = st.umask;
+	vmask = st.vmask;
+
+	for (i=x1; x2-i>=3; i+=4) {
+		float u_1 = u+du, u_2 = u_1+du, u_3 = u_2+du;
+		float v_1 = v+dv, v_2 = v_1+dv, v_3 = v_2+dv;
+		float w_1 = w+dw, w_2 = w_1+dw, w_3 = w_2+dw;
+		__m128 invw4, pfu, pfv, outside;
+		__m128i pu, pv;
+		int j;
+
+		invw4 = _mm_div_ps(_mm_set1_ps(65536.0f), _mm_setr_ps(w, w_1, w_2, w_3));
+		pfu = _mm_mul_ps(_mm_setr_ps(u, u_1, u_2, u_3), invw4);	/* XXXXxxxx */
+		pfv = _mm_mul_ps(_mm_setr_ps(v, v_1, v_2, v_3), invw4);	/* YYYYyyyy */
+
+		u = u_3+du;
+		v = v_3+dv;
+		w = w_3+dw;
+
+		outside = _mm_or_ps(
+			_mm_cmpnlt_ps(_mm_and_ps(pfu, absmask), limit),
+			_mm_cmpnlt_ps(_mm_and_ps(pfv, absmask), limit));
+		if (_mm_movemask_ps(outside)) {
+			/* Not in signed 32 bits range, convert through 64 bits
+			   as compiled C renderer does */
+			float uu[4], vv[4];
+			Uint32 pui[4], pvi[4];
+
+			_mm_storeu_ps(uu, pfu);
+			_mm_storeu_ps(vv, pfv);
+			for (j=0; j<4; j++) {
+				pui[j] = _mm_cvttss_si64(_mm_set_ss(uu[j]));
+				pvi[j] = _mm_cvttss_si64(_mm_set_ss(vv[j]));
+			}
+			pu = _mm_loadu_si128((__m128i *) pui);
+			pv = _mm_loadu_si128((__m128i *) pvi);
+		} else {
+			pu = _mm_cvttps_epi32(pfu);
+			pv = _mm_cvttps_epi32(pfv);
+		}
+
+		span_simd_put4(&st, dst_col, span_simd_texidx(&st, pu, pv));
+		dst_col += 4;
+	}
+
+	if (st.paletted) {
+		Uint32 *palette = st.palette;
+		Uint8 *alpha_pal = st.alpha_pal;
+		Uint8 *tex_pixels = st.pixels8;
+
+		for ( ; i<=x2; i++) {
+			Uint32 pu,pv;
+
+			invw = 65536.0f / w;
+			pu = u * invw;	/* XXXXxxxx */
+			pv = v * invw;	/* YYYYyyyy */
+
+			pu >>= 16;		/* 0000XXXX */
+			pu &= umask;		/* 0000---X */
+			pv >>= 16-ubits;	/* 000YYYYy */
+			pv &= vmask;		/* 000YYYY- */
+
+			WRITE_ALPHATESTED_PIXEL
+
+			u += du;
+			v += dv;
+			w += dw;
+		}
+	} else {
+		TEXTURE_PIXEL_TYPE *tex_pixels = st.pixels;
+
+		for ( ; i<=x2; i++) {
+			Uint32 pu,pv;
+
+			invw = 65536.0f / w;
+			pu = u * invw;	/* XXXXxxxx */
+			pv = v * invw;	/* YYYYyyyy */
+
+			pu >>= 16;		/* 0000XXXX */
+			pu &= umask;		/* 0000---X */
+			pv >>= 16-ubits;	/* 000YYYYy */
+			pv &= vmask;		/* 000YYYY- */
+
+			color = tex_pixels[pv|pu];
+			WRITE_PIXEL_GONEXT(dst_col, color)
+
+			u += du;
+			v += dv;
+			w += dw;
+		}
+	}
+}
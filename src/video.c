@@ -475,61 +475,28 @@ static void countFps(void)
 /* Update background from rectangle list */
 static int updateDirtyRects(void)
 {
-	int i, x, y;
+	dirty_rects_t *rects = upload_rects[video.numfb];
+	int i, num_rects;
 
-	i = upload_rects[video.numfb]->width * upload_rects[video.numfb]->height;
+	i = rects->width * rects->height;
 	if (i>video.num_list_rects) {
 		video.list_rects = (SDL_Rect *) realloc(video.list_rects, i * sizeof(SDL_Rect));
 		video.num_list_rects = i;
 	}
 
-	i = 0;
-	for (y=0; y<upload_rects[video.numfb]->height; y++) {
-		int block_w = 0;
-		int block_x = 0;
-		int num_rows = 16;
+	/* Merge dirty blocks, then convert to pixels, clipped to screen */
+	num_rects = rects->getRects(rects, video.list_rects);
 
-		if (((y+1)<<4) > video.height) {
-			num_rows = video.height - (y<<4);
-		}
-
-		for (x=0; x<upload_rects[video.numfb]->width; x++) {
-			/* Force update on last column */
-			int block_update = (x==upload_rects[video.numfb]->width-1);
-			int num_cols = 16;
-
-			if (((x+1)<<4) > video.width) {
-				num_cols = video.width - (x<<4);
-			}
-
-			if (upload_rects[video.numfb]->markers[y*upload_rects[video.numfb]->width + x]) {
-				/* Dirty */
-				if (block_w==0) {
-					/* First dirty block, mark x pos */
-					block_x = x;
-				}
-				block_w += num_cols;
-			} else {
-				/* Non dirty, force update of previously merged blocks */
-				block_update = 1;
-			}
-
-			/* Update only if we have a dirty block */
-			if (block_update && (block_w>0)) {
-				/* Add rectangle */
-				video.list_rects[i].x = block_x<<4;
-				video.list_rects[i].y = y<<4;
-				video.list_rects[i].w = block_w;
-				video.list_rects[i].h = num_rows;
-
-				i++;
+	for (i=0; i<num_rects; i++) {
+		SDL_Rect *rect = &video.list_rects[i];
 
-				block_w = 0;
-			}
-		}
+		rect->x <<= 4;
+		rect->y <<= 4;
+		rect->w = MIN(rect->w<<4, video.width - rect->x);
+		rect->h = MIN(rect->h<<4, video.height - rect->y);
 	}
 
-	return i;
+	return num_rects;
 }
 
 static void screenShot(void)
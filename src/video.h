@@ -54,8 +54,10 @@ struct video_s {
 	SDL_Rect *list_rects;
 
 	/* OpenGL extensions */
+	int has_gl_arb_fragment_program;
 	int has_gl_arb_texture_non_power_of_two;
 	int has_gl_arb_texture_rectangle;
+	int has_gl_arb_vertex_buffer_object;
 	int has_gl_ext_paletted_texture;
 	int has_gl_ext_texture_rectangle;
 	int has_gl_nv_texture_rectangle;
@@ -214,12 +214,19 @@ static void setVideoMode(int width, int height, int bpp)
 		/* Check OpenGL extensions */
 		extensions = (char *) gl.GetString(GL_EXTENSIONS);
 
+		video.has_gl_arb_fragment_program = (strstr(extensions, "GL_ARB_fragment_program") != NULL)
+			&& (strstr(extensions, "GL_ARB_multitexture") != NULL);
+		logMsg(2, "GL_ARB_fragment_program: %d\n", video.has_gl_arb_fragment_program);
+
 		video.has_gl_arb_texture_non_power_of_two = 0 /*(strstr(extensions, "GL_ARB_texture_non_power_of_two") != NULL)*/;
 		logMsg(2, "GL_ARB_texture_non_power_of_two: %d\n", video.has_gl_arb_texture_non_power_of_two);
 
 		video.has_gl_arb_texture_rectangle = (strstr(extensions, "GL_ARB_texture_rectangle") != NULL);
 		logMsg(2, "GL_ARB_texture_rectangle: %d\n", video.has_gl_arb_texture_rectangle);
 
+		video.has_gl_arb_vertex_buffer_object = (strstr(extensions, "GL_ARB_vertex_buffer_object") != NULL);
+		logMsg(2, "GL_ARB_vertex_buffer_object: %d\n", video.has_gl_arb_vertex_buffer_object);
+
 		video.has_gl_ext_paletted_texture = 0 /*(strstr(extensions, "GL_EXT_paletted_texture") != NULL)*/;
 		logMsg(2, "GL_EXT_paletted_texture: %d\n", video.has_gl_ext_paletted_texture);
 
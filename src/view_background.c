@@ -37,6 +37,7 @@
 #include "g_common/room.h"
 #include "g_common/room_map.h"
 #include "g_common/room_door.h"
+#include "g_common/bgprefetch.h"
 #include "g_common/player.h"
 
 #include "r_common/render.h"
@@ -46,6 +47,7 @@
 
 #define KEY_TOGGLE_RENDERING	SDLK_F2
 #define KEY_TOGGLE_PERSCORR	SDLK_F3
+#define KEY_TOGGLE_THREADS	SDLK_F4
 
 /*#define KEY_RENDER_WIREFRAME	SDLK_F2
 #define KEY_RENDER_FILLED	SDLK_F3
@@ -134,6 +136,7 @@ static Sint16 anim_x=0,anim_y=0,anim_z=0;	/* base position for anim */
 static void toggle_map_mode(void);
 static void toggle_render_mode(void);
 static void toggle_pers_corr(void);
+static void toggle_threads(void);
 
 static void processPlayerMovement(void);
 static void processEnterDoor(void);
@@ -270,6 +273,9 @@ void view_background_input(SDL_Event *event)
 			case KEY_TOGGLE_PERSCORR:
 				toggle_pers_corr();
 				break;
+			case KEY_TOGGLE_THREADS:
+				toggle_threads();
+				break;
 			case KEY_RENDER_DEPTH:
 				render_depth ^= 1;
 				render.setRenderDepth(render_depth);
@@ -392,6 +398,23 @@ static void toggle_pers_corr(void)
 	}
 }
 
+static void toggle_threads(void)
+{
+	static int threads = 0;
+
+	if (params.use_opengl) {
+		return;
+	}
+
+	if (threads == 0) {
+		threads = params.threads;
+	}
+	threads = (threads>1 ? 1 : (params.threads>1 ? params.threads : 4));
+	render.set_threads(threads);
+
+	logMsg(1, "software renderer: %d thread(s)\n", threads);
+}
+
 void view_background_refresh(void)
 {
 	refresh_bg = 1;
@@ -410,6 +433,7 @@ void view_background_update(void)
 		if (reload_room) {
 			logMsg(1, "view_background: Load room\n");
 			game->setRoom(game, game->num_stage, game->num_room);
+			bgprefetch_rooms(game->room);
 			reload_room = 0;
 			reload_bg = 1;
 			/*refresh_player_pos = 1;*/
@@ -495,6 +519,7 @@ static void processPlayerMovement(void)
 		new_camera = -1;
 #endif
 		if (new_camera != -1) {
+			bgprefetch_switch(room, new_camera);
 			game->num_camera = new_camera;
 			reload_bg = 1;
 		}
@@ -519,6 +544,7 @@ static void processPlayerMovement(void)
 		new_camera = -1;
 #endif
 		if (new_camera != -1) {
+			bgprefetch_switch(room, new_camera);
 			game->num_camera = new_camera;
 			reload_bg = 1;
 		}
@@ -535,6 +561,8 @@ static void processPlayerMovement(void)
 	if (player_turnright) {
 		player->turn_right(player);
 	}
+
+	bgprefetch_update(room, game->num_camera, player->x, player->z);
 }
 
 static void processEnterDoor(void)
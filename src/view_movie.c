@@ -26,6 +26,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <SDL.h>
 #ifdef ENABLE_OPENGL
 #include <SDL_opengl.h>
@@ -43,6 +44,7 @@
 
 #include "filesystem.h"
 #include "log.h"
+#include "movie_cd.h"
 #include "view_movie.h"
 #include "clock.h"
 #include "parameters.h"
@@ -69,15 +71,8 @@
 
 #define BUFSIZE 32768
 
-#define RAW_CD_SECTOR_SIZE	2352
-#define DATA_CD_SECTOR_SIZE	2048
-
-#define CD_SYNC_SIZE 12
-#define CD_SEC_SIZE 4
-#define CD_XA_SIZE 8
-#define CD_DATA_SIZE 2048
-
-#define STR_MAGIC 0x60010180
+/* Frame displayed more than this late is counted as late */
+#define MOVIE_LATE_MS	40
 
 /* Pixel formats */
 
@@ -96,6 +91,15 @@
 #  endif
 #endif
 
+/*--- Types ---*/
+
+/* Decoded frame, converted to display format */
+typedef struct {
+	Uint8 *pixels[4];	/* sws_scale() uses 4 planes */
+	int linesize[4];
+	Sint64 pts;
+} movie_frame_t;
+
 /*--- Global variables ---*/
 
 view_movie_t view_movie;
@@ -120,7 +124,7 @@ static SDL_RWops *movie_src = NULL;
 static int audstream = -1, vidstream = -1;
 static int fps_num = 1, fps_den = 1;
 static int emul_cd;
-static int emul_cd_pos;
+static movie_cd_t movie_cd;
 
 #if SDL_VERSION_ATLEAST(2,0,0)
 /*static SDL_Texture *overlay = NULL;
@@ -129,9 +133,22 @@ static Uint8 *yPlane = NULL, *uPlane = NULL, *vPlane = NULL;*/
 static SDL_Overlay *overlay = NULL;
 #endif
 static Uint32 start_tic, current_tic;
+static Sint64 start_pts;
 
 render_texture_t *vid_texture = NULL;
 
+/* Frames decoded in advance by decode thread */
+static SDL_Thread *decode_thread = NULL;
+static SDL_mutex *decode_mutex = NULL;
+static SDL_cond *decode_cond = NULL;
+static int decode_quit, decode_eof;
+
+static movie_frame_t *frames = NULL;
+static int num_frames = 0;	/* Size of ring */
+static int first_frame, queued_frames;
+
+static int num_decoded, num_displayed, num_dropped, num_late, num_full;
+
 /*--- Functions prototypes ---*/
 
 static void movie_refresh_soft(SDL_Surface *screen);
@@ -152,8 +169,13 @@ static int64_t movie_ioseek( void *opaque, int64_t offset, int whence );
 
 static int movie_decode_video(SDL_Surface *screen);
 
-static void movie_scale_frame_soft(void);
-static void movie_scale_frame_opengl(void);
+static int decode_start(int width, int height, int dstFormat);
+static void decode_stop(void);
+static int decode_thread_func(void *data);
+static void decode_frame(movie_frame_t *frame);
+
+static void movie_upload_frame_soft(Uint8 *pixels[3], int linesize[3]);
+static void movie_upload_frame_opengl(Uint8 *pixels[3], int linesize[3]);
 
 static void movie_update_frame_soft(SDL_Rect *rect);
 static void movie_update_frame_opengl(SDL_Rect *rect);
@@ -174,7 +196,7 @@ void movie_init(void)
 	if (params.use_opengl) {
 		view_movie.refresh = movie_refresh_opengl;
 		view_movie.stop = movie_stop_opengl;
-		view_movie.scale_frame = movie_scale_frame_opengl;
+		view_movie.upload_frame = movie_upload_frame_opengl;
 		view_movie.update_frame = movie_update_frame_opengl;
 	} else {
 #	if SDL_VERSION_ATLEAST(2,0,0)
@@ -182,7 +204,7 @@ void movie_init(void)
 #	else
 		view_movie.refresh = movie_refresh_soft;
 		view_movie.stop = movie_stop_soft;
-		view_movie.scale_frame = movie_scale_frame_soft;
+		view_movie.upload_frame = movie_upload_frame_soft;
 		view_movie.update_frame = movie_update_frame_soft;
 #	endif
 	}
@@ -193,7 +215,15 @@ void movie_init(void)
 void movie_shutdown(void)
 {
 #ifdef ENABLE_MOVIES
+	decode_stop();
 	view_movie.stop();
+
+	if (decode_mutex) {
+		SDL_DestroyCond(decode_cond);
+		decode_cond = NULL;
+		SDL_DestroyMutex(decode_mutex);
+		decode_mutex = NULL;
+	}
 #endif
 }
 
@@ -362,14 +392,12 @@ static int movie_start(const char *filename, SDL_Surface *screen)
 	logMsg(2, "movie: init\n");
 
 	check_emul_cd();
-	emul_cd_pos = 0;
 
 	if (probe_movie(filename)!=0) {
 		fprintf(stderr, "Can not probe movie %s\n", filename);
 		movie_shutdown();
 		return 1;
 	}
-	emul_cd_pos = 0;
 
 	movie_src = FS_makeRWops(filename);
 	if (!movie_src) {
@@ -377,6 +405,12 @@ static int movie_start(const char *filename, SDL_Surface *screen)
 		movie_shutdown();
 		return 1;
 	}
+	if (emul_cd) {
+		if (!movie_cd_init(&movie_cd, movie_src)) {
+			movie_shutdown();
+			return 1;
+		}
+	}
 
 	if (!tmpbuf) {
 		tmpbuf = (char *) av_malloc(BUFSIZE);
@@ -475,24 +509,12 @@ static int movie_start(const char *filename, SDL_Surface *screen)
 		dstFormat = REEVENGI_RGBA_FORMAT;
 	} else {
 		dstFormat = REEVENGI_YUV_FORMAT;
-	}
 
-#if SDL_VERSION_ATLEAST(2,0,0)
-	if (vCodecCtx->pix_fmt == REEVENGI_YUV_FORMAT) {
-		create_sws_scaler = 0;
-	} else {
-		int yPlaneSz, uvPlaneSz;
-
-		yPlaneSz = vCodecCtx->width * vCodecCtx->height;
-		uvPlaneSz = vCodecCtx->width * vCodecCtx->height / 4;
-
-		view_movie.yPlane = (Uint8*) realloc(view_movie.yPlane, yPlaneSz + uvPlaneSz*2);
-		if (view_movie.yPlane) {
-			view_movie.uPlane = &view_movie.yPlane[yPlaneSz];
-			view_movie.vPlane = &view_movie.yPlane[yPlaneSz+uvPlaneSz];
+		/* Frames copied as is */
+		if (vCodecCtx->pix_fmt == REEVENGI_YUV_FORMAT) {
+			create_sws_scaler = 0;
 		}
 	}
-#endif
 
 	if (create_sws_scaler) {
 		logMsg(2, "movie: sws_getContext\n");
@@ -509,6 +531,12 @@ static int movie_start(const char *filename, SDL_Surface *screen)
 	view_movie.refresh(screen);
 
 	start_tic = 0;
+
+	if (!decode_start(vCodecCtx->width, vCodecCtx->height, dstFormat)) {
+		/* Free contexts and overlay or texture created above */
+		movie_stop();
+		return 1;
+	}
 #endif
 	return 0;
 }
@@ -517,8 +545,12 @@ void movie_stop(void)
 {
 	logMsg(2, "movie: stop\n");
 
+	/* Decode thread uses everything below */
+	decode_stop();
+
 	audstream = vidstream = -1;
 	emul_cd = 0;
+	movie_cd_shutdown(&movie_cd);
 
 	view_movie.stop();
 
@@ -595,6 +627,12 @@ static int probe_movie(const char *filename)
 	}
 
 	src = FS_makeRWops(filename);
+	if (src && emul_cd) {
+		if (!movie_cd_init(&movie_cd, src)) {
+			SDL_RWclose(src);
+			src = NULL;
+		}
+	}
 	if (src) {
 		if (movie_ioread( src, pd.buf, pd.buf_size) == pd.buf_size) {
 			AVInputFormat *fmt = av_probe_input_format(&pd, 1);
@@ -608,6 +646,7 @@ static int probe_movie(const char *filename)
 		} else {
 			fprintf(stderr, "Error reading file %s for probing\n", filename);
 		}
+		movie_cd_shutdown(&movie_cd);
 		SDL_RWclose(src);
 	} else {
 		fprintf(stderr, "Can not open file %s for probing\n", filename);
@@ -620,129 +659,32 @@ static int probe_movie(const char *filename)
 
 static int movie_ioread( void *opaque, uint8_t *buf, int buf_size )
 {
-	int size_read = 0;
-
 	if (emul_cd) {
-		/* TODO: skip non video sectors */
-		/* TODO: detect audio sectors */
-
-		logMsg(2, "cd: pos %d, read %d\n", emul_cd_pos, buf_size);
-		if (emul_cd_pos<0)
-			return -1;
-
-		while (buf_size>0) {
-			int sector_pos = emul_cd_pos % RAW_CD_SECTOR_SIZE;
-			int max_size;
-			int pos_data_type = -1; /* need to set data type */
-			int is_video = 0;
-
-			logMsg(2,"cd:  generate sector %d, pos %d, remains %d\n",
-				emul_cd_pos / RAW_CD_SECTOR_SIZE, sector_pos,
-				buf_size);
-			while ((sector_pos<CD_SYNC_SIZE) && (buf_size>0)) {
-				buf[size_read++] = ((sector_pos==0) || (sector_pos==11)) ? 0 : 0xff;
-				buf_size--;
-				sector_pos++;
-				emul_cd_pos++;
-			}
-			while ((sector_pos<CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE) && (buf_size>0)) {
-				if (sector_pos == 0x12) {
-					pos_data_type = size_read;
-				}
-				buf[size_read++] = 0;
-				buf_size--;
-				sector_pos++;
-				emul_cd_pos++;
-			}
-			while ((sector_pos<CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE+CD_DATA_SIZE) && (buf_size>0)) {
-				max_size = CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE+CD_DATA_SIZE-sector_pos;
-				max_size = (max_size>buf_size) ? buf_size : max_size;
-				logMsg(3, "cd: reading real data at 0x%08x in file, %d\n", SDL_RWtell((SDL_RWops *)opaque), max_size);
-				if (SDL_RWread((SDL_RWops *)opaque, &buf[size_read], max_size, 1)<1) {
-					return -1;
-				}
-				if ((sector_pos == CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE) && (max_size>=4)) {
-					/* Read first bytes */
-					Uint32 magic = *((Uint32 *) &buf[size_read]);
-					is_video = (SDL_SwapBE32(magic) == STR_MAGIC);
-				}
-				buf_size -= max_size;
-				size_read += max_size;
-				sector_pos += max_size;
-				emul_cd_pos += max_size;
-			}
-			while ((sector_pos<RAW_CD_SECTOR_SIZE) && (buf_size>0)) {
-				buf[size_read++] = 0;
-				buf_size--;
-				sector_pos++;
-				emul_cd_pos++;
-			}
+		return movie_cd_read(&movie_cd, buf, buf_size);
+	}
 
-			/* set data type */
-			if (pos_data_type>=0) {
-				if (is_video) {
-					logMsg(3, "cd: generate video\n");
-					buf[pos_data_type] = 0x08;
-				} else {
-					logMsg(3, "cd: generate audio\n");
-					buf[pos_data_type] = 0x04;
-				}
-			}
-		}
-	} else {
-		if (SDL_RWread((SDL_RWops *)opaque, buf, buf_size, 1)<1) {
-			return -1;
-		}
-		size_read = buf_size;
+	if (SDL_RWread((SDL_RWops *)opaque, buf, buf_size, 1)<1) {
+		return -1;
 	}
 
-	logMsg(2, "cd: after read: pos %d, read %d\n", emul_cd_pos, size_read);
-	return size_read;
+	return buf_size;
 }
 
 static int64_t movie_ioseek( void *opaque, int64_t offset, int whence )
 {
-	int64_t new_offset = offset;
-
-	logMsg(2, "cd: ioseek %d, %d\n", offset, whence);
+	logMsg(2, "cd: ioseek %d, %d\n", (int) offset, whence);
 
 	if (emul_cd) {
-		int sector_num, sector_pos;
-		int64_t file_offset;
-
-		switch(whence) {
-			case RW_SEEK_SET:
-			case RW_SEEK_END:
-				emul_cd_pos = (int) offset;
-				break;
-			case RW_SEEK_CUR:
-				emul_cd_pos += (int) offset;
-				break;
-		}
-
-		sector_num = emul_cd_pos / RAW_CD_SECTOR_SIZE;
-		sector_pos = emul_cd_pos % RAW_CD_SECTOR_SIZE;
-
-		if (sector_pos<CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE) {
-			sector_pos = 0;
-		} else if ((sector_pos>=CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE) &&
-			  (sector_pos<CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE+CD_DATA_SIZE))
-		{
-			sector_pos -= CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE;
-		} else if (sector_pos>=CD_SYNC_SIZE+CD_SEC_SIZE+CD_XA_SIZE+CD_DATA_SIZE) {
-			sector_pos = 0;
-			sector_num++;
+#ifdef ENABLE_MOVIES
+		if (whence & AVSEEK_SIZE) {
+			return movie_cd_length(&movie_cd);
 		}
-
-		file_offset = (sector_num * DATA_CD_SECTOR_SIZE) + sector_pos;
-		SDL_RWseek((SDL_RWops *)opaque, file_offset, whence);
-
-		new_offset = emul_cd_pos;
-	} else {
-		new_offset = SDL_RWseek((SDL_RWops *)opaque, offset, whence);
+		whence &= ~AVSEEK_FORCE;
+#endif
+		return movie_cd_seek(&movie_cd, offset, whence);
 	}
 
-	return new_offset;
+	return SDL_RWseek((SDL_RWops *)opaque, offset, whence);
 }
 
 static int movie_decode_video(SDL_Surface *screen)
@@ -750,64 +692,63 @@ static int movie_decode_video(SDL_Surface *screen)
 	int retval = 0;
 #ifdef ENABLE_MOVIES
 	AVCodecContext *vCodecCtx = (AVCodecContext *) view_movie.vCodecCtx;
-	AVFrame *decoded_frame = (AVFrame *) view_movie.decoded_frame;
-	AVPacket pkt;
-	int err, got_pic = 0;
-	int current_frame;
+	movie_frame_t *frame = NULL;
+	Sint64 current_frame = 0;
+	int num_skip = 0, eof;
 
-	if (start_tic == 0) {
-		current_tic = start_tic = clockGet();
-	} else {
-		current_tic = clockGet();
+	if (!fmt_ctx || !decode_thread) {
+		return retval;
 	}
-	/* 33333/1000000 = 0.033333s per frame or 33.333ms per frame  */
-	current_frame = ((current_tic-start_tic) * fps_den) / (fps_num * 1000);
 
-	if (!fmt_ctx) {
-		return retval;
+	SDL_LockMutex(decode_mutex);
+	if (queued_frames>0) {
+		if (start_tic == 0) {
+			/* Start clock when first frame is ready */
+			current_tic = start_tic = clockGet();
+			start_pts = frames[first_frame].pts;
+		} else {
+			current_tic = clockGet();
+		}
+		/* 33333/1000000 = 0.033333s per frame or 33.333ms per frame  */
+		current_frame = start_pts + ((Sint64) (current_tic-start_tic) * fps_den) / (fps_num * 1000);
+
+		/* Display most recent frame whose time has come, drop older ones */
+		if (frames[first_frame].pts <= current_frame) {
+			while ((num_skip+1 < queued_frames)
+			       && (frames[(first_frame+num_skip+1) % num_frames].pts <= current_frame))
+			{
+				++num_skip;
+			}
+			frame = &frames[(first_frame+num_skip) % num_frames];
+		}
 	}
+	eof = decode_eof && (queued_frames == 0);
+	SDL_UnlockMutex(decode_mutex);
 
-	logMsg(2, "movie: av_read_frame %p %p at 0x%08x\n", fmt_ctx, &pkt, emul_cd_pos);
-	err = av_read_frame(fmt_ctx, &pkt);
-	if (err<0) {
-		logMsg(1, "movie: eof\n");
+	if (eof) {
 		movie_stop();
 		return retval;
 	}
 
-	if (pkt.stream_index == vidstream) {
-		/* Decode video packet */
-		logMsg(2, "movie: avcodec_send_packet %p %p\n", vCodecCtx, &pkt);
-		err = avcodec_send_packet(vCodecCtx, &pkt);
+	/* Frame stays in ring until uploaded */
+	if (frame) {
+		int late_ms = (int) (((current_frame - frame->pts) * 1000 * fps_num) / fps_den);
 
-		if (err<0) {
-			fprintf(stderr, "Error decoding frame: %d\n", err);
-		} else {
-			err = avcodec_receive_frame(vCodecCtx, decoded_frame);
-			if (err==0) {
-				got_pic=1;
-			}
-			retval = 1;
-		}
-	} else if (pkt.stream_index == audstream) {
-		logMsg(2, "movie: audio packet\n");
-	} else {
-		logMsg(2, "movie: unknown packet\n");
-	}
+		logMsg(2, "movie: upload frame %d, %d dropped\n", (int) frame->pts, num_skip);
+		view_movie.upload_frame(frame->pixels, frame->linesize);
 
-	/* Scale and decode frame */
-	if (got_pic) {
-		if (current_frame < decoded_frame->pts) {
-			int delay_frame = decoded_frame->pts - current_frame;
-			int delay_ms = (delay_frame * 1000 * fps_num) / fps_den;
-			if (delay_ms>0) {
-				/*logMsg(2, "movie: wait %d\n", delay_ms);*/
-				SDL_Delay(delay_ms);
-			}
+		SDL_LockMutex(decode_mutex);
+		first_frame = (first_frame+num_skip+1) % num_frames;
+		queued_frames -= num_skip+1;
+		num_dropped += num_skip;
+		++num_displayed;
+		if (late_ms > MOVIE_LATE_MS) {
+			++num_late;
 		}
+		SDL_CondBroadcast(decode_cond);
+		SDL_UnlockMutex(decode_mutex);
 
-		logMsg(2, "movie: decode and scale frame\n");
-		view_movie.scale_frame();
+		retval = 1;
 	}
 
 	/* Display current decoded frame */
@@ -833,36 +774,236 @@ static int movie_decode_video(SDL_Surface *screen)
 		/*logMsg(2, "movie: update frame to %d,%d %dx%d\n",rect.x,rect.y,rect.w,rect.h);*/
 		view_movie.update_frame(&rect);
 	}
-
-	av_packet_unref(&pkt);
 #endif
 
 	return retval;
 }
 
-static void movie_scale_frame_soft(void)
+/* Allocate ring of frames, start decoding in a thread */
+
+static int decode_start(int width, int height, int dstFormat)
 {
-#if defined(ENABLE_MOVIES) && (!SDL_VERSION_ATLEAST(2,0,0))
+#ifdef ENABLE_MOVIES
+	int i;
+
+	if (!decode_mutex) {
+		decode_mutex = SDL_CreateMutex();
+		decode_cond = SDL_CreateCond();
+		if (!decode_mutex || !decode_cond) {
+			fprintf(stderr, "movie: can not create mutex: %s\n", SDL_GetError());
+			return 0;
+		}
+	}
+
+	num_frames = params.movie_frames;
+	frames = (movie_frame_t *) calloc(num_frames, sizeof(movie_frame_t));
+	if (!frames) {
+		fprintf(stderr, "movie: can not allocate memory for %d frames\n", num_frames);
+		return 0;
+	}
+
+	for (i=0; i<num_frames; i++) {
+		movie_frame_t *frame = &frames[i];
+
+		if (dstFormat == REEVENGI_RGBA_FORMAT) {
+			frame->linesize[0] = width*4;
+			frame->pixels[0] = (Uint8 *) malloc(frame->linesize[0]*height);
+		} else {
+			int uv_size = ((width+1)>>1) * ((height+1)>>1);
+
+			frame->linesize[0] = width;
+			frame->linesize[1] = frame->linesize[2] = (width+1)>>1;
+			frame->pixels[0] = (Uint8 *) malloc(width*height + uv_size*2);
+			if (frame->pixels[0]) {
+				frame->pixels[1] = frame->pixels[0] + width*height;
+				frame->pixels[2] = frame->pixels[1] + uv_size;
+			}
+		}
+
+		if (!frame->pixels[0]) {
+			fprintf(stderr, "movie: can not allocate memory for %d frames\n", num_frames);
+			decode_stop();
+			return 0;
+		}
+	}
+
+	first_frame = queued_frames = 0;
+	decode_quit = decode_eof = 0;
+	num_decoded = num_displayed = num_dropped = num_late = num_full = 0;
+
+#if SDL_VERSION_ATLEAST(2,0,0)
+	decode_thread = SDL_CreateThread(decode_thread_func, "movie", NULL);
+#else
+	decode_thread = SDL_CreateThread(decode_thread_func, NULL);
+#endif
+	if (!decode_thread) {
+		fprintf(stderr, "movie: can not create thread: %s\n", SDL_GetError());
+		decode_stop();
+		return 0;
+	}
+#endif
+	return 1;
+}
+
+static void decode_stop(void)
+{
+	int i;
+
+	if (decode_thread) {
+		SDL_LockMutex(decode_mutex);
+		decode_quit = 1;
+		SDL_CondBroadcast(decode_cond);
+		SDL_UnlockMutex(decode_mutex);
+
+		SDL_WaitThread(decode_thread, NULL);
+		decode_thread = NULL;
+
+		logMsg(1, "movie: %d frames decoded, %d displayed, %d dropped, %d late, decoder waited %d times\n",
+			num_decoded, num_displayed, num_dropped, num_late, num_full);
+	}
+
+	if (frames) {
+		for (i=0; i<num_frames; i++) {
+			free(frames[i].pixels[0]);
+		}
+		free(frames);
+		frames = NULL;
+	}
+	num_frames = 0;
+}
+
+/* Read packets, decode and convert video frames in ring */
+
+static int decode_thread_func(void *data)
+{
+#ifdef ENABLE_MOVIES
+	AVCodecContext *vCodecCtx = (AVCodecContext *) view_movie.vCodecCtx;
+	AVFrame *decoded_frame = (AVFrame *) view_movie.decoded_frame;
+	AVPacket pkt;
+	int err, quit = 0;
+
+	while (!quit) {
+		logMsg(2, "movie: av_read_frame %p %p at 0x%08x\n", fmt_ctx, &pkt, (int) movie_cd.pos);
+		err = av_read_frame(fmt_ctx, &pkt);
+		if (err<0) {
+			logMsg(1, "movie: eof\n");
+			break;
+		}
+
+		if (pkt.stream_index == vidstream) {
+			/* Decode video packet */
+			logMsg(2, "movie: avcodec_send_packet %p %p\n", vCodecCtx, &pkt);
+			err = avcodec_send_packet(vCodecCtx, &pkt);
+			if (err<0) {
+				fprintf(stderr, "Error decoding frame: %d\n", err);
+			}
+
+			while ((err>=0) && !quit && (avcodec_receive_frame(vCodecCtx, decoded_frame) == 0)) {
+				movie_frame_t *frame;
+
+				/* Wait for a free frame in ring */
+				SDL_LockMutex(decode_mutex);
+				if (queued_frames == num_frames) {
+					++num_full;
+				}
+				while ((queued_frames == num_frames) && !decode_quit) {
+					SDL_CondWait(decode_cond, decode_mutex);
+				}
+				frame = &frames[(first_frame+queued_frames) % num_frames];
+				quit = decode_quit;
+				SDL_UnlockMutex(decode_mutex);
+
+				if (quit) {
+					break;
+				}
+
+				logMsg(2, "movie: decode and scale frame\n");
+				decode_frame(frame);
+
+				SDL_LockMutex(decode_mutex);
+				++queued_frames;
+				++num_decoded;
+				SDL_UnlockMutex(decode_mutex);
+			}
+		} else if (pkt.stream_index == audstream) {
+			logMsg(2, "movie: audio packet\n");
+		} else {
+			logMsg(2, "movie: unknown packet\n");
+		}
+
+		av_packet_unref(&pkt);
+
+		SDL_LockMutex(decode_mutex);
+		quit = decode_quit;
+		SDL_UnlockMutex(decode_mutex);
+	}
+
+	SDL_LockMutex(decode_mutex);
+	decode_eof = 1;
+	SDL_UnlockMutex(decode_mutex);
+#endif
+	return 0;
+}
+
+/* Convert decoded frame to display format */
+
+static void decode_frame(movie_frame_t *frame)
+{
+#ifdef ENABLE_MOVIES
 	AVCodecContext *vCodecCtx = (AVCodecContext *) view_movie.vCodecCtx;
 	struct SwsContext *img_convert_ctx = (struct SwsContext *) view_movie.img_convert_ctx;
 	AVFrame *decoded_frame = (AVFrame *) view_movie.decoded_frame;
-	uint8_t *pixels[4]={NULL,NULL,NULL,NULL};
-	int linesize[4]={0,0,0,0};
+	int i, y;
 
-	SDL_LockYUVOverlay(overlay);
+	frame->pts = decoded_frame->pts;
+	if (frame->pts == AV_NOPTS_VALUE) {
+		frame->pts = decoded_frame->best_effort_timestamp;
+	}
 
-	pixels[0] = overlay->pixels[0];
-	pixels[1] = overlay->pixels[2];
-	pixels[2] = overlay->pixels[1];
+	if (img_convert_ctx) {
+		sws_scale(img_convert_ctx,
+			(const uint8_t * const*) decoded_frame->data, decoded_frame->linesize,
+			0, vCodecCtx->height,
+			frame->pixels, frame->linesize);
+		return;
+	}
 
-	linesize[0] = overlay->pitches[0];
-	linesize[1] = overlay->pitches[2];
-	linesize[2] = overlay->pitches[1];
+	/* Same format, copy planes */
+	for (i=0; i<3; i++) {
+		int height = (i==0) ? vCodecCtx->height : (vCodecCtx->height+1)>>1;
 
-	sws_scale(img_convert_ctx,
-		(const uint8_t * const*) decoded_frame->data, decoded_frame->linesize,
-		0, vCodecCtx->height,
-		pixels, linesize);
+		for (y=0; y<height; y++) {
+			memcpy(frame->pixels[i] + y*frame->linesize[i],
+				decoded_frame->data[i] + y*decoded_frame->linesize[i],
+				frame->linesize[i]);
+		}
+	}
+#endif
+}
+
+static void movie_upload_frame_soft(Uint8 *pixels[3], int linesize[3])
+{
+#if defined(ENABLE_MOVIES) && (!SDL_VERSION_ATLEAST(2,0,0))
+	AVCodecContext *vCodecCtx = (AVCodecContext *) view_movie.vCodecCtx;
+	int i, y;
+
+	if (!overlay) {
+		return;
+	}
+
+	SDL_LockYUVOverlay(overlay);
+
+	for (i=0; i<3; i++) {
+		/* YV12 overlay: V plane before U plane */
+		int plane = (i==0) ? 0 : 3-i;
+		int width = (i==0) ? vCodecCtx->width : (vCodecCtx->width+1)>>1;
+		int height = (i==0) ? vCodecCtx->height : (vCodecCtx->height+1)>>1;
+
+		for (y=0; y<height; y++) {
+			memcpy(overlay->pixels[plane] + y*overlay->pitches[plane],
+				pixels[i] + y*linesize[i], width);
+		}
+	}
 
 	SDL_UnlockYUVOverlay(overlay);
 #endif
@@ -875,22 +1016,20 @@ static void movie_update_frame_soft(SDL_Rect *rect)
 #endif
 }
 
-static void movie_scale_frame_opengl(void)
+static void movie_upload_frame_opengl(Uint8 *pixels[3], int linesize[3])
 {
 #if defined(ENABLE_MOVIES) && defined(ENABLE_OPENGL)
 	AVCodecContext *vCodecCtx = (AVCodecContext *) view_movie.vCodecCtx;
-	struct SwsContext *img_convert_ctx = (struct SwsContext *) view_movie.img_convert_ctx;
-	AVFrame *decoded_frame = (AVFrame *) view_movie.decoded_frame;
-	uint8_t *pixels[4]={NULL,NULL,NULL,NULL};
-	int linesize[4]={0,0,0,0};
+	int y;
 
-	pixels[0] = vid_texture->pixels;
-	linesize[0] = vid_texture->pitch;
+	if (!vid_texture) {
+		return;
+	}
 
-	sws_scale(img_convert_ctx,
-		(const uint8_t * const*) decoded_frame->data, decoded_frame->linesize,
-		0, vCodecCtx->height,
-		pixels, linesize);
+	for (y=0; y<vCodecCtx->height; y++) {
+		memcpy((Uint8 *) vid_texture->pixels + y*vid_texture->pitch,
+			pixels[0] + y*linesize[0], vCodecCtx->width*4);
+	}
 
 	vid_texture->update(vid_texture, 0);
 #endif
@@ -30,12 +30,11 @@ struct view_movie_s {
 	void *img_convert_ctx;	/* struct SwsContext * */
 	void *decoded_frame; /* AVFrame * */
 
-	/*SDL2*/
-	Uint8 *yPlane, *uPlane, *vPlane;
-
 	void (*refresh)(SDL_Surface *screen);
 	void (*stop)(void);
-	void (*scale_frame)(void);
+	/* Copy frame converted by decode thread: RGBA for OpenGL, YUV planes
+	   otherwise */
+	void (*upload_frame)(Uint8 *pixels[3], int linesize[3]);
 	void (*update_frame)(SDL_Rect *rect);
 };
 
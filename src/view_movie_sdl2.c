@@ -59,7 +59,7 @@ static SDL_Texture *overlay = NULL;
 
 static void movie_refresh_soft_sdl2(SDL_Surface *screen);
 static void movie_stop_soft_sdl2(void);
-static void movie_scale_frame_soft_sdl2(void);
+static void movie_upload_frame_soft_sdl2(Uint8 *pixels[3], int linesize[3]);
 static void movie_update_frame_soft_sdl2(SDL_Rect *rect);
 
 /*--- Functions ---*/
@@ -68,7 +68,7 @@ void view_movie_init_sdl2(void)
 {
 	view_movie.refresh = movie_refresh_soft_sdl2;
 	view_movie.stop = movie_stop_soft_sdl2;
-	view_movie.scale_frame = movie_scale_frame_soft_sdl2;
+	view_movie.upload_frame = movie_upload_frame_soft_sdl2;
 	view_movie.update_frame = movie_update_frame_soft_sdl2;
 }
 
@@ -87,63 +87,43 @@ static void movie_refresh_soft_sdl2(SDL_Surface *screen)
 
 	logMsg(1, "movie: create overlay %dx%d\n", vCodecCtx->width, vCodecCtx->height);
 
-	overlay = SDL_CreateTexture(video.renderer, SDL_PIXELFORMAT_YV12,
-		SDL_TEXTUREACCESS_STATIC/*STREAMING*/,
+	/* Same planes order as decoded YUV420P frames, updated each frame.
+	   Renderer does colour conversion and scaling when drawing */
+	overlay = SDL_CreateTexture(video.renderer, SDL_PIXELFORMAT_IYUV,
+		SDL_TEXTUREACCESS_STREAMING,
 		vCodecCtx->width, vCodecCtx->height);
 	if (!overlay) {
-		fprintf(stderr, "Can not create overlay\n");
+		fprintf(stderr, "Can not create overlay: %s\n", SDL_GetError());
 	}
 }
 
 static void movie_stop_soft_sdl2(void)
 {
-	if (view_movie.yPlane) {
-		free(view_movie.yPlane);
-		view_movie.yPlane = view_movie.uPlane = view_movie.vPlane = NULL;
-	}
-
 	if (overlay) {
 		SDL_DestroyTexture(overlay);
 		overlay=NULL;
 	}
 }
 
-static void movie_scale_frame_soft_sdl2(void)
+static void movie_upload_frame_soft_sdl2(Uint8 *pixels[3], int linesize[3])
 {
-	AVCodecContext *vCodecCtx = (AVCodecContext *) view_movie.vCodecCtx;
-	struct SwsContext *img_convert_ctx = (struct SwsContext *) view_movie.img_convert_ctx;
-	AVFrame *decoded_frame = (AVFrame *) view_movie.decoded_frame;
-	uint8_t *pixels[4]={NULL,NULL,NULL,NULL};
-	int linesize[4]={0,0,0,0};
-
-	if (!img_convert_ctx) {
-		SDL_UpdateYUVTexture(overlay, NULL,
-			decoded_frame->data[0], decoded_frame->linesize[0],
-			decoded_frame->data[1], decoded_frame->linesize[1],
-			decoded_frame->data[2], decoded_frame->linesize[2]);
-	} else {
-		pixels[0] = view_movie.yPlane;
-		pixels[1] = view_movie.uPlane;
-		pixels[2] = view_movie.vPlane;
-
-		linesize[0] = vCodecCtx->width;
-		linesize[1] = vCodecCtx->width >> 1;
-		linesize[2] = vCodecCtx->width >> 1;
-
-		sws_scale(img_convert_ctx,
-			(const uint8_t * const*) decoded_frame->data, decoded_frame->linesize,
-			0, vCodecCtx->height,
-			pixels, linesize);
-
-		SDL_UpdateYUVTexture(overlay, NULL,
-			pixels[0], linesize[0],
-			pixels[1], linesize[1],
-			pixels[2], linesize[2]);
+	if (!overlay) {
+		return;
+	}
+
+	if (SDL_UpdateYUVTexture(overlay, NULL,
+		pixels[0], linesize[0], pixels[1], linesize[1],
+		pixels[2], linesize[2])<0) {
+		logMsg(1, "movie: can not update overlay: %s\n", SDL_GetError());
 	}
 }
 
 static void movie_update_frame_soft_sdl2(SDL_Rect *rect)
 {
+	if (!overlay) {
+		return;
+	}
+
 	SDL_RenderCopy(video.renderer, overlay, NULL, rect);
 }
 